@@ -1,3 +1,4 @@
+#include <process.h>
 #include "AnalyzeDialog.h"
 #include <QBoxLayout>
 #include <QCoreApplication>
@@ -5,6 +6,8 @@
 #include <QDir>
 #include <QTextStream>
 
+const char* BUILTIN_ENGINE = "PolarChess (built in)";
+
 AnalyzeDialog::AnalyzeDialog(QWidget* parent, Computer* c, Database* t, Database* w, Database* b, EngineWindow* e, BoardWindow* bw, Path* p)
 	:QDialog(parent)
 {
@@ -21,6 +24,11 @@ AnalyzeDialog::AnalyzeDialog(QWidget* parent, Computer* c, Database* t, Database
 	path = p;
 	running = false;
 	currentPosition = 0;
+	builtin = NULL;
+	hBuiltin = NULL;
+	builtinStop = false;
+	builtinTime = 0;
+	InitializeCriticalSection(&cs);
 
 	vbox = new QVBoxLayout;
 	hbox = new QHBoxLayout;
@@ -31,6 +39,7 @@ AnalyzeDialog::AnalyzeDialog(QWidget* parent, Computer* c, Database* t, Database
 	QFileInfoList qfil = QDir(iniPath, "*.eng").entryInfoList(QDir::NoFilter, QDir::Name | QDir::IgnoreCase);
 	for (int i = 0; i < qfil.size(); i++)
 		engineList->addItem(qfil[i].completeBaseName());
+	engineList->addItem(BUILTIN_ENGINE);
 	if (compDB->enginelist.size())
 		engineList->setCurrentText(compDB->enginelist.at(0));
 	dbList = new QComboBox;
@@ -85,6 +94,12 @@ AnalyzeDialog::AnalyzeDialog(QWidget* parent, Computer* c, Database* t, Database
 
 }
 
+AnalyzeDialog::~AnalyzeDialog()
+{
+	stopBuiltin();
+	DeleteCriticalSection(&cs);
+}
+
 void AnalyzeDialog::startAnalyze()
 {
 	int i;
@@ -100,17 +115,29 @@ void AnalyzeDialog::startAnalyze()
 		return;
 	boardwindow->setPosition(positions[currentPosition]);
 	emit setPosition(positions[currentPosition]);
-	connect(enginewindow, SIGNAL(enginePV(ComputerDBEngine&, ChessBoard&)), this, SLOT(enginePV(ComputerDBEngine&, ChessBoard&)));
-	enginewindow->startAutomated(positions[currentPosition], eng, timeToUse->value());
 	running = true;
 	stopButton->setDisabled(false);
 	startButton->setDisabled(true);
+	if (eng == BUILTIN_ENGINE)
+	{
+		startBuiltin();
+		return;
+	}
+	connect(enginewindow, SIGNAL(enginePV(ComputerDBEngine&, ChessBoard&)), this, SLOT(enginePV(ComputerDBEngine&, ChessBoard&)));
+	enginewindow->startAutomated(positions[currentPosition], eng, timeToUse->value());
 }
 
 void AnalyzeDialog::stopAnalyze()
 {
-	disconnect(enginewindow, nullptr, nullptr, nullptr);
-	enginewindow->stopAutomated();
+	if (builtin)
+	{
+		stopBuiltin();
+	}
+	else
+	{
+		disconnect(enginewindow, nullptr, nullptr, nullptr);
+		enginewindow->stopAutomated();
+	}
 	running = false;
 	stopButton->setDisabled(true);
 	startButton->setDisabled(false);
@@ -205,4 +232,92 @@ void AnalyzeDialog::updateAnalyzed()
 	QString qs;
 	QTextStream(&qs) << tr("Analyzed: ") << currentPosition << "/" << positions.size();
 	posLabel->setText(qs);
+}
+
+// The positions are searched on one thread with the time to use for each.
+// The results are added to the computer database from the gui thread.
+void AnalyzeDialog::startBuiltin()
+{
+	builtinResults.clear();
+	builtinTime = timeToUse->value() * 1000;
+	builtinStop = false;
+	builtin = new SearchSession;
+	hBuiltin = (HANDLE)_beginthreadex(NULL, 0, builtinSearch, this, 0, NULL);
+}
+
+void AnalyzeDialog::stopBuiltin()
+{
+	if (!builtin)
+		return;
+	builtinStop = true;
+	// A search started after the first stop is stopped by the next.
+	do
+		builtin->stop();
+	while (WaitForSingleObject(hBuiltin, 100) == WAIT_TIMEOUT);
+	CloseHandle(hBuiltin);
+	hBuiltin = NULL;
+	delete builtin;
+	builtin = NULL;
+}
+
+unsigned __stdcall AnalyzeDialog::builtinSearch(void* lpv)
+{
+	AnalyzeDialog* ad = (AnalyzeDialog*)lpv;
+	SearchLimits limits;
+	ComputerDBEngine ce;
+	ChessBoard cb;
+	int i;
+
+	limits.moveTime = ad->builtinTime;
+	for (i = ad->currentPosition; i < ad->positions.size(); i++)
+	{
+		if (ad->builtinStop)
+			break;
+		cb = ad->positions[i];
+		ad->builtin->setPosition(cb);
+		ce.clear();
+		// A mate or stalemate has no move, the empty result only moves on
+		// to the next position.
+		if (!ad->builtin->go(limits).empty())
+		{
+			const SearchInfo& info = ad->builtin->lastInfo();
+			ce.engine = BUILTIN_ENGINE;
+			// The database has the score from white.
+			ce.cp = (cb.toMove == WHITE) ? info.score : -info.score;
+			ce.depth = info.depth;
+			ce.time = (int)info.time;
+			ce.pv = info.pv;
+		}
+		if (ad->builtinStop)
+			break;
+		EnterCriticalSection(&ad->cs);
+		ad->builtinResults.push_back(ce);
+		LeaveCriticalSection(&ad->cs);
+		QMetaObject::invokeMethod(ad, "builtinResult", Qt::QueuedConnection);
+	}
+	return 0;
+}
+
+void AnalyzeDialog::builtinResult()
+{
+	QVector<ComputerDBEngine> results;
+	int i;
+	EnterCriticalSection(&cs);
+	results.swap(builtinResults);
+	LeaveCriticalSection(&cs);
+	if (!running)
+		return;
+	for (i = 0; i < results.size(); i++)
+	{
+		if (!results[i].engine.isEmpty())
+			compDB->add(results[i], positions[currentPosition]);
+		++currentPosition;
+	}
+	updateAnalyzed();
+	if (currentPosition >= positions.size())
+	{
+		stopAnalyze();
+		return;
+	}
+	boardwindow->setPosition(positions[currentPosition]);
 }
\ No newline at end of file
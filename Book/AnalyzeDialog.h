@@ -12,6 +12,7 @@
 #include "Database.h"
 #include "EngineWindow.h"
 #include "Path.h"
+#include "../Engine/SearchSession.h"
 
 class AnalyzeDialog: public QDialog
 {
@@ -23,16 +24,21 @@ public slots:
 	void closeAnalyze();
 	void pathChanged(bool);
 	void enginePV(ComputerDBEngine&, ChessBoard&);
+	void builtinResult();
 
 signals:
 	void setPosition(const ChessBoard&);
 
 public:
 	AnalyzeDialog(QWidget* parent, Computer*, Database*, Database*, Database*, EngineWindow*, BoardWindow*, Path*);
+	virtual ~AnalyzeDialog();
 
 private:
 	void collectPositions();
 	void updateAnalyzed();
+	void startBuiltin();
+	void stopBuiltin();
+	static unsigned __stdcall builtinSearch(void* lpv);
 	QComboBox* dbList;
 	QComboBox* engineList;
 	QSpinBox* timeToUse;
@@ -51,4 +57,12 @@ private:
 	Path* path;
 	bool running;
 	int currentPosition;
+	// The engine in this program is searched on a thread here instead of
+	// in the engine window.
+	SearchSession* builtin;
+	HANDLE hBuiltin;
+	volatile bool builtinStop;
+	int builtinTime; // ms
+	CRITICAL_SECTION cs;
+	QVector<ComputerDBEngine> builtinResults;
 };
\ No newline at end of file
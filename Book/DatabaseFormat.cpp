@@ -434,8 +434,6 @@ void ComputerDBEntry::convertFromEngineList(QString& data, ChessBoard& cb)
 	data.clear();
 	char sz[16];
 	std::string s;
-	ChessBoard b;
-	int mit;
 	QVector<ComputerDBEngine>::iterator it = enginelist.begin();
 	while (it != enginelist.end())
 	{
@@ -449,16 +447,8 @@ void ComputerDBEntry::convertFromEngineList(QString& data, ChessBoard& cb)
 		data += "|";
 		data += itoa(it->time, sz, 10);
 		data += "|";
-		b = cb;
-		for (mit = 0; mit < it->pv.size(); mit)
-		{
-			s = b.makeMoveText(it->pv[mit], FIDE);
-			if (mit > 0)
-				data += " ";
-			data += s.c_str();
-			b.doMove(it->pv[mit], false);
-			++mit;
-		}
+		cb.makeMovesText(it->pv, s, FIDE);
+		data += s.c_str();
 		++it;
 	}
 }
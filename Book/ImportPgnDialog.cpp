@@ -12,7 +12,7 @@
 #include <QMessageBox>
 #include <QProgressDialog>
 #include <QApplication>
-#include "../Common/Pgn.h"
+#include "../Common/PgnPipeline.h"
 #include "../Common/ChessGame.h"
 
 ImportPgnDialog::ImportPgnDialog(QWidget *parent)
@@ -97,81 +97,78 @@ void ImportPgnDialog::importPgnFile(QWidget* parent, Database* db, QString& pgnf
 	progress.setWindowModality(Qt::WindowModal);
 	progress.setMinimumDuration(0);
 	progress.show();
-	Pgn pgn;
-	if (!pgn.open(pgnfile.toStdString(), true))
+	PgnPipeline pgn;
+	pgn.maxmove = moves;
+	if (!pgn.start(pgnfile.toStdString()))
 	{
 		QMessageBox msgBox(parent);
 		msgBox.setText("Can't open pgn file: " + pgnfile);
 		progress.setValue(100);
 		return;
 	}
-	int games = pgn.size();
-	progress.setMaximum(games);
-	if (games < 1)
-	{
-		QMessageBox msgBox(parent);
-		msgBox.setText("No games in the pgn file: " + pgnfile);
-		pgn.close();
-		progress.setValue(games);
-		return;
-	}
+	int size = (int)(pgn.size() / 1024);
+	progress.setMaximum(size);
 	ChessGame game;
 	BookDBEntry bde;
 	BookDBMove bdm;
-	int i, j, k, l;
+	DWORD index;
+	int games, j, k, l;
 
-	for (i = 0; i < games; i++)
+	// The games are parsed by the pipeline threads while they are added.
+	for (games = 0; pgn.next(game, index); games++)
 	{
-		progress.setValue(i);
+		progress.setValue((int)(pgn.position() / 1024));
 		QApplication::processEvents();
 		if (progress.wasCanceled())
 		{
-			pgn.close();
+			pgn.stop();
 			return;
 		}
-		if (pgn.read(game, i + 1, moves))
+		for (j = 0; j < game.position.size(); j++)
 		{
-			for (j = 0; j < game.position.size(); j++)
+			bde = db->find(game.position[j].board);
+			if (comment && !game.position[j].comment.empty())
+			{
+				if (!bde.comment.isEmpty())
+					bde.comment = "\n";
+				bde.comment += QString::fromLatin1(game.position[j].comment.c_str());
+			}
+			for (k = 0; k < game.position[j].move.size(); k++)
 			{
-				bde = db->find(game.position[j].board);
-				if (comment && !game.position[j].comment.empty())
+				bdm.clear();
+				bdm.move = game.position[j].move[k].move;
+				if (!bde.moveExist(bdm.move))
 				{
-					if (!bde.comment.isEmpty())
-						bde.comment = "\n";
-					bde.comment += QString::fromLatin1(game.position[j].comment.c_str());
+					if (comment && !game.position[j].move[k].comment.empty())
+						bdm.comment = QString::fromLatin1(game.position[j].move[k].comment.c_str());
+					bde.movelist.push_back(bdm);
 				}
-				for (k = 0; k < game.position[j].move.size(); k++)
+				else
 				{
-					bdm.clear();
-					bdm.move = game.position[j].move[k].move;
-					if (!bde.moveExist(bdm.move))
+					for (l = 0; l < bde.movelist.size(); l++)
 					{
-						if (comment && !game.position[j].move[k].comment.empty())
-							bdm.comment = QString::fromLatin1(game.position[j].move[k].comment.c_str());
-						bde.movelist.push_back(bdm);
-					}
-					else
-					{
-						for (l = 0; l < bde.movelist.size(); l++)
+						if (bdm.move == bde.movelist[l].move)
 						{
-							if (bdm.move == bde.movelist[l].move)
+							if (comment && !game.position[j].move[k].comment.empty())
 							{
-								if (comment && !game.position[j].move[k].comment.empty())
-								{
-									if (bde.movelist[l].comment.isEmpty())
-										bde.movelist[l].comment = QString::fromLatin1(game.position[j].move[k].comment.c_str());
-								}
-								break;
+								if (bde.movelist[l].comment.isEmpty())
+									bde.movelist[l].comment = QString::fromLatin1(game.position[j].move[k].comment.c_str());
 							}
+							break;
 						}
 					}
-
 				}
-				db->add(bde);
+
 			}
+			db->add(bde);
 		}
 	}
-	progress.setValue(games);
+	if (games < 1)
+	{
+		QMessageBox msgBox(parent);
+		msgBox.setText("No games in the pgn file: " + pgnfile);
+	}
+	progress.setValue(size);
 	QApplication::processEvents();
-	pgn.close();
+	pgn.stop();
 }
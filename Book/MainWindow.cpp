@@ -73,6 +73,7 @@ MainWindow::MainWindow(QWidget *parent)
 	statisticsDB = new Statistics();
 	computerDB = new Computer();
 	openingsDB = new Openings();
+	polyglotBook = new Polyglot();
 	currentPath = new Path();
 	training = new Training();
 	training->SetRepertoireDatabase(WHITE, Base[REPWHITE]);
@@ -80,6 +81,7 @@ MainWindow::MainWindow(QWidget *parent)
 	trainingwindow->setTraining(training);
 	trainingwindow->setDatabase(Base[THEORY], Base[REPWHITE], Base[REPBLACK], computerDB);
 	movewindow->computerDB = computerDB;
+	movewindow->polyglotBook = polyglotBook;
 	openingwindow->setOpeningsDB(openingsDB);
 	dgt = NULL;
 	readSettings();
@@ -120,6 +122,7 @@ MainWindow::~MainWindow()
 {
 	delete currentPath;
 	delete training;
+	delete polyglotBook;
 }
 
 void MainWindow::createMenu()
@@ -130,6 +133,7 @@ void MainWindow::createMenu()
 
 	bookMenu = menuBar()->addMenu("Book");
 	bookAnalyzeAct = bookMenu->addAction("*", this, &MainWindow::bookAnalyze);
+	bookPolyglotAct = bookMenu->addAction("*", this, &MainWindow::bookPolyglot);
 	bookMenu->addSeparator();
 	bookWriteMenu = bookMenu->addMenu("Write enable");
 	writeAct[THEORY] = bookWriteMenu->addAction("Write to theory book", this, &MainWindow::bookWriteTheory);
@@ -184,6 +188,7 @@ void MainWindow::retranslateUi()
 	exitAct->setText(tr("Exit"));
 
 	bookAnalyzeAct->setText(tr("Annalyze book"));
+	bookPolyglotAct->setText(tr("Open Polyglot book"));
 	trainingMenu->setTitle(tr("Training"));
 	startTrainingAct->setText(tr("Start training"));
 	stopTrainingAct->setText(tr("Stop training"));
@@ -332,6 +337,7 @@ void MainWindow::writeSettings()
 	settings.setValue("dataComputer", computerDB->getPath());
 //	settings.setValue("dataTraining", trainingDB->getPath());
 	settings.setValue("dataOpenings", openingsDB->getPath());
+	settings.setValue("dataPolyglot", polyglotPath);
 	settings.setValue("language", locale);
 	settings.setValue("movewindowFont", movewindow->fontToString());
 	settings.setValue("enginewindowFont", enginewindow->fontToString());
@@ -387,6 +393,7 @@ void MainWindow::readSettings()
 	dataComputer = settings.value("dataComputer", dataPath + "/Computer.pcp").toString();
 //	dataTraining = settings.value("dataTraining", dataPath + "/Training.ptr").toString();
 	dataOpenings = settings.value("dataOpenings", dataPath + "/Openings.pop").toString();
+	polyglotPath = settings.value("dataPolyglot", QString()).toString();
 	locale = settings.value("language", QString()).toString();
 	if (locale.isEmpty())
 	{
@@ -432,6 +439,8 @@ void MainWindow::readSettings()
 	if (!dataOpenings.isEmpty())
 		if (!openingsDB->open(dataOpenings))
 			openingsDB->create(dataOpenings);
+	if (!polyglotPath.isEmpty())
+		polyglotBook->open(polyglotPath.toLocal8Bit().toStdString());
 
 	/*
 	QSettings settings;
@@ -467,6 +476,26 @@ void MainWindow::bookAnalyze()
 	connect(enginewindow, SIGNAL(enginePV(ComputerDBEngine&, ChessBoard&)), this, SLOT(enginePV(ComputerDBEngine&, ChessBoard&)));
 }
 
+// The Polyglot book is read only, it is shown in the move table.
+void MainWindow::bookPolyglot()
+{
+	QString path = QFileDialog::getOpenFileName(this, tr("Open Polyglot book"), polyglotPath, tr("Polyglot books (*.bin)"));
+	if (path.isEmpty())
+		return;
+	if (!Polyglot::haveKeys())
+	{
+		QMessageBox::warning(this, tr("Polyglot book"), tr("The Polyglot keys failed the self test."));
+		return;
+	}
+	if (!polyglotBook->open(path.toLocal8Bit().toStdString()))
+	{
+		QMessageBox::warning(this, tr("Polyglot book"), tr("Unable to open: ") + path);
+		return;
+	}
+	polyglotPath = path;
+	updateWindow();
+}
+
 void MainWindow::bookWrite(int type)
 {
 	if (write == type)
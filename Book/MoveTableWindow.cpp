@@ -13,6 +13,7 @@ MoveTableWindow::MoveTableWindow(QWidget *parent)
 	: QWidget(parent)
 {
 	computerDB = NULL;
+	polyglotBook = NULL;
 	QVBoxLayout* vbox = new QVBoxLayout;
 	model = new QStandardItemModel(0, 0);
 	table = new QTableView;
@@ -63,6 +64,9 @@ MoveTableWindow::MoveTableWindow(QWidget *parent)
 	hYear.label = tr("Year");
 	hYear.inUse = true;
 	hYear.column = 10;
+	hPolyglot.label = tr("Polyglot");
+	hPolyglot.inUse = true;
+	hPolyglot.column = 11;
 }
 
 MoveTableWindow::~MoveTableWindow()
@@ -175,6 +179,34 @@ void MoveTableWindow::add(ComputerDBEntry& comp)
 	}
 }
 
+void MoveTableWindow::add(Polyglot& book, ChessBoard& cb)
+{
+	MoveTableEntry mte;
+	std::vector<ChessMove> moves;
+	std::vector<ChessMove>::iterator pit;
+	int index, total;
+
+	book.get(cb, moves);
+	total = 0;
+	for (pit = moves.begin(); pit != moves.end(); ++pit)
+		total += pit->score;
+	for (pit = moves.begin(); pit != moves.end(); ++pit)
+	{
+		index = existInTable(*pit);
+		if (index < 0)
+		{
+			mte.clear();
+			mte.move = *pit;
+			mte.polyglot = total ? (100 * pit->score) / total : 0;
+			movetable.push_back(mte);
+		}
+		else
+		{
+			movetable[index].polyglot = total ? (100 * pit->score) / total : 0;
+		}
+	}
+}
+
 int MoveTableWindow::existInTable(ChessMove& m)
 {
 	int i;
@@ -195,6 +227,8 @@ void MoveTableWindow::refresh(BookDBEntry& theory, BookDBEntry& white, BookDBEnt
 	add(theory, 0, cb);
 	add(white, 1, cb);
 	add(black, 2, cb);
+	if (polyglotBook && polyglotBook->isOpen())
+		add(*polyglotBook, cb);
 	refresh();
 }
 
@@ -407,6 +441,22 @@ void MoveTableWindow::refresh()
 				model->setItem(i, hYear.column, item);
 			}
 		}
+		if (hPolyglot.inUse)
+		{
+			if (i == 0)
+			{
+				model->setHorizontalHeaderItem(hPolyglot.column, new QStandardItem(hPolyglot.label));
+				++col;
+			}
+			if (movetable[i].polyglot >= 0)
+			{
+				qs.clear();
+				QTextStream(&qs) << movetable[i].polyglot << "%";
+				item = new QStandardItem(qs);
+				item->setTextAlignment(Qt::AlignVCenter | Qt::AlignRight);
+				model->setItem(i, hPolyglot.column, item);
+			}
+		}
 	}
 
 	table->verticalHeader()->hide();
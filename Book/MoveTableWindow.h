@@ -9,6 +9,7 @@
 #include <QStandardItemModel>
 #include "Statistics.h"
 #include "Computer.h"
+#include "../Common/PolyglotBook.h"
 #include "../Common/ChessMove.h"
 
 struct MoveTableHeader
@@ -27,7 +28,8 @@ struct MoveTableEntry
 	QString engine;
 	int cp;
 	int rep[3];
-	void clear() { move.clear(); whitewin = draw = blackwin = elo = year = 0; engine.clear(); cp = 0; rep[0] = rep[1] = rep[2] = 0; };
+	int polyglot; // Share of the book weight in %, -1 if not in the book.
+	void clear() { move.clear(); whitewin = draw = blackwin = elo = year = 0; engine.clear(); cp = 0; rep[0] = rep[1] = rep[2] = 0; polyglot = -1; };
 };
 
 class MoveTableWindow : public QWidget
@@ -36,6 +38,7 @@ class MoveTableWindow : public QWidget
 
 public:
 	Computer* computerDB;
+	Polyglot* polyglotBook;
 	MoveTableWindow(QWidget *parent=0);
 	~MoveTableWindow();
 	void refresh(BookDBEntry& theory, BookDBEntry& white, BookDBEntry& black, StatisticsDBEntry& statistics, ComputerDBEntry& compdata, ChessBoard&, int movenr);
@@ -83,10 +86,12 @@ private:
 	MoveTableHeader hDraw;
 	MoveTableHeader hElo;
 	MoveTableHeader hYear;
+	MoveTableHeader hPolyglot;
 	QVector<MoveTableEntry> movetable;
 	void add(BookDBEntry&, int rep, ChessBoard&);
 	void add(StatisticsDBEntry&);
 	void add(ComputerDBEntry&);
+	void add(Polyglot&, ChessBoard&);
 	int existInTable(ChessMove& m);
 	void refresh();
 };
@@ -8,6 +8,7 @@
 #include <QApplication>
 #include "../Common/WinFile.h"
 #include "../Common/Pgn.h"
+#include "../Common/PgnPipeline.h"
 #include "../Common/ChessGame.h"
 #include <QDebug>
 
@@ -227,8 +228,9 @@ void Openings::importPgn(QWidget* parent)
 {
 	OpeningsDBEntry ode;
 	ChessBoard cb;
-	Pgn pgn;
+	PgnPipeline pgn;
 	ChessGame game;
+	DWORD index;
 
 	if (!_opened)
 		return;
@@ -237,17 +239,17 @@ void Openings::importPgn(QWidget* parent)
 	QString path = QFileDialog::getOpenFileName(parent, "Open pgnfile", QString(), "Pgn files (*.pgn)");
 	if (path.isEmpty())
 		return;
-	if (!pgn.open(path.toStdString(), true))
+	pgn.maxmove = 20;
+	if (!pgn.start(path.toStdString()))
 		return;
 
 	// Open progress dialog
-	QProgressDialog progress("Importing Pgn file.", "Cancel", 0, pgn.file.size(), parent);
+	QProgressDialog progress("Importing Pgn file.", "Cancel", 0, (int)(pgn.size() / 1024), parent);
 	progress.setWindowModality(Qt::WindowModal);
 	progress.setMinimumDuration(0);
 	progress.show();
 
-	int next = 1;
-	while (pgn.read(game, next++, 20))
+	while (pgn.next(game, index))
 	{
 		game.toEnd();
 		if (!game.getPosition(cb))
@@ -262,14 +264,14 @@ void Openings::importPgn(QWidget* parent)
 			ode.variation = game.info.Variation.c_str();
 		if (game.info.SubVariation.size())
 			ode.subvariation = game.info.SubVariation.c_str();
-		progress.setValue(pgn.file.dwFilepointer);
+		progress.setValue((int)(pgn.position() / 1024));
 		QApplication::processEvents();
 		if (progress.wasCanceled())
 			return;
 
 		add(ode, cb);
 	}
-	progress.setValue(pgn.file.size());
+	progress.setValue((int)(pgn.size() / 1024));
 }
 
 void Openings::exportPgn(QWidget* parent)
@@ -182,8 +182,8 @@ void Statistics::importGames(QWidget* parent)
 #ifdef _DEBUG
 	QSqlError error;
 #endif
-	Pgn pgn;
-	int gameindex, i, j;
+	PgnPipeline pgn;
+	int i, j;
 	QVector<StatisticsDBEntry> list;
 	QVector<StatisticsDBEntry> dblist;
 	StatisticsDBEntry sde;
@@ -198,24 +198,26 @@ void Statistics::importGames(QWidget* parent)
 	QString path = QFileDialog::getOpenFileName(parent, "Open pgnfile", QString(), "Pgn files (*.pgn)");
 	if (path.isEmpty())
 		return;
-	if (!pgn.open(path.toStdString(), true))
+	// The order of the games doesn't change the statistics.
+	pgn.ordered = false;
+	pgn.maxmove = 20;
+	if (!pgn.start(path.toStdString()))
 		return;
 	// Open progress dialog
-	QProgressDialog progress("Importing Pgn file.", "Cancel", 0, pgn.file.size(), parent);
+	QProgressDialog progress("Importing Pgn file.", "Cancel", 0, (int)(pgn.size() / 1024), parent);
 	progress.setWindowModality(Qt::WindowModal);
 	progress.setMinimumDuration(0);
 	progress.show();
 	progress.setLabelText("Reading games");
 	QApplication::processEvents();
 
-	gameindex = 1;
-	while (readGames(list, pgn, gameindex))
+	while (readGames(list, pgn))
 	{
 		progress.setLabelText("Reading statistics");
 		QApplication::processEvents();
 		if (progress.wasCanceled())
 		{
-			pgn.close();
+			pgn.stop();
 			return;
 		}
 
@@ -251,7 +253,7 @@ void Statistics::importGames(QWidget* parent)
 		QApplication::processEvents();
 		if (progress.wasCanceled())
 		{
-			pgn.close();
+			pgn.stop();
 			return;
 		}
 
@@ -302,22 +304,23 @@ void Statistics::importGames(QWidget* parent)
 		db.commit();
 
 		progress.setLabelText("Reading games");
-		progress.setValue(pgn.file.dwFilepointer);
+		progress.setValue((int)(pgn.position() / 1024));
 		QApplication::processEvents();
 		if (progress.wasCanceled())
 		{
-			pgn.close();
+			pgn.stop();
 			return;
 		}
 	}
-	progress.setValue(pgn.file.size());
-	pgn.close();
+	progress.setValue((int)(pgn.size() / 1024));
+	pgn.stop();
 }
 
 // Read the 20 first moves from 1000 games and put each position into list
-bool Statistics::readGames(QVector<StatisticsDBEntry>& list, Pgn& pgn, int& index)
+bool Statistics::readGames(QVector<StatisticsDBEntry>& list, PgnPipeline& pgn)
 {
 	SYSTEMTIME st;
+	DWORD index;
 	int i,wElo,bElo;
 	ChessGame game;
 	ChessBoard cb;
@@ -330,7 +333,7 @@ bool Statistics::readGames(QVector<StatisticsDBEntry>& list, Pgn& pgn, int& inde
 
 	for (i = 0; i < 1000; i++)
 	{
-		if (!pgn.read(game, index++, 20))
+		if (!pgn.next(game, index))
 			break;
 		sdm.clear();
 		if (game.info.Result == "1-0")
@@ -387,9 +390,10 @@ void Statistics::importGames2(QWidget* parent)
 	ChessBoard cb;
 	QVector<StatisticsDBEntry> sdes;
 	std::string ss;
-	Pgn pgn;
+	PgnPipeline pgn;
 	ChessGame game;
 	QByteArray cboard;
+	DWORD index;
 	int i;
 	QSqlDatabase db = QSqlDatabase::database(STATISTICS);
 	if (!opened)
@@ -401,11 +405,12 @@ void Statistics::importGames2(QWidget* parent)
 	QString path = QFileDialog::getOpenFileName(parent, "Open pgnfile", QString(), "Pgn files (*.pgn)");
 	if (path.isEmpty())
 		return;
-	if (!pgn.open(path.toStdString(), true))
+	pgn.maxmove = 20;
+	if (!pgn.start(path.toStdString()))
 		return;
 
 	// Open progress dialog
-	QProgressDialog progress("Importing Pgn file.", "Cancel", 0, pgn.file.size(), parent);
+	QProgressDialog progress("Importing Pgn file.", "Cancel", 0, (int)(pgn.size() / 1024), parent);
 	progress.setWindowModality(Qt::WindowModal);
 	progress.setMinimumDuration(0);
 	progress.show();
@@ -413,8 +418,7 @@ void Statistics::importGames2(QWidget* parent)
 	QSqlQuery query(db);
 	QString qs;
 	int wElo = 0, bElo = 0;
-	int next = 1;
-	while (pgn.read(game, next++, 20))
+	while (pgn.next(game, index))
 	{
 		sdm.clear();
 		if (game.info.Result == "1-0")
@@ -432,11 +436,11 @@ void Statistics::importGames2(QWidget* parent)
 			bElo = stoi(game.info.BlackElo);
 		game.getDate(st);
 		sdm.year = st.wYear;
-		progress.setValue(pgn.file.dwFilepointer);
+		progress.setValue((int)(pgn.position() / 1024));
 		QApplication::processEvents();
 		if (progress.wasCanceled())
 		{
-			pgn.close();
+			pgn.stop();
 			return;
 		}
 		game.getStartPosition(cb);
@@ -504,7 +508,7 @@ void Statistics::importGames2(QWidget* parent)
 		}
 		db.commit();
 	}
-	progress.setValue(pgn.file.size());
+	progress.setValue((int)(pgn.size() / 1024));
 }
 
 void Statistics::removeSingleGame(QWidget* parent)
@@ -8,6 +8,7 @@
 #include "../Common/ChessMove.h"
 #include "../Common/ChessBoard.h"
 #include "../Common/Pgn.h"
+#include "../Common/PgnPipeline.h"
 #include "DatabaseFormat.h"
 
 class Statistics : public QObject
@@ -47,5 +48,5 @@ public:
 private:
 	bool opened;
 	bool haveSingleMove(QString&);
-	bool readGames(QVector<StatisticsDBEntry>&, Pgn&, int&);
+	bool readGames(QVector<StatisticsDBEntry>&, PgnPipeline&);
 };
\ No newline at end of file
@@ -144,6 +144,10 @@ public:
 	virtual void write(const char* sz) { write(QString(sz)); };
 	virtual void write(QString& qs);
 	virtual void analyze(ChessBoard& board) {};
+	// Search the position after moves from board. The times are in ms.
+	// For TIME_SEARCH, NODES_SEARCH, DEPTH_SEARCH and MATE_SEARCH the limit is given in wtime.
+	virtual void search(ChessBoard& board, MoveList& moves, SEARCHTYPE searchtype, int wtime, int winc, int btime, int binc, int movestogo) {};
 	virtual void stop() {};
+	virtual void newGame() {};
 	virtual void setMultiPV(int n) {};
 };
\ No newline at end of file
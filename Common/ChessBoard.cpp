@@ -10,14 +10,38 @@
 
 using namespace std;
 
-static bool initHash = false;
-
 // keyValues to be XOR'ed
 // key[0-11][0-63] = Value for each pieces on each square
 // key[12][0-15]   = Value for castle rights
 // key[12][16]     = Value for black on move.
 // key[12][17-24]  = Value for ep file
-static HASHKEY ZobristKey[13][64];
+struct ZobristTable
+{
+	HASHKEY key[13][64];
+};
+
+// The keys are made at compile time with a fixed seed (splitmix64), so they
+// are the same in every build and for every program using ChessBoard.
+constexpr ZobristTable makeZobristKeys()
+{
+	ZobristTable t{};
+	HASHKEY seed = 0x5A17C4E55ULL;
+	HASHKEY z = 0;
+	for (int i = 0; i < 13; i++)
+	{
+		for (int j = 0; j < 64; j++)
+		{
+			seed += 0x9E3779B97F4A7C15ULL;
+			z = seed;
+			z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+			z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+			t.key[i][j] = z ^ (z >> 31);
+		}
+	}
+	return t;
+}
+
+static constexpr ZobristTable Zobrist = makeZobristKeys();
 
 ChessBoard::ChessBoard()
 { 
@@ -307,15 +331,6 @@ bool ChessBoard::doMove(ChessMove& m, bool legalcheck)
 	return true;
 }
 
-bool ChessBoard::isLegal(ChessMove& m)
-{
-//	MoveGenerator gen;
-	ChessMove mm;
-	string sm=makeMoveText(m,UCI);
-	mm=getMoveFromText(sm);
-	return (mm.score == 0) ? true : false;
-}
-
 int ChessBoard::legalMoves()
 {
 	MoveGenerator gen;
@@ -326,46 +341,508 @@ int ChessBoard::legalMoves()
 	return n;
 }
 
-const ChessMove ChessBoard::getMoveFromText(const std::string text)
+// The move given as text to getMoveFromText. The moves of the piece to the
+// target square are made without a move list and checked against the text.
+struct MoveText
+{
+	MoveGenerator gen;
+	typePiece piece;   // With color
+	typePiece promote; // With color, EMPTY if not a promotion
+	int fFile;         // -1 if not given
+	int fRow;
+	ChessMove move;    // The last legal move found
+	int count;         // Number of legal moves found
+};
+
+static void addTextMove(ChessBoard& b, MoveText& t, ChessMove& m)
+{
+	if ((t.fFile >= 0) && (t.fFile != FILE(m.fromSquare)))
+		return;
+	if ((t.fRow >= 0) && (t.fRow != RANK(m.fromSquare)))
+		return;
+	if (t.promote != m.promotePiece)
+		return;
+	if (!t.gen.isLegal(b, m))
+		return;
+	t.move = m;
+	++t.count;
+}
+
+static void addTextSlideMoves(ChessBoard& b, MoveText& t, ChessMove& m, const int* path)
+{
+	int i;
+	typeSquare sq;
+	for (i = 0; i < 4; i++)
+	{
+		sq = m.toSquare + path[i];
+		while (LEGALSQUARE(sq) && (b.board[sq] == EMPTY))
+			sq += path[i];
+		if (LEGALSQUARE(sq) && (b.board[sq] == t.piece))
+		{
+			m.fromSquare = sq;
+			addTextMove(b, t, m);
+		}
+	}
+}
+
+static void addTextPawnMoves(ChessBoard& b, MoveText& t, ChessMove& m)
+{
+	int i, pawnRow;
+	typeSquare to = m.toSquare;
+	typeSquare sq;
+	typeColor color = b.toMove;
+
+	pawnRow = color ? -16 : 16;
+	m.moveType |= PAWNMOVE;
+	if ((to < a2) || (to > h7))
+	{
+		if ((t.promote != COLORPIECE(color, QUEEN)) && (t.promote != COLORPIECE(color, ROOK)) &&
+			(t.promote != COLORPIECE(color, BISHOP)) && (t.promote != COLORPIECE(color, KNIGHT)))
+			return;
+		m.moveType |= PROMOTE;
+		m.promotePiece = t.promote;
+	}
+	if (b.board[to] == EMPTY)
+	{
+		sq = to - pawnRow;
+		if (LEGALSQUARE(sq) && (b.board[sq] == t.piece))
+		{
+			m.fromSquare = sq;
+			addTextMove(b, t, m);
+		}
+		else if ((RANK(to) == (color ? 4 : 3)) && (b.board[sq] == EMPTY) && (b.board[sq - pawnRow] == t.piece))
+		{
+			m.fromSquare = sq - pawnRow;
+			m.moveType |= DBLPAWNMOVE;
+			addTextMove(b, t, m);
+			m.moveType &= ~DBLPAWNMOVE;
+		}
+	}
+
+	// Capture
+	if ((b.board[to] == EMPTY) && (to != b.enPassant))
+		return;
+	m.moveType |= CAPTURE;
+	if (b.board[to] == EMPTY)
+	{
+		m.moveType |= ENPASSANT;
+		m.capturedpiece = COLORPIECE(OTHERPLAYER(color), PAWN);
+	}
+	for (i = -1; i <= 1; i += 2)
+	{
+		sq = to - pawnRow + i;
+		if (LEGALSQUARE(sq) && (b.board[sq] == t.piece))
+		{
+			m.fromSquare = sq;
+			addTextMove(b, t, m);
+		}
+	}
+}
+
+static void addTextKingMoves(ChessBoard& b, MoveText& t, ChessMove& m)
+{
+	int i;
+	typeCastle ctl;
+	typeSquare to = m.toSquare;
+	typeSquare sq;
+
+	for (i = 0; kingMoves.sq[to][i] != UNDEF; i++)
+	{
+		if (b.board[kingMoves.sq[to][i]] == t.piece)
+		{
+			m.fromSquare = kingMoves.sq[to][i];
+			addTextMove(b, t, m);
+		}
+	}
+
+	// Castle, the king is moving two squares.
+	if (b.board[to] != EMPTY)
+		return;
+	m.moveType = CASTLE;
+	ctl = (b.toMove == WHITE) ? b.castle : b.castle >> 2;
+	sq = to - 2;
+	if ((ctl&whitekingsidecastle) && LEGALSQUARE(sq) && (b.board[sq] == t.piece) && (b.board[sq + 1] == EMPTY))
+	{
+		m.fromSquare = sq;
+		addTextMove(b, t, m);
+	}
+	sq = to + 2;
+	if ((ctl&whitequeensidecastle) && LEGALSQUARE(sq) && LEGALSQUARE(to - 1) && (b.board[sq] == t.piece) &&
+		(b.board[sq - 1] == EMPTY) && (b.board[to - 1] == EMPTY))
+	{
+		m.fromSquare = sq;
+		addTextMove(b, t, m);
+	}
+}
+
+// Find the legal moves of the piece to a square that is matching the text.
+static void addTextMoves(ChessBoard& b, MoveText& t, typeSquare to)
 {
-	int moveit;
-	MoveList* ml = new MoveList;
-	MoveList* allmoves = new MoveList;
-	MoveGenerator mgen;
+	ChessMove m;
+	int i;
+
+	if ((b.board[to] != EMPTY) && (PIECECOLOR(b.board[to]) == b.toMove))
+		return;
+	m.toSquare = to;
+	if (b.board[to] != EMPTY)
+	{
+		m.moveType = CAPTURE;
+		m.capturedpiece = b.board[to];
+	}
+	switch (PIECE(t.piece))
+	{
+	case PAWN:
+		addTextPawnMoves(b, t, m);
+		break;
+	case KNIGHT:
+		for (i = 0; knightMoves.sq[to][i] != UNDEF; i++)
+		{
+			if (b.board[knightMoves.sq[to][i]] == t.piece)
+			{
+				m.fromSquare = knightMoves.sq[to][i];
+				addTextMove(b, t, m);
+			}
+		}
+		break;
+	case BISHOP:
+		addTextSlideMoves(b, t, m, bishopPath);
+		break;
+	case ROOK:
+		addTextSlideMoves(b, t, m, rookPath);
+		break;
+	case QUEEN:
+		addTextSlideMoves(b, t, m, bishopPath);
+		addTextSlideMoves(b, t, m, rookPath);
+		break;
+	case KING:
+		addTextKingMoves(b, t, m);
+		break;
+	}
+}
+
+// The legal move with the squares and promotion piece of a move, with the
+// other fields filled in. A pawn move to the last rank is a queen promotion
+// if the promotion piece is missing.
+static bool findLegalMove(ChessBoard& b, const ChessMove& cm, ChessMove& m)
+{
+	MoveText t;
+	if (!LEGALSQUARE(cm.fromSquare) || !LEGALSQUARE(cm.toSquare))
+		return false;
+	t.piece = b.board[cm.fromSquare];
+	if ((t.piece == EMPTY) || (PIECECOLOR(t.piece) != b.toMove))
+		return false;
+	t.promote = EMPTY;
+	if ((cm.moveType&PROMOTE) && (PIECE(cm.promotePiece) > PAWN))
+		t.promote = COLORPIECE(b.toMove, cm.promotePiece);
+	else if ((PIECE(t.piece) == PAWN) && ((RANK(cm.toSquare) == 0) || (RANK(cm.toSquare) == 7)))
+		t.promote = COLORPIECE(b.toMove, QUEEN);
+	t.fFile = FILE(cm.fromSquare);
+	t.fRow = RANK(cm.fromSquare);
+	t.count = 0;
+	addTextMoves(b, t, cm.toSquare);
+	if (t.count != 1)
+		return false;
+	m = t.move;
+	return true;
+}
+
+// Number of legal moves of a piece type to a square, only the pieces on the
+// file or rank if given. Used for the disambiguation in SAN.
+static int countMovesTo(ChessBoard& b, typePiece piece, typeSquare to, int file, int row)
+{
+	MoveText t;
+	t.piece = piece;
+	t.promote = EMPTY;
+	t.fFile = file;
+	t.fRow = row;
+	t.count = 0;
+	addTextMoves(b, t, to);
+	return t.count;
+}
+
+// Number of pieces giving check to the king of the side to move, checker is
+// the square of one of them.
+static int findCheckers(ChessBoard& b, typeSquare king, typeSquare& checker)
+{
+	typeColor other = OTHERPLAYER(b.toMove);
+	typeSquare sq;
+	int i, n = 0;
+
+	for (i = 0; i < 4; i++)
+	{
+		sq = king + bishopPath[i];
+		while (LEGALSQUARE(sq) && (b.board[sq] == EMPTY))
+			sq += bishopPath[i];
+		if (LEGALSQUARE(sq) && ((b.board[sq] == COLORPIECE(other, BISHOP)) || (b.board[sq] == COLORPIECE(other, QUEEN))))
+		{
+			checker = sq;
+			++n;
+		}
+		sq = king + rookPath[i];
+		while (LEGALSQUARE(sq) && (b.board[sq] == EMPTY))
+			sq += rookPath[i];
+		if (LEGALSQUARE(sq) && ((b.board[sq] == COLORPIECE(other, ROOK)) || (b.board[sq] == COLORPIECE(other, QUEEN))))
+		{
+			checker = sq;
+			++n;
+		}
+	}
+	for (i = 0; knightMoves.sq[king][i] != UNDEF; i++)
+	{
+		if (b.board[knightMoves.sq[king][i]] == COLORPIECE(other, KNIGHT))
+		{
+			checker = knightMoves.sq[king][i];
+			++n;
+		}
+	}
+	sq = king - 1 + (other ? 16 : -16);
+	for (i = 0; i < 2; i++, sq += 2)
+	{
+		if (LEGALSQUARE(sq) && (b.board[sq] == COLORPIECE(other, PAWN)))
+		{
+			checker = sq;
+			++n;
+		}
+	}
+	return n;
+}
+
+// Is there a legal move when in check. Only the king moves, and with one
+// checking piece the moves capturing it or blocking the check, are made.
+static bool canEscapeCheck(ChessBoard& b, typeSquare king, int checkers, typeSquare checker)
+{
+	MoveText t;
+	typePiece p;
+	typeSquare sq;
+	int i, step;
+
+	t.piece = b.board[king];
+	t.promote = EMPTY;
+	t.fFile = FILE(king);
+	t.fRow = RANK(king);
+	t.count = 0;
+	for (i = 0; kingMoves.sq[king][i] != UNDEF; i++)
+	{
+		addTextMoves(b, t, kingMoves.sq[king][i]);
+		if (t.count)
+			return true;
+	}
+	if (checkers > 1)
+		return false;
+
+	t.fFile = -1;
+	t.fRow = -1;
+	step = rayStep.value[DIFF0x88(checker, king)];
+	sq = checker;
+	do
+	{
+		for (p = PAWN; p < KING; p++)
+		{
+			t.piece = COLORPIECE(b.toMove, p);
+			t.promote = ((p == PAWN) && ((sq < a2) || (sq > h7))) ? COLORPIECE(b.toMove, QUEEN) : EMPTY;
+			addTextMoves(b, t, sq);
+			if (t.count)
+				return true;
+		}
+		sq += step;
+	} while (step && (sq != king));
+
+	// The checking pawn can be taken en passant.
+	if ((b.enPassant != UNDEF) && (PIECE(b.board[checker]) == PAWN))
+	{
+		t.piece = COLORPIECE(b.toMove, PAWN);
+		t.promote = EMPTY;
+		addTextMoves(b, t, b.enPassant);
+		if (t.count)
+			return true;
+	}
+	return false;
+}
+
+// '+' or '#' if the legal move is giving check, else 0.
+static char checkChar(ChessBoard& b, ChessMove& m)
+{
+	MoveGenerator gen;
+	typePiece king;
+	typeSquare sq, checker;
+	int checkers;
+	char c = 0;
+
+	gen.doMove(b, m);
+	king = COLORPIECE(b.toMove, KING);
+	sq = 0;
+	while (b.board[sq] != king)
+	{
+		sq++;
+		if (sq & 8)
+		{
+			sq += 8;
+			if (sq > 127)
+				break;
+		}
+	}
+	if (sq < 128)
+	{
+		checkers = findCheckers(b, sq, checker);
+		if (checkers)
+			c = canEscapeCheck(b, sq, checkers, checker) ? '+' : '#';
+	}
+	gen.undoMove(b, m);
+	return c;
+}
+
+// Write a legal move, sz must have room for 16 characters. Returns the length.
+static int writeMoveText(ChessBoard& b, ChessMove& m, char* sz, int type)
+{
+	typePiece piece = PIECE(b.board[m.fromSquare]);
+	typeSquare from = m.fromSquare;
+	typeSquare to = m.toSquare;
+	int p = 0;
+	char c;
+
+	if ((type == UCI) || (type == COOR))
+	{
+		sz[p++] = 'a' + FILE(from);
+		sz[p++] = '1' + RANK(from);
+		sz[p++] = 'a' + FILE(to);
+		sz[p++] = '1' + RANK(to);
+		if (m.moveType&PROMOTE)
+			sz[p++] = tolower(b.getCharFromPiece(m.promotePiece));
+		sz[p] = '\0';
+		return p;
+	}
+
+	switch (piece)
+	{
+	case PAWN:
+		if ((type == LAN) || (m.moveType&CAPTURE))
+		{
+			sz[p++] = 'a' + FILE(from);
+			if (type == LAN)
+				sz[p++] = '1' + RANK(from);
+		}
+		break;
+	case KNIGHT:
+	case BISHOP:
+	case ROOK:
+	case QUEEN:
+		sz[p++] = b.getCharFromPiece(piece);
+		if (type == LAN)
+		{
+			sz[p++] = 'a' + FILE(from);
+			sz[p++] = '1' + RANK(from);
+		}
+		else if (countMovesTo(b, b.board[from], to, -1, -1) > 1)
+		{
+			// The file if it is enough, else the rank, else both.
+			if (countMovesTo(b, b.board[from], to, FILE(from), -1) == 1)
+			{
+				sz[p++] = 'a' + FILE(from);
+			}
+			else if (countMovesTo(b, b.board[from], to, -1, RANK(from)) == 1)
+			{
+				sz[p++] = '1' + RANK(from);
+			}
+			else
+			{
+				sz[p++] = 'a' + FILE(from);
+				sz[p++] = '1' + RANK(from);
+			}
+		}
+		break;
+	case KING:
+		if (m.moveType&CASTLE)
+		{
+			sz[p++] = 'O';
+			sz[p++] = '-';
+			sz[p++] = 'O';
+			if (FILE(to) == 2)
+			{
+				sz[p++] = '-';
+				sz[p++] = 'O';
+			}
+			if ((c = checkChar(b, m)) != 0)
+				sz[p++] = c;
+			sz[p] = '\0';
+			return p;
+		}
+		sz[p++] = 'K';
+		if (type == LAN)
+		{
+			sz[p++] = 'a' + FILE(from);
+			sz[p++] = '1' + RANK(from);
+		}
+		break;
+	}
+
+	if (m.moveType&CAPTURE)
+		sz[p++] = 'x';
+	else if (type == LAN)
+		sz[p++] = '-';
+
+	sz[p++] = 'a' + FILE(to);
+	sz[p++] = '1' + RANK(to);
+	if (m.moveType&PROMOTE)
+	{
+		if (type == SAN)
+			sz[p++] = '=';
+		sz[p++] = b.getCharFromPiece(m.promotePiece);
+	}
+	if ((c = checkChar(b, m)) != 0)
+		sz[p++] = c;
+	if ((type == FIDE) && (m.moveType&ENPASSANT))
+	{
+		//    sz[p++]=' '; // Could gives unwanted linebreak
+		sz[p++] = 'e';
+		sz[p++] = '.';
+		sz[p++] = 'p';
+		sz[p++] = '.';
+	}
+	sz[p] = '\0';
+	return p;
+}
+
+const ChessMove ChessBoard::getMoveFromText(const std::string& text)
+{
+	return getMoveFromText(text.c_str(), text.length());
+}
+
+const ChessMove ChessBoard::getMoveFromText(const char* text, size_t length)
+{
+	MoveText t;
 	ChessMove m;
 	typePiece piece, ppiece = EMPTY;
 	char mt[20];
 	int fRow = -1, fFile = -1, tRow = -1, tFile = -1;
-	size_t len;
-	int i;
+	int len, i, f, r, f1, r1;
+	char c;
 
-	if (text.length()>19)
-		strcpy_s(mt, 20, text.substr(0, 18).c_str());
-	else
-		strcpy_s(mt, 20, text.c_str());
-	i = 0;
-	while (mt[i]) // uniform castle
+	// Uniform castle and strip the characters not needed (as stripMoveText)
+	// while copying.
+	if (length > 19)
+		length = 18;
+	len = 0;
+	for (i = 0; (i < (int)length) && text[i]; i++)
 	{
-		if (mt[i] == '0')
-			mt[i] = 'O';
-		if (mt[i] == 'o')
-			mt[i] = 'O';
-		i++;
+		c = text[i];
+		if ((c == '0') || (c == 'o'))
+			c = 'O';
+		if (isFileChar(c) || isPieceChar(c) || (c == 'O') || (len && (isRowChar(c) || isPieceChar(toupper(c)))))
+			mt[len++] = c;
 	}
-	stripMoveText(mt);
-	len = strlen(mt);
+	// For a move like exd6 e.p. the last 'e' would still exist in the movetext (ed6e).
+	if ((len > 2) && (mt[len - 1] == 'e'))
+		--len;
 	if (len<2)
 	{
 		m.score = 1;
-		delete ml;
-		delete allmoves;
 		return m; // Move is an empty move by default.
 	}
 	// Castle
-	if (strncmp(mt, "OO", 2) == 0)
+	if ((mt[0] == 'O') && (mt[1] == 'O'))
 	{
 		fFile = 4;
-		if (strncmp(mt, "OOO", 3) == 0)
+		if ((len > 2) && (mt[2] == 'O'))
 			tFile = 2;
 		else
 			tFile = 6;
@@ -384,7 +861,7 @@ const ChessMove ChessBoard::getMoveFromText(const std::string text)
 	else
 	{
 		piece = getPieceFromChar(mt[0]);
-		i = (int)len - 1;
+		i = len - 1;
 		if (isPieceChar(toupper(mt[i])))
 		{
 			ppiece = getPieceFromChar(toupper(mt[i]));
@@ -408,12 +885,8 @@ const ChessMove ChessBoard::getMoveFromText(const std::string text)
 			}
 			i--;
 		}
-		if ((fFile>7) || (fRow>7) || (tFile>7) || (tRow>7))
-			return m;
 		if ((piece == EMPTY) && (fFile == -1))
 			fFile = tFile;
-		if ((piece == PAWN) && (fFile == -1))
-			fFile = tFile;
 		if ((fFile >= 0) && (fRow >= 0))
 			piece = PIECE(board[SQUARE(fFile, fRow)]);
 		if (piece == EMPTY)
@@ -422,70 +895,23 @@ const ChessMove ChessBoard::getMoveFromText(const std::string text)
 
 	// Force queen promotion if promotion piece is missing.
 	if ((piece == PAWN) && ((tRow == 7) || (tRow == 0)) && (ppiece == EMPTY))
-		ppiece = (toMove == WHITE) ? whitequeen : blackqueen;
-
-	piece = PIECE(piece);
-	piece = (toMove == WHITE) ? piece : piece + 6;
-	mgen.makeMoves(*this, *allmoves);
-	moveit = 0;
-	ml->clear();
-	while (moveit != allmoves->size())
-	{
-		m = allmoves->at(moveit);
-		if (piece == board[m.fromSquare])
-		{
-			if (fFile >= 0)
-			{
-				if (fFile != FILE(m.fromSquare))
-				{
-					++moveit;
-					continue;
-				}
-			}
-			if (tFile >= 0)
-			{
-				if (tFile != FILE(m.toSquare))
-				{
-					++moveit;
-					continue;
-				}
-			}
-			if (fRow >= 0)
-			{
-				if (fRow != RANK(m.fromSquare))
-				{
-					++moveit;
-					continue;
-				}
-			}
-			if (tRow >= 0)
-			{
-				if (tRow != RANK(m.toSquare))
-				{
-					++moveit;
-					continue;
-				}
-			}
-			if (ppiece != m.promotePiece)
-			{
-				++moveit;
-				continue;
-			}
-			ml->push_back(m);
-		}
-		++moveit;
-	};
-	if (ml->size() == 1)
-	{
-		m = (ml->at(ml->begin()));
-	}
-	else
-	{
-		m.clear();
-		m.score = 2;
-	}
-	delete ml;
-	delete allmoves;
+		ppiece = COLORPIECE(toMove, QUEEN);
+
+	// Only the moves of the piece to the target square(s) are made.
+	t.piece = COLORPIECE(toMove, piece);
+	t.promote = ppiece;
+	t.fFile = fFile;
+	t.fRow = fRow;
+	t.count = 0;
+	f1 = (tFile < 0) ? 7 : tFile;
+	r1 = (tRow < 0) ? 7 : tRow;
+	for (r = (tRow < 0) ? 0 : tRow; r <= r1; r++)
+		for (f = (tFile < 0) ? 0 : tFile; f <= f1; f++)
+			addTextMoves(*this, t, SQUARE(f, r));
+	if (t.count == 1)
+		return t.move;
+	m.clear();
+	m.score = 2;
 	return m;
 }
 
@@ -584,22 +1010,13 @@ typePiece ChessBoard::getPieceFromChar(char c)
 HASHKEY ChessBoard::hashkey()
 {
 	HASHKEY key = (HASHKEY)0;
-	if (!initHash)
-	{
-		int i, j;
-
-		for (i = 0; i<13; i++)
-			for (j = 0; j<64; j++)
-				ZobristKey[i][j] = rand64();
-		initHash = true;
-	}
 
 	// Pieces
 	typeSquare sq = 0;
 	while (1)
 	{
 		if (board[sq] != EMPTY)
-			key ^= ZobristKey[board[sq] - 1][SQUARE64(sq)];
+			key ^= Zobrist.key[board[sq] - 1][SQUARE64(sq)];
 		sq++;
 		if (sq & 8)
 		{
@@ -610,15 +1027,15 @@ HASHKEY ChessBoard::hashkey()
 	}
 
 	// castle could be any values from 0 to 15
-	key ^= ZobristKey[12][castle];
+	key ^= Zobrist.key[12][castle];
 
 	// EnPassant
 	if (enPassant != UNDEF)
-		key ^= ZobristKey[12][17 + FILE(enPassant)];
+		key ^= Zobrist.key[12][17 + FILE(enPassant)];
 
 	// Set color to move
 	if (toMove == BLACK)
-		key ^= ZobristKey[12][16];
+		key ^= Zobrist.key[12][16];
 
 	return key;
 }
@@ -631,19 +1048,19 @@ HASHKEY ChessBoard::newHashkey(const ChessMove& m, HASHKEY key)
 		if (m.moveType&CAPTURE)
 		{
 			if (m.moveType&ENPASSANT)
-				key ^= ZobristKey[m.capturedpiece - 1][SQUARE64(m.toSquare) + (toMove == WHITE ? -8 : 8)];
+				key ^= Zobrist.key[m.capturedpiece - 1][SQUARE64(m.toSquare) + (toMove == WHITE ? -8 : 8)];
 			else
-				key ^= ZobristKey[board[m.toSquare] - 1][SQUARE64(m.toSquare)];
+				key ^= Zobrist.key[board[m.toSquare] - 1][SQUARE64(m.toSquare)];
 		}
 
 		// Remove piece
-		key ^= ZobristKey[board[m.fromSquare] - 1][SQUARE64(m.fromSquare)];
+		key ^= Zobrist.key[board[m.fromSquare] - 1][SQUARE64(m.fromSquare)];
 
 		// Add piece
 		if (m.moveType&PROMOTE)
-			key ^= ZobristKey[m.promotePiece - 1][SQUARE64(m.toSquare)];
+			key ^= Zobrist.key[m.promotePiece - 1][SQUARE64(m.toSquare)];
 		else
-			key ^= ZobristKey[board[m.fromSquare] - 1][SQUARE64(m.toSquare)];
+			key ^= Zobrist.key[board[m.fromSquare] - 1][SQUARE64(m.toSquare)];
 
 		// Move the rook on castle
 		if (m.moveType&CASTLE)
@@ -651,20 +1068,20 @@ HASHKEY ChessBoard::newHashkey(const ChessMove& m, HASHKEY key)
 			switch (m.toSquare)
 			{
 			case g1:
-				key ^= ZobristKey[whiterook - 1][SQUARE64(h1)];
-				key ^= ZobristKey[whiterook - 1][SQUARE64(f1)];
+				key ^= Zobrist.key[whiterook - 1][SQUARE64(h1)];
+				key ^= Zobrist.key[whiterook - 1][SQUARE64(f1)];
 				break;
 			case g8:
-				key ^= ZobristKey[blackrook - 1][SQUARE64(h8)];
-				key ^= ZobristKey[blackrook - 1][SQUARE64(f8)];
+				key ^= Zobrist.key[blackrook - 1][SQUARE64(h8)];
+				key ^= Zobrist.key[blackrook - 1][SQUARE64(f8)];
 				break;
 			case c1:
-				key ^= ZobristKey[whiterook - 1][SQUARE64(a1)];
-				key ^= ZobristKey[whiterook - 1][SQUARE64(d1)];
+				key ^= Zobrist.key[whiterook - 1][SQUARE64(a1)];
+				key ^= Zobrist.key[whiterook - 1][SQUARE64(d1)];
 				break;
 			case c8:
-				key ^= ZobristKey[blackrook - 1][SQUARE64(a8)];
-				key ^= ZobristKey[blackrook - 1][SQUARE64(d8)];
+				key ^= Zobrist.key[blackrook - 1][SQUARE64(a8)];
+				key ^= Zobrist.key[blackrook - 1][SQUARE64(d8)];
 				break;
 			}
 		}
@@ -724,27 +1141,27 @@ HASHKEY ChessBoard::newHashkey(const ChessMove& m, HASHKEY key)
 					e = c;
 				else
 					e = c & d;
-				key ^= ZobristKey[12][castle];
-				key ^= ZobristKey[12][e];
+				key ^= Zobrist.key[12][castle];
+				key ^= Zobrist.key[12][e];
 			}
 		}
 	}
 
 	// Remove old ep.
 	if (enPassant != UNDEF)
-		key ^= ZobristKey[12][17 + FILE(enPassant)];
+		key ^= Zobrist.key[12][17 + FILE(enPassant)];
 
 	// Add ep
 	if (m.moveType&DBLPAWNMOVE)
 	{
 		if (LEGALSQUARE(m.toSquare-1)&& (board[m.toSquare-1]== COLORPIECE(OTHERPLAYER(toMove), PAWN)))
-			key ^= ZobristKey[12][17 + FILE(m.toSquare)];
+			key ^= Zobrist.key[12][17 + FILE(m.toSquare)];
 		else if ((LEGALSQUARE(m.toSquare + 1)) && (board[m.toSquare + 1] == COLORPIECE(OTHERPLAYER(toMove), PAWN)))
-			key ^= ZobristKey[12][17 + FILE(m.toSquare)];
+			key ^= Zobrist.key[12][17 + FILE(m.toSquare)];
 	}
 
 	// Change color to move
-	key ^= ZobristKey[12][16];
+	key ^= Zobrist.key[12][16];
 
 	return key;
 }
@@ -786,11 +1203,8 @@ const std::string ChessBoard::makeMoveText(const ChessMove& m, int type)
 
 char* ChessBoard::makeMoveText(const ChessMove& cm, char* buf, int bufsize, int type)
 {
-	int it, cnt, f, r;
-	int p = 0;
-	typePiece piece;
-	std::string mt;
 	ChessMove m;
+	char sz[16];
 	buf[0] = '\0';
 
 	// Uci format allow null move
@@ -800,145 +1214,85 @@ char* ChessBoard::makeMoveText(const ChessMove& cm, char* buf, int bufsize, int
 		return buf;
 	}
 
-	// Be sure that all field in the move is filled (capture, ep etc.)
-	mt = 'a' + FILE(cm.fromSquare);
-	mt += '1' + RANK(cm.fromSquare);
-	mt += 'a' + FILE(cm.toSquare);
-	mt += '1' + RANK(cm.toSquare);
-	if (cm.moveType&PROMOTE)
-		mt += tolower(getCharFromPiece(cm.promotePiece));
+	// The uci move is written without checking it.
 	if (type == UCI)
 	{
-		strcpy_s(buf, bufsize, mt.c_str());
+		m = cm;
+		writeMoveText(*this, m, sz, UCI);
+		strcpy_s(buf, bufsize, sz);
 		return buf;
 	}
 
-	m = getMoveFromText(mt);
-	if (m.empty())
+	// Be sure that all field in the move is filled (capture, ep etc.)
+	if (!findLegalMove(*this, cm, m))
 		return buf;
+	writeMoveText(*this, m, sz, type);
+	strcpy_s(buf, bufsize, sz);
+	return buf;
+}
+
+bool ChessBoard::isLegal(ChessMove& m)
+{
+	ChessMove mm;
+	return findLegalMove(*this, m, mm);
+}
 
-	// For coordinate system there isn't needed more work
-	if (type == COOR)
+const ChessMove ChessBoard::getLegalMove(const ChessMove& cm)
+{
+	ChessMove m;
+	if (!findLegalMove(*this, cm, m))
 	{
-		strcpy_s(buf, bufsize, mt.c_str());
-		return buf;
+		m.clear();
+		m.score = 1;
 	}
-	m.score = cm.score;
+	return m;
+}
 
-	MoveList* ml1 = new MoveList;
-	MoveList* ml2 = new MoveList;
-//	MoveList ml1;
-//	MoveList ml2;
-	MoveGenerator mg;
+int ChessBoard::makeMovesText(const ChessMove* moves, int count, char* buf, int bufsize, int type)
+{
+	ChessBoard b(*this);
+	MoveGenerator gen;
+	ChessMove m;
+	char sz[16];
+	int i, len, p = 0;
 
-	piece = PIECE(board[m.fromSquare]);
-	switch (piece)
+	buf[0] = '\0';
+	for (i = 0; i < count; i++)
 	{
-	case PAWN:
-		if ((type == LAN) || (m.moveType&CAPTURE))
-		{
-			buf[p++] = 'a' + FILE(m.fromSquare);
-			if (type == LAN)
-			{
-				buf[p++] = '1' + RANK(m.fromSquare);
-			}
-		}
-		break;
-	case KNIGHT:
-	case BISHOP:
-	case ROOK:
-	case QUEEN:
-		buf[p++] = getCharFromPiece(piece);
-		if (type == LAN)
-		{
-			buf[p++] = 'a' + FILE(m.fromSquare);
-			buf[p++] = '1' + RANK(m.fromSquare);
+		if (!findLegalMove(b, moves[i], m))
 			break;
-		}
-		mg.makeMoves(*this, *ml1);
-		it = 0;
-		while (it<ml1->size())
-		{
-			if ((ml1->at(it).toSquare == m.toSquare) && (PIECE(board[ml1->at(it).fromSquare]) == piece))
-				ml2->push_back(ml1->at(it));
-			it++;
-		};
-		if (ml2->size()>1)
-		{
-			f = FILE(m.fromSquare);
-			r = RANK(m.fromSquare);
-			it = 0;
-			cnt = 0;
-			while (it<ml2->size())
-			{
-				if (FILE(ml2->at(it).fromSquare) == f)
-					cnt++;
-				it++;
-			};
-			if (cnt == 1)
-			{
-				buf[p++] = 'a' + f;
-				break;
-			}
-			buf[p++] = '1' + r;
-		}
-		break;
-	case KING:
-		if (m.moveType&CASTLE)
-		{
-			strcpy_s(buf, bufsize, "O-O");
-			if (FILE(m.toSquare) == 2)
-				strcat_s(buf, bufsize, "-O");
-			mg.doMove(*this, m);
-			if (mg.inCheck(*this, toMove))
-				strcat_s(buf, bufsize, "+");
-			mg.undoMove(*this, m);
-			return buf;
-		}
-		buf[p++] = 'K';
-		if (type == LAN)
-		{
-			buf[p++] = 'a' + FILE(m.fromSquare);
-			buf[p++] = '1' + RANK(m.fromSquare);
-		}
-		break;
+		len = writeMoveText(b, m, sz, type);
+		if (p + len + (p ? 1 : 0) >= bufsize)
+			break;
+		if (p)
+			buf[p++] = ' ';
+		memcpy(buf + p, sz, len + 1);
+		p += len;
+		gen.doMove(b, m);
 	}
+	return i;
+}
 
-	if (m.moveType&CAPTURE)
-		buf[p++] = 'x';
-	else if (type == LAN)
-		buf[p++] = '-';
+int ChessBoard::makeMovesText(const MoveList& ml, std::string& text, int type)
+{
+	ChessBoard b(*this);
+	MoveGenerator gen;
+	ChessMove m;
+	char sz[16];
+	int i;
 
-	buf[p++] = 'a' + FILE(m.toSquare);
-	buf[p++] = '1' + RANK(m.toSquare);
-	if (m.moveType&PROMOTE)
-	{
-		if (type == SAN)
-			buf[p++] = '=';
-		buf[p++] = getCharFromPiece(m.promotePiece);
-	}
-	mg.doMove(*this, m);
-	if (mg.inCheck(*this, toMove))
-	{
-		mg.makeMoves(*this, *ml1);
-		if (ml1->size() == 0)
-			buf[p++] = '#';
-		else
-			buf[p++] = '+';
-	}
-	mg.undoMove(*this, m);
-	if ((type == FIDE) && (m.moveType&ENPASSANT))
+	text.clear();
+	for (i = 0; i < ml.size(); i++)
 	{
-		//    buf[p++]=' '; // Could gives unwanted linebreak
-		buf[p++] = 'e';
-		buf[p++] = '.';
-		buf[p++] = 'p';
-		buf[p++] = '.';
+		if (!findLegalMove(b, ml[i], m))
+			break;
+		writeMoveText(b, m, sz, type);
+		if (i)
+			text += ' ';
+		text += sz;
+		gen.doMove(b, m);
 	}
-	buf[p++] = '\0';
-	delete ml1;
-	delete ml2;
-	return buf;
+	return i;
 }
 
 char ChessBoard::getCharFromPiece(typePiece p)
@@ -3,6 +3,7 @@
 #include <string>
 #include "../Common/defs.h"
 #include "../Common/ChessMove.h"
+#include "../Common/MoveList.h"
 
 enum { FIDE, SAN, LAN, COOR, UCI };
 
@@ -37,8 +38,14 @@ public:
 	bool doMove(const char* sz);
 	// Checking from square, to square, castle and promoting (defaults to queen)
 	bool isLegal(ChessMove& m);
+	// The legal move with the squares and promotion piece of a move, with the
+	// other fields filled in. If illegal move the move.score>0
+	const ChessMove getLegalMove(const ChessMove& cm);
+	// Read a move in SAN, LAN, coordinate or UCI notation.
 	// If illegal move the move.score>0
-	const ChessMove getMoveFromText(const std::string text);
+	const ChessMove getMoveFromText(const std::string& text);
+	// The text doesn't need to be zero terminated.
+	const ChessMove getMoveFromText(const char* text, size_t length);
 	// Strip 'non' important characters from a movestring
 	char* stripMoveText(char* mt);
 	bool isRowChar(char c);
@@ -61,6 +68,11 @@ public:
 	const std::string makeMoveText(const ChessMove& m, int type);
 	char* makeMoveText(const ChessMove& cm, char* buf, int bufsize, const char* charset);
 	const std::string makeMoveText(const ChessMove& m,  const std::string& charset);
+	// Write a line of moves from this position separated by spaces, the moves
+	// are done on a copy of the board. Stops at an illegal move or when buf is
+	// full, returns the number of moves written.
+	int makeMovesText(const ChessMove* moves, int count, char* buf, int bufsize, int type);
+	int makeMovesText(const MoveList& ml, std::string& text, int type);
 	bool isStartposition();
 	void setStartposition();
 
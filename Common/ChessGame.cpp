@@ -12,6 +12,20 @@ ChessGame::ChessGame()
   piecechar="NBRQK";
 }
 
+ChessGame::ChessGame(const ChessGame& g)
+{
+  piecechar=g.piecechar;
+  copy(g);
+}
+
+// The positions and the header are taken from g, g is left empty.
+ChessGame::ChessGame(ChessGame&& g) noexcept
+{
+  activePosition=-1;
+  piecechar=g.piecechar;
+  swap(g);
+}
+
 ChessGame::~ChessGame()
 {
 }
@@ -214,7 +228,7 @@ bool ChessGame::addMove(const char* sz)
   if (strcmp(sz,"null")==0)
     m.moveType=NULL_MOVE;
   else
-    m=position[activePosition].board.getMoveFromText(sz);
+    m=position[activePosition].board.getMoveFromText(sz,strlen(sz));
   if (m.empty())
     return false;
   return addMove(m);
@@ -662,11 +676,16 @@ void ChessGame::iterateMoves(std::string& s, int pos, int mn, bool comment, bool
 
 void ChessGame::copy(const ChessGame& g)
 {
-  clear();
   activePosition=g.activePosition;
   info=g.info;
-  for (unsigned int i=0;i<g.position.size();i++)
-    position.push_back(g.position[i]);
+  position=g.position;
+}
+
+void ChessGame::swap(ChessGame& g)
+{
+  std::swap(info,g.info);
+  position.swap(g.position);
+  std::swap(activePosition,g.activePosition);
 }
 
 
@@ -45,17 +45,6 @@ struct ChessGamePosition
     }
     return -1;
   }
-  ChessGamePosition& operator=(const ChessGamePosition& b)
-  {
-    unsigned int i;
-    fromIndex=b.fromIndex;
-    board=b.board;
-    comment=b.comment;
-    move.clear();
-    for (i=0;i<b.move.size();i++)
-      move.push_back(b.move[i]);
-    return *this;
-  };
 };
 
 struct ChessGameInfo
@@ -102,30 +91,6 @@ struct ChessGameInfo
     Remark.erase();
     Annotator.erase();
   };
-
-  ChessGameInfo& operator=(const ChessGameInfo& b)
-  { 
-    Event=b.Event;
-    Site=b.Site;
-    White=b.White;
-    Black=b.Black;
-    Round=b.Round;
-    Date=b.Date;
-    Result=b.Result;
-    WhiteElo=b.WhiteElo;
-    BlackElo=b.BlackElo;
-    WhiteType=b.WhiteType;
-    BlackType=b.BlackType;
-	WhiteTimeControl = b.WhiteTimeControl;
-	BlackTimeControl = b.BlackTimeControl;
-	ECO=b.ECO;
-    Opening=b.Opening;
-    Variation=b.Variation;
-    SubVariation=b.SubVariation;
-    Remark=b.Remark;
-    Annotator=b.Annotator;
-    return *this;
-  };
 };
 
 class ChessGame
@@ -134,9 +99,13 @@ public:
   std::vector<ChessGamePosition> position;
   ChessGameInfo info;
   ChessGame();
+  ChessGame(const ChessGame& g);
+  ChessGame(ChessGame&& g) noexcept;
   virtual ~ChessGame();
   void clear(bool keepheader=false);
   void copy(const ChessGame& g);
+  // Exchange the games without copying the positions.
+  void swap(ChessGame& g);
   void getStartPosition(ChessBoard& cb);
   void setStartPosition(const ChessBoard& cb);
   void setStartPosition(const char* fen);
@@ -159,6 +128,8 @@ public:
   int getVariation(int n, bool comment, ChessGame& variation);
   ChessGame& operator=(const ChessGame& b)
   { copy(b); return *this;};
+  ChessGame& operator=(ChessGame&& b) noexcept
+  { swap(b); b.clear(); return *this;};
   // 1=3-fold draw, 2=50 move draw.
   int isDraw();
   void backup(unsigned int n);
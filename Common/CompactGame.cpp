@@ -0,0 +1,315 @@
+#include <string.h>
+#include "../Common/CompactGame.h"
+
+using namespace std;
+
+// The ChessGameInfo fields in the order they are kept in the text.
+static std::string ChessGameInfo::* const headerField[]=
+{
+  &ChessGameInfo::Event, &ChessGameInfo::Site, &ChessGameInfo::White, &ChessGameInfo::Black,
+  &ChessGameInfo::Round, &ChessGameInfo::Date, &ChessGameInfo::Result, &ChessGameInfo::WhiteElo,
+  &ChessGameInfo::BlackElo, &ChessGameInfo::WhiteType, &ChessGameInfo::BlackType,
+  &ChessGameInfo::WhiteTimeControl, &ChessGameInfo::BlackTimeControl, &ChessGameInfo::ECO,
+  &ChessGameInfo::Opening, &ChessGameInfo::Variation, &ChessGameInfo::SubVariation,
+  &ChessGameInfo::Remark, &ChessGameInfo::Annotator
+};
+
+const int HEADERFIELDS=sizeof(headerField)/sizeof(headerField[0]);
+
+void CompactBoard::pack(const ChessBoard& cb)
+{
+  int sq;
+  memset(squares,0,sizeof(squares));
+  for (sq=0;sq<64;sq++)
+    squares[sq/2]|=cb[sq]<<((sq&1)*4);
+  castle=cb.castle;
+  enPassant=cb.enPassant;
+  toMove=cb.toMove;
+  move50draw=__min(cb.move50draw,255);
+}
+
+void CompactBoard::unpack(ChessBoard& cb) const
+{
+  int sq;
+  cb.clear();
+  for (sq=0;sq<64;sq++)
+    cb[sq]=(squares[sq/2]>>((sq&1)*4))&0x0f;
+  cb.castle=castle;
+  cb.enPassant=enPassant;
+  cb.toMove=toMove;
+  cb.move50draw=move50draw;
+}
+
+CompactGame::CompactGame()
+{
+  clear();
+}
+
+void CompactGame::clear()
+{
+  moves.clear();
+  lines.clear();
+  checkpoints.clear();
+  comments.clear();
+  text.clear();
+  memset(header,0,sizeof(header));
+}
+
+void CompactGame::swap(CompactGame& g)
+{
+  DWORD h[20];
+  moves.swap(g.moves);
+  lines.swap(g.lines);
+  checkpoints.swap(g.checkpoints);
+  comments.swap(g.comments);
+  text.swap(g.text);
+  memcpy(h,header,sizeof(header));
+  memcpy(header,g.header,sizeof(header));
+  memcpy(g.header,h,sizeof(header));
+}
+
+CompactMove CompactGame::encode(const ChessMove& m)
+{
+  CompactMove cm;
+  if (m.moveType&NULL_MOVE)
+    return COMPACT_NULLMOVE;
+  cm=SQUARE64(m.fromSquare)|(SQUARE64(m.toSquare)<<6);
+  if (m.moveType&PROMOTE)
+    cm|=COMPACT_PROMOTE|((PIECE(m.promotePiece)-KNIGHT)<<12);
+  return cm;
+}
+
+ChessMove CompactGame::decode(ChessBoard& cb, CompactMove cm)
+{
+  ChessMove m;
+  if (cm&COMPACT_NULLMOVE)
+  {
+    m.moveType=NULL_MOVE;
+    return m;
+  }
+  m.fromSquare=SQUARE128(cm&0x3f);
+  m.toSquare=SQUARE128((cm>>6)&0x3f);
+  if (cm&COMPACT_PROMOTE)
+  {
+    m.moveType=PROMOTE;
+    m.promotePiece=KNIGHT+((cm>>12)&3);
+  }
+  return cb.getLegalMove(m);
+}
+
+void CompactGame::addComment(DWORD key, const std::string& s)
+{
+  CompactComment c;
+  if (s.empty())
+    return;
+  c.key=key;
+  c.offset=(DWORD)text.length();
+  c.length=(DWORD)s.length();
+  text+=s;
+  comments.push_back(c);
+}
+
+// Add the moves of a line, from the move firstMove in position pos and then
+// the first move of each position. The variations are added after it.
+void CompactGame::setLine(const ChessGame& game, int line, int pos, int firstMove)
+{
+  CompactBoard cb;
+  DWORD ply,move;
+  int p,n,i;
+
+  lines[line].first=(DWORD)moves.size();
+  lines[line].checkpoint=(DWORD)checkpoints.size();
+  p=pos;
+  n=firstMove;
+  for (ply=0;;ply++)
+  {
+    if ((ply%COMPACT_CHECKPOINT)==0)
+    {
+      cb.pack(game.position[p].board);
+      checkpoints.push_back(cb);
+    }
+    if ((int)game.position[p].move.size()<=n)
+      break;
+    const ChessGameMove& cgm=game.position[p].move[n];
+    move=(DWORD)moves.size();
+    moves.push_back(encode(cgm.move));
+    p=cgm.posIndex;
+    addComment((move+1)*2,game.position[p].comment);
+    addComment((move+1)*2+1,cgm.comment);
+    n=0;
+  }
+  lines[line].length=ply;
+
+  // The variations, the other moves in the positions of the line. The
+  // other moves in the first position are variations of the parent line.
+  p=pos;
+  n=firstMove;
+  for (ply=0;ply<lines[line].length;ply++)
+  {
+    if ((line==0) || (ply>0))
+    {
+      for (i=1;i<(int)game.position[p].move.size();i++)
+      {
+        CompactLine cl;
+        cl.parent=line;
+        cl.branch=ply;
+        lines.push_back(cl);
+        setLine(game,(int)lines.size()-1,p,i);
+      }
+    }
+    p=game.position[p].move[n].posIndex;
+    n=0;
+  }
+}
+
+void CompactGame::set(const ChessGame& game)
+{
+  CompactLine cl;
+  size_t i,n;
+  clear();
+
+  for (i=0;i<HEADERFIELDS;i++)
+  {
+    header[i]=(DWORD)text.length();
+    text+=game.info.*headerField[i];
+  }
+  header[HEADERFIELDS]=(DWORD)text.length();
+  if (game.position.empty())
+    return;
+
+  // Each position but the start is made by one move, and each move but
+  // the first in a position starts a line.
+  n=1;
+  for (i=0;i<game.position.size();i++)
+    if (game.position[i].move.size()>1)
+      n+=game.position[i].move.size()-1;
+  moves.reserve(game.position.size()-1);
+  lines.reserve(n);
+  addComment(0,game.position[0].comment);
+  cl.parent=-1;
+  cl.branch=0;
+  lines.push_back(cl);
+  setLine(game,0,0,0);
+}
+
+void CompactGame::getInfo(ChessGameInfo& info) const
+{
+  int i;
+  for (i=0;i<HEADERFIELDS;i++)
+    (info.*headerField[i]).assign(text,header[i],header[i+1]-header[i]);
+}
+
+bool CompactGame::get(ChessGame& game) const
+{
+  ChessGamePosition cgp;
+  ChessGameMove cgm;
+  ChessBoard cb;
+  vector<int> posIndex(moves.size());
+  size_t c=0;
+  DWORD key,move;
+  int line,pos;
+
+  game.clear();
+  getInfo(game.info);
+  if (lines.empty())
+    return true;
+  game.position.reserve(moves.size()+1);
+  checkpoints[0].unpack(cgp.board);
+  if (comments.size() && (comments[0].key==0))
+  {
+    cgp.comment.assign(text,comments[0].offset,comments[0].length);
+    c=1;
+  }
+  game.position.push_back(cgp);
+
+  // The lines are in the order the moves are in each position.
+  for (line=0;line<(int)lines.size();line++)
+  {
+    const CompactLine& cl=lines[line];
+    pos=(cl.parent<0)?0:posIndex[lines[cl.parent].first+cl.branch];
+    for (move=cl.first;move<cl.first+cl.length;move++)
+    {
+      posIndex[move]=pos;
+      cb=game.position[pos].board;
+      cgm.move=decode(cb,moves[move]);
+      if (cgm.move.score)
+      {
+        // The later lines would branch from positions never made.
+        game.position.clear();
+        return false;
+      }
+      cgp.board=cb;
+      cgp.board.doMove(cgm.move,false);
+      cgp.fromIndex=pos;
+      cgp.comment.clear();
+      cgm.comment.clear();
+      cgm.posIndex=(int)game.position.size();
+      key=(move+1)*2;
+      while ((c<comments.size()) && (comments[c].key<key))
+        ++c;
+      if ((c<comments.size()) && (comments[c].key==key))
+      {
+        cgp.comment.assign(text,comments[c].offset,comments[c].length);
+        ++c;
+      }
+      if ((c<comments.size()) && (comments[c].key==key+1))
+      {
+        cgm.comment.assign(text,comments[c].offset,comments[c].length);
+        ++c;
+      }
+      game.position[pos].move.push_back(cgm);
+      game.position.push_back(cgp);
+      pos=cgm.posIndex;
+    }
+  }
+  game.activePosition=0;
+  return true;
+}
+
+bool CompactGame::getBoard(int line, int ply, ChessBoard& cb) const
+{
+  ChessMove m;
+  DWORD i;
+  if ((line<0) || (line>=(int)lines.size()) || (ply<0) || ((DWORD)ply>lines[line].length))
+    return false;
+  const CompactLine& cl=lines[line];
+  checkpoints[cl.checkpoint+ply/COMPACT_CHECKPOINT].unpack(cb);
+  for (i=ply-ply%COMPACT_CHECKPOINT;i<(DWORD)ply;i++)
+  {
+    m=decode(cb,moves[cl.first+i]);
+    if (m.score)
+      return false;
+    cb.doMove(m,false);
+  }
+  return true;
+}
+
+bool CompactGame::getComment(DWORD key, std::string& s) const
+{
+  size_t lo=0,hi=comments.size(),mid;
+  s.clear();
+  while (lo<hi)
+  {
+    mid=(lo+hi)/2;
+    if (comments[mid].key<key)
+      lo=mid+1;
+    else
+      hi=mid;
+  }
+  if ((lo==comments.size()) || (comments[lo].key!=key))
+    return false;
+  s.assign(text,comments[lo].offset,comments[lo].length);
+  return true;
+}
+
+size_t CompactGame::memory() const
+{
+  size_t n=sizeof(CompactGame);
+  n+=moves.capacity()*sizeof(CompactMove);
+  n+=lines.capacity()*sizeof(CompactLine);
+  n+=checkpoints.capacity()*sizeof(CompactBoard);
+  n+=comments.capacity()*sizeof(CompactComment);
+  if (text.capacity()>15)
+    n+=text.capacity()+1;
+  return n;
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <windows.h>
+#include <string>
+#include <vector>
+#include "../Common/ChessBoard.h"
+#include "../Common/ChessGame.h"
+
+// A move in 16 bits. From square (0-63) in bit 0-5, to square in bit 6-11,
+// promotion piece (0=knight .. 3=queen) in bit 12-13, bit 14 is set for a
+// promotion and bit 15 for a null move.
+typedef WORD CompactMove;
+
+const CompactMove COMPACT_PROMOTE=0x4000;
+const CompactMove COMPACT_NULLMOVE=0x8000;
+
+// Plies between the boards kept in each line.
+const int COMPACT_CHECKPOINT=32;
+
+// Board for a checkpoint, two squares in each byte.
+struct CompactBoard
+{
+  BYTE squares[32]; // a1 in the low bits of the first
+  BYTE castle;
+  BYTE enPassant;   // 0x88 square
+  BYTE toMove;
+  BYTE move50draw;
+  void pack(const ChessBoard& cb);
+  void unpack(ChessBoard& cb) const;
+};
+
+// A line of moves. Line 0 is the main line from the start position, a
+// variation is an alternative to the move at ply branch in the parent line.
+// The lines are in the order the variations are written in pgn, so the
+// parent is always before.
+struct CompactLine
+{
+  DWORD first;      // First move in moves
+  DWORD length;
+  int parent;       // -1 for the main line
+  DWORD branch;
+  DWORD checkpoint; // First checkpoint of the line
+};
+
+// A comment in the text. The key is (move+1)*2 for the comment of the
+// position after a move (0 for the start position) and (move+1)*2+1 for the
+// comment of a move, the comments are sorted by the key.
+struct CompactComment
+{
+  DWORD key;
+  DWORD offset;
+  DWORD length;
+};
+
+// A game in a compact form for tools that keep many games in memory. The
+// moves of all lines are in one array of 16 bit moves, the header and the
+// comments are in one string, and only a board every COMPACT_CHECKPOINT
+// plies of each line is kept. The other boards are made from the nearest
+// checkpoint when asked for. All members are standard containers, so a game
+// can be moved or swapped without copying.
+// A ChessGame is converted with set() and get(), for editing in the Gui.
+class CompactGame
+{
+  void setLine(const ChessGame& game, int line, int pos, int firstMove);
+  void addComment(DWORD key, const std::string& s);
+public:
+  std::vector<CompactMove> moves;
+  std::vector<CompactLine> lines;
+  std::vector<CompactBoard> checkpoints;
+  std::vector<CompactComment> comments;
+  std::string text;
+  DWORD header[20]; // Start of each ChessGameInfo field in text, and the end
+  CompactGame();
+  void clear();
+  void swap(CompactGame& g);
+  void set(const ChessGame& game);
+  // False if a move can't be decoded, the game then only has the header.
+  bool get(ChessGame& game) const;
+  void getInfo(ChessGameInfo& info) const;
+  // Number of halfmoves in the main line.
+  int mainMoves() const { return lines.size()?lines[0].length:0; };
+  // The board before a move in a line, ply can be the length of the line.
+  bool getBoard(int line, int ply, ChessBoard& cb) const;
+  // The comment of a position or a move, see CompactComment.
+  bool getComment(DWORD key, std::string& s) const;
+  // Bytes used by the game.
+  size_t memory() const;
+  static CompactMove encode(const ChessMove& m);
+  // The move on the board, with the fields filled in. If illegal move the move.score>0
+  static ChessMove decode(ChessBoard& cb, CompactMove cm);
+};
@@ -59,12 +59,14 @@ bool Engine::load(QString& enginefile)
 		con = connect(uci, SIGNAL(engineStarted()), SLOT(slotEngineStarted()));
 		con = connect(uci, SIGNAL(engineStoped()), SLOT(slotEngineStoped()));
 		con = connect(uci, SIGNAL(engineInfo(const EngineInfo&)), SLOT(slotEngineInfo(const EngineInfo&)));
+		con = connect(uci, SIGNAL(engineMove(const QString&, const QString&)), SLOT(slotEngineMove(const QString&, const QString&)));
 		return uci->load(enginepath);
 	}
 	
 	con = connect(xboard, SIGNAL(engineStarted()), SLOT(slotEngineStarted()));
 	con = connect(xboard, SIGNAL(engineStoped()), SLOT(slotEngineStoped()));
 	con = connect(xboard, SIGNAL(engineInfo(const EngineInfo&)), SLOT(slotEngineInfo(const EngineInfo&)));
+	con = connect(xboard, SIGNAL(engineMove(const QString&, const QString&)), SLOT(slotEngineMove(const QString&, const QString&)));
 	return xboard->load(enginepath);
 }
 
@@ -82,6 +84,11 @@ void Engine::slotEngineInfo(const EngineInfo& ei)
 {
 	emit engineInfo(ei);
 }
+
+void Engine::slotEngineMove(const QString& move, const QString& ponder)
+{
+	emit engineMove(move, ponder);
+}
 /*
 bool Engine::loadSetup(QString& setup)
 {
@@ -141,64 +148,11 @@ void Engine::analyze(ChessBoard& board)
 
 void Engine::search(ChessBoard& board, MoveList& moves, SEARCHTYPE searchtype, int wtime, int winc, int btime, int binc, int movestogo)
 {
-/*	if (!process)
-		return;
-	QString cmd;
-	QStringList list;
-	ChessBoard b;
-	int i;
-	currentBoard = board;
-	for (i = 0; i < moves.size; i++)
-	{
-		list.append(currentBoard.makeMoveText(moves.at(i),UCI).c_str());
-		if (!currentBoard.doMove(moves.at(i), true))
-			break;
-	}
-	string s=board.getFen();
-	cmd = "position fen ";
-
-	if (board.isStartposition())
-		cmd += "startfen";
-	else
-		cmd += board.getFen(true).c_str();
-	if (list.size())
-	{
-		cmd += " moves";
-		QStringList::iterator lit = list.begin();
-		while (lit != list.end())
-		{
-			cmd += " ";
-			cmd += *lit;
-			++lit;
-		}
-	}
-	// If engine playing white it is most probaly not ready yet.
-	if (readyok)
-		write(cmd);
-	else
-		waitCommand += cmd;
-	cmd="go";
-	if (searchtype == PONDER_SEARCH)
-		cmd += " ponder";
-	if (searchtype == INFINITE_SEARCH)
-	{
-		cmd += " infinite";
-	}
-	else
-	{
-		cmd += " wtime " + QString().setNum(wtime);
-		cmd += " btime " + QString().setNum(btime);
-		cmd += " winc " + QString().setNum(winc);
-		cmd += " binc " + QString().setNum(binc);
-	}
-	if (movestogo)
-		cmd += "movestogo " + QString().setNum(movestogo);
-	cmd += "\n";
-	if (readyok)
-		write(cmd);
-	else
-		waitCommand += cmd;
-*/}
+	if (xboard)
+		xboard->search(board, moves, searchtype, wtime, winc, btime, binc, movestogo);
+	else if (uci)
+		uci->search(board, moves, searchtype, wtime, winc, btime, binc, movestogo);
+}
 
 void Engine::stop()
 {
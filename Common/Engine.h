@@ -21,6 +21,7 @@ public slots:
 	void slotEngineStarted();
 	void slotEngineStoped();
 	void slotEngineInfo(const EngineInfo&);
+	void slotEngineMove(const QString&, const QString&);
 signals:
 	void engineMessage(const QString&);
 	void engineMove(const QString&, const QString&);
@@ -330,12 +330,16 @@ std::string Epd::getFen()
   s+=' ';
   s+=enpassant;
   s+=' ';
-  s+=_itoa_s(hmvc,sz,20,10);
+  sprintf(sz,"%i",hmvc);
+  s+=sz;
   s+=' ';
   if (fmvn<1)
     s+='1';
   else
-    s+=_itoa_s(fmvn,sz,20,10);
+  {
+    sprintf(sz,"%i",fmvn);
+    s+=sz;
+  }
   return s;
 }
 
@@ -0,0 +1,875 @@
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <ctype.h>
+#include <algorithm>
+#include "../Common/GameBase.h"
+#include "../Common/CompactGame.h"
+#include "../Common/MoveGenerator.h"
+#include "../Common/LookupTables.h"
+#include "../Common/PgnPipeline.h"
+#include "../Common/Pgn.h"
+
+using namespace std;
+
+struct GameBaseHeader
+{
+  char magic[4];
+  DWORD entrySize;
+};
+
+static const char GBH_MAGIC[4] = { 'G','B','H','1' };
+
+// Read buffer for the header and move files, small as most reads are random.
+const size_t GAMEBASE_BUFFERSIZE=0x10000;
+// Size of the appended moves when they are written.
+const size_t GAMEBASE_FLUSHSIZE=0x100000;
+// Offsets read at a time, the length in WinFile is a DWORD.
+const size_t GAMEBASE_CHUNK=0x10000;
+
+// The ChessGameInfo fields by the number used for the fields after the moves.
+static std::string ChessGameInfo::* const infoField[]=
+{
+  &ChessGameInfo::Event, &ChessGameInfo::Site, &ChessGameInfo::White, &ChessGameInfo::Black,
+  &ChessGameInfo::Round, &ChessGameInfo::Date, &ChessGameInfo::Result, &ChessGameInfo::WhiteElo,
+  &ChessGameInfo::BlackElo, &ChessGameInfo::WhiteType, &ChessGameInfo::BlackType,
+  &ChessGameInfo::WhiteTimeControl, &ChessGameInfo::BlackTimeControl, &ChessGameInfo::ECO,
+  &ChessGameInfo::Opening, &ChessGameInfo::Variation, &ChessGameInfo::SubVariation,
+  &ChessGameInfo::Remark, &ChessGameInfo::Annotator
+};
+
+const int INFOFIELDS=sizeof(infoField)/sizeof(infoField[0]);
+enum { FIELD_DATE=5, FIELD_RESULT=6, FIELD_WHITEELO=7, FIELD_BLACKELO=8, FIELD_ECO=13 };
+
+static void putVarint(std::string& s, DWORD n)
+{
+  while (n>=0x80)
+  {
+    s+=(char)(n|0x80);
+    n>>=7;
+  }
+  s+=(char)n;
+}
+
+static bool getVarint(const BYTE*& p, const BYTE* end, DWORD& n)
+{
+  int shift=0;
+  n=0;
+  while ((p<end) && (shift<32))
+  {
+    n|=(DWORD)(*p&0x7f)<<shift;
+    if (!(*p++&0x80))
+      return true;
+    shift+=7;
+  }
+  return false;
+}
+
+static int readNumber(const std::string& s, size_t start, size_t length)
+{
+  int n=0;
+  size_t i;
+  if (s.length()<start+length)
+    return 0;
+  for (i=start;i<start+length;i++)
+  {
+    if ((s[i]<'0') || (s[i]>'9'))
+      return 0;
+    n=n*10+s[i]-'0';
+  }
+  return n;
+}
+
+// Set the fields of the entry that are numbers.
+static void setNumbers(GameBaseEntry& e, const ChessGameInfo& info)
+{
+  // yyyy.mm.dd, ?? is 0.
+  e.date=readNumber(info.Date,0,4)*10000+readNumber(info.Date,5,2)*100+readNumber(info.Date,8,2);
+  if (info.Result=="1-0")
+    e.result=1;
+  else if (info.Result=="0-1")
+    e.result=2;
+  else if (info.Result=="1/2-1/2")
+    e.result=3;
+  e.whiteElo=(WORD)__min(readNumber(info.WhiteElo,0,info.WhiteElo.length()),0xffff);
+  e.blackElo=(WORD)__min(readNumber(info.BlackElo,0,info.BlackElo.length()),0xffff);
+  if ((info.ECO.length()==3) && (info.ECO[0]>='A') && (info.ECO[0]<='E') && isdigit((BYTE)info.ECO[1]) && isdigit((BYTE)info.ECO[2]))
+    e.eco=(info.ECO[0]-'A')*100+readNumber(info.ECO,1,2)+1;
+}
+
+// The text of a field that is a number in the entry.
+static std::string numberField(const GameBaseEntry& e, int field)
+{
+  static const char* result[]={ "*","1-0","0-1","1/2-1/2" };
+  char sz[16];
+  switch (field)
+  {
+  case FIELD_DATE:
+    if (!e.date)
+      return "????.??.??";
+    sprintf_s(sz,sizeof(sz),"%04u.%02u.%02u",e.date/10000,(e.date/100)%100,e.date%100);
+    if (!(e.date/10000))
+      memcpy(sz,"????",4);
+    if (!((e.date/100)%100))
+      memcpy(sz+5,"??",2);
+    if (!(e.date%100))
+      memcpy(sz+8,"??",2);
+    return sz;
+  case FIELD_RESULT:
+    return result[e.result&3];
+  case FIELD_WHITEELO:
+  case FIELD_BLACKELO:
+    if (!((field==FIELD_WHITEELO)?e.whiteElo:e.blackElo))
+      return "";
+    sprintf_s(sz,sizeof(sz),"%u",(field==FIELD_WHITEELO)?e.whiteElo:e.blackElo);
+    return sz;
+  case FIELD_ECO:
+    if (!e.eco)
+      return "";
+    sprintf_s(sz,sizeof(sz),"%c%02u",'A'+(e.eco-1)/100,(e.eco-1)%100);
+    return sz;
+  }
+  return "";
+}
+
+// Number of keys made by makeKeys, more than the moves in any position.
+const int GAMEBASE_MAXKEYS=320;
+
+static inline void addKey(CompactMove* keys, int& n, typeSquare from, typeSquare to)
+{
+  if (n<GAMEBASE_MAXKEYS)
+    keys[n++]=SQUARE64(from)|(SQUARE64(to)<<6);
+}
+
+static void addPawnKeys(CompactMove* keys, int& n, typeSquare from, typeSquare to, bool promote)
+{
+  int i;
+  if (!promote)
+  {
+    addKey(keys,n,from,to);
+    return;
+  }
+  for (i=0;(i<4) && (n<GAMEBASE_MAXKEYS);i++)
+    keys[n++]=SQUARE64(from)|(SQUARE64(to)<<6)|COMPACT_PROMOTE|(i<<12);
+}
+
+// The moves of the side to move as CompactMove, without checking for check.
+// The moves are in a fixed order, the pieces from a1 to h8 and the moves of
+// each piece in the order of the paths. The index of a move in this order is
+// what is stored in the move file, so it must not change. When reading a
+// move only the keys up to its index are needed, so it stops at the first
+// piece after the key last.
+static int makeKeys(const ChessBoard& b, CompactMove* keys, int last=GAMEBASE_MAXKEYS)
+{
+  typeSquare sq, to;
+  const typeSquare* next;
+  typePiece piece;
+  typeColor side=b.toMove;
+  int n=0, i, dir, ctl;
+  bool promote;
+
+  for (sq=0;(sq<0x80) && (n<=last);sq++)
+  {
+    if (!LEGALSQUARE(sq))
+    {
+      sq+=7;
+      continue;
+    }
+    piece=b.board[sq];
+    if ((piece==EMPTY) || (PIECECOLOR(piece)!=side))
+      continue;
+    switch (PIECE(piece))
+    {
+    case PAWN:
+      dir=(side==WHITE)?16:-16;
+      to=sq+dir;
+      if (!LEGALSQUARE(to))
+        break;
+      promote=(RANK(to)==0) || (RANK(to)==7);
+      if (b.board[to]==EMPTY)
+      {
+        addPawnKeys(keys,n,sq,to,promote);
+        if ((RANK(sq)==((side==WHITE)?1:6)) && (b.board[to+dir]==EMPTY))
+          addKey(keys,n,sq,to+dir);
+      }
+      for (i=-1;i<=1;i+=2)
+      {
+        if (!LEGALSQUARE(to+i))
+          continue;
+        if (((b.board[to+i]!=EMPTY) && (PIECECOLOR(b.board[to+i])!=side)) || (to+i==b.enPassant))
+          addPawnKeys(keys,n,sq,to+i,promote);
+      }
+      break;
+    case KNIGHT:
+    case KING:
+      next=(PIECE(piece)==KNIGHT)?knightMoves.sq[sq]:kingMoves.sq[sq];
+      for (i=0;next[i]!=UNDEF;i++)
+        if ((b.board[next[i]]==EMPTY) || (PIECECOLOR(b.board[next[i]])!=side))
+          addKey(keys,n,sq,next[i]);
+      if (PIECE(piece)==KING)
+      {
+        ctl=(side==WHITE)?b.castle:b.castle>>2;
+        if ((ctl&whitekingsidecastle) && (FILE(sq)<6) && (b.board[sq+1]==EMPTY) && (b.board[sq+2]==EMPTY))
+          addKey(keys,n,sq,sq+2);
+        if ((ctl&whitequeensidecastle) && (FILE(sq)>2) && (b.board[sq-1]==EMPTY) && (b.board[sq-2]==EMPTY) && (b.board[sq-3]==EMPTY))
+          addKey(keys,n,sq,sq-2);
+      }
+      break;
+    default:
+      for (i=0;i<8;i++)
+      {
+        if ((i<4)?(PIECE(piece)==ROOK):(PIECE(piece)==BISHOP))
+          continue;
+        dir=(i<4)?bishopPath[i]:rookPath[i-4];
+        for (to=sq+dir;LEGALSQUARE(to);to+=dir)
+        {
+          if (b.board[to]==EMPTY)
+          {
+            addKey(keys,n,sq,to);
+            continue;
+          }
+          if (PIECECOLOR(b.board[to])!=side)
+            addKey(keys,n,sq,to);
+          break;
+        }
+      }
+      break;
+    }
+  }
+  return n;
+}
+
+// Add the board at a ply to the signature of a game.
+static void addSignature(GameBaseSignature& sig, const ChessBoard& cb, DWORD ply)
+{
+  int bit=GameBase::materialBit(GameBase::materialKey(cb));
+  int i;
+  sig.material[bit/64]|=(unsigned __int64)1<<(bit%64);
+  for (i=0;i<GAMEBASE_PAWNPLIES;i++)
+    if (GAMEBASE_PAWNPLY[i]==ply)
+      sig.pawns[i]=GameBase::pawnHash(cb);
+}
+
+GameBase::GameBase()
+{
+  games=0;
+  savedGames=0;
+  savedNames=0;
+  nameSize=0;
+  names.push_back("");
+}
+
+GameBase::~GameBase()
+{
+  close();
+}
+
+bool GameBase::open(const std::string& path, bool create)
+{
+  GameBaseHeader h;
+  vector<char> data;
+  unsigned __int64 size;
+  DWORD creation=create?OPEN_ALWAYS:OPEN_EXISTING;
+  size_t i, n, len;
+
+  close();
+  if (!headerFile.open(path+".gbh",GENERIC_WRITE,false,creation,true)
+    || !moveFile.open(path+".gbm",GENERIC_WRITE,false,creation,true)
+    || !offsetFile.open(path+".gbo",GENERIC_WRITE,false,creation,false)
+    || !nameFile.open(path+".gbn",GENERIC_WRITE,false,creation,false)
+    || !signatureFile.open(path+".gbs",GENERIC_WRITE,false,OPEN_ALWAYS,false))
+  {
+    close();
+    error="Unable to open: "+path;
+    return false;
+  }
+  headerFile.setBufferSize(GAMEBASE_BUFFERSIZE);
+  moveFile.setBufferSize(GAMEBASE_BUFFERSIZE);
+
+  size=headerFile.size();
+  if (!size)
+  {
+    // A new base, the first offset and the empty name.
+    memcpy(h.magic,GBH_MAGIC,4);
+    h.entrySize=sizeof(GameBaseEntry);
+    offsets.push_back(0);
+    if (!headerFile.write(&h,sizeof(h),0) || !offsetFile.write(&offsets[0],sizeof(offsets[0]),0) || !nameFile.write("\0\0",2,0))
+    {
+      close();
+      error="Unable to write: "+path;
+      return false;
+    }
+    nameSize=2;
+    savedNames=1;
+    return true;
+  }
+  if ((headerFile.read(&h,sizeof(h),0)!=sizeof(h)) || memcmp(h.magic,GBH_MAGIC,4) || (h.entrySize!=sizeof(GameBaseEntry)))
+  {
+    close();
+    error="Not a game base: "+path;
+    return false;
+  }
+
+  // An offset for each game and the end of the last, more are from
+  // games that were not written to the end.
+  games=(DWORD)((size-sizeof(h))/sizeof(GameBaseEntry));
+  games=(DWORD)__min((unsigned __int64)games,offsetFile.size()/sizeof(unsigned __int64)-1);
+  offsets.resize((size_t)games+1);
+  for (i=0;i<offsets.size();i+=n)
+  {
+    n=__min(offsets.size()-i,GAMEBASE_CHUNK);
+    if (offsetFile.read(&offsets[i],(DWORD)(n*sizeof(unsigned __int64)))!=n*sizeof(unsigned __int64))
+      break;
+  }
+  if (i<offsets.size())
+  {
+    close();
+    error="Unable to read: "+path+".gbo";
+    return false;
+  }
+  savedGames=games;
+
+  // The names, a WORD with the length before each.
+  size=nameFile.size();
+  data.resize((size_t)size);
+  if (size && (nameFile.read(&data[0],(DWORD)size,0)!=size))
+  {
+    close();
+    error="Unable to read: "+path+".gbn";
+    return false;
+  }
+  names.clear();
+  for (i=0;i+2<=data.size();i+=len+2)
+  {
+    len=(BYTE)data[i]|((BYTE)data[i+1]<<8);
+    if (i+2+len>data.size())
+      break;
+    names.push_back(string(&data[i+2],len));
+    nameIndex[names.back()]=(DWORD)names.size()-1;
+  }
+  nameSize=i;
+  if (!names.size())
+  {
+    close();
+    error="Not a game base: "+path;
+    return false;
+  }
+  savedNames=(DWORD)names.size();
+
+  // A base made before the signatures, or not written to the end.
+  n=(size_t)(signatureFile.size()/sizeof(GameBaseSignature));
+  if ((n<games) && !makeSignatures((DWORD)n+1))
+  {
+    close();
+    return false;
+  }
+  return true;
+}
+
+void GameBase::close()
+{
+  if (isOpen())
+    flush();
+  headerFile.close();
+  moveFile.close();
+  offsetFile.close();
+  nameFile.close();
+  signatureFile.close();
+  names.clear();
+  names.push_back("");
+  nameIndex.clear();
+  offsets.clear();
+  pendingHeaders.clear();
+  pendingMoves.clear();
+  pendingSignatures.clear();
+  games=0;
+  savedGames=0;
+  savedNames=0;
+  nameSize=0;
+}
+
+DWORD GameBase::intern(const std::string& s)
+{
+  if (s.empty())
+    return 0;
+  unordered_map<string, DWORD>::iterator it=nameIndex.find(s);
+  if (it!=nameIndex.end())
+    return it->second;
+  names.push_back(s.substr(0,0xffff));
+  nameIndex[s]=(DWORD)names.size()-1;
+  return (DWORD)names.size()-1;
+}
+
+bool GameBase::flush()
+{
+  string s;
+  size_t i, len;
+  if (!isOpen())
+    return false;
+  // The header last, so a game is only counted when the rest is written.
+  if (pendingMoves.size() && !moveFile.write(pendingMoves.data(),(DWORD)pendingMoves.size(),offsets[savedGames]))
+  {
+    error="Unable to write: "+moveFile.sFilename;
+    return false;
+  }
+  pendingMoves.clear();
+  if (savedNames<names.size())
+  {
+    for (i=savedNames;i<names.size();i++)
+    {
+      len=names[i].length();
+      s+=(char)(len&0xff);
+      s+=(char)(len>>8);
+      s+=names[i];
+    }
+    if (!nameFile.write(s.data(),(DWORD)s.size(),nameSize))
+    {
+      error="Unable to write: "+nameFile.sFilename;
+      return false;
+    }
+    nameSize+=s.size();
+    savedNames=(DWORD)names.size();
+  }
+  if (pendingSignatures.size() && !signatureFile.write(pendingSignatures.data(),(DWORD)pendingSignatures.size(),(unsigned __int64)savedGames*sizeof(GameBaseSignature)))
+  {
+    error="Unable to write: "+signatureFile.sFilename;
+    return false;
+  }
+  pendingSignatures.clear();
+  if (savedGames<games)
+  {
+    if (!offsetFile.write(&offsets[(size_t)savedGames+1],(games-savedGames)*sizeof(unsigned __int64),((size_t)savedGames+1)*sizeof(unsigned __int64))
+      || !headerFile.write(pendingHeaders.data(),(DWORD)pendingHeaders.size(),sizeof(GameBaseHeader)+(unsigned __int64)savedGames*sizeof(GameBaseEntry)))
+    {
+      error="Unable to write: "+headerFile.sFilename;
+      return false;
+    }
+    pendingHeaders.clear();
+    savedGames=games;
+  }
+  return true;
+}
+
+bool GameBase::append(const ChessGame& game)
+{
+  GameBaseEntry e;
+  GameBaseSignature sig;
+  string moves, extra;
+  CompactMove key, keys[GAMEBASE_MAXKEYS];
+  DWORD plies;
+  int pos, i, n, index, extras;
+
+  if (!isOpen() || game.position.empty())
+    return false;
+  memset(&e,0,sizeof(e));
+  const ChessGameInfo& info=game.info;
+  e.event=intern(info.Event);
+  e.site=intern(info.Site);
+  e.white=intern(info.White);
+  e.black=intern(info.Black);
+  e.round=intern(info.Round);
+  setNumbers(e,info);
+
+  // The moves of the main line. An illegal move ends the game.
+  memset(&sig,0,sizeof(sig));
+  ChessBoard cb=game.position[0].board;
+  pos=0;
+  for (plies=0;game.position[pos].move.size() && (plies<0xffff);plies++)
+  {
+    addSignature(sig,cb,plies);
+    const ChessGameMove& cgm=game.position[pos].move[0];
+    if (cgm.move.moveType&NULL_MOVE)
+    {
+      moves+=(char)GAMEBASE_NULLMOVE;
+    }
+    else
+    {
+      key=CompactGame::encode(cgm.move);
+      n=makeKeys(cb,keys);
+      for (index=0;(index<n) && (keys[index]!=key);index++);
+      // A move that is not in the keys, as a promotion to a king, ends the game.
+      if ((index>=n) && CompactGame::decode(cb,key).score)
+        break;
+      if ((index<n) && (index<GAMEBASE_LONGMOVE))
+      {
+        moves+=(char)index;
+      }
+      else
+      {
+        moves+=(char)GAMEBASE_LONGMOVE;
+        moves+=(char)(key&0xff);
+        moves+=(char)(key>>8);
+      }
+    }
+    pos=cgm.posIndex;
+    cb=game.position[pos].board;
+  }
+  addSignature(sig,cb,plies);
+  e.plies=(WORD)plies;
+
+  // The fields that are not in the entry.
+  extras=0;
+  for (i=FIELD_DATE;i<INFOFIELDS;i++)
+  {
+    const string& s=info.*infoField[i];
+    if ((i==FIELD_DATE) || (i==FIELD_RESULT) || (i==FIELD_WHITEELO) || (i==FIELD_BLACKELO) || (i==FIELD_ECO))
+    {
+      if (s==numberField(e,i))
+        continue;
+    }
+    else if (s.empty())
+    {
+      continue;
+    }
+    extra+=(char)i;
+    putVarint(extra,intern(s));
+    ++extras;
+  }
+
+  record.clear();
+  putVarint(record,plies);
+  cb.setStartposition();
+  if (game.position[0].board!=cb)
+  {
+    e.flags|=GAMEBASE_SETUP;
+    cb=game.position[0].board;
+    string fen=cb.getFen();
+    record+=(char)GAMEBASE_SETUP;
+    record+=(char)fen.length();
+    record+=fen;
+  }
+  else
+  {
+    record+=(char)0;
+  }
+  record+=moves;
+  record+=(char)extras;
+  record+=extra;
+
+  pendingMoves+=record;
+  offsets.push_back(offsets.back()+record.size());
+  pendingHeaders.append((const char*)&e,sizeof(e));
+  pendingSignatures.append((const char*)&sig,sizeof(sig));
+  ++games;
+  if (pendingMoves.size()>=GAMEBASE_FLUSHSIZE)
+    return flush();
+  return true;
+}
+
+bool GameBase::readEntry(DWORD index, GameBaseEntry& entry)
+{
+  if (!isOpen() || (index<1) || (index>games))
+    return false;
+  if ((savedGames<games) && !flush())
+    return false;
+  return (headerFile.read(&entry,sizeof(entry),sizeof(GameBaseHeader)+(unsigned __int64)(index-1)*sizeof(GameBaseEntry))==sizeof(entry));
+}
+
+void GameBase::getInfo(const GameBaseEntry& entry, ChessGameInfo& info)
+{
+  info.clear();
+  info.Event=name(entry.event);
+  info.Site=name(entry.site);
+  info.White=name(entry.white);
+  info.Black=name(entry.black);
+  info.Round=name(entry.round);
+  info.Date=numberField(entry,FIELD_DATE);
+  info.Result=numberField(entry,FIELD_RESULT);
+  info.WhiteElo=numberField(entry,FIELD_WHITEELO);
+  info.BlackElo=numberField(entry,FIELD_BLACKELO);
+  info.ECO=numberField(entry,FIELD_ECO);
+}
+
+// Read a record of the move file. The moves are not made if moves is NULL,
+// the fields after the moves are only read if info is given.
+bool GameBase::decode(const BYTE* data, size_t length, ChessBoard& start, std::vector<ChessMove>* moves, ChessGameInfo* info)
+{
+  MoveGenerator gen;
+  CompactMove keys[GAMEBASE_MAXKEYS];
+  const BYTE* p=data;
+  const BYTE* end=data+length;
+  DWORD plies, i, id;
+  ChessMove m;
+  int extras, field;
+
+  if (!getVarint(p,end,plies) || (p>=end))
+    return false;
+  if (*p++&GAMEBASE_SETUP)
+  {
+    if ((p>=end) || (p+1+*p>end))
+      return false;
+    string fen((const char*)p+1,*p);
+    start.setFen(fen.c_str());
+    p+=1+fen.length();
+  }
+  else
+  {
+    start.setStartposition();
+  }
+
+  ChessBoard cb=start;
+  if (moves)
+  {
+    moves->clear();
+    moves->reserve(plies);
+  }
+  for (i=0;i<plies;i++)
+  {
+    if (p>=end)
+      return false;
+    if (*p==GAMEBASE_LONGMOVE)
+    {
+      if (p+3>end)
+        return false;
+      if (moves)
+      {
+        m=CompactGame::decode(cb,p[1]|(p[2]<<8));
+        if (m.score)
+          return false;
+        moves->push_back(m);
+        gen.doMove(cb,m);
+      }
+      p+=3;
+      continue;
+    }
+    if (moves)
+    {
+      if (*p==GAMEBASE_NULLMOVE)
+      {
+        m.clear();
+        m.moveType=NULL_MOVE;
+        moves->push_back(m);
+        gen.doNullMove(cb,m);
+      }
+      else
+      {
+        if (makeKeys(cb,keys,*p)<=*p)
+          return false;
+        m=CompactGame::decode(cb,keys[*p]);
+        if (m.score)
+          return false;
+        moves->push_back(m);
+        gen.doMove(cb,m);
+      }
+    }
+    ++p;
+  }
+
+  if (info)
+  {
+    if (p>=end)
+      return false;
+    extras=*p++;
+    while (extras--)
+    {
+      if (p>=end)
+        return false;
+      field=*p++;
+      if (!getVarint(p,end,id) || (field>=INFOFIELDS))
+        return false;
+      info->*infoField[field]=name(id);
+    }
+  }
+  return true;
+}
+
+bool GameBase::readMoves(DWORD index, ChessBoard& start, std::vector<ChessMove>& moves)
+{
+  size_t length;
+  if (!isOpen() || (index<1) || (index>games))
+    return false;
+  if ((savedGames<games) && !flush())
+    return false;
+  length=(size_t)(offsets[index]-offsets[index-1]);
+  record.resize(length);
+  if (moveFile.read(&record[0],(DWORD)length,offsets[index-1])!=length)
+    return false;
+  return decode((const BYTE*)record.data(),length,start,&moves,NULL);
+}
+
+DWORD GameBase::readSignatures(DWORD first, DWORD count, GameBaseSignature* signatures)
+{
+  if (!isOpen() || (first<1) || (first>games))
+    return 0;
+  if ((savedGames<games) && !flush())
+    return 0;
+  count=__min(count,games-first+1);
+  count=__min(count,(DWORD)(0x80000000/sizeof(GameBaseSignature)));
+  return signatureFile.read(signatures,count*sizeof(GameBaseSignature),(unsigned __int64)(first-1)*sizeof(GameBaseSignature))/sizeof(GameBaseSignature);
+}
+
+// Make the signatures from game first by replaying the games.
+bool GameBase::makeSignatures(DWORD first)
+{
+  MoveGenerator gen;
+  GameBaseSignature sig;
+  vector<ChessMove> moves;
+  ChessBoard cb;
+  string s;
+  DWORD index, ply, start=first;
+
+  for (index=first;index<=games;index++)
+  {
+    memset(&sig,0,sizeof(sig));
+    if (readMoves(index,cb,moves))
+    {
+      for (ply=0;ply<moves.size();ply++)
+      {
+        addSignature(sig,cb,ply);
+        if (moves[ply].moveType&NULL_MOVE)
+          gen.doNullMove(cb,moves[ply]);
+        else
+          gen.doMove(cb,moves[ply]);
+      }
+      addSignature(sig,cb,ply);
+    }
+    s.append((const char*)&sig,sizeof(sig));
+    if ((s.size()>=GAMEBASE_FLUSHSIZE) || (index==games))
+    {
+      if (!signatureFile.write(s.data(),(DWORD)s.size(),(unsigned __int64)(start-1)*sizeof(sig)))
+      {
+        error="Unable to write: "+signatureFile.sFilename;
+        return false;
+      }
+      s.clear();
+      start=index+1;
+    }
+  }
+  return true;
+}
+
+DWORD GameBase::materialKey(const ChessBoard& cb)
+{
+  int count[2][7]={ { 0 } };
+  int sq, c, p;
+  DWORD key=0;
+  for (sq=0;sq<64;sq++)
+    if (cb[sq]!=EMPTY)
+      ++count[PIECECOLOR(cb[sq])][PIECE(cb[sq])];
+  for (c=WHITE;c<=BLACK;c++)
+  {
+    key|=(DWORD)__min(count[c][PAWN],8)<<(c*12);
+    for (p=KNIGHT;p<=QUEEN;p++)
+      key|=(DWORD)__min(count[c][p],3)<<(c*12+p*2);
+  }
+  return key;
+}
+
+int GameBase::materialBit(DWORD key)
+{
+  // Without the pawns.
+  return (int)(((unsigned __int64)(key&~0xf00f)*0x9e3779b97f4a7c15ull)>>56);
+}
+
+DWORD GameBase::pawnHash(const ChessBoard& cb)
+{
+  unsigned __int64 pawns[2]={ 0,0 }, h;
+  int sq;
+  for (sq=0;sq<64;sq++)
+    if (PIECE(cb[sq])==PAWN)
+      pawns[PIECECOLOR(cb[sq])]|=(unsigned __int64)1<<sq;
+  h=pawns[WHITE]*0x9e3779b97f4a7c15ull^pawns[BLACK]*0xc2b2ae3d27d4eb4full;
+  h^=h>>29;
+  h*=0xbf58476d1ce4e5b9ull;
+  h^=h>>32;
+  return (DWORD)h?(DWORD)h:1;
+}
+
+bool GameBase::read(DWORD index, ChessGame& game, bool onlyheader)
+{
+  GameBaseEntry e;
+  ChessGamePosition cgp;
+  ChessGameMove cgm;
+  vector<ChessMove> moves;
+  ChessBoard start;
+  size_t i, length;
+
+  game.clear();
+  if (!readEntry(index,e))
+    return false;
+  getInfo(e,game.info);
+  length=(size_t)(offsets[index]-offsets[index-1]);
+  record.resize(length);
+  if ((moveFile.read(&record[0],(DWORD)length,offsets[index-1])!=length)
+    || !decode((const BYTE*)record.data(),length,start,onlyheader?NULL:&moves,&game.info))
+  {
+    error="Unable to read game "+to_string(index);
+    return false;
+  }
+  game.setStartPosition(start);
+  if (onlyheader)
+    return true;
+  game.position.reserve(moves.size()+1);
+  for (i=0;i<moves.size();i++)
+  {
+    cgp.board=game.position[i].board;
+    cgm.move=moves[i];
+    cgp.board.doMove(cgm.move,false);
+    cgp.fromIndex=(int)i;
+    cgm.posIndex=(int)i+1;
+    game.position[i].move.push_back(cgm);
+    game.position.push_back(cgp);
+  }
+  game.activePosition=0;
+  return true;
+}
+
+DWORD GameBase::importPgn(const std::string& pgnfile)
+{
+  PgnPipeline pgn;
+  ChessGame game;
+  DWORD index, added=0;
+  pgn.expandnag=false;
+  if (!pgn.start(pgnfile))
+  {
+    error=pgn.lastError();
+    return 0;
+  }
+  while (pgn.next(game,index))
+  {
+    if (!append(game))
+    {
+      pgn.stop();
+      break;
+    }
+    ++added;
+  }
+  flush();
+  return added;
+}
+
+bool GameBase::exportPgn(const std::string& pgnfile, DWORD first, DWORD last)
+{
+  WinFile out;
+  Pgn pgn;
+  ChessGame game;
+  string text;
+  unsigned __int64 fp=0;
+  DWORD index;
+
+  if (!last || (last>games))
+    last=games;
+  if (!out.open(pgnfile,GENERIC_WRITE,false,CREATE_ALWAYS,false))
+  {
+    error="Unable to open: "+pgnfile;
+    return false;
+  }
+  for (index=__max(first,1);index<=last;index++)
+  {
+    if (!read(index,game))
+      return false;
+    text+=pgn.toString(game);
+    text+="\r\n";
+    if ((text.size()>=GAMEBASE_FLUSHSIZE) || (index==last))
+    {
+      if (!out.write(text.data(),(DWORD)text.size(),fp))
+      {
+        error="Unable to write: "+pgnfile;
+        return false;
+      }
+      fp+=text.size();
+      text.clear();
+    }
+  }
+  return true;
+}
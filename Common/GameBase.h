@@ -0,0 +1,125 @@
+#pragma once
+
+#include <windows.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include "../Common/WinFile.h"
+#include "../Common/ChessGame.h"
+
+// The fixed part of a game, one record for each game in the header file.
+struct GameBaseEntry
+{
+  DWORD event;    // In the name table, 0 is an empty string
+  DWORD site;
+  DWORD white;
+  DWORD black;
+  DWORD round;
+  DWORD date;     // yyyymmdd, 0 if unknown
+  WORD whiteElo;
+  WORD blackElo;
+  WORD eco;       // A00=1 .. E99=500, 0 if not given
+  WORD plies;     // Moves in the game
+  BYTE result;    // 0=*, 1=1-0, 2=0-1, 3=1/2-1/2
+  BYTE flags;     // GAMEBASE_SETUP
+  BYTE reserved[2];
+};
+
+// The game doesn't start from the start position.
+const BYTE GAMEBASE_SETUP=0x01;
+
+// Move index for a null move.
+const BYTE GAMEBASE_NULLMOVE=0xff;
+// A move with a larger index is written as this byte and the CompactMove.
+const BYTE GAMEBASE_LONGMOVE=0xfe;
+
+// Bits in the material signature.
+const int GAMEBASE_MATERIALBITS=256;
+// Plies where the pawn structure is kept in the signature.
+const int GAMEBASE_PAWNPLIES=8;
+const WORD GAMEBASE_PAWNPLY[GAMEBASE_PAWNPLIES]={ 16,24,32,40,50,60,80,100 };
+
+// What a game reached, to find games by material and pawn structure
+// without replaying them. One record for each game in the signature file.
+struct GameBaseSignature
+{
+  // Bit materialBit() is set for the material of each position in the game.
+  unsigned __int64 material[GAMEBASE_MATERIALBITS/64];
+  // pawnHash() at GAMEBASE_PAWNPLY, 0 if the game is shorter.
+  DWORD pawns[GAMEBASE_PAWNPLIES];
+};
+
+// A database of games in five files with the same base name:
+// .gbh  A GameBaseEntry for each game.
+// .gbm  The moves of each game, one byte for each move. The byte is the
+//       index of the move in the moves made in a fixed order without
+//       checking for check (see makeKeys), so reading a move doesn't need a
+//       legal move list. The start position (if not the normal) is before
+//       the moves and the header fields that are not in the entry are after.
+// .gbo  Where the moves of each game start in the .gbm file.
+// .gbn  The name table, all strings in the entries.
+// .gbs  A GameBaseSignature for each game. They are made when a base
+//       without them is opened.
+// A PositionIndex of the games is kept beside them in .gpx and .gps files.
+// Only the main line is stored, variations and comments are not.
+// Games are numbered from 1 as in Pgn. Appended games are kept in memory
+// until flush(), the header file is written last so a game is not counted
+// until all of it is written.
+class GameBase
+{
+  WinFile headerFile;
+  WinFile moveFile;
+  WinFile offsetFile;
+  WinFile nameFile;
+  WinFile signatureFile;
+  std::string error;
+  std::vector<std::string> names;
+  std::unordered_map<std::string, DWORD> nameIndex;
+  // Start of the moves of each game, and the end of the last.
+  std::vector<unsigned __int64> offsets;
+  DWORD games;
+  DWORD savedGames;
+  DWORD savedNames;
+  unsigned __int64 nameSize; // Bytes of whole names in the name file
+  std::string pendingHeaders;
+  std::string pendingMoves;
+  std::string pendingSignatures;
+  std::string record;
+  DWORD intern(const std::string& s);
+  bool decode(const BYTE* data, size_t length, ChessBoard& start, std::vector<ChessMove>* moves, ChessGameInfo* info);
+  bool makeSignatures(DWORD first);
+public:
+  GameBase();
+  virtual ~GameBase();
+  // path is the name of the files without the extension.
+  bool open(const std::string& path, bool create=true);
+  void close();
+  bool isOpen() { return headerFile.isOpen(); };
+  bool flush();
+  inline DWORD size() { return games; };
+  bool append(const ChessGame& game);
+  bool readEntry(DWORD index, GameBaseEntry& entry);
+  bool read(DWORD index, ChessGame& game, bool onlyheader=false);
+  // The start position and the moves of a game, for tools that replay the
+  // games without a ChessGame.
+  bool readMoves(DWORD index, ChessBoard& start, std::vector<ChessMove>& moves);
+  // The signatures of count games from first, returns the number read.
+  DWORD readSignatures(DWORD first, DWORD count, GameBaseSignature* signatures);
+  const std::string& name(DWORD id) { return (id<names.size())?names[id]:names[0]; };
+  void getInfo(const GameBaseEntry& entry, ChessGameInfo& info);
+  // Add the games in a pgn file, returns the number of games added.
+  DWORD importPgn(const std::string& pgnfile);
+  // Write the games from first to last (0 is the last game) to a pgn file.
+  bool exportPgn(const std::string& pgnfile, DWORD first=1, DWORD last=0);
+  inline const std::string& lastError() { return error; };
+  // The number of pawns, knights, bishops, rooks and queens of each side,
+  // 4 bits for pawns and 2 bits for the others (3 is 3 or more) from bit 0
+  // for white and bit 12 for black.
+  static DWORD materialKey(const ChessBoard& cb);
+  static inline int materialCount(DWORD key, int color, int piece) { return (piece==PAWN)?(key>>(color*12))&0x0f:(key>>(color*12+piece*2))&3; };
+  // The bit in GameBaseSignature::material for a material key. The pawns
+  // are not used, so a search with any number of pawns has few bits.
+  static int materialBit(DWORD key);
+  // A hash of the squares of the pawns, never 0.
+  static DWORD pawnHash(const ChessBoard& cb);
+};
@@ -0,0 +1,261 @@
+#include <string.h>
+#include <ctype.h>
+#include "../Common/GameSearch.h"
+#include "../Common/MoveGenerator.h"
+
+using namespace std;
+
+// Signatures read at a time, 1 MB.
+const DWORD GAMESEARCH_CHUNK=0x4000;
+// A pattern with more material keys than this doesn't use the signatures.
+const DWORD GAMESEARCH_MAXKEYS=0x1000;
+
+// The most of a piece that is counted.
+static int pieceLimit(int piece)
+{
+  return (piece==PAWN)?8:3;
+}
+
+MaterialPattern::MaterialPattern()
+{
+  int c, p;
+  memset(min,0,sizeof(min));
+  memset(max,0,sizeof(max));
+  for (c=WHITE;c<=BLACK;c++)
+    for (p=PAWN;p<=QUEEN;p++)
+      max[c][p]=pieceLimit(p);
+  eitherColor=false;
+}
+
+bool MaterialPattern::set(const std::string& s, bool eitherColor)
+{
+  const char* letters=" PNBRQ";
+  const char* sz;
+  size_t i;
+  int side=WHITE, piece=EMPTY;
+
+  memset(min,0,sizeof(min));
+  memset(max,0,sizeof(max));
+  this->eitherColor=eitherColor;
+  for (i=0;i<s.length();i++)
+  {
+    if ((s[i]=='v') || (s[i]=='V') || (s[i]=='-'))
+    {
+      if (side!=WHITE)
+        return false;
+      side=BLACK;
+      piece=EMPTY;
+      if ((i+1<s.length()) && ((s[i+1]=='s') || (s[i+1]=='S')))
+        ++i;
+      continue;
+    }
+    if (s[i]=='*')
+    {
+      if (piece==EMPTY)
+        return false;
+      // The letter before is any number of the piece.
+      --min[side][piece];
+      max[side][piece]=pieceLimit(piece);
+      piece=EMPTY;
+      continue;
+    }
+    if ((s[i]=='+') || (s[i]==' ') || (toupper((BYTE)s[i])=='K'))
+      continue;
+    if ((sz=strchr(letters+1,toupper((BYTE)s[i])))==NULL)
+      return false;
+    piece=(int)(sz-letters);
+    if (min[side][piece]<pieceLimit(piece))
+      ++min[side][piece];
+    if (max[side][piece]<min[side][piece])
+      max[side][piece]=min[side][piece];
+  }
+  return (side==BLACK);
+}
+
+bool MaterialPattern::match(DWORD materialKey) const
+{
+  int c, p, n;
+  bool same=true, swapped=eitherColor;
+  for (c=WHITE;c<=BLACK;c++)
+  {
+    for (p=PAWN;p<=QUEEN;p++)
+    {
+      n=GameBase::materialCount(materialKey,c,p);
+      if ((n<min[c][p]) || (n>max[c][p]))
+        same=false;
+      n=GameBase::materialCount(materialKey,OTHERPLAYER(c),p);
+      if ((n<min[c][p]) || (n>max[c][p]))
+        swapped=false;
+    }
+  }
+  return same || swapped;
+}
+
+GameSearch::GameSearch()
+{
+  clear();
+}
+
+void GameSearch::clear()
+{
+  material=MaterialPattern();
+  useMaterial=false;
+  usePawns=false;
+  pawnKey=0;
+  candidates=0;
+  makeMask();
+}
+
+bool GameSearch::setMaterial(const std::string& pattern, bool eitherColor)
+{
+  MaterialPattern mp;
+  if (!mp.set(pattern,eitherColor))
+    return false;
+  setMaterial(mp);
+  return true;
+}
+
+void GameSearch::setMaterial(const MaterialPattern& pattern)
+{
+  material=pattern;
+  useMaterial=true;
+  makeMask();
+}
+
+void GameSearch::setPawns(const ChessBoard& cb)
+{
+  pawns=cb;
+  pawnKey=GameBase::pawnHash(cb);
+  usePawns=true;
+}
+
+// Set the bit of each material key that match the pattern.
+void GameSearch::makeMask()
+{
+  int count[2][7];
+  int c, p, bit;
+  DWORD keys=1, key;
+  bool done=false;
+
+  // The pawns are not in the bits.
+  memset(mask,0,sizeof(mask));
+  for (c=WHITE;c<=BLACK;c++)
+    for (p=KNIGHT;p<=QUEEN;p++)
+      keys*=material.max[c][p]-material.min[c][p]+1;
+  if (!useMaterial || (keys>GAMESEARCH_MAXKEYS))
+  {
+    memset(mask,0xff,sizeof(mask));
+    return;
+  }
+  for (c=WHITE;c<=BLACK;c++)
+    for (p=KNIGHT;p<=QUEEN;p++)
+      count[c][p]=material.min[c][p];
+  while (!done)
+  {
+    key=0;
+    for (c=WHITE;c<=BLACK;c++)
+      for (p=KNIGHT;p<=QUEEN;p++)
+        key|=count[c][p]<<(c*12+p*2);
+    bit=GameBase::materialBit(key);
+    mask[bit/64]|=(unsigned __int64)1<<(bit%64);
+    if (material.eitherColor)
+    {
+      bit=GameBase::materialBit((key>>12)|((key&0xfff)<<12));
+      mask[bit/64]|=(unsigned __int64)1<<(bit%64);
+    }
+    // The next counts.
+    done=true;
+    for (c=WHITE;(c<=BLACK) && done;c++)
+    {
+      for (p=KNIGHT;(p<=QUEEN) && done;p++)
+      {
+        if (count[c][p]<material.max[c][p])
+        {
+          ++count[c][p];
+          done=false;
+        }
+        else
+        {
+          count[c][p]=material.min[c][p];
+        }
+      }
+    }
+  }
+}
+
+bool GameSearch::matchPawns(const ChessBoard& cb) const
+{
+  int sq;
+  for (sq=0;sq<64;sq++)
+    if ((PIECE(cb[sq])==PAWN)!=(PIECE(pawns[sq])==PAWN) || ((PIECE(cb[sq])==PAWN) && (cb[sq]!=pawns[sq])))
+      return false;
+  return true;
+}
+
+// The first ply of a game where the position match, -1 if none.
+int GameSearch::findPly(GameBase& base, DWORD game)
+{
+  MoveGenerator gen;
+  vector<ChessMove> moves;
+  ChessBoard cb;
+  size_t ply;
+  if (!base.readMoves(game,cb,moves))
+    return -1;
+  for (ply=0;;ply++)
+  {
+    if ((!useMaterial || material.match(cb)) && (!usePawns || matchPawns(cb)))
+      return (int)ply;
+    if (ply>=moves.size())
+      break;
+    if (moves[ply].moveType&NULL_MOVE)
+      gen.doNullMove(cb,moves[ply]);
+    else
+      gen.doMove(cb,moves[ply]);
+  }
+  return -1;
+}
+
+size_t GameSearch::find(GameBase& base, std::vector<PositionHit>& hits, size_t max)
+{
+  vector<GameBaseSignature> sig(GAMESEARCH_CHUNK);
+  vector<BYTE> pass(GAMESEARCH_CHUNK);
+  PositionHit hit;
+  unsigned __int64 m;
+  DWORD first, n, i, p;
+  int j, ply;
+
+  hits.clear();
+  candidates=0;
+  if (!base.isOpen())
+    return 0;
+  for (first=1;first<=base.size();first+=n)
+  {
+    if ((n=base.readSignatures(first,GAMESEARCH_CHUNK,&sig[0]))==0)
+      break;
+    // No branches in the loop, so the compiler can use vector instructions.
+    for (i=0;i<n;i++)
+    {
+      m=0;
+      for (j=0;j<GAMEBASE_MATERIALBITS/64;j++)
+        m|=sig[i].material[j]&mask[j];
+      p=!usePawns;
+      for (j=0;j<GAMEBASE_PAWNPLIES;j++)
+        p|=(sig[i].pawns[j]==pawnKey);
+      pass[i]=(m!=0)&p;
+    }
+    for (i=0;i<n;i++)
+    {
+      if (!pass[i])
+        continue;
+      ++candidates;
+      if ((ply=findPly(base,first+i))<0)
+        continue;
+      hit.game=first+i;
+      hit.ply=(WORD)ply;
+      hits.push_back(hit);
+      if (max && (hits.size()>=max))
+        return hits.size();
+    }
+  }
+  return hits.size();
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <windows.h>
+#include <string>
+#include <vector>
+#include "../Common/ChessBoard.h"
+#include "../Common/GameBase.h"
+#include "../Common/PositionIndex.h"
+
+// The material to search for, the least and most of each piece for each
+// side. The counts are as in GameBase::materialKey, 3 pieces is 3 or more.
+struct MaterialPattern
+{
+  BYTE min[2][7]; // [color][piece]
+  BYTE max[2][7];
+  bool eitherColor; // Also the pattern with the colors swapped
+  MaterialPattern();
+  // Read a pattern as "R vs B+P*". The pieces of white and black are
+  // separated with "vs", "v" or "-". Each letter (Q, R, B, N or P) is one
+  // piece and a * after a letter makes it any number of the piece, so
+  // "BP*" is a bishop and any number of pawns and "BPP*" is a bishop and
+  // at least one pawn. K and + are ignored.
+  bool set(const std::string& s, bool eitherColor=true);
+  bool match(DWORD materialKey) const;
+  bool match(const ChessBoard& cb) const { return match(GameBase::materialKey(cb)); };
+};
+
+// Find games in a GameBase by the material or the pawn structure of a
+// position reached in the game. The signatures of the games are scanned
+// first, for the material a game must have the bit of one of the material
+// keys that match the pattern, and for the pawns the hash of the pawns at
+// one of the plies GAMEBASE_PAWNPLY. The games that pass are replayed to
+// find the first ply where the position match, so a pawn structure is
+// only found if the game has it at one of the plies in the signature.
+class GameSearch
+{
+  MaterialPattern material;
+  bool useMaterial;
+  ChessBoard pawns;
+  bool usePawns;
+  DWORD pawnKey;
+  // The bits of the material keys that match the pattern.
+  unsigned __int64 mask[GAMEBASE_MATERIALBITS/64];
+  void makeMask();
+  bool matchPawns(const ChessBoard& cb) const;
+  int findPly(GameBase& base, DWORD game);
+public:
+  // Games that passed the signatures in the last find.
+  DWORD candidates;
+  GameSearch();
+  void clear();
+  bool setMaterial(const std::string& pattern, bool eitherColor=true);
+  void setMaterial(const MaterialPattern& pattern);
+  // Search for the pawns of the board.
+  void setPawns(const ChessBoard& cb);
+  // The games and the first ply where the position match, sorted on game.
+  // If max>0 it stops after max games. Returns the number of hits.
+  size_t find(GameBase& base, std::vector<PositionHit>& hits, size_t max=0);
+};
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "../Common/defs.h"
+
+// Lookup tables generated at compile time. They are constant data, so no
+// init flag is needed before use and they are shared read-only by all
+// translation units.
+
+// Tables indexed by the difference between two squares on the 0x88 board.
+// Use: table[DIFF0x88(from,to)]
+#define DIFF0x88(from,to)  ((to)-(from)+0x77)
+
+struct SquareMoves
+{
+	// Squares reached from a square, terminated with UNDEF.
+	typeSquare sq[0x80][9];
+};
+
+struct DiffTable
+{
+	int value[0xf0];
+};
+
+constexpr SquareMoves makeSquareMoves(const int* path)
+{
+	SquareMoves t{};
+	for (int sq = 0; sq < 0x80; sq++)
+	{
+		int j = 0;
+		if (LEGALSQUARE(sq))
+		{
+			for (int i = 0; i < 8; i++)
+			{
+				int to = sq + path[i];
+				if (LEGALSQUARE(to))
+					t.sq[sq][j++] = to;
+			}
+		}
+		while (j < 9)
+			t.sq[sq][j++] = UNDEF;
+	}
+	return t;
+}
+
+// Step to go from one square towards another along a rank, file or diagonal.
+// 0 if the squares don't share a line.
+constexpr DiffTable makeRayStep()
+{
+	DiffTable t{};
+	for (int i = 0; i < 4; i++)
+	{
+		for (int n = 1; n < 8; n++)
+		{
+			t.value[DIFF0x88(0, bishopPath[i] * n)] = bishopPath[i];
+			t.value[DIFF0x88(0, rookPath[i] * n)] = rookPath[i];
+		}
+	}
+	return t;
+}
+
+constexpr SquareMoves knightMoves = makeSquareMoves(knightPath);
+constexpr SquareMoves kingMoves = makeSquareMoves(kingPath);
+constexpr DiffTable rayStep = makeRayStep();
@@ -2,46 +2,14 @@
 #include "../Common/MoveGenerator.h"
 #include "../Common/Relations.h"
 
-static bool initMoveGen=0;
-
 MoveGenerator::MoveGenerator() 
 {
-  if (!initMoveGen)
-    init();
 };
 
 MoveGenerator::~MoveGenerator()
 {
 };
 
-void MoveGenerator::init()
-{
-  int i,j;
-  typeSquare sq;
-  // Generate all knightmoves;
-  testMove.clear();
-  for (sq=0;sq<128;sq++)
-    for (i=0;i<8;i++)
-      knightMoves[sq][i]=UNDEF;
-  sq=0;
-  while(1)
-  {
-    j=0;
-    for (i=0;i<8;i++)
-    {
-      if (LEGALSQUARE(sq+knightPath[i]))
-        knightMoves[sq][j++]=sq+knightPath[i];
-    }
-    sq++;
-    if (sq&8)
-    {
-      sq+=8;
-      if (sq>127)
-        break;
-    }
-  }
-}
-
 void MoveGenerator::makeAllCaptureMoves(ChessBoard& b, MoveList& ml)
 {
   typeSquare sq=0;
@@ -333,17 +301,12 @@ bool MoveGenerator::squareAttacked(ChessBoard& b, typeSquare sq, typeColor color
   }
 
   // Attacked from knights or king
-  for (i=0;i<8;i++)
-  {
-    testSquare=sq+knightPath[i];
-    if (LEGALSQUARE(testSquare))
-      if (b.board[testSquare]==knight)
-        return true;
-    testSquare=sq+kingPath[i];
-    if (LEGALSQUARE(testSquare))
-      if (b.board[testSquare]==king)
-        return true;
-  }
+  for (i=0;knightMoves.sq[sq][i]!=UNDEF;i++)
+    if (b.board[knightMoves.sq[sq][i]]==knight)
+      return true;
+  for (i=0;kingMoves.sq[sq][i]!=UNDEF;i++)
+    if (b.board[kingMoves.sq[sq][i]]==king)
+      return true;
 
   // Attacked from pawns
   testSquare=sq-1+(color?16:-16);
@@ -520,8 +483,25 @@ void MoveGenerator::addSlideMoves(ChessBoard& b, MoveList& ml, typeSquare sq, co
 
 void MoveGenerator::addKingMoves(ChessBoard& b, MoveList& ml, typeSquare sq)
 {
+  int i=0;
   typeCastle ctl;
-  addNoSlideMoves(b,ml,sq,kingPath);
+  testMove.clear();
+  testMove.fromSquare=sq;
+  while (kingMoves.sq[sq][i]!=UNDEF)
+  {
+    testMove.toSquare=kingMoves.sq[sq][i++];
+    if (b.board[testMove.toSquare]==EMPTY)
+    {
+      ml.push_back(testMove);
+    }else if (PIECECOLOR(b.board[testMove.toSquare])!=b.toMove)
+    {
+      testMove.moveType=CAPTURE;
+      testMove.capturedpiece=b.board[testMove.toSquare];
+      ml.push_back(testMove);
+      testMove.moveType=0;
+      testMove.capturedpiece=0;
+    }
+  }
 
   // castle
   testMove.clear();
@@ -555,11 +535,9 @@ void MoveGenerator::addKnightMoves(ChessBoard& b, MoveList& ml, typeSquare sq)
   int i=0;
   testMove.clear();
   testMove.fromSquare=sq;
-  while (i<8)
+  while (knightMoves.sq[sq][i]!=UNDEF)
   {
-    if (knightMoves[sq][i]==UNDEF)
-      break;
-    testMove.toSquare=knightMoves[sq][i++];
+    testMove.toSquare=knightMoves.sq[sq][i++];
     if (b.board[testMove.toSquare]==EMPTY)
     {
       ml.push_back(testMove);
@@ -580,11 +558,9 @@ void MoveGenerator::addKnightCaptureMoves(ChessBoard& b, MoveList& ml, typeSquar
   testMove.clear();
   testMove.fromSquare=sq;
   testMove.moveType=CAPTURE;
-  while (i<8)
+  while (knightMoves.sq[sq][i]!=UNDEF)
   {
-    if (knightMoves[sq][i]==UNDEF)
-      break;
-    testMove.toSquare=knightMoves[sq][i++];
+    testMove.toSquare=knightMoves.sq[sq][i++];
     if ((b.board[testMove.toSquare]!=EMPTY) && 
         (PIECECOLOR(b.board[testMove.toSquare])!=b.toMove))
     {
@@ -3,12 +3,7 @@
 #include "../Common/ChessBoard.h"
 #include "../Common/ChessMove.h"
 #include "../Common/MoveList.h"
-
-// There is two method to find the knight square
-// Both makeKnightMoves and makeNoSlideMoves. Therefore
-// this two array of knight moves. One will be removed when
-// I have tested speed/size.
-static typeSquare knightMoves[0x88][8];
+#include "../Common/LookupTables.h"
 
 class MoveGenerator // : public BasicBoard
 {
@@ -26,8 +21,6 @@ protected:
   virtual void addKnightCaptureMoves(ChessBoard& b, MoveList& ml, typeSquare sq);
   // color is color to do the attack
   virtual bool squareAttacked(ChessBoard& b, typeSquare sq, typeColor color);
-  // Initiate the movegeneration
-  virtual void init();
 public:
   MoveGenerator();
   virtual ~MoveGenerator();
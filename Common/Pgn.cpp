@@ -1,5 +1,6 @@
 //
 #include <math.h>
+#include <stdio.h>
 #include "../Common/Utility.h"
 #include "../Common/Pgn.h"
 #include <iostream>
@@ -12,6 +13,7 @@ using namespace std;
 
 Pgn::Pgn()
 {
+  printErrors=true;
 }
 
 Pgn::~Pgn()
@@ -22,6 +24,7 @@ Pgn::~Pgn()
 bool Pgn::open(const std::string& fname, bool readonly)
 {
   nextGame=1;
+  gameIndex.clear();
   if (readonly)
     return file.open(fname,GENERIC_READ,false,OPEN_EXISTING,false);
   else
@@ -30,16 +33,26 @@ bool Pgn::open(const std::string& fname, bool readonly)
 
 void Pgn::close()
 {
+  gameIndex.clear();
   file.close();
 }
 
+bool Pgn::useIndex()
+{
+  if (!gameIndex.loaded)
+    gameIndex.load(file);
+  return gameIndex.loaded;
+}
+
 int Pgn::size()
 {
   string line;
   int nr;
   if (!file.isOpen())
     return -1;
-  DWORD fp=file.dwFilepointer;
+  if (useIndex())
+    return (int)gameIndex.size();
+  unsigned __int64 fp=file.filepointer;
   file.setFilepointer(0);
   nr=0;
 
@@ -55,611 +68,223 @@ int Pgn::size()
 
 bool Pgn::read(ChessGame& game, DWORD index, int maxmove, bool expandnag, const char* sz, bool onlyheader)
 {
-  string sGame,sHeader,line;
-  string termination;
-  int start=0,len=0,n;
+  const char* text=NULL;
+  const char* line;
+  const char* nl;
+  const char* end;
+  size_t length;
+  DWORD n;
   game.clear();
-  
+
   if (!index) // no game 0
     return false;
-  
-  if (!sz)
-  {
-    if (nextGame>index)
-    {
-      nextGame=1;
-      file.setFilepointer(0);
-    }
-  
-    // Find the next game in file
-    while (1)
-    {
-      if (!file.readLine(line))
-        return false;
-      if (line.substr(0,7)=="[Event ")
-      {
-        if (nextGame==index)
-        {
-          nextGame++;
-          sHeader=line;
-          sHeader+=' ';
-          break;
-        }
-        nextGame++;
-      }
-    }
 
-    // Read the header
-    while (1)
-    {
-      if (!file.readLine(line))
-        break;
-      line=trim(line);
-      if (line.length())
-      {
-        if (line.substr(0,7)=="[Event ")
-        {
-          file.putBack(line);
-          break;
-        }
-        if (line.at(0)!='[')
-        {
-          file.putBack(line);
-          break;
-        }
-        sHeader+=line;
-        sHeader+=' ';
-      }else
-      {
-        break;
-      }
-    }
-  }else
-  {
-    start=0;
-    len=strlen(sz);
-    n=1;
-    // Find the next game in file
-    while (1)
-    {
-      if (start>=len)
-        return false;
-      line=getLine(&sz[start]);
-      start+=line.length()+1;
-      line=trim(line);
-      if (line.length())
-      {
-        if (line.substr(0,7)=="[Event ")
-        {
-          if (n==index)
-          {
-            sHeader=line;
-            sHeader+=' ';
-            break;
-          }
-        }
-        ++n;
-      }
-    }
-
-    // Read the header
-    while (1)
-    {
-      if (start>=len)
-        break;
-      line=getLine(&sz[start]);
-      start+=line.length()+1;
-      line=trim(line);
-      if (line.length())
-      {
-        if (line.at(0)!='[')
-        {
-          sGame=line;
-          sGame+=' ';
-          break;
-        }
-        sHeader+=line;
-        sHeader+=' ';
-      }else
-      {
-        break;
-      }
-    }
-  }
-
-  interpretHeader(sHeader,game);
-
-  if (onlyheader)
-    return true;
-
-  // Find the terminationmarker
-  if (game.info.Result.find("1-0")!=string::npos)
-    termination="1-0";
-  else if (game.info.Result.find("0-1")!=string::npos)
-    termination="0-1";
-  else if (game.info.Result.find("1/2-1/2")!=string::npos)
-    termination="1/2-1/2";
-  else if (game.info.Result.find("*")!=string::npos)
-    termination="*";
-  else
-    termination="";
-
-
-  // Read the movetext
   if (!sz)
   {
-    while (1)
-    {
-      if (!file.readLine(line))
-        break;
-      line=trim(line);
-      if (line.length())
-      {
-        if (line.substr(0,7)=="[Event ")
-        {
-          file.putBack(line);
-          break;
-        }
-        sGame+=line;
-        sGame+=' ';
-      }
-    }
+    if (!useIndex() || (index>gameIndex.size()))
+      return false;
+    PgnIndexEntry& e=gameIndex.games[index-1];
+    // The game is not copied, it is taken from the read buffer or the mapped file.
+    text=file.view(e.offset,e.length);
+    if (!text)
+      return false;
+    length=e.length;
+    nextGame=index+1;
   }else
   {
-    while (1)
-    {
-      if (start>=len)
-        break;
-      line=getLine(&sz[start]);
-      start+=line.length()+1;
-      line=trim(line);
-      if (line.length())
+    // The game goes from its [Event to the next.
+    end=sz+strlen(sz);
+    n=0;
+    for (line=sz; line<end; line=nl+1)
+    {
+      nl=(const char*)memchr(line,'\n',end-line);
+      if (!nl)
+        nl=end;
+      while ((line<nl) && ((*line==' ') || (*line=='\t')))
+        ++line;
+      if ((nl-line>=7) && !memcmp(line,"[Event ",7))
       {
-        if (line.substr(0,7)=="[Event ")
+        if (++n>index)
           break;
-        sGame+=line;
-        sGame+=' ';
+        if (n==index)
+          text=line;
       }
     }
+    if (!text)
+      return false;
+    length=__min(line,end)-text;
   }
 
-  // Fix a normal pgn-error 
-  string::size_type f;
-  while ((f=sGame.find("0-0-0"))!=string::npos)
-    sGame.replace(f,5,"O-O-O");
-  while ((f=sGame.find("0-0"))!=string::npos)
-    sGame.replace(f,3,"O-O");
-
-  interpretGame(sGame,game,maxmove,0,termination,expandnag);
+  parseGame(text,length,game,maxmove,expandnag,onlyheader);
   return true;
 }
 
-void Pgn::interpretHeader(std::string sHeader, ChessGame& game)
+void Pgn::parseGame(const char* text, size_t length, ChessGame& game, int maxmove, bool expandnag, bool onlyheader)
 {
-  int token;
-  int setup;
-  int index;
+  PgnTokenizer tokenizer(text,length);
+  PgnToken t;
+  PgnVariation v;
   string value;
+  char move[16];
   char fen[256];
-  setup=0;
-  index=0;
+  char sz[64];
+  int token, movenumber=0, skip=0;
+  size_t i;
+  bool header=true, setup=false, illegalmove=false;
+  ChessMove nullmove;
+  nullmove.moveType=NULL_MOVE;
+
   *fen=0;
+  parseErrors.clear();
+  variations.clear();
+  game.clear();
   game.setStartPosition("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq 0 1");
-  while ((token=nextHeaderToken(sHeader,value,index))!=PGN_eof)
-  {
-    switch (token)
-    {
-      case PGN_black :
-        game.info.Black=value;
-        break;
-      case PGN_date :
-        game.info.Date=value;
-        break;
-      case PGN_event :
-        game.info.Event=value;
-        break;
-      case PGN_result :
-        game.info.Result=value;
-        break;
-      case PGN_round :
-        game.info.Round=value;
-        break;
-      case PGN_site :
-        game.info.Site=value;
-        break;
-      case PGN_white :
-        game.info.White=value;
-        break;
-      case PGN_setup :
-        if (value=="1")
-        {
-          setup=1;
-          if (*fen)
-            game.setStartPosition(fen);
-        }else
-        {
-          setup=0;
-        }
-        break;
-      case PGN_fen :
+  while ((token=tokenizer.next(t))!=PGNT_eof)
+  {
+    if (token==PGNT_tag)
+    {
+      if (!header)
+        continue;
+      if (t.is("Event"))
+        PgnTokenizer::tagValue(t,game.info.Event);
+      else if (t.is("Site"))
+        PgnTokenizer::tagValue(t,game.info.Site);
+      else if (t.is("Date"))
+        PgnTokenizer::tagValue(t,game.info.Date);
+      else if (t.is("Round"))
+        PgnTokenizer::tagValue(t,game.info.Round);
+      else if (t.is("White"))
+        PgnTokenizer::tagValue(t,game.info.White);
+      else if (t.is("Black"))
+        PgnTokenizer::tagValue(t,game.info.Black);
+      else if (t.is("Result"))
+        PgnTokenizer::tagValue(t,game.info.Result);
+      else if (t.is("WhiteElo"))
+        PgnTokenizer::tagValue(t,game.info.WhiteElo);
+      else if (t.is("BlackElo"))
+        PgnTokenizer::tagValue(t,game.info.BlackElo);
+      else if (t.is("ECO"))
+        PgnTokenizer::tagValue(t,game.info.ECO);
+      else if (t.is("Opening"))
+        PgnTokenizer::tagValue(t,game.info.Opening);
+      else if (t.is("Variation"))
+        PgnTokenizer::tagValue(t,game.info.Variation);
+      else if (t.is("SubVariation"))
+        PgnTokenizer::tagValue(t,game.info.SubVariation);
+      else if (t.is("Remark"))
+        PgnTokenizer::tagValue(t,game.info.Remark);
+      else if (t.is("Annotator"))
+        PgnTokenizer::tagValue(t,game.info.Annotator);
+      else if (t.is("SetUp"))
+      {
+        setup=((t.valueLength==1) && (*t.value=='1'));
+        if (setup && *fen)
+          game.setStartPosition(fen);
+      }
+      else if (t.is("FEN"))
+      {
+        PgnTokenizer::tagValue(t,value);
         strcpy_s(fen,256,value.c_str());
         if (setup)
           game.setStartPosition(fen);
-        break;
-      case PGN_eco :
-        game.info.ECO=value;
-        break;
-      case PGN_opening1 :
-        game.info.Opening=value;
-        break;
-      case PGN_opening2 :
-        game.info.Variation=value;
-        break;
-      case PGN_opening3 :
-        game.info.SubVariation=value;
-        break;
-      case PGN_whiteelo :
-        game.info.WhiteElo=value;
-        break;
-      case PGN_blackelo :
-        game.info.BlackElo=value;
-        break;
-      case PGN_remark :
-        game.info.Remark=value;
-        break;
-      case PGN_annotator :
-        game.info.Annotator=value;
-        break;
-    };
-  };
-}
-
-int Pgn::nextHeaderToken(std::string& s, std::string& value, int& index)
-{
-  if (index >= (int)s.length())
-    return PGN_eof;
-  getValue(s,value,'[',']',index);
-  return tagValue(value);
-}
-
-int Pgn::tagValue(std::string& value)
-{
-  int ret=PGN_tag;
-  if (value.substr(0,6)=="Event ")
-    ret = PGN_event;
-  if (value.substr(0,5)=="Site ")
-    ret = PGN_site;
-  if (value.substr(0,6)=="Round ")
-    ret = PGN_round;
-  if (value.substr(0,6)=="White ")
-    ret = PGN_white;
-  if (value.substr(0,6)=="Black ")
-    ret = PGN_black;
-  if (value.substr(0,5)=="Date ")
-    ret = PGN_date;
-  if (value.substr(0,7)=="Result ")
-    ret = PGN_result;
-  if (value.substr(0,6)=="SetUp ")
-    ret = PGN_setup;
-  if (value.substr(0,4)=="FEN ")
-    ret = PGN_fen;
-  if (value.substr(0,4)=="ECO ")
-    ret = PGN_eco;
-  if (value.substr(0,8)=="Opening ")
-    ret = PGN_opening1;
-  if (value.substr(0,10)=="Variation ")
-    ret = PGN_opening2;
-  if (value.substr(0,13)=="SubVariation ")
-    ret = PGN_opening3;
-  if (value.substr(0,9)=="WhiteElo ")
-    ret = PGN_whiteelo;
-  if (value.substr(0,9)=="BlackElo ")
-    ret = PGN_blackelo;
-  if (value.substr(0,7)=="Remark ")
-    ret = PGN_remark;
-  if (value.substr(0,10)=="Annotator ")
-    ret = PGN_annotator;
-  if (ret==PGN_tag)
-    return ret;
-  stringValue(value);
-  return ret;
-}
-
-void Pgn::stringValue(std::string& value)
-{
-  char c;
-  string s=value;
-  int index=0;
-  value="";
-  while ((c=s.at(index))!='\"')
-  {
-    index++;
-    if (s.at(index)=='\\')
-      index++;
-    if (s.length()==index)
-      return;
-  }
+      }
+      continue;
+    }
+    if (header)
+    {
+      if (onlyheader)
+        return;
+      header=false;
+    }
 
-  index++;
-  while ((c=s.at(index))!='\"')
-  {
-    index++;
-    if (c=='\\')
+    // The rest of a variation is skipped after an illegal move or maxmove.
+    if (skip)
     {
-      c=s.at(index);
-      index++;
+      if (token==PGNT_variationStart)
+        ++skip;
+      else if (token==PGNT_variationEnd)
+        --skip;
+      if (skip)
+        continue;
     }
-    value+=c;
-    if (s.length()==index)
-      return;
-  }
-  return;
-}
 
-void Pgn::interpretGame(std::string sGame, ChessGame& game, int maxmove, int movenumber, const std::string& termination, bool expandnag)
-{
-  int token;
-  //char sz[256];
-  int savePosition,index;
-  bool illegalmove=false;
-  string value;
-  ChessMove nullmove;
-  nullmove.moveType=NULL_MOVE;
-  index=0;
-  while ((token=nextToken(sGame,value,index))!=PGN_eof)
-  {
     switch (token)
     {
-      case PGN_move :
-        if (illegalmove)
-          return;
-        if ((movenumber/2)>=maxmove)
-          return;
-//        strcpy(sz,value.c_str());
-        if (!game.addMove(value))
+      case PGNT_move :
+        if (illegalmove || ((movenumber/2)>=maxmove))
         {
+          if (!variations.size())
+            return;
+          skip=1;
+          break;
+        }
+        // Copy to a terminated string, 0-0 is written as O-O.
+        if (t.length<sizeof(move))
+        {
+          for (i=0; i<t.length; i++)
+            move[i]=(t.text[i]=='0')?'O':t.text[i];
+          move[i]=0;
+        }
+        if ((t.length>=sizeof(move)) || !game.addMove(move))
+        {
+          t.copy(value);
           game.addMove(nullmove);
           game.addBoardComment("Illegal move: ");
           game.addBoardComment(value);
-          cerr << "Illegal move: " << movenumber/2+1 << ".";
-          if (game.position[game.activePosition].board.toMove==WHITE)
-            cerr << "..";
-          cerr << value.c_str() << endl;
+          // The workers of PgnPipeline don't print, the errors are given with the game.
+          sprintf_s(sz,64,"Illegal move: %i.%s",movenumber/2+1,(game.position[game.activePosition].board.toMove==WHITE)?"..":"");
+          parseErrors+=sz+value+"\n";
+          if (printErrors)
+            cerr << sz << value.c_str() << endl;
           illegalmove=true;
         }
         movenumber++;
         break;
-      case PGN_bracket : // Not in use
-        break;
-      case PGN_variation :
-        savePosition=game.activePosition;
+      case PGNT_variationStart :
+        v.activePosition=game.activePosition;
+        v.movenumber=movenumber;
+        v.illegalmove=illegalmove;
+        variations.push_back(v);
         game.backup(1);
         movenumber--;
-        interpretGame(value,game,maxmove,movenumber,string(""),expandnag);
-        game.activePosition=savePosition;
-        movenumber++;
+        illegalmove=false;
         break;
-      case PGN_comment :
+      case PGNT_variationEnd :
+        if (!variations.size())
+          break;
+        v=variations.back();
+        variations.pop_back();
+        game.activePosition=v.activePosition;
+        movenumber=v.movenumber;
+        illegalmove=v.illegalmove;
+        break;
+      case PGNT_comment :
+        PgnTokenizer::comment(t,value);
+        convertControlCharacter(value,false);
         expandNags(value);
         if (moveComment(value))
           game.addMoveComment(value);
         else
           game.addBoardComment(value);
         break;
-      case PGN_shortcomment :
+      case PGNT_shortcomment :
+        t.copy(value);
         game.addMoveComment(value);
         break;
-      case PGN_nag :
-        if (expandnag)
-        {
-          if (!convertNag(value))
-            break;
-        }else
-        {
-          value='$'+value;
-        }
+      case PGNT_nag :
+        sprintf_s(move,sizeof(move),"%s%d",expandnag?"":"$",PgnTokenizer::integer(t));
+        value=move;
+        if (expandnag && !convertNag(value))
+          break;
         if (moveComment(value))
           game.addMoveComment(value);
         else
           game.addBoardComment(value);
         break;
-      case PGN_symbol :
-        if (termination.length())
-          if (value==termination)
-            return;
-        break;
     };
   };
 }
 
-int Pgn::nextToken(std::string& s, std::string& value, int& index)
-{
-  char c;
-  if ((int)s.length()<=index)
-    return PGN_eof;
-  if (index==string::npos)
-    return PGN_eof;
-
-  value="";
-  while (1)
-  {
-    c=s.at(index);
-    switch (c)
-    {
-      case '{' :                      // Comment
-		string::size_type f;
-		getValue(s,value,'{','}',index);
-		convertControlCharacter(value, false);
-        return PGN_comment;
-      case '<':                       // Bracket
-        getValue(s,value,'<','>',index);
-        return PGN_bracket;
-      case '(':                       // Variation
-        ravValue(s,value,index);
-        return PGN_variation;
-      case '$':                       // NAG value
-        if (++index>=(int)s.length()) return PGN_nag;
-        integerValue(s,value,index);
-        return PGN_nag;
-      case '!':
-      case '?':
-        while ((c=='!') || (c=='?'))
-        {
-          value+=c;
-          if (++index>=(int)s.length()) return PGN_shortcomment;
-          c=s.at(index);
-        }
-        return PGN_shortcomment;
-      case '0':
-      case '1':
-      case '2':
-      case '3':
-      case '4':
-      case '5':
-      case '6':
-      case '7':
-      case '8':
-      case '9':
-        integerValue(s,value,index);
-        return PGN_integer;
-      case '.':
-        value=c;
-        index++;
-        return PGN_period;
-      default: // Move or symbol
-        if (isSymbol(c))
-        {
-          if (isMove(s,index))
-          {
-            while (existIn(c,"NBRQKabcdefgh12345678xoO-="))
-            {
-              value+=c;
-              if (++index>=(int)s.length()) return PGN_move;
-              c=s.at(index);
-              // Check for promotion since this could also be equal position.
-              if (c=='=')
-                if (index>=((int)s.length()-1))
-                  if (existIn(s.at(index+1),"NBRQ"))
-                    index++;
-            }
-            return PGN_move;
-          }
-          while (isSymbol(c))
-          {
-            value+=c;
-            if (++index>=(int)s.length()) return PGN_symbol;
-            c=s.at(index);
-          }
-          return PGN_symbol;
-        }
-        break;
-    }
-    if (++index>=(int)s.length()) return PGN_eof;
-  };
-}
-
-void Pgn::getValue(std::string& s, std::string& value, char start, char end, int& index)
-{
-  char c;
-  value="";
-  if ((int)s.length()<=index)
-    return;
-  while ((c=s.at(index))!=start)
-  {
-    if (++index>=(int)s.length()) return;
-    if (s.at(index)=='\\')
-      if (++index>=(int)s.length()) return;
-    if (s.length()==index)
-      return;
-  }
-  if (++index>=(int)s.length()) return;
-  while ((c=s.at(index))!=end)
-  {
-    if (++index>=(int)s.length()) return;
-    if (c=='\\')
-    {
-      c=s.at(index);
-      if (++index>=(int)s.length()) return;
-    }
-    value+=c;
-  }
-  value=trim(value);
-  index++;
-}
-
-// Get variation
-void Pgn::ravValue(std::string& s, std::string& value, int& index)
-{
-  char c,d;
-  int count;
-  string v;
-  value="";
-  while ((c=s.at(index))!='(')
-  {
-    index++;
-    if (s.at(index)=='\\')
-      index++;
-    if (s.length()==index) return;
-  }
-  if (++index>=(int)s.length()) return;
-  count=1;
-  while (1)
-  {
-    c=s.at(index);
-    switch (c)
-    {
-      case ')' :
-        count--;
-        if (!count)
-        {
-          index++;
-          return;
-        }
-        value+=c;
-        break;
-      case '(':
-        count++;
-        value+=c;
-        break;
-      case '{':
-        value+=c;
-        if (++index>=(int)s.length()) return;
-        while ((d=s.at(index))!='}')
-        {
-          value+=d;
-          if (++index>=(int)s.length()) return;
-        }
-        value+=d;
-        break;
-      case '<':
-        value+=c;
-        if (++index>=(int)s.length()) return;
-        while ((d=s.at(index))!='>')
-        {
-          value+=d;
-          if (++index>=(int)s.length()) return;
-        }
-        value+=d;
-        break;
-      default :
-        value+=c;
-    }
-    if (++index>=(int)s.length()) return;
-  }
-}
-
-void Pgn::integerValue(std::string& s, std::string& value, int& index)
-{
-  char sz[16];
-  int i=atoi(s.substr(index).c_str());
-  if (!_itoa_s(i,sz,16,10))
-    value=sz;
-  if (i==0)
-    index+=1;
-  else
-    index+=(int)log10((double)i)+1;
-}
-
 bool Pgn::moveComment(std::string& s)
 {
   if ((s.length()>2) || (s.length()<1))
@@ -669,46 +294,6 @@ bool Pgn::moveComment(std::string& s)
   return false;
 }
 
-bool Pgn::isSymbol(char c)
-{
-  if ((c>='A') && (c<='Z'))
-    return true;
-  if ((c>='a') && (c<='z'))
-    return true;
-  if ((c>='0') && (c<='9'))
-    return true;
-  if (c=='_')
-    return true;
-  if (c=='+')
-    return true;
-  if (c=='#')
-    return true;
-  if (c=='=')
-    return true;
-  if (c==':')
-    return true;
-  if (c=='-')
-    return true;
-  return false;
-}
-
-bool Pgn::isMove(std::string& s, int& index)
-{
-  char c1;
-  char c2;
-  if ((int)s.length()<(index+2))
-    return false;
-  c1=s.at(index);
-  c2=s.at(index+1);
-  if (existIn(c1,"NBRQKabcdefgh"))
-    if (existIn(c2,"abcdefgh12345678x"))
-      return true;
-  if ((s.substr(index,3)=="o-o") || 
-      (s.substr(index,3)=="O-O"))
-    return true;
-  return false;
-}
-
 int Pgn::convertNag(std::string& s)
 {
   #include "NagValues.h"
@@ -970,10 +555,12 @@ bool Pgn::deleteGame(DWORD index)
 {
   char sz[MAX_PATH];
   char temppath[MAX_PATH];
+  char buf[0x10000];
   WinFile temp;
   string line;
   int nr;
-  DWORD start_fp,end_fp;
+  DWORD n;
+  unsigned __int64 start_fp,end_fp;
 
   if (!file.isOpen())
     return false;
@@ -983,42 +570,56 @@ bool Pgn::deleteGame(DWORD index)
   if (!temp.open(sz,GENERIC_WRITE,false,CREATE_ALWAYS,false))
     return false;
 
-  file.setFilepointer(0);
-  nr=0;
-
-  start_fp=0;
-  while (file.readLine(line))
+  if (useIndex())
   {
-    if (line.substr(0,7)=="[Event ")
-      ++nr;
-    if (nr==index)
-      break;
-    start_fp=file.dwFilepointer;
+    if (!index || (index>gameIndex.size()))
+    {
+      temp.deleteFile();
+      return false;
+    }
+    start_fp=gameIndex.games[index-1].offset;
+    end_fp=start_fp+gameIndex.games[index-1].length;
   }
-  
-  if (nr!=index)
+  else
   {
-    temp.deleteFile();
-    return false;
-  }
+    file.setFilepointer(0);
+    nr=0;
 
-  end_fp=start_fp;
-  while (file.readLine(line))
-  {
-    if (line.substr(0,7)=="[Event ")
-      break;
-    end_fp=file.dwFilepointer;
+    start_fp=0;
+    while (file.readLine(line))
+    {
+      if (line.substr(0,7)=="[Event ")
+        ++nr;
+      if (nr==index)
+        break;
+      start_fp=file.filepointer;
+    }
+
+    if (nr!=index)
+    {
+      temp.deleteFile();
+      return false;
+    }
+
+    end_fp=start_fp;
+    while (file.readLine(line))
+    {
+      if (line.substr(0,7)=="[Event ")
+        break;
+      end_fp=file.filepointer;
+    }
   }
  
   file.setFilepointer(0);
-  while (file.dwFilepointer<start_fp)
+  while (file.filepointer<start_fp)
   {
-    if (!file.read(sz,1))
+    n=(DWORD)__min((unsigned __int64)sizeof(buf),start_fp-file.filepointer);
+    if (file.read(buf,n)!=n)
     {
       temp.deleteFile();
       return false;
     }
-    if (!temp.write(sz,1))
+    if (!temp.write(buf,n))
     {
       temp.deleteFile();
       return false;
@@ -1027,14 +628,17 @@ bool Pgn::deleteGame(DWORD index)
 
   file.setFilepointer(end_fp);
 
-  while (file.read(sz,1))
-    temp.write(sz,1);
+  while ((n=file.read(buf,sizeof(buf)))>0)
+    temp.write(buf,n);
  
   file.close();
   temp.close();
   CopyFileA(temp.sFilename.c_str(),file.sFilename.c_str(),FALSE);
   temp.deleteFile();
   file.reopen();
+  nextGame=1;
+  if (gameIndex.loaded)
+    gameIndex.remove(file,index);
   return true;
 }
 
@@ -1042,10 +646,12 @@ bool Pgn::replaceGame(DWORD index, ChessGame& game)
 {
   char sz[MAX_PATH];
   char temppath[MAX_PATH];
+  char buf[0x10000];
   WinFile temp;
   string line;
   int nr;
-  DWORD start_fp,end_fp;
+  DWORD n;
+  unsigned __int64 start_fp,end_fp;
 
   if (!file.isOpen())
     return false;
@@ -1055,42 +661,56 @@ bool Pgn::replaceGame(DWORD index, ChessGame& game)
   if (!temp.open(sz,GENERIC_WRITE,false,CREATE_ALWAYS,false))
     return false;
 
-  file.setFilepointer(0);
-  nr=0;
-
-  start_fp=0;
-  while (file.readLine(line))
+  if (useIndex())
   {
-    if (line.substr(0,7)=="[Event ")
-      ++nr;
-    if (nr==index)
-      break;
-    start_fp=file.dwFilepointer;
+    if (!index || (index>gameIndex.size()))
+    {
+      temp.deleteFile();
+      return false;
+    }
+    start_fp=gameIndex.games[index-1].offset;
+    end_fp=start_fp+gameIndex.games[index-1].length;
   }
-  
-  if (nr!=index)
+  else
   {
-    temp.deleteFile();
-    return false;
-  }
+    file.setFilepointer(0);
+    nr=0;
 
-  end_fp=start_fp;
-  while (file.readLine(line))
-  {
-    if (line.substr(0,7)=="[Event ")
-      break;
-    end_fp=file.dwFilepointer;
+    start_fp=0;
+    while (file.readLine(line))
+    {
+      if (line.substr(0,7)=="[Event ")
+        ++nr;
+      if (nr==index)
+        break;
+      start_fp=file.filepointer;
+    }
+
+    if (nr!=index)
+    {
+      temp.deleteFile();
+      return false;
+    }
+
+    end_fp=start_fp;
+    while (file.readLine(line))
+    {
+      if (line.substr(0,7)=="[Event ")
+        break;
+      end_fp=file.filepointer;
+    }
   }
  
   file.setFilepointer(0);
-  while (file.dwFilepointer<start_fp)
+  while (file.filepointer<start_fp)
   {
-    if (!file.read(sz,1))
+    n=(DWORD)__min((unsigned __int64)sizeof(buf),start_fp-file.filepointer);
+    if (file.read(buf,n)!=n)
     {
       temp.deleteFile();
       return false;
     }
-    if (!temp.write(sz,1))
+    if (!temp.write(buf,n))
     {
       temp.deleteFile();
       return false;
@@ -1104,34 +724,39 @@ bool Pgn::replaceGame(DWORD index, ChessGame& game)
 
   file.setFilepointer(end_fp);
 
-  while (file.read(sz,1))
-    temp.write(sz,1);
+  while ((n=file.read(buf,sizeof(buf)))>0)
+    temp.write(buf,n);
  
   file.close();
   temp.close();
   CopyFileA(temp.sFilename.c_str(),file.sFilename.c_str(),FALSE);
   temp.deleteFile();
   file.reopen();
+  nextGame=1;
+  if (gameIndex.loaded)
+    gameIndex.resize(file,index,(DWORD)line.length());
   return true;
 }
 
 bool Pgn::appendGame(ChessGame& game)
 {
-  DWORD fp;
-  int i;
+  unsigned __int64 fp;
   if (!file.isOpen())
     return false;
 
   string s,line1,line2;
 
+  // Only a saved index is updated, it is not made for a file that is written.
+  if (!gameIndex.loaded)
+    gameIndex.load(file,false);
+
   fp=file.size();
   if (fp>0)
   {
-    i=fp-20;
-    if (i<0)
+    if (fp<20)
       fp=0;
     else
-      fp=(DWORD)i;
+      fp-=20;
     file.setFilepointer(fp);
     while (file.readLine(s))
     {
@@ -1152,7 +777,11 @@ bool Pgn::appendGame(ChessGame& game)
   
   s=toString(game,false);
   s+='\n';
-  file.write(s.c_str(),s.length());
+  fp=file.filepointer;
+  if (!file.write(s.c_str(),s.length()))
+    return false;
+  if (gameIndex.loaded)
+    gameIndex.append(file,fp,s);
   
   return true;
 }
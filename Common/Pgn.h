@@ -2,60 +2,32 @@
 
 #include <windows.h>
 #include <string>
+#include <vector>
 #include "../Common/WinFile.h"
+#include "../Common/PgnIndex.h"
+#include "../Common/PgnTokenizer.h"
 #include "../Common/ChessGame.h"
 
+// Where to go back to at the end of a variation.
+struct PgnVariation
+{
+  int activePosition;
+  int movenumber;
+  bool illegalmove;
+};
+
 class Pgn
 {
 protected:
-  enum { 
-      PGN_unknown,      // Unknown or none token.
-      PGN_string,       // String token ("abc")
-      PGN_integer,      // Integer token
-      PGN_period,       // Period token.
-      PGN_termination,  // Termination def.= *, 1-0, 0-1, 1/2-1/2.
-      PGN_tag,          // Unknown TAG. ("[xxx]")
-      PGN_event,        // Event tag.
-      PGN_site,         // Site tag.
-      PGN_date,         // Date tag.
-      PGN_round,        // Round tag.
-      PGN_white,        // White tag.
-      PGN_black,        // Black tag.
-      PGN_result,       // Result tag.
-      PGN_setup,        // Setup tag.
-      PGN_fen,          // Start position if Setup==1
-      PGN_eco,          // ECO tag
-      PGN_opening1,     // Opening tag
-      PGN_opening2,     // Variation tag
-      PGN_opening3,     // SubVariation tag
-      PGN_whiteelo,
-      PGN_blackelo,
-      PGN_remark,
-      PGN_annotator,
-      PGN_variation,    // Variation ("(xxx)").
-      PGN_bracket,      // Bracked ("<xxx>").
-      PGN_nag,          // NAG ("$")
-      PGN_comment,      // Comment. ("{vbvbbvb}")
-      PGN_symbol,       // Symbol as not could get into PGN_move eg. +#
-      PGN_shortcomment, // ! !?
-      PGN_move,         // Moves
-      PGN_eof           // End of string.
-  };
-  int nextHeaderToken(std::string& s, std::string& value,int& index);
-  int nextToken(std::string& s, std::string& value,int& index);
-  int tagValue(std::string& value);
-  void stringValue(std::string& value);
-  void getValue(std::string&s, std::string& value, char start, char end, int& index);
-  void ravValue(std::string& s, std::string& value, int& index);
-  void integerValue(std::string& s, std::string& value, int& index);
-  bool isSymbol(char c);
-  bool isMove(std::string& s, int& index);
-  void interpretHeader(std::string sHeader, ChessGame& game);
-  void interpretGame(std::string sGame, ChessGame& game, int maxmove, int movenumber, const std::string& termination, bool expandnag);
   bool moveComment(std::string& s);
   int  convertNag(std::string& s);
   void expandNags(std::string& s);
   DWORD nextGame;
+  // Offsets of the games, loaded or made the first time it is needed.
+  PgnIndex gameIndex;
+  bool useIndex();
+  // Open variations while a game is parsed, kept to reuse the memory.
+  std::vector<PgnVariation> variations;
   // Convert control characters (\n, \r, \t).
   // From = true:
   // \x -> ^0xx
@@ -64,11 +36,22 @@ protected:
   void convertControlCharacter(std::string&, bool from);
 public:
   WinFile file;
+  // The illegal moves in the last game parsed, one line each. They are
+  // also written to cerr when printErrors is set, the default.
+  std::string parseErrors;
+  bool printErrors;
   Pgn();
   virtual ~Pgn();
   virtual bool open(const std::string& fname, bool readonly);
+  // Save the game index to <pgnfile>.pgi so the next open doesn't need to
+  // read the whole file. Off by default, a file that can't be written is
+  // skipped.
+  inline void saveIndex(bool save) { gameIndex.saveFile = save; };
   virtual void close();
   virtual bool read(ChessGame& game, DWORD index, int maxmove=999, bool expandnag=true, const char* sz=NULL, bool onlyheader=false);
+  // Make the game from the pgn text of one game, as read() does. The text
+  // doesn't need to be terminated, so it can be a part of a larger buffer.
+  void parseGame(const char* text, size_t length, ChessGame& game, int maxmove=999, bool expandnag=true, bool onlyheader=false);
   virtual std::string toString(ChessGame game, bool strict=false);
   virtual void getMovetext(std::string& movetext, ChessGame& g, int movenumber=1);
   virtual int  size();
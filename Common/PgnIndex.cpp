@@ -0,0 +1,287 @@
+#include "../Common/PgnIndex.h"
+#include <string.h>
+#include <stdlib.h>
+
+using namespace std;
+
+struct PgnIndexHeader
+{
+  char magic[4];
+  DWORD entrySize;
+  unsigned __int64 pgnSize;
+  unsigned __int64 pgnTime;
+  unsigned __int64 games;
+};
+
+static const char PGI_MAGIC[4] = { 'P','G','I','1' };
+
+// Entries read or written at a time, the length in WinFile is a DWORD.
+#define PGI_CHUNK 0x10000
+
+PgnIndex::PgnIndex()
+{
+  saveFile=false;
+  clear();
+}
+
+void PgnIndex::clear()
+{
+  games.clear();
+  path="";
+  pgnSize=0;
+  pgnTime=0;
+  loaded=false;
+}
+
+unsigned __int64 PgnIndex::fileTime(WinFile& file)
+{
+  FILETIME ft;
+  if (!file.isOpen() || !GetFileTime(file.hFile,NULL,NULL,&ft))
+    return 0;
+  return ((unsigned __int64)ft.dwHighDateTime<<32)|ft.dwLowDateTime;
+}
+
+bool PgnIndex::load(WinFile& pgnfile, bool make)
+{
+  WinFile in;
+  PgnIndexHeader h;
+  size_t i, n;
+
+  clear();
+  if (!pgnfile.isOpen())
+    return false;
+  path=pgnfile.sFilename+".pgi";
+  if (in.open(path,GENERIC_READ,false,OPEN_EXISTING,false))
+  {
+    if ((in.read(&h,sizeof(h),0)==sizeof(h)) && !memcmp(h.magic,PGI_MAGIC,4) && (h.entrySize==sizeof(PgnIndexEntry))
+      && (h.pgnSize==pgnfile.size()) && (h.pgnTime==fileTime(pgnfile))
+      && (in.size()==sizeof(h)+h.games*sizeof(PgnIndexEntry)))
+    {
+      games.resize((size_t)h.games);
+      for (i=0; i<games.size(); i+=n)
+      {
+        n=__min(games.size()-i,(size_t)PGI_CHUNK);
+        if (in.read(&games[i],(DWORD)(n*sizeof(PgnIndexEntry)))!=n*sizeof(PgnIndexEntry))
+          break;
+      }
+      if (i>=games.size())
+      {
+        pgnSize=h.pgnSize;
+        pgnTime=h.pgnTime;
+        loaded=true;
+        return true;
+      }
+      games.clear();
+    }
+    in.close();
+  }
+  if (!make)
+    return false;
+  return build(pgnfile);
+}
+
+// Read the tags used in the index from a header line.
+bool PgnIndex::readHeader(const char* line, size_t len, PgnIndexEntry& entry)
+{
+  string tag, value;
+  const char* q;
+  const char* e;
+  if ((len<4) || (line[0]!='['))
+    return false;
+  q=(const char*)memchr(line,'\"',len);
+  if (!q)
+    return false;
+  e=(const char*)memchr(q+1,'\"',len-(q+1-line));
+  if (!e)
+    return false;
+  tag.assign(line+1,q-line-1);
+  while (tag.length() && (tag.at(tag.length()-1)==' '))
+    tag.erase(tag.length()-1);
+  value.assign(q+1,e-q-1);
+  if (tag=="Result")
+  {
+    if (value=="1-0")
+      entry.result=1;
+    else if (value=="0-1")
+      entry.result=2;
+    else if (value=="1/2-1/2")
+      entry.result=3;
+  }
+  else if (tag=="Date")
+  {
+    // yyyy.mm.dd, ?? is 0.
+    entry.date=atoi(value.c_str())*10000;
+    if (value.length()>=7)
+      entry.date+=atoi(value.substr(5,2).c_str())*100;
+    if (value.length()>=10)
+      entry.date+=atoi(value.substr(8,2).c_str());
+  }
+  else if (tag=="WhiteElo")
+  {
+    entry.whiteElo=(WORD)atoi(value.c_str());
+  }
+  else if (tag=="BlackElo")
+  {
+    entry.blackElo=(WORD)atoi(value.c_str());
+  }
+  return true;
+}
+
+bool PgnIndex::build(WinFile& pgnfile)
+{
+  PgnIndexEntry e;
+  const char* line;
+  size_t len;
+  unsigned __int64 fp, oldfp;
+  bool game=false, header=false;
+
+  games.clear();
+  loaded=false;
+  if (!pgnfile.isOpen())
+    return false;
+  path=pgnfile.sFilename+".pgi";
+  oldfp=pgnfile.filepointer;
+  pgnfile.setFilepointer(0);
+  while (1)
+  {
+    fp=pgnfile.filepointer;
+    if (!pgnfile.readLine(line,len))
+      break;
+    // A game goes to the start of the next [Event, as in Pgn::read.
+    if ((len>=7) && !memcmp(line,"[Event ",7))
+    {
+      if (game)
+      {
+        e.length=(DWORD)(fp-e.offset);
+        games.push_back(e);
+      }
+      memset(&e,0,sizeof(e));
+      e.offset=fp;
+      game=true;
+      header=true;
+    }
+    else if (header && len)
+    {
+      if (line[0]=='[')
+        readHeader(line,len,e);
+      else
+        header=false;
+    }
+  }
+  if (game)
+  {
+    e.length=(DWORD)(pgnfile.filepointer-e.offset);
+    games.push_back(e);
+  }
+  pgnfile.setFilepointer(oldfp);
+  loaded=true;
+  save(pgnfile);
+  return true;
+}
+
+bool PgnIndex::save(WinFile& pgnfile)
+{
+  WinFile out;
+  PgnIndexHeader h;
+  size_t i, n;
+
+  pgnSize=pgnfile.size();
+  pgnTime=fileTime(pgnfile);
+  // The index is still used if it can't be saved.
+  if (!saveFile || !out.open(path,GENERIC_WRITE,false,CREATE_ALWAYS,false))
+    return false;
+  memcpy(h.magic,PGI_MAGIC,4);
+  h.entrySize=sizeof(PgnIndexEntry);
+  h.pgnSize=pgnSize;
+  h.pgnTime=pgnTime;
+  h.games=games.size();
+  if (!out.write(&h,sizeof(h),0))
+  {
+    out.deleteFile();
+    return false;
+  }
+  for (i=0; i<games.size(); i+=n)
+  {
+    n=__min(games.size()-i,(size_t)PGI_CHUNK);
+    if (!out.write(&games[i],(DWORD)(n*sizeof(PgnIndexEntry))))
+    {
+      out.deleteFile();
+      return false;
+    }
+  }
+  out.close();
+  return true;
+}
+
+void PgnIndex::append(WinFile& pgnfile, unsigned __int64 offset, const std::string& text)
+{
+  WinFile out;
+  PgnIndexEntry e;
+  PgnIndexHeader h;
+  size_t start, end;
+  bool updated=false;
+
+  memset(&e,0,sizeof(e));
+  e.offset=offset;
+  e.length=(DWORD)text.length();
+  for (start=0; start<text.length(); start=end+1)
+  {
+    end=text.find('\n',start);
+    if (end==string::npos)
+      end=text.length();
+    if ((end==start) || (text.at(start)!='['))
+      break;
+    readHeader(text.c_str()+start,end-start,e);
+  }
+  // The last game goes to the new game.
+  if (games.size())
+    games.back().length=(DWORD)(offset-games.back().offset);
+  games.push_back(e);
+
+  // Write the changed entries and the header, or the whole index.
+  pgnSize=pgnfile.size();
+  pgnTime=fileTime(pgnfile);
+  if (saveFile && out.open(path,GENERIC_WRITE,false,OPEN_EXISTING,false) && (out.size()==sizeof(h)+(games.size()-1)*sizeof(PgnIndexEntry)))
+  {
+    memcpy(h.magic,PGI_MAGIC,4);
+    h.entrySize=sizeof(PgnIndexEntry);
+    h.pgnSize=pgnSize;
+    h.pgnTime=pgnTime;
+    h.games=games.size();
+    updated=true;
+    if (games.size()>1)
+      updated=out.write(&games[games.size()-2],2*sizeof(PgnIndexEntry),sizeof(h)+(games.size()-2)*sizeof(PgnIndexEntry));
+    else
+      updated=out.write(&games[0],sizeof(PgnIndexEntry),sizeof(h));
+    updated=updated && out.write(&h,sizeof(h),0);
+    out.close();
+  }
+  if (!updated)
+    save(pgnfile);
+}
+
+void PgnIndex::resize(WinFile& pgnfile, DWORD index, DWORD length)
+{
+  size_t i;
+  __int64 diff;
+  if (!index || (index>games.size()))
+    return;
+  diff=(__int64)length-(__int64)games[index-1].length;
+  games[index-1].length=length;
+  for (i=index; i<games.size(); i++)
+    games[i].offset+=diff;
+  save(pgnfile);
+}
+
+void PgnIndex::remove(WinFile& pgnfile, DWORD index)
+{
+  size_t i;
+  DWORD length;
+  if (!index || (index>games.size()))
+    return;
+  length=games[index-1].length;
+  games.erase(games.begin()+(index-1));
+  for (i=index-1; i<games.size(); i++)
+    games[i].offset-=length;
+  save(pgnfile);
+}
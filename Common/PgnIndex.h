@@ -0,0 +1,50 @@
+#pragma once
+
+#include <windows.h>
+#include <string>
+#include <vector>
+#include "../Common/WinFile.h"
+
+// Where a game is in the pgn file, with some header fields.
+struct PgnIndexEntry
+{
+  unsigned __int64 offset; // Start of the [Event tag
+  DWORD length;            // To the start of the next game
+  DWORD date;              // yyyymmdd, 0 if unknown
+  WORD whiteElo;
+  WORD blackElo;
+  BYTE result;             // 0=*, 1=1-0, 2=0-1, 3=1/2-1/2
+  BYTE reserved[3];
+};
+
+// Index of the games in a pgn file, game n is games[n-1]. When saveFile is
+// set the index is saved to <pgnfile>.pgi with the size and time of the pgn
+// file, and is only used if they are the same when it is loaded. Without it
+// the index is only kept in memory, and a saved index is read but not
+// written.
+class PgnIndex
+{
+  std::string path;
+  unsigned __int64 pgnSize;
+  unsigned __int64 pgnTime;
+  bool readHeader(const char* line, size_t len, PgnIndexEntry& entry);
+public:
+  std::vector<PgnIndexEntry> games;
+  bool loaded;
+  bool saveFile;
+  PgnIndex();
+  void clear();
+  // Load the index for the open pgn file, if it is not saved or the pgn
+  // file has changed it is made with one pass over the file when make is set.
+  bool load(WinFile& pgnfile, bool make=true);
+  // Make the index from the open pgn file and save it.
+  bool build(WinFile& pgnfile);
+  bool save(WinFile& pgnfile);
+  // Add a game written at offset to the end of the pgn file, text is the game as written.
+  void append(WinFile& pgnfile, unsigned __int64 offset, const std::string& text);
+  // The game has a new length, the games after it are moved.
+  void resize(WinFile& pgnfile, DWORD index, DWORD length);
+  void remove(WinFile& pgnfile, DWORD index);
+  inline DWORD size() { return (DWORD)games.size(); };
+  static unsigned __int64 fileTime(WinFile& file);
+};
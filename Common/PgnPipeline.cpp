@@ -0,0 +1,336 @@
+#include <process.h>
+#include <string.h>
+#include "../Common/PgnPipeline.h"
+#include "../Common/Pgn.h"
+
+using namespace std;
+
+const size_t PIPELINE_CHUNKSIZE = 0x40000; // 256 kB
+
+PgnPipeline::PgnPipeline()
+{
+	threads = 0;
+	ordered = true;
+	queueSize = 0;
+	chunkSize = PIPELINE_CHUNKSIZE;
+	maxmove = 999;
+	expandnag = true;
+	onlyheader = false;
+	current = NULL;
+	nextSequence = 0;
+	chunks = 0;
+	workers = 0;
+	readerDone = true;
+	stopped = false;
+	done = 0;
+	fileSize = 0;
+	InitializeCriticalSection(&cs);
+	InitializeConditionVariable(&chunkRead);
+	InitializeConditionVariable(&chunkParsed);
+	InitializeConditionVariable(&chunkTaken);
+}
+
+PgnPipeline::~PgnPipeline()
+{
+	stop();
+	DeleteCriticalSection(&cs);
+}
+
+bool PgnPipeline::start(const std::string& pgnfile)
+{
+	SYSTEM_INFO si;
+	HANDLE h;
+	int i, n;
+
+	stop();
+	error = "";
+	errors = "";
+	if (!file.open(pgnfile, GENERIC_READ, false, OPEN_EXISTING, false))
+	{
+		error = "Unable to open: " + pgnfile;
+		return false;
+	}
+	fileSize = file.size();
+	n = threads;
+	if (n < 1)
+	{
+		GetSystemInfo(&si);
+		n = si.dwNumberOfProcessors;
+	}
+	// The reader is also waited for.
+	n = __max(1, __min(n, MAXIMUM_WAIT_OBJECTS - 1));
+	if (!queueSize)
+		queueSize = 2 * n;
+	queueSize = __max(queueSize, (size_t)n + 1);
+
+	nextSequence = 0;
+	chunks = 0;
+	done = 0;
+	stopped = false;
+	readerDone = false;
+	workers = n;
+	hThreads.push_back((HANDLE)_beginthreadex(NULL, 0, reader, this, 0, NULL));
+	for (i = 0; i < n; i++)
+	{
+		h = (HANDLE)_beginthreadex(NULL, 0, worker, this, 0, NULL);
+		if (!h)
+		{
+			EnterCriticalSection(&cs);
+			workers -= n - i;
+			LeaveCriticalSection(&cs);
+			break;
+		}
+		hThreads.push_back(h);
+	}
+	if (!hThreads[0] || !workers)
+	{
+		error = "Unable to start the threads.";
+		stop();
+		return false;
+	}
+	return true;
+}
+
+void PgnPipeline::stop()
+{
+	size_t i;
+	EnterCriticalSection(&cs);
+	stopped = true;
+	WakeAllConditionVariable(&chunkRead);
+	WakeAllConditionVariable(&chunkParsed);
+	WakeAllConditionVariable(&chunkTaken);
+	LeaveCriticalSection(&cs);
+	for (i = 0; i < hThreads.size(); i++)
+	{
+		if (hThreads[i])
+		{
+			WaitForSingleObject(hThreads[i], INFINITE);
+			CloseHandle(hThreads[i]);
+		}
+	}
+	hThreads.clear();
+	freeChunks();
+	readerDone = true;
+	workers = 0;
+	file.close();
+}
+
+void PgnPipeline::freeChunks()
+{
+	size_t i;
+	for (i = 0; i < readChunks.size(); i++)
+		delete readChunks[i];
+	readChunks.clear();
+	for (i = 0; i < parsedChunks.size(); i++)
+		delete parsedChunks[i];
+	parsedChunks.clear();
+	if (current)
+		delete current;
+	current = NULL;
+}
+
+unsigned __stdcall PgnPipeline::reader(void* lpv)
+{
+	((PgnPipeline*)lpv)->read();
+	return 0;
+}
+
+unsigned __stdcall PgnPipeline::worker(void* lpv)
+{
+	((PgnPipeline*)lpv)->parse();
+	return 0;
+}
+
+// Find the games in the chunk, a game starts with [Event first on a line.
+void PgnPipeline::findGames(PgnChunk* chunk)
+{
+	const char* text = chunk->text.data();
+	const char* end = text + chunk->text.size();
+	const char* p = text;
+	chunk->start.clear();
+	while (p < end)
+	{
+		if ((end - p >= 7) && !memcmp(p, "[Event ", 7))
+			chunk->start.push_back(p - text);
+		p = (const char*)memchr(p, '\n', end - p);
+		if (!p)
+			break;
+		++p;
+	}
+}
+
+void PgnPipeline::read()
+{
+	PgnChunk* chunk = NULL;
+	vector<char> rest;
+	unsigned __int64 fp = 0;
+	DWORD dwRead, firstGame = 1;
+	ULONGLONG sequence = 0;
+	size_t len, cut;
+	bool eof = false;
+
+	while (!eof)
+	{
+		// Wait until next() has taken a chunk if the queue is full.
+		EnterCriticalSection(&cs);
+		while (!stopped && (chunks >= queueSize))
+			SleepConditionVariableCS(&chunkTaken, &cs, INFINITE);
+		LeaveCriticalSection(&cs);
+		if (stopped)
+			break;
+
+		chunk = new PgnChunk;
+		chunk->sequence = sequence;
+		chunk->offset = fp - rest.size();
+		chunk->next = 0;
+		chunk->text.swap(rest);
+		// Read until the chunk has a whole game.
+		while (1)
+		{
+			len = chunk->text.size();
+			chunk->text.resize(len + chunkSize);
+			dwRead = file.read(chunk->text.data() + len, (DWORD)chunkSize, fp);
+			chunk->text.resize(len + dwRead);
+			fp += dwRead;
+			eof = (dwRead == 0);
+			findGames(chunk);
+			if (eof || (chunk->start.size() > 1))
+				break;
+			// Text before the first game is not kept.
+			if (!chunk->start.size() && (chunk->text.size() > 6))
+			{
+				chunk->text.erase(chunk->text.begin(), chunk->text.end() - 6);
+				chunk->offset = fp - 6;
+			}
+		}
+		// The last game can continue in the next chunk.
+		cut = chunk->text.size();
+		if (!eof)
+			cut = chunk->start.back();
+		rest.assign(chunk->text.begin() + cut, chunk->text.end());
+		chunk->text.resize(cut);
+		if (!eof)
+			chunk->start.pop_back();
+		chunk->length = cut;
+		if (!chunk->start.size())
+		{
+			// Only text before the first game.
+			delete chunk;
+			continue;
+		}
+		chunk->firstGame = firstGame;
+		firstGame += (DWORD)chunk->start.size();
+		++sequence;
+
+		EnterCriticalSection(&cs);
+		readChunks.push_back(chunk);
+		++chunks;
+		WakeConditionVariable(&chunkRead);
+		LeaveCriticalSection(&cs);
+	}
+
+	EnterCriticalSection(&cs);
+	readerDone = true;
+	WakeAllConditionVariable(&chunkRead);
+	WakeAllConditionVariable(&chunkParsed);
+	LeaveCriticalSection(&cs);
+}
+
+void PgnPipeline::parse()
+{
+	Pgn pgn;
+	PgnChunk* chunk;
+	size_t i, end;
+
+	pgn.printErrors = false;
+	while (1)
+	{
+		EnterCriticalSection(&cs);
+		while (!stopped && !readChunks.size() && !readerDone)
+			SleepConditionVariableCS(&chunkRead, &cs, INFINITE);
+		if (stopped || !readChunks.size())
+		{
+			LeaveCriticalSection(&cs);
+			break;
+		}
+		chunk = readChunks.front();
+		readChunks.pop_front();
+		LeaveCriticalSection(&cs);
+
+		chunk->games.resize(chunk->start.size());
+		chunk->errors.resize(chunk->start.size());
+		for (i = 0; (i < chunk->start.size()) && !stopped; i++)
+		{
+			end = (i + 1 < chunk->start.size()) ? chunk->start[i + 1] : chunk->text.size();
+			pgn.parseGame(chunk->text.data() + chunk->start[i], end - chunk->start[i], chunk->games[i], maxmove, expandnag, onlyheader);
+			if (pgn.parseErrors.length())
+				chunk->errors[i] = pgn.parseErrors;
+		}
+		// The text is not needed any more.
+		vector<char>().swap(chunk->text);
+
+		EnterCriticalSection(&cs);
+		parsedChunks.push_back(chunk);
+		WakeAllConditionVariable(&chunkParsed);
+		LeaveCriticalSection(&cs);
+	}
+
+	EnterCriticalSection(&cs);
+	--workers;
+	WakeAllConditionVariable(&chunkParsed);
+	LeaveCriticalSection(&cs);
+}
+
+// Take the next parsed chunk, called with cs entered.
+PgnChunk* PgnPipeline::nextChunk()
+{
+	PgnChunk* chunk;
+	size_t i;
+	for (i = 0; i < parsedChunks.size(); i++)
+	{
+		if (!ordered || (parsedChunks[i]->sequence == nextSequence))
+		{
+			chunk = parsedChunks[i];
+			parsedChunks.erase(parsedChunks.begin() + i);
+			++nextSequence;
+			return chunk;
+		}
+	}
+	return NULL;
+}
+
+bool PgnPipeline::next(ChessGame& game, DWORD& index)
+{
+	PgnChunk* chunk = NULL;
+	while (1)
+	{
+		if (current && (current->next < current->games.size()))
+		{
+			index = current->firstGame + (DWORD)current->next;
+			errors.swap(current->errors[current->next]);
+			game.swap(current->games[current->next++]);
+			return true;
+		}
+
+		EnterCriticalSection(&cs);
+		if (current)
+		{
+			// The reader can read the next chunk.
+			done += current->length;
+			delete current;
+			current = NULL;
+			--chunks;
+			WakeConditionVariable(&chunkTaken);
+		}
+		while (!stopped && !(chunk = nextChunk()))
+		{
+			if (readerDone && !workers)
+				break;
+			SleepConditionVariableCS(&chunkParsed, &cs, INFINITE);
+		}
+		LeaveCriticalSection(&cs);
+		if (stopped || !chunk)
+			return false;
+		current = chunk;
+	}
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <Windows.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include "../Common/WinFile.h"
+#include "../Common/ChessGame.h"
+
+// Whole games read from the pgn file, and the games when they are parsed.
+struct PgnChunk
+{
+	ULONGLONG sequence;      // From 0 in file order
+	DWORD firstGame;         // Game number of the first game, from 1
+	unsigned __int64 offset; // In the file
+	size_t length;
+	std::vector<char> text;
+	std::vector<size_t> start; // Start of each game in text
+	std::vector<ChessGame> games;
+	std::vector<std::string> errors; // Pgn::parseErrors for each game
+	size_t next;             // Next game for next()
+};
+
+// Read the games in a pgn file with more threads. A reader thread splits the
+// file in chunks of whole games, the workers parse the games and replay the
+// moves, and next() gives the games in file order or as they are ready. At
+// most queueSize chunks are read and not given by next(), so the reader and
+// workers wait for a slow caller and the memory used doesn't grow with the
+// size of the file. The workers don't write to cerr, the illegal moves in a
+// game are given by gameErrors() after next().
+// How the speed grows with more threads is not measured yet, only that one
+// to four threads on one core are as fast as Pgn::read. 'Test pgn' measures
+// it on a computer with more cores.
+class PgnPipeline
+{
+	WinFile file;
+	std::string error;
+	std::vector<HANDLE> hThreads;
+	CRITICAL_SECTION cs;
+	CONDITION_VARIABLE chunkRead;   // For the workers
+	CONDITION_VARIABLE chunkParsed; // For next()
+	CONDITION_VARIABLE chunkTaken;  // For the reader
+	std::deque<PgnChunk*> readChunks;
+	std::vector<PgnChunk*> parsedChunks;
+	PgnChunk* current;
+	std::string errors;     // For the last game from next()
+	ULONGLONG nextSequence;
+	size_t chunks;          // Read and not given by next()
+	int workers;            // Running
+	bool readerDone;
+	volatile bool stopped;
+	unsigned __int64 fileSize;
+	unsigned __int64 done;  // Bytes given by next()
+	static unsigned __stdcall reader(void* lpv);
+	static unsigned __stdcall worker(void* lpv);
+	void read();
+	void parse();
+	void findGames(PgnChunk* chunk);
+	PgnChunk* nextChunk();
+	void freeChunks();
+public:
+	// Worker threads, 0 is one for each processor.
+	int threads;
+	// Give the games in file order, else as they are parsed.
+	bool ordered;
+	// Chunks in memory, 0 is two for each worker.
+	size_t queueSize;
+	// Bytes read at a time, a chunk is larger if a game doesn't fit.
+	size_t chunkSize;
+	// As for Pgn::read
+	int maxmove;
+	bool expandnag;
+	bool onlyheader;
+	PgnPipeline();
+	virtual ~PgnPipeline();
+	bool start(const std::string& pgnfile);
+	// The next game and its number in the file. Returns false at the end
+	// of the file or after stop.
+	bool next(ChessGame& game, DWORD& index);
+	// Stop the threads, it can be called to cancel before the end.
+	void stop();
+	unsigned __int64 size() { return fileSize; };
+	// Bytes of the file given by next(), for progress.
+	unsigned __int64 position() { return done; };
+	inline const std::string& lastError() { return error; };
+	// The illegal moves in the last game from next(), one line each.
+	inline const std::string& gameErrors() { return errors; };
+};
@@ -0,0 +1,283 @@
+#include "../Common/PgnTokenizer.h"
+#include <string.h>
+
+using namespace std;
+
+#define PGNC_SPACE  0x01 // Skipped between tokens
+#define PGNC_WHITE  0x02 // Removed by trim
+#define PGNC_DIGIT  0x04
+#define PGNC_MOVE1  0x08 // First character of a move
+#define PGNC_MOVE2  0x10 // Second character of a move
+#define PGNC_MOVE   0x20 // Rest of a move
+#define PGNC_SYMBOL 0x40
+
+// Character classes, made once before main so the tokenizer can be used
+// from more threads.
+struct PgnCharClass
+{
+  unsigned char c[256];
+  PgnCharClass()
+  {
+    const char* s;
+    int i;
+    memset(c,0,sizeof(c));
+    for (i=0; i<=' '; i++)
+      c[i]|=PGNC_SPACE;
+    for (s=" \t\n\r\v\f"; *s; s++)
+      c[(unsigned char)*s]|=PGNC_WHITE;
+    for (i='0'; i<='9'; i++)
+      c[i]|=PGNC_DIGIT|PGNC_SYMBOL;
+    for (s="NBRQKabcdefgh"; *s; s++)
+      c[(unsigned char)*s]|=PGNC_MOVE1;
+    for (s="abcdefgh12345678x"; *s; s++)
+      c[(unsigned char)*s]|=PGNC_MOVE2;
+    for (s="NBRQKabcdefgh12345678xoO-="; *s; s++)
+      c[(unsigned char)*s]|=PGNC_MOVE;
+    for (i='A'; i<='Z'; i++)
+      c[i]|=PGNC_SYMBOL;
+    for (i='a'; i<='z'; i++)
+      c[i]|=PGNC_SYMBOL;
+    for (s="_+#=:-"; *s; s++)
+      c[(unsigned char)*s]|=PGNC_SYMBOL;
+  }
+};
+
+static const PgnCharClass pgnChar;
+
+static inline bool charIs(char c, unsigned char cls)
+{
+  return (pgnChar.c[(unsigned char)c]&cls)?true:false;
+}
+
+bool PgnToken::is(const char* sz) const
+{
+  size_t n=strlen(sz);
+  return (n==length) && !memcmp(text,sz,n);
+}
+
+PgnTokenizer::PgnTokenizer()
+{
+  set(NULL,0);
+}
+
+PgnTokenizer::PgnTokenizer(const char* text, size_t length)
+{
+  set(text,length);
+}
+
+void PgnTokenizer::set(const char* text, size_t length)
+{
+  p=text;
+  end=text+length;
+}
+
+// Find c, characters after a \ are skipped. Returns end if not found.
+const char* PgnTokenizer::skipTo(const char* s, char c)
+{
+  while ((s<end) && (*s!=c))
+  {
+    if ((*s=='\\') && (s+1<end))
+      ++s;
+    ++s;
+  }
+  return s;
+}
+
+int PgnTokenizer::next(PgnToken& t)
+{
+  const char* s;
+  const char* v;
+  char c;
+
+  t.value=NULL;
+  t.valueLength=0;
+  while (p<end)
+  {
+    c=*p;
+    if (charIs(c,PGNC_SPACE))
+    {
+      ++p;
+      continue;
+    }
+    s=p;
+    // Fast path for the movetext, a move is two move characters or O-O.
+    if ((p+1<end) && ((charIs(c,PGNC_MOVE1) && charIs(p[1],PGNC_MOVE2))
+      || (((c=='O') || (c=='o')) && (p+2<end) && (p[1]=='-') && (p[2]==c))))
+    {
+      p+=2;
+      while ((p<end) && charIs(*p,PGNC_MOVE))
+        ++p;
+      t.type=PGNT_move;
+    }
+    else if (charIs(c,PGNC_DIGIT))
+    {
+      ++p;
+      while ((p<end) && charIs(*p,PGNC_DIGIT))
+        ++p;
+      t.type=PGNT_integer;
+      if ((p+1<end) && ((*p=='-') || (*p=='/')))
+      {
+        if ((c=='0') && (p==s+1) && (*p=='-') && (p[1]=='0'))
+        {
+          // 0-0 and 0-0-0 is a common error for O-O and O-O-O.
+          while ((p<end) && ((*p=='0') || (*p=='-')))
+            ++p;
+          t.type=PGNT_move;
+        }
+        else
+        {
+          while ((p<end) && (charIs(*p,PGNC_DIGIT) || (*p=='-') || (*p=='/')))
+            ++p;
+          t.type=PGNT_result;
+        }
+      }
+    }
+    else
+    {
+      switch (c)
+      {
+        case '.':
+          while ((p<end) && (*p=='.'))
+            ++p;
+          t.type=PGNT_period;
+          break;
+        case '{':
+        case '<':
+          p=skipTo(p+1,(c=='{')?'}':'>');
+          t.type=(c=='{')?PGNT_comment:PGNT_bracket;
+          t.text=s+1;
+          t.length=p-s-1;
+          if (p<end)
+            ++p;
+          return t.type;
+        case '(':
+          ++p;
+          t.type=PGNT_variationStart;
+          break;
+        case ')':
+          ++p;
+          t.type=PGNT_variationEnd;
+          break;
+        case '$':
+          ++p;
+          while ((p<end) && charIs(*p,PGNC_DIGIT))
+            ++p;
+          t.type=PGNT_nag;
+          t.text=s+1;
+          t.length=p-s-1;
+          return t.type;
+        case '!':
+        case '?':
+          while ((p<end) && ((*p=='!') || (*p=='?')))
+            ++p;
+          t.type=PGNT_shortcomment;
+          break;
+        case '[':
+          ++p;
+          while ((p<end) && charIs(*p,PGNC_SPACE))
+            ++p;
+          t.text=p;
+          while ((p<end) && !charIs(*p,PGNC_SPACE) && (*p!='\"') && (*p!=']'))
+            ++p;
+          t.length=p-t.text;
+          while ((p<end) && (*p!='\"') && (*p!=']'))
+            ++p;
+          t.value=p;
+          if ((p<end) && (*p=='\"'))
+          {
+            v=++p;
+            p=skipTo(p,'\"');
+            t.value=v;
+            t.valueLength=p-v;
+            if (p<end)
+              ++p;
+          }
+          p=skipTo(p,']');
+          if (p<end)
+            ++p;
+          t.type=PGNT_tag;
+          return t.type;
+        default:
+          if (!charIs(c,PGNC_SYMBOL))
+          {
+            ++p;
+            continue;
+          }
+          while ((p<end) && charIs(*p,PGNC_SYMBOL))
+            ++p;
+          t.type=PGNT_symbol;
+          break;
+      }
+    }
+    t.text=s;
+    t.length=p-s;
+    return t.type;
+  }
+  t.type=PGNT_eof;
+  t.text=end;
+  t.length=0;
+  return t.type;
+}
+
+void PgnTokenizer::comment(const PgnToken& t, std::string& s)
+{
+  const char* q=t.text;
+  const char* e=t.text+t.length;
+  s.clear();
+  while ((q<e) && charIs(*q,PGNC_WHITE))
+    ++q;
+  while ((e>q) && charIs(e[-1],PGNC_WHITE))
+    --e;
+  while (q<e)
+  {
+    if ((*q=='\\') && (q+1<e))
+    {
+      s+=q[1];
+      q+=2;
+    }
+    else if ((*q=='\n') || (*q=='\r'))
+    {
+      // The lines are trimmed and joined with a space.
+      while (s.length() && charIs(s.at(s.length()-1),PGNC_WHITE))
+        s.erase(s.length()-1);
+      while ((q<e) && charIs(*q,PGNC_WHITE))
+        ++q;
+      s+=' ';
+    }
+    else
+    {
+      s+=*q++;
+    }
+  }
+}
+
+void PgnTokenizer::tagValue(const PgnToken& t, std::string& s)
+{
+  const char* q=t.value;
+  const char* e=t.value+t.valueLength;
+  if (!memchr(q,'\\',t.valueLength))
+  {
+    s.assign(q,t.valueLength);
+    return;
+  }
+  s.clear();
+  while (q<e)
+  {
+    if ((*q=='\\') && (q+1<e))
+      ++q;
+    s+=*q++;
+  }
+}
+
+int PgnTokenizer::integer(const PgnToken& t)
+{
+  size_t i;
+  int n=0;
+  for (i=0; i<t.length; i++)
+  {
+    if ((t.text[i]<'0') || (t.text[i]>'9'))
+      break;
+    n=n*10+(t.text[i]-'0');
+  }
+  return n;
+}
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <string>
+
+enum PGNTOKEN {
+  PGNT_eof,            // End of the text.
+  PGNT_tag,            // [Name "value"], text is the name.
+  PGNT_move,           // Move, 0-0 and 0-0-0 are moves.
+  PGNT_integer,        // Move number.
+  PGNT_period,         // One or more periods.
+  PGNT_result,         // 1-0, 0-1, 1/2-1/2.
+  PGNT_comment,        // {comment}, text is without the braces.
+  PGNT_bracket,        // <reserved>
+  PGNT_variationStart, // (
+  PGNT_variationEnd,   // )
+  PGNT_nag,            // $n, text is the number.
+  PGNT_shortcomment,   // ! ? !! ?? !? ?!
+  PGNT_symbol          // Other symbols, eg. + #
+};
+
+// A token in pgn text. The text is not copied, it points into the text
+// given to the tokenizer and is not zero terminated.
+struct PgnToken
+{
+  int type;
+  const char* text;
+  size_t length;
+  // Tag value without the quotes, escapes are not removed.
+  const char* value;
+  size_t valueLength;
+  bool is(const char* sz) const;
+  void copy(std::string& s) const { s.assign(text,length); };
+};
+
+// Split pgn text into tokens without copying it. The text can be a game
+// in a read buffer or a memory mapped file, it must stay valid while the
+// tokens are used. Comments and tag values are only copied with comment()
+// and tagValue().
+class PgnTokenizer
+{
+  const char* p;
+  const char* end;
+  const char* skipTo(const char* s, char c);
+public:
+  PgnTokenizer();
+  PgnTokenizer(const char* text, size_t length);
+  void set(const char* text, size_t length);
+  int next(PgnToken& token);
+  // Comment with the escapes removed and the lines joined by a space.
+  static void comment(const PgnToken& token, std::string& s);
+  // Tag value with the escapes removed.
+  static void tagValue(const PgnToken& token, std::string& s);
+  static int integer(const PgnToken& token);
+};
@@ -1,10 +1,19 @@
 #pragma once
 
-#include <QString>
-#include <QVector>
+#include <Windows.h>
+#include <string>
+#include <vector>
 #include "../Common/ChessMove.h"
 #include "../Common/ChessBoard.h"
+#include "../Common/MoveList.h"
+#include "../Common/defs.h"
 
+// Random numbers for the Polyglot key: 12*64 pieces, 4 castle rights,
+// 8 enpassant files and the side to move.
+const int POLYGLOT_KEYS = 781;
+
+// One record in the book file. The file is sorted on key and the numbers
+// are stored big endian.
 struct PolyglotEntry
 {
 	unsigned __int64 key;
@@ -13,16 +22,36 @@ struct PolyglotEntry
 	unsigned __int32 learn;
 };
 
+// Polyglot opening book. The file is memory mapped and searched in place,
+// nothing is read into memory at open.
 class Polyglot
 {
+	HANDLE hFile;
+	HANDLE hMap;
+	const PolyglotEntry* book;
+	size_t entries;
+	static bool checkKeys();
 public:
 	Polyglot();
-	Polyglot(QString& bookfile);
+	Polyglot(const std::string& bookfile);
 	virtual ~Polyglot();
-	bool open(QString& bookfile);
+	bool open(const std::string& bookfile);
 	void close();
-	void get(ChessBoard& board, QVector<ChessMove>& moves);
-private:
-	bool isOpen;
-};
+	inline bool isOpen() const { return book != NULL; };
+	inline size_t size() const { return entries; };
+	// All book moves for the position with the weight in ChessMove::score.
+	// Moves that are not legal in the position are skipped.
+	void get(ChessBoard& board, std::vector<ChessMove>& moves);
+	// Index of the first entry with the key, size() if not found.
+	size_t find(unsigned __int64 key) const;
+	// Convert a book move to a move in ml (the legal moves of the board),
+	// score>0 if illegal.
+	static ChessMove decode(ChessBoard& board, MoveList& ml, unsigned __int16 move);
+	// Convert a move to the book format.
+	static unsigned __int16 encode(const ChessMove& m);
 
+	// Self test of the random numbers, the keys for the start position and
+	// after 1.e4 are checked against the known keys.
+	static bool haveKeys();
+	static unsigned __int64 hashkey(const ChessBoard& board);
+};
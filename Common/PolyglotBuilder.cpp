@@ -0,0 +1,354 @@
+#include <algorithm>
+#include <queue>
+#include <stdlib.h>
+#include "../Common/PolyglotBuilder.h"
+#include "../Common/PgnPipeline.h"
+#include "../Common/StopWatch.h"
+
+using namespace std;
+
+// Records read at a time from each run when merging.
+const size_t MERGE_BUFFER = 4096;
+const ULONGLONG PROGRESS_GAMES = 100000;
+
+void PolyglotBuildStats::clear()
+{
+	games = skipped = moves = runs = entries = 0;
+	seconds = 0;
+}
+
+static bool compareRecord(const PolyglotBuildRecord& r1, const PolyglotBuildRecord& r2)
+{
+	if (r1.key != r2.key)
+		return r1.key < r2.key;
+	return r1.move < r2.move;
+}
+
+static bool compareWeight(const PolyglotBuildRecord& r1, const PolyglotBuildRecord& r2)
+{
+	return r1.score > r2.score;
+}
+
+// One sorted run file read in blocks.
+struct PolyglotRun
+{
+	ifstream f;
+	vector<PolyglotBuildRecord> block;
+	size_t next;
+	bool open(const string& filename)
+	{
+		f.open(filename, ios::binary);
+		next = 0;
+		return f.is_open();
+	};
+	bool get(PolyglotBuildRecord& r)
+	{
+		if (next >= block.size())
+		{
+			block.resize(MERGE_BUFFER);
+			f.read((char*)block.data(), MERGE_BUFFER * sizeof(PolyglotBuildRecord));
+			block.resize((size_t)f.gcount() / sizeof(PolyglotBuildRecord));
+			next = 0;
+			if (!block.size())
+				return false;
+		}
+		r = block[next++];
+		return true;
+	};
+};
+
+// Heap entry, the smallest record on top.
+struct PolyglotMergeItem
+{
+	PolyglotBuildRecord record;
+	size_t run;
+	bool operator<(const PolyglotMergeItem& m) const { return compareRecord(m.record, record); };
+};
+
+PolyglotBuilder::PolyglotBuilder()
+{
+	maxPly = 30;
+	minGames = 1;
+	minScore = 0;
+	minElo = 0;
+	runSize = 1 << 22;
+	progress = NULL;
+	progressData = NULL;
+	stats.clear();
+}
+
+PolyglotBuilder::~PolyglotBuilder()
+{
+	removeRuns();
+}
+
+bool PolyglotBuilder::build(const std::string& pgnfile, const std::string& bookfile)
+{
+	PgnPipeline pgn;
+	ChessGame game;
+	StopWatch watch;
+	DWORD index;
+	bool ok = true;
+
+	stats.clear();
+	error = "";
+	if (!Polyglot::haveKeys())
+	{
+		error = "The Polyglot keys failed the self test.";
+		return false;
+	}
+	// The games are added in any order, the moves are sorted anyway.
+	pgn.ordered = false;
+	pgn.maxmove = maxPly / 2 + 1;
+	pgn.expandnag = false;
+	if (!pgn.start(pgnfile))
+	{
+		error = pgn.lastError();
+		return false;
+	}
+	watch.start();
+	bookName = bookfile;
+	buffer.clear();
+	buffer.reserve(runSize);
+
+	while (pgn.next(game, index))
+	{
+		++stats.games;
+		if (!addGame(game))
+		{
+			ok = false;
+			break;
+		}
+		if (progress && !(stats.games % PROGRESS_GAMES))
+		{
+			stats.seconds = watch.read(WatchPrecision::Millisecond) / 1000.0;
+			progress(stats, progressData);
+		}
+	}
+	pgn.stop();
+
+	if (ok && buffer.size())
+		ok = writeRun();
+	vector<PolyglotBuildRecord>().swap(buffer);
+	if (ok)
+		ok = merge();
+	removeRuns();
+	stats.seconds = watch.read(WatchPrecision::Millisecond) / 1000.0;
+	return ok;
+}
+
+bool PolyglotBuilder::addGame(ChessGame& game)
+{
+	DWORD score[2];
+	bool use[2];
+	int pos, ply;
+	typeColor color;
+	PolyglotBuildRecord r;
+
+	if (game.info.Result == "1-0")
+	{
+		score[WHITE] = 2;
+		score[BLACK] = 0;
+	}
+	else if (game.info.Result == "0-1")
+	{
+		score[WHITE] = 0;
+		score[BLACK] = 2;
+	}
+	else if (game.info.Result == "1/2-1/2")
+	{
+		score[WHITE] = score[BLACK] = 1;
+	}
+	else
+	{
+		++stats.skipped;
+		return true;
+	}
+	use[WHITE] = atoi(game.info.WhiteElo.c_str()) >= minElo;
+	use[BLACK] = atoi(game.info.BlackElo.c_str()) >= minElo;
+	if (!use[WHITE] && !use[BLACK])
+	{
+		++stats.skipped;
+		return true;
+	}
+
+	// Follow the main line
+	pos = 0;
+	for (ply = 0; (ply < maxPly) && (pos < (int)game.position.size()) && game.position[pos].move.size(); ply++)
+	{
+		ChessGamePosition& gp = game.position[pos];
+		ChessMove& m = gp.move[0].move;
+		if (m.moveType&NULL_MOVE)
+			break;
+		color = gp.board.toMove;
+		if (use[color])
+		{
+			r.key = Polyglot::hashkey(gp.board);
+			r.move = Polyglot::encode(m);
+			r.reserved = 0;
+			r.games = 1;
+			r.score = score[color];
+			buffer.push_back(r);
+			++stats.moves;
+			if ((buffer.size() >= runSize) && !writeRun())
+				return false;
+		}
+		pos = gp.move[0].posIndex;
+	}
+	return true;
+}
+
+// Sort the buffer, combine equal moves and write it to a new run file.
+bool PolyglotBuilder::writeRun()
+{
+	size_t i, n;
+	char sz[32];
+
+	sort(buffer.begin(), buffer.end(), compareRecord);
+	n = 0;
+	for (i = 1; i < buffer.size(); i++)
+	{
+		if ((buffer[i].key == buffer[n].key) && (buffer[i].move == buffer[n].move))
+		{
+			buffer[n].games += buffer[i].games;
+			buffer[n].score += buffer[i].score;
+		}
+		else
+		{
+			buffer[++n] = buffer[i];
+		}
+	}
+	if (buffer.size())
+		buffer.resize(n + 1);
+
+	sprintf_s(sz, 32, ".run%u", (unsigned int)runFiles.size());
+	runFiles.push_back(bookName + sz);
+	ofstream f(runFiles.back(), ios::binary | ios::trunc);
+	if (f.is_open())
+		f.write((const char*)buffer.data(), buffer.size() * sizeof(PolyglotBuildRecord));
+	if (!f.is_open() || !f.good())
+	{
+		error = "Unable to write temporary file: " + runFiles.back();
+		return false;
+	}
+	++stats.runs;
+	buffer.clear();
+	return true;
+}
+
+// K-way merge of the runs into the book.
+bool PolyglotBuilder::merge()
+{
+	vector<PolyglotRun*> runs;
+	priority_queue<PolyglotMergeItem> heap;
+	PolyglotMergeItem item;
+	PolyglotBuildRecord current;
+	vector<PolyglotBuildRecord> moves;
+	bool ok = true;
+	bool haveCurrent = false;
+	size_t i;
+
+	ofstream book(bookName, ios::binary | ios::trunc);
+	if (!book.is_open())
+	{
+		error = "Unable to create: " + bookName;
+		return false;
+	}
+	for (i = 0; i < runFiles.size(); i++)
+	{
+		runs.push_back(new PolyglotRun);
+		if (!runs[i]->open(runFiles[i]))
+		{
+			error = "Unable to read temporary file: " + runFiles[i];
+			ok = false;
+			break;
+		}
+		item.run = i;
+		if (runs[i]->get(item.record))
+			heap.push(item);
+	}
+
+	while (ok && !heap.empty())
+	{
+		item = heap.top();
+		heap.pop();
+		if (haveCurrent && (item.record.key == current.key) && (item.record.move == current.move))
+		{
+			current.games += item.record.games;
+			current.score += item.record.score;
+		}
+		else
+		{
+			if (haveCurrent)
+			{
+				if (moves.size() && (moves[0].key != current.key))
+					ok = writeEntries(book, moves);
+				moves.push_back(current);
+			}
+			current = item.record;
+			haveCurrent = true;
+		}
+		if (runs[item.run]->get(item.record))
+			heap.push(item);
+	}
+	if (ok && haveCurrent)
+	{
+		if (moves.size() && (moves[0].key != current.key))
+			ok = writeEntries(book, moves);
+		moves.push_back(current);
+		ok = writeEntries(book, moves);
+	}
+
+	for (i = 0; i < runs.size(); i++)
+		delete runs[i];
+	book.close();
+	if (ok && book.fail())
+	{
+		error = "Unable to write: " + bookName;
+		ok = false;
+	}
+	return ok;
+}
+
+// Write the moves for one position and clear the list.
+bool PolyglotBuilder::writeEntries(std::ofstream& book, std::vector<PolyglotBuildRecord>& moves)
+{
+	PolyglotEntry e;
+	DWORD highest = 0;
+	size_t i, n;
+
+	// Filter
+	n = 0;
+	for (i = 0; i < moves.size(); i++)
+	{
+		if ((moves[i].games < (DWORD)minGames) || ((50 * moves[i].score) < (DWORD)minScore*moves[i].games))
+			continue;
+		moves[n++] = moves[i];
+		highest = __max(highest, moves[i].score);
+	}
+	moves.resize(n);
+	sort(moves.begin(), moves.end(), compareWeight);
+
+	for (i = 0; i < moves.size(); i++)
+	{
+		// The weight is 16 bit, scale the position down if needed.
+		if (highest > 0xffff)
+			moves[i].score = (DWORD)(((ULONGLONG)moves[i].score * 0xffff) / highest);
+		e.key = _byteswap_uint64(moves[i].key);
+		e.move = _byteswap_ushort(moves[i].move);
+		e.weight = _byteswap_ushort((unsigned __int16)moves[i].score);
+		e.learn = 0;
+		book.write((const char*)&e, sizeof(e));
+		++stats.entries;
+	}
+	moves.clear();
+	return book.good();
+}
+
+void PolyglotBuilder::removeRuns()
+{
+	size_t i;
+	for (i = 0; i < runFiles.size(); i++)
+		DeleteFileA(runFiles[i].c_str());
+	runFiles.clear();
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <Windows.h>
+#include <string>
+#include <vector>
+#include <fstream>
+#include "../Common/PolyglotBook.h"
+#include "../Common/ChessGame.h"
+
+// A move seen in the games, before the moves are combined.
+struct PolyglotBuildRecord
+{
+	unsigned __int64 key;
+	unsigned __int16 move;
+	unsigned __int16 reserved;
+	// Games with the move and the score for the side that played it in
+	// half points (win=2, draw=1).
+	DWORD games;
+	DWORD score;
+};
+
+struct PolyglotBuildStats
+{
+	ULONGLONG games;
+	ULONGLONG skipped; // Games without result or with a too low rating
+	ULONGLONG moves;
+	ULONGLONG runs;
+	ULONGLONG entries; // Written to the book
+	double seconds;
+	void clear();
+	double gamesPerSecond() { return (seconds > 0) ? games / seconds : 0; };
+};
+
+// Make a Polyglot book from a pgn file. The moves are collected in a buffer
+// of fixed size, when it's full it is sorted and written to a temporary
+// run file. The runs are merged when all games are read, so the memory used
+// doesn't grow with the size of the pgn file.
+class PolyglotBuilder
+{
+	std::vector<PolyglotBuildRecord> buffer;
+	std::vector<std::string> runFiles;
+	std::string bookName;
+	std::string error;
+	bool addGame(ChessGame& game);
+	bool writeRun();
+	bool merge();
+	bool writeEntries(std::ofstream& book, std::vector<PolyglotBuildRecord>& moves);
+	void removeRuns();
+public:
+	// Plies from the start position
+	int maxPly;
+	// Lowest number of games for a move
+	int minGames;
+	// Lowest score for a move in %
+	int minScore;
+	// Lowest rating for the player of a move. Games without rating is skipped if set.
+	int minElo;
+	// Moves in the buffer before a run is written (24 bytes each).
+	size_t runSize;
+	PolyglotBuildStats stats;
+	// Called for every 100000 games with progressData.
+	void(*progress)(const PolyglotBuildStats& stats, void* data);
+	void* progressData;
+	PolyglotBuilder();
+	virtual ~PolyglotBuilder();
+	bool build(const std::string& pgnfile, const std::string& bookfile);
+	inline const std::string& lastError() { return error; };
+};
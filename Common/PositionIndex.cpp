@@ -0,0 +1,731 @@
+#include <string.h>
+#include <algorithm>
+#include "../Common/PositionIndex.h"
+#include "../Common/MoveGenerator.h"
+
+using namespace std;
+
+// Keys in a block of a segment.
+const int POSITIONINDEX_BLOCKKEYS=32;
+// Postings kept in memory before they are written to a segment, 64 MB.
+const size_t POSITIONINDEX_PENDING=0x400000;
+// Size of the segment data written at a time.
+const size_t POSITIONINDEX_FLUSHSIZE=0x100000;
+
+struct PositionListHeader
+{
+  char magic[4];
+  DWORD games;
+  DWORD nextId;
+  DWORD segments; // The number of each segment follows
+};
+
+static const char GPX_MAGIC[4] = { 'G','P','X','1' };
+
+struct PositionSegmentHeader
+{
+  char magic[4];
+  DWORD firstGame; // The first game in a list is the difference to this
+  DWORD lastGame;
+  DWORD blocks;
+  unsigned __int64 keys;
+  unsigned __int64 hits;
+  unsigned __int64 table; // Offset of the block table
+};
+
+static const char GPS_MAGIC[4] = { 'G','P','S','1' };
+
+// An entry in the block table.
+struct PositionBlock
+{
+  HASHKEY key; // First key in the block
+  unsigned __int64 offset;
+};
+
+static void putVarint(std::string& s, unsigned __int64 n)
+{
+  while (n>=0x80)
+  {
+    s+=(char)(n|0x80);
+    n>>=7;
+  }
+  s+=(char)n;
+}
+
+static bool getVarint(const BYTE*& p, const BYTE* end, unsigned __int64& n)
+{
+  int shift=0;
+  n=0;
+  while ((p<end) && (shift<64))
+  {
+    n|=(unsigned __int64)(*p&0x7f)<<shift;
+    if (!(*p++&0x80))
+      return true;
+    shift+=7;
+  }
+  return false;
+}
+
+static bool postingLess(const PositionPosting& p1, const PositionPosting& p2)
+{
+  if (p1.key!=p2.key)
+    return p1.key<p2.key;
+  if (p1.game!=p2.game)
+    return p1.game<p2.game;
+  return p1.ply<p2.ply;
+}
+
+static string segmentName(const string& path, DWORD id)
+{
+  return path+"."+to_string(id)+".gps";
+}
+
+// A segment file opened for reading.
+class PositionSegment
+{
+public:
+  DWORD id;
+  WinFile file;
+  PositionSegmentHeader header;
+  bool open(const std::string& filename);
+  // The data of block n and its first key. The data is in the mapped file
+  // or in the buffer of the file, so it is valid until the next read.
+  const BYTE* block(DWORD n, size_t& length, HASHKEY& first);
+  // Add the hits of the key.
+  bool find(HASHKEY key, std::vector<PositionHit>& hits, size_t max);
+  // Read the hits of a key from p.
+  bool getHits(const BYTE*& p, const BYTE* end, std::vector<PositionHit>& hits, size_t max);
+};
+
+bool PositionSegment::open(const std::string& filename)
+{
+  if (!file.open(filename,GENERIC_READ,false,OPEN_EXISTING,true))
+    return false;
+  if ((file.read(&header,sizeof(header),0)!=sizeof(header)) || memcmp(header.magic,GPS_MAGIC,4)
+    || (header.table+(unsigned __int64)header.blocks*sizeof(PositionBlock)>file.size()))
+  {
+    file.close();
+    return false;
+  }
+  // A lookup reads a few bytes at random, so without a mapped file the
+  // buffer is small.
+  if (!file.useMemoryFile())
+    file.setBufferSize(0x1000);
+  return true;
+}
+
+const BYTE* PositionSegment::block(DWORD n, size_t& length, HASHKEY& first)
+{
+  PositionBlock b[2];
+  const char* p;
+  if (n>=header.blocks)
+    return NULL;
+  // The block ends where the next starts, the last at the table.
+  if (n+1<header.blocks)
+  {
+    if ((p=file.view(header.table+(unsigned __int64)n*sizeof(PositionBlock),2*sizeof(PositionBlock)))==NULL)
+      return NULL;
+    memcpy(b,p,2*sizeof(PositionBlock));
+  }
+  else
+  {
+    if ((p=file.view(header.table+(unsigned __int64)n*sizeof(PositionBlock),sizeof(PositionBlock)))==NULL)
+      return NULL;
+    memcpy(b,p,sizeof(PositionBlock));
+    b[1].offset=header.table;
+  }
+  if (b[1].offset<b[0].offset)
+    return NULL;
+  first=b[0].key;
+  length=(size_t)(b[1].offset-b[0].offset);
+  return (const BYTE*)file.view(b[0].offset,length);
+}
+
+bool PositionSegment::getHits(const BYTE*& p, const BYTE* end, std::vector<PositionHit>& hits, size_t max)
+{
+  PositionHit hit;
+  unsigned __int64 count, length, n;
+  const BYTE* listEnd;
+  if (!getVarint(p,end,count) || !getVarint(p,end,length) || (length>(unsigned __int64)(end-p)))
+    return false;
+  listEnd=p+length;
+  hit.game=header.firstGame;
+  while (count-- && (!max || (hits.size()<max)))
+  {
+    if (!getVarint(p,listEnd,n))
+      return false;
+    hit.game+=(DWORD)n;
+    if (!getVarint(p,listEnd,n))
+      return false;
+    hit.ply=(WORD)n;
+    hits.push_back(hit);
+  }
+  p=listEnd;
+  return true;
+}
+
+bool PositionSegment::find(HASHKEY key, std::vector<PositionHit>& hits, size_t max)
+{
+  PositionBlock b;
+  const BYTE* p;
+  const BYTE* end;
+  const char* sz;
+  size_t length;
+  unsigned __int64 count, delta;
+  HASHKEY k;
+  DWORD lo=0, hi=header.blocks, mid;
+
+  // The last block with a first key not larger than the key.
+  while (lo<hi)
+  {
+    mid=(lo+hi)/2;
+    if ((sz=file.view(header.table+(unsigned __int64)mid*sizeof(PositionBlock),sizeof(PositionBlock)))==NULL)
+      return false;
+    memcpy(&b,sz,sizeof(b));
+    if (b.key<=key)
+      lo=mid+1;
+    else
+      hi=mid;
+  }
+  if (!lo)
+    return true;
+  if ((p=block(lo-1,length,k))==NULL)
+    return false;
+  end=p+length;
+  while (p<end)
+  {
+    if (k==key)
+      return getHits(p,end,hits,max);
+    // Skip the list of the key.
+    if (!getVarint(p,end,count) || !getVarint(p,end,delta) || (delta>(unsigned __int64)(end-p)))
+      return false;
+    p+=delta;
+    if ((p>=end) || !getVarint(p,end,delta))
+      return true;
+    k+=delta;
+    if (k>key)
+      return true;
+  }
+  return true;
+}
+
+// Reads the keys of a segment in order, for merging.
+class SegmentCursor
+{
+  PositionSegment* seg;
+  DWORD next;
+  const BYTE* p;
+  const BYTE* end;
+public:
+  HASHKEY key;
+  std::vector<PositionHit> hits;
+  bool done;
+  bool bad;
+  SegmentCursor(PositionSegment* s) { seg=s; next=0; p=end=NULL; done=bad=false; };
+  bool read();
+};
+
+bool SegmentCursor::read()
+{
+  unsigned __int64 delta;
+  size_t length;
+  hits.clear();
+  if (done)
+    return false;
+  if (p<end)
+  {
+    if (!getVarint(p,end,delta))
+      bad=true;
+    key+=delta;
+  }
+  else if (next<seg->header.blocks)
+  {
+    if ((p=seg->block(next++,length,key))==NULL)
+    {
+      bad=done=true;
+      return false;
+    }
+    end=p+length;
+  }
+  else
+  {
+    done=true;
+    return false;
+  }
+  if (bad || !seg->getHits(p,end,hits,0) || hits.empty())
+  {
+    bad=done=true;
+    return false;
+  }
+  return true;
+}
+
+// Writes a segment file, the keys must be added in order.
+class SegmentWriter
+{
+  WinFile file;
+  PositionSegmentHeader header;
+  std::string data;
+  std::string table;
+  std::string list;
+  unsigned __int64 offset;
+  int blockKeys;
+  HASHKEY lastKey;
+  bool writeData();
+public:
+  bool open(const std::string& filename, DWORD firstGame, DWORD lastGame);
+  bool add(HASHKEY key, const std::vector<PositionHit>& hits);
+  bool close();
+};
+
+bool SegmentWriter::open(const std::string& filename, DWORD firstGame, DWORD lastGame)
+{
+  memset(&header,0,sizeof(header));
+  memcpy(header.magic,GPS_MAGIC,4);
+  header.firstGame=firstGame;
+  header.lastGame=lastGame;
+  data.clear();
+  table.clear();
+  offset=sizeof(header);
+  blockKeys=0;
+  lastKey=0;
+  if (!file.open(filename,GENERIC_WRITE,false,CREATE_ALWAYS,false))
+    return false;
+  return true;
+}
+
+bool SegmentWriter::writeData()
+{
+  if (data.size() && !file.write(data.data(),(DWORD)data.size(),offset))
+    return false;
+  offset+=data.size();
+  data.clear();
+  return true;
+}
+
+bool SegmentWriter::add(HASHKEY key, const std::vector<PositionHit>& hits)
+{
+  PositionBlock b;
+  DWORD game=header.firstGame;
+  size_t i;
+  if (!blockKeys)
+  {
+    b.key=key;
+    b.offset=offset+data.size();
+    table.append((const char*)&b,sizeof(b));
+    ++header.blocks;
+  }
+  else
+  {
+    putVarint(data,key-lastKey);
+  }
+  list.clear();
+  for (i=0;i<hits.size();i++)
+  {
+    putVarint(list,hits[i].game-game);
+    putVarint(list,hits[i].ply);
+    game=hits[i].game;
+  }
+  putVarint(data,hits.size());
+  putVarint(data,list.size());
+  data+=list;
+  lastKey=key;
+  if (++blockKeys==POSITIONINDEX_BLOCKKEYS)
+    blockKeys=0;
+  ++header.keys;
+  header.hits+=hits.size();
+  if (data.size()>=POSITIONINDEX_FLUSHSIZE)
+    return writeData();
+  return true;
+}
+
+bool SegmentWriter::close()
+{
+  bool ok=writeData();
+  header.table=offset;
+  data.swap(table);
+  ok=ok && writeData() && file.write(&header,sizeof(header),0);
+  file.close();
+  return ok;
+}
+
+PositionIndex::PositionIndex()
+{
+  pendingSorted=true;
+  games=0;
+  savedGames=0;
+  nextId=1;
+}
+
+PositionIndex::~PositionIndex()
+{
+  close();
+}
+
+HASHKEY PositionIndex::key(const ChessBoard& cb)
+{
+  ChessBoard b(cb);
+  typeSquare sq;
+  typePiece pawn;
+  if (b.enPassant!=UNDEF)
+  {
+    // The pawns that can take are beside the pawn that moved.
+    sq=(b.toMove==WHITE)?b.enPassant-16:b.enPassant+16;
+    pawn=(b.toMove==WHITE)?whitepawn:blackpawn;
+    if (!(LEGALSQUARE(sq-1) && (b.board[sq-1]==pawn)) && !(LEGALSQUARE(sq+1) && (b.board[sq+1]==pawn)))
+      b.enPassant=UNDEF;
+  }
+  return b.hashkey();
+}
+
+PositionSegment* PositionIndex::openSegment(DWORD id)
+{
+  PositionSegment* seg=new PositionSegment;
+  seg->id=id;
+  if (!seg->open(segmentName(path,id)))
+  {
+    delete seg;
+    return NULL;
+  }
+  return seg;
+}
+
+bool PositionIndex::open(const std::string& path)
+{
+  PositionListHeader h;
+  PositionSegment* seg;
+  WinFile list;
+  vector<DWORD> ids;
+  size_t i;
+
+  close();
+  this->path=path;
+  if (!list.open(path+".gpx",GENERIC_READ,false,OPEN_EXISTING,false))
+    return true; // A new index
+  if ((list.read(&h,sizeof(h),0)==sizeof(h)) && !memcmp(h.magic,GPX_MAGIC,4))
+  {
+    ids.resize(h.segments);
+    if (!h.segments || (list.read(&ids[0],h.segments*sizeof(DWORD))==h.segments*sizeof(DWORD)))
+    {
+      nextId=h.nextId;
+      for (i=0;i<ids.size();i++)
+      {
+        if ((seg=openSegment(ids[i]))==NULL)
+          break;
+        segments.push_back(seg);
+      }
+      if (i==ids.size())
+      {
+        games=savedGames=h.games;
+        return true;
+      }
+    }
+  }
+  list.close();
+  // A broken index is made again from the games.
+  clear();
+  return true;
+}
+
+void PositionIndex::close()
+{
+  size_t i;
+  if (isOpen())
+    flush();
+  for (i=0;i<segments.size();i++)
+    delete segments[i];
+  segments.clear();
+  pending.clear();
+  pendingSorted=true;
+  games=0;
+  savedGames=0;
+  nextId=1;
+  path.clear();
+}
+
+void PositionIndex::clear()
+{
+  size_t i;
+  for (i=0;i<segments.size();i++)
+  {
+    segments[i]->file.deleteFile();
+    delete segments[i];
+  }
+  segments.clear();
+  pending.clear();
+  pendingSorted=true;
+  games=0;
+  savedGames=0;
+  if (isOpen())
+    writeList();
+}
+
+bool PositionIndex::writeList()
+{
+  PositionListHeader h;
+  string s;
+  WinFile list;
+  size_t i;
+  memcpy(h.magic,GPX_MAGIC,4);
+  h.games=savedGames;
+  h.nextId=nextId;
+  h.segments=(DWORD)segments.size();
+  s.append((const char*)&h,sizeof(h));
+  for (i=0;i<segments.size();i++)
+    s.append((const char*)&segments[i]->id,sizeof(DWORD));
+  if (!list.open(path+".gpx",GENERIC_WRITE,false,CREATE_ALWAYS,false) || !list.write(s.data(),(DWORD)s.size(),0))
+  {
+    error="Unable to write: "+path+".gpx";
+    return false;
+  }
+  return true;
+}
+
+bool PositionIndex::flush()
+{
+  if (!isOpen())
+    return false;
+  return writeSegment();
+}
+
+// Write the postings in memory to a new segment.
+bool PositionIndex::writeSegment()
+{
+  SegmentWriter writer;
+  PositionSegment* seg;
+  vector<PositionHit> hits;
+  PositionHit hit;
+  size_t i, j;
+  DWORD id;
+
+  if (savedGames==games)
+    return true;
+  if (pending.empty())
+  {
+    savedGames=games;
+    return writeList();
+  }
+  if (!pendingSorted)
+    sort(pending.begin(),pending.end(),postingLess);
+  pendingSorted=true;
+  id=nextId++;
+  if (!writer.open(segmentName(path,id),savedGames+1,games))
+  {
+    error="Unable to write: "+segmentName(path,id);
+    return false;
+  }
+  for (i=0;i<pending.size();i=j)
+  {
+    hits.clear();
+    for (j=i;(j<pending.size()) && (pending[j].key==pending[i].key);j++)
+    {
+      hit.game=pending[j].game;
+      hit.ply=pending[j].ply;
+      hits.push_back(hit);
+    }
+    if (!writer.add(pending[i].key,hits))
+      break;
+  }
+  if ((i<pending.size()) || !writer.close() || ((seg=openSegment(id))==NULL))
+  {
+    error="Unable to write: "+segmentName(path,id);
+    return false;
+  }
+  segments.push_back(seg);
+  pending.clear();
+  savedGames=games;
+  if (!writeList())
+    return false;
+  while ((segments.size()>1) && (segments.back()->header.hits*2>=segments[segments.size()-2]->header.hits))
+    if (!merge())
+      return false;
+  return true;
+}
+
+// Merge the last two segments. The games of the last are after the games of
+// the other, so the lists of a key are joined.
+bool PositionIndex::merge()
+{
+  SegmentWriter writer;
+  PositionSegment* older=segments[segments.size()-2];
+  PositionSegment* newer=segments.back();
+  PositionSegment* seg;
+  SegmentCursor a(older), b(newer);
+  DWORD id=nextId++;
+  bool ok;
+
+  ok=writer.open(segmentName(path,id),older->header.firstGame,newer->header.lastGame);
+  a.read();
+  b.read();
+  while (ok && (!a.done || !b.done))
+  {
+    if (b.done || (!a.done && (a.key<b.key)))
+    {
+      ok=writer.add(a.key,a.hits);
+      a.read();
+    }
+    else if (a.done || (b.key<a.key))
+    {
+      ok=writer.add(b.key,b.hits);
+      b.read();
+    }
+    else
+    {
+      a.hits.insert(a.hits.end(),b.hits.begin(),b.hits.end());
+      ok=writer.add(a.key,a.hits);
+      a.read();
+      b.read();
+    }
+  }
+  ok=writer.close() && ok && !a.bad && !b.bad;
+  if (!ok || ((seg=openSegment(id))==NULL))
+  {
+    DeleteFileA(segmentName(path,id).c_str());
+    error="Unable to merge: "+segmentName(path,id);
+    return false;
+  }
+  segments.pop_back();
+  segments.back()=seg;
+  if (!writeList())
+    return false;
+  // The old files are removed when the list doesn't have them.
+  older->file.deleteFile();
+  newer->file.deleteFile();
+  delete older;
+  delete newer;
+  return true;
+}
+
+bool PositionIndex::update(GameBase& base)
+{
+  MoveGenerator gen;
+  vector<ChessMove> moves;
+  ChessBoard start, cb;
+  PositionPosting posting;
+  DWORD game;
+  size_t ply;
+
+  if (!isOpen() || !base.isOpen())
+    return false;
+  if (base.size()<games)
+    clear();
+  for (game=games+1;game<=base.size();game++)
+  {
+    games=game;
+    // A game that can't be read is not in the index.
+    if (!base.readMoves(game,start,moves))
+      continue;
+    cb=start;
+    posting.game=game;
+    for (ply=0;;ply++)
+    {
+      posting.key=key(cb);
+      posting.ply=(WORD)ply;
+      pending.push_back(posting);
+      if ((ply>=moves.size()) || (ply>=0xffff))
+        break;
+      if (moves[ply].moveType&NULL_MOVE)
+        gen.doNullMove(cb,moves[ply]);
+      else
+        gen.doMove(cb,moves[ply]);
+    }
+    pendingSorted=false;
+    if ((pending.size()>=POSITIONINDEX_PENDING) && !writeSegment())
+      return false;
+  }
+  return true;
+}
+
+size_t PositionIndex::find(const ChessBoard& cb, std::vector<PositionHit>& hits, size_t max)
+{
+  PositionPosting posting;
+  PositionHit hit;
+  vector<PositionPosting>::iterator it;
+  size_t i;
+
+  hits.clear();
+  posting.key=key(cb);
+  posting.game=0;
+  posting.ply=0;
+  for (i=0;(i<segments.size()) && (!max || (hits.size()<max));i++)
+    segments[i]->find(posting.key,hits,max);
+  // The games not in a segment.
+  if (!pendingSorted)
+    sort(pending.begin(),pending.end(),postingLess);
+  pendingSorted=true;
+  for (it=lower_bound(pending.begin(),pending.end(),posting,postingLess);(it!=pending.end()) && (it->key==posting.key);++it)
+  {
+    if (max && (hits.size()>=max))
+      break;
+    hit.game=it->game;
+    hit.ply=it->ply;
+    hits.push_back(hit);
+  }
+  return hits.size();
+}
+
+static bool moreGames(const PositionMove& m1, const PositionMove& m2)
+{
+  return m1.games>m2.games;
+}
+
+bool PositionIndex::nextMoves(GameBase& base, const ChessBoard& cb, std::vector<PositionMove>& moves, size_t maxGames)
+{
+  MoveGenerator gen;
+  vector<PositionHit> hits;
+  vector<ChessMove> line;
+  PositionMove pm;
+  GameBaseEntry e;
+  ChessBoard start, b;
+  HASHKEY k=key(cb);
+  DWORD lastGame=0;
+  size_t i, j, games=0;
+
+  moves.clear();
+  if (!isOpen() || !base.isOpen())
+    return false;
+  find(cb,hits);
+  for (i=0;(i<hits.size()) && (!maxGames || (games<maxGames));i++)
+  {
+    // A game is only counted the first time it is in the position.
+    if ((hits[i].game==lastGame) || !base.readMoves(hits[i].game,start,line) || (hits[i].ply>=line.size()))
+      continue;
+    b=start;
+    for (j=0;j<hits[i].ply;j++)
+    {
+      if (line[j].moveType&NULL_MOVE)
+        gen.doNullMove(b,line[j]);
+      else
+        gen.doMove(b,line[j]);
+    }
+    if ((key(b)!=k) || !base.readEntry(hits[i].game,e))
+      continue;
+    lastGame=hits[i].game;
+    ++games;
+    for (j=0;(j<moves.size()) && !(moves[j].move==line[hits[i].ply]);j++);
+    if (j==moves.size())
+    {
+      pm.move=line[hits[i].ply];
+      pm.games=pm.whiteWins=pm.draws=pm.blackWins=0;
+      moves.push_back(pm);
+    }
+    ++moves[j].games;
+    if (e.result==1)
+      ++moves[j].whiteWins;
+    else if (e.result==2)
+      ++moves[j].blackWins;
+    else if (e.result==3)
+      ++moves[j].draws;
+  }
+  stable_sort(moves.begin(),moves.end(),moreGames);
+  return true;
+}
+
+unsigned __int64 PositionIndex::fileSize()
+{
+  unsigned __int64 size=0;
+  size_t i;
+  for (i=0;i<segments.size();i++)
+    size+=segments[i]->file.size();
+  return size;
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <windows.h>
+#include <string>
+#include <vector>
+#include "../Common/defs.h"
+#include "../Common/ChessBoard.h"
+#include "../Common/WinFile.h"
+#include "../Common/GameBase.h"
+
+// A game that reached a position, the position is before move ply (0 is
+// the start position of the game).
+struct PositionHit
+{
+  DWORD game;
+  WORD ply;
+};
+
+// A move played in a position and how the games went on.
+struct PositionMove
+{
+  ChessMove move;
+  DWORD games;
+  DWORD whiteWins;
+  DWORD draws;
+  DWORD blackWins;
+};
+
+// A position in a game, before it is written to a segment.
+struct PositionPosting
+{
+  HASHKEY key;
+  DWORD game;
+  WORD ply;
+};
+
+class PositionSegment;
+
+// Index from position to the games of a GameBase that reached it. The key
+// is the Zobrist key of the board, so a position reached by different move
+// orders is found in all the games.
+// The index is in segment files (path.n.gps) with the postings sorted on
+// key. A key has a list of (game, ply) where the game is written as the
+// difference to the game before, all numbers as varints. The keys are in
+// blocks of POSITIONINDEX_BLOCKKEYS with a table of the first key of each
+// block at the end of the file, so a lookup is a binary search in the
+// table and a scan of one block. The segments are memory mapped.
+// New games are kept in memory and written as a new segment when there are
+// enough of them, or at flush(). Two segments are merged when the newer is
+// as large as half of the older, so there are few segments. The list of
+// segments and the number of games indexed is in path.gpx, it is written
+// after the segments so a crash only loses the last games, they are
+// indexed again at the next update().
+class PositionIndex
+{
+  std::string path;
+  std::string error;
+  std::vector<PositionSegment*> segments;
+  std::vector<PositionPosting> pending;
+  bool pendingSorted;
+  DWORD games;      // Games indexed, in the segments and pending
+  DWORD savedGames; // Games in the segments
+  DWORD nextId;     // Number of the next segment file
+  bool writeList();
+  bool writeSegment();
+  bool merge();
+  PositionSegment* openSegment(DWORD id);
+public:
+  PositionIndex();
+  virtual ~PositionIndex();
+  // path is the name of the files without the extension, the same as for
+  // the GameBase.
+  bool open(const std::string& path);
+  void close();
+  bool isOpen() { return !path.empty(); };
+  // Remove all games from the index.
+  void clear();
+  // Write the games in memory to a segment.
+  bool flush();
+  // Index the games of the base that are not indexed. If the base has fewer
+  // games than the index it is a new base and the index is made again.
+  bool update(GameBase& base);
+  inline DWORD size() { return games; };
+  // The games that reached the position, sorted on game and ply. A game
+  // can be more than once if the position is repeated. If max>0 it stops
+  // after max hits. Returns the number of hits.
+  size_t find(const ChessBoard& cb, std::vector<PositionHit>& hits, size_t max=0);
+  // The moves played from the position with the results of the games,
+  // sorted on the number of games. The games are replayed to the position,
+  // so hits from another position with the same key are not counted.
+  bool nextMoves(GameBase& base, const ChessBoard& cb, std::vector<PositionMove>& moves, size_t maxGames=0);
+  // Bytes in the segment files.
+  unsigned __int64 fileSize();
+  // The key of a board. The en passant square is only used if a pawn can
+  // take on it, else the position after a double pawn move would not be
+  // the same as the position reached by another move order.
+  static HASHKEY key(const ChessBoard& cb);
+  inline const std::string& lastError() { return error; };
+};
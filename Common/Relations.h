@@ -1,9 +1,9 @@
 #pragma once
 
-const int knightPath[8] = { 14, 31, 33, 18,-14,-31,-33,-18 };
-const int kingPath[8]   = { -1, 15, 16, 17,  1,-15,-16,-17 };
-const int bishopPath[4] = { 15, 17,-15,-17 };
-const int rookPath[4]   = { -1, 16, 1, -16 };
+constexpr int knightPath[8] = { 14, 31, 33, 18,-14,-31,-33,-18 };
+constexpr int kingPath[8]   = { -1, 15, 16, 17,  1,-15,-16,-17 };
+constexpr int bishopPath[4] = { 15, 17,-15,-17 };
+constexpr int rookPath[4]   = { -1, 16, 1, -16 };
 
 
 // Distance to edge
@@ -52,6 +52,7 @@ void UciEngine::fromEngine(std::string& input)
 	}
 	else if (cmd == "bestmove")
 	{
+		searchtype = NO_SEARCH;
 		emit engineMove(QString(getWord(input, 2).c_str()), QString(getWord(input, 4).c_str()));
 	}
 	else if (cmd == "option")
@@ -297,6 +298,68 @@ void UciEngine::analyze(ChessBoard& board)
 	searchtype = INFINITE_SEARCH;
 }
 
+void UciEngine::search(ChessBoard& board, MoveList& moves, SEARCHTYPE st, int wtime, int winc, int btime, int binc, int movestogo)
+{
+	int i;
+	QString qs;
+
+	stop();
+
+	currentBoard = board;
+
+	qs = "position ";
+	if (currentBoard.isStartposition())
+		qs += "startpos";
+	else
+		qs += QString("fen ") + currentBoard.getFen(true).c_str();
+	if (moves.size())
+	{
+		qs += " moves";
+		for (i = 0; i < moves.size(); i++)
+		{
+			qs += " ";
+			qs += currentBoard.makeMoveText(moves[i], UCI).c_str();
+			currentBoard.doMove(moves[i], false);
+		}
+	}
+	write(qs);
+
+	qs = "go";
+	if (st == INFINITE_SEARCH)
+	{
+		qs += " infinite";
+	}
+	else if (st == TIME_SEARCH)
+	{
+		qs += " movetime " + QString().setNum(wtime);
+	}
+	else if (st == NODES_SEARCH)
+	{
+		qs += " nodes " + QString().setNum(wtime);
+	}
+	else if (st == DEPTH_SEARCH)
+	{
+		qs += " depth " + QString().setNum(wtime);
+	}
+	else if (st == MATE_SEARCH)
+	{
+		qs += " mate " + QString().setNum(wtime);
+	}
+	else
+	{
+		if (st == PONDER_SEARCH)
+			qs += " ponder";
+		qs += " wtime " + QString().setNum(wtime);
+		qs += " btime " + QString().setNum(btime);
+		qs += " winc " + QString().setNum(winc);
+		qs += " binc " + QString().setNum(binc);
+		if (movestogo)
+			qs += " movestogo " + QString().setNum(movestogo);
+	}
+	write(qs);
+	searchtype = st;
+}
+
 void UciEngine::stop()
 {
 	// Stop current search
@@ -313,6 +376,9 @@ void UciEngine::slotFinishInit()
 void UciEngine::newGame()
 {
 	stop();
+	write("ucinewgame");
+	// readyok is sent as engineStarted.
+	write("isready");
 }
 
 void UciEngine::setMultiPV(int n)
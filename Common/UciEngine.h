@@ -17,6 +17,7 @@ public:
 	UciEngine();
 	virtual ~UciEngine();
 	void analyze(ChessBoard& board);
+	void search(ChessBoard& board, MoveList& moves, SEARCHTYPE searchtype, int wtime, int winc, int btime, int binc, int movestogo);
 	void stop();
 	void newGame();
 	void setMultiPV(int n);
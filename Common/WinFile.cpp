@@ -1,20 +1,31 @@
 #include "../Common/WinFile.h"
+#include <string.h>
 #include "../Common/Utility.h"
 
 using namespace std;
 
+#define WINFILE_BUFFERSIZE 0x100000
+
 WinFile::WinFile()
 {
   hFile=NULL;
   dwAccess=0;
-  dwFilepointer=0;
+  filepointer=0;
   flags=FILE_ATTRIBUTE_NORMAL;
   MemoryFile=NULL;
+  hMapping=NULL;
+  buffer=NULL;
+  bufferSize=WINFILE_BUFFERSIZE;
+  bufferLength=0;
+  bufferStart=0;
+  lastLine=0;
 }
 
 WinFile::~WinFile()
 {
   close();
+  if (buffer)
+    delete[] buffer;
 }
 
 void WinFile::flush()
@@ -45,9 +56,9 @@ bool WinFile::open(const std::string& filename, DWORD access, bool append, DWORD
     return false;
   }
   if (append)
-    dwFilepointer=SetFilePointer(hFile,0,NULL,FILE_END);
+    filepointer=size();
   else
-    dwFilepointer=0;
+    filepointer=0;
   return true;
 }
 
@@ -63,17 +74,26 @@ bool WinFile::reopen()
     hFile=NULL;
     return false;
   }
-  dwFilepointer=0;
+  filepointer=0;
   return true;
 }
 
 void WinFile::close()
 {
-  lineBuffer="";
+  if (MemoryFile)
+  {
+    UnmapViewOfFile(MemoryFile);
+    CloseHandle(hMapping);
+    MemoryFile=NULL;
+    hMapping=NULL;
+  }
   if (hFile)
     CloseHandle(hFile);
   hFile=NULL;
-  dwFilepointer=0;
+  filepointer=0;
+  bufferLength=0;
+  bufferStart=0;
+  lastLine=0;
 }
 
 void WinFile::deleteFile()
@@ -84,106 +104,270 @@ void WinFile::deleteFile()
     DeleteFileA(sFilename.c_str());
 }
 
-DWORD WinFile::size()
+bool WinFile::useMemoryFile()
+{
+  unsigned __int64 fs;
+  if (!hFile || (dwAccess&GENERIC_WRITE))
+    return false;
+  if (MemoryFile)
+    return true;
+  fs=size();
+  // An empty file can't be mapped.
+  if (!fs)
+    return false;
+  hMapping=CreateFileMappingA(hFile,NULL,PAGE_READONLY,0,0,NULL);
+  if (!hMapping)
+    return false;
+  MemoryFile=(BYTE*)MapViewOfFile(hMapping,FILE_MAP_READ,0,0,0);
+  if (!MemoryFile)
+  {
+    CloseHandle(hMapping);
+    hMapping=NULL;
+    return false;
+  }
+  bufferStart=0;
+  bufferLength=(size_t)fs;
+  return true;
+}
+
+void WinFile::setBufferSize(size_t size)
+{
+  if (buffer)
+  {
+    delete[] buffer;
+    buffer=NULL;
+  }
+  bufferSize=__max(size,(size_t)0x1000);
+  if (!MemoryFile)
+    bufferLength=0;
+}
+
+unsigned __int64 WinFile::size()
 {
-  DWORD dwSize=0;
+  LARGE_INTEGER li;
+  li.QuadPart=0;
   if (hFile)
   {
-    dwSize=GetFileSize(hFile,NULL);
+    if (!GetFileSizeEx(hFile,&li))
+      li.QuadPart=0;
   }else
   {
     if (reopen())
     {
-      dwSize=GetFileSize(hFile,NULL);
+      if (!GetFileSizeEx(hFile,&li))
+        li.QuadPart=0;
       close();
     }
   }
-  if (dwSize==0xFFFFFFFF)
-    dwSize=0;
-  return dwSize;
+  return (unsigned __int64)li.QuadPart;
 }
 
-DWORD WinFile::read(void* buffer, DWORD length, DWORD filepointer)
+bool WinFile::seek(unsigned __int64 fp)
+{
+  LARGE_INTEGER li;
+  li.QuadPart=(LONGLONG)fp;
+  return SetFilePointerEx(hFile,li,NULL,FILE_BEGIN)?true:false;
+}
+
+// Make the buffer hold the byte at filepointer. Returns false at the end of the file.
+bool WinFile::fill()
 {
   DWORD dwRead;
-  if (!hFile)
+  if ((filepointer>=bufferStart) && (filepointer<bufferStart+bufferLength))
+    return true;
+  if (MemoryFile)
     return false;
-  if (!setFilepointer(filepointer))
-    return 0;
-  if (!ReadFile(hFile,buffer,length,&dwRead,NULL))
+  if (!buffer)
+    buffer=new BYTE[bufferSize];
+  bufferStart=filepointer;
+  bufferLength=0;
+  if (!seek(filepointer))
+    return false;
+  if (!ReadFile(hFile,buffer,(DWORD)bufferSize,&dwRead,NULL))
+    return false;
+  bufferLength=dwRead;
+  return (dwRead>0);
+}
+
+DWORD WinFile::read(void* dest, DWORD length, unsigned __int64 fp)
+{
+  DWORD done=0;
+  size_t n;
+  if (!hFile)
     return 0;
-  if (!dwRead)
+  if (!setFilepointer(fp))
     return 0;
-  dwFilepointer+=dwRead;
-  return dwRead;
+  // Large reads go directly to the destination.
+  if (!MemoryFile && (length>=bufferSize))
+  {
+    if (!seek(filepointer))
+      return 0;
+    if (!ReadFile(hFile,dest,length,&done,NULL))
+      return 0;
+    filepointer+=done;
+    return done;
+  }
+  while (done<length)
+  {
+    if (!fill())
+      break;
+    n=__min((size_t)(length-done),(size_t)(bufferStart+bufferLength-filepointer));
+    memcpy((BYTE*)dest+done,(MemoryFile?MemoryFile:buffer)+(filepointer-bufferStart),n);
+    done+=(DWORD)n;
+    filepointer+=n;
+  }
+  return done;
 }
 
-bool WinFile::readLine(std::string& line)
+const char* WinFile::view(unsigned __int64 fp, size_t length)
 {
+  BYTE* data;
+  size_t keep;
   DWORD dwRead;
-  char c;
-  if (lineBuffer.length())
+
+  if (!hFile)
+    return NULL;
+  if ((fp<bufferStart) || (fp+length>bufferStart+bufferLength))
   {
-    line=lineBuffer;
-    lineBuffer="";
-    return true;
+    if (MemoryFile)
+      return NULL;
+    // Keep the part that is in the buffer and read the rest after it.
+    keep=0;
+    if (buffer && (fp>=bufferStart) && (fp<bufferStart+bufferLength))
+      keep=(size_t)(bufferStart+bufferLength-fp);
+    if (length>bufferSize)
+    {
+      bufferSize=length;
+      data=new BYTE[bufferSize];
+      if (keep)
+        memcpy(data,buffer+(fp-bufferStart),keep);
+      if (buffer)
+        delete[] buffer;
+      buffer=data;
+    }else if (!buffer)
+    {
+      buffer=new BYTE[bufferSize];
+    }else if (keep)
+    {
+      memmove(buffer,buffer+(fp-bufferStart),keep);
+    }
+    bufferStart=fp;
+    bufferLength=keep;
+    if (!seek(fp+keep) || !ReadFile(hFile,buffer+keep,(DWORD)(bufferSize-keep),&dwRead,NULL))
+      return NULL;
+    bufferLength+=dwRead;
+    if (length>bufferLength)
+      return NULL;
   }
-  line="";
+  filepointer=fp+length;
+  lastLine=fp;
+  return (const char*)(MemoryFile?MemoryFile:buffer)+(fp-bufferStart);
+}
+
+bool WinFile::readLine(const char*& line, size_t& length)
+{
+  BYTE* data;
+  const char* start;
+  const char* nl;
+  size_t keep;
+  DWORD dwRead;
+
+  if (!hFile)
+    return false;
+  lastLine=filepointer;
+  if (!fill())
+    return false;
   while (1)
   {
-    if (!ReadFile(hFile,&c,1,&dwRead,NULL))
+    data=MemoryFile?MemoryFile:buffer;
+    start=(const char*)data+(filepointer-bufferStart);
+    keep=(size_t)(bufferStart+bufferLength-filepointer);
+    nl=(const char*)memchr(start,'\n',keep);
+    if (nl)
     {
-      if (line.length())
-        return true;
-      return false;
+      line=start;
+      length=nl-start;
+      filepointer+=length+1;
+      break;
     }
-    if (dwRead==0)
+    // The line continues after the buffer, move it to the start of the
+    // buffer and read more. The buffer grows if the line fills it.
+    if (!MemoryFile)
     {
-      if (line.length())
-        return true;
-      return false;
-    }
-    dwFilepointer++;
-    if (c!='\r')
-    {
-      if (c=='\n')
-        return true;
-      line+=c;
+      if (keep==bufferSize)
+      {
+        bufferSize*=2;
+        data=new BYTE[bufferSize];
+        memcpy(data,start,keep);
+        delete[] buffer;
+        buffer=data;
+      }else
+      {
+        memmove(buffer,start,keep);
+      }
+      bufferStart=filepointer;
+      bufferLength=keep;
+      if (seek(bufferStart+keep) && ReadFile(hFile,buffer+keep,(DWORD)(bufferSize-keep),&dwRead,NULL) && dwRead)
+      {
+        bufferLength+=dwRead;
+        continue;
+      }
+      start=(const char*)buffer;
     }
+    // Last line without a line end.
+    line=start;
+    length=keep;
+    filepointer+=keep;
+    break;
   }
+  if (length && (line[length-1]=='\r'))
+    --length;
+  return true;
+}
+
+bool WinFile::readLine(std::string& line)
+{
+  const char* p;
+  size_t len;
+  if (!readLine(p,len))
+  {
+    line="";
+    return false;
+  }
+  line.assign(p,len);
+  return true;
 }
 
 void WinFile::putBack(std::string& line)
 {
-  lineBuffer=line;
+  filepointer=lastLine;
 }
 
-bool WinFile::write(const void* buffer, DWORD length, DWORD filepointer)
+bool WinFile::write(const void* buffer, DWORD length, unsigned __int64 fp)
 {
   DWORD dwWrite;
   if (!hFile)
     return false;
-  if (!setFilepointer(filepointer))
+  if (!setFilepointer(fp))
+    return false;
+  // The read buffer is not valid any more.
+  if (!MemoryFile)
+    bufferLength=0;
+  if (!seek(filepointer))
     return false;
   if (!WriteFile(hFile,buffer,length,&dwWrite,NULL))
     return false;
-  dwFilepointer+=dwWrite;
+  filepointer+=dwWrite;
   return true;
 }
 
-bool WinFile::setFilepointer(DWORD filepointer)
+bool WinFile::setFilepointer(unsigned __int64 fp)
 {
   if (!hFile)
     return false;
-  lineBuffer="";
-  if (dwFilepointer==filepointer)
-    return true;
-  dwFilepointer=SetFilePointer(hFile,filepointer,NULL,FILE_BEGIN);
-  if (dwFilepointer==0xFFFFFFFF)
-  {
-    dwFilepointer=0;
-    return false;
-  }
+  // The system file pointer is set on the next read or write.
+  filepointer=fp;
+  lastLine=fp;
   return true;
 }
 
@@ -210,7 +394,7 @@ bool WinFile::writeLine(const std::string& line)
   // Add a newline at the end if it not exist.
   if (s.at(s.length()-1)!='\n')
     s+="\r\n";
-  return write(s.c_str(),s.length(),dwFilepointer);
+  return write(s.c_str(),s.length(),filepointer);
 }
 
 const bool WinFile::exist(const std::string& filename)
@@ -238,4 +422,4 @@ const std::string WinFile::toString()
     s+=sz;
   }
   return s;
-}
\ No newline at end of file
+}
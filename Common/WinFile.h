@@ -3,15 +3,30 @@
 #include <windows.h>
 #include <string>
 
+// File with 64 bit offsets and a read-ahead buffer. Reads and lines are
+// taken from the buffer, so there is only a system call for each
+// bufferSize bytes. Writes go directly to the file. A file opened for
+// reading can be memory mapped with useMemoryFile, the buffer is then the
+// whole file.
 class WinFile
 {
+  BYTE* buffer;
+  size_t bufferSize;
+  // The buffer holds bufferLength bytes from bufferStart in the file.
+  size_t bufferLength;
+  unsigned __int64 bufferStart;
+  // Start of the last line read, for putBack.
+  unsigned __int64 lastLine;
+  HANDLE hMapping;
+  bool fill();
+  bool seek(unsigned __int64 fp);
 public:
   HANDLE hFile;
   DWORD dwAccess;
-  DWORD dwFilepointer;
+  // Position of the next read or write.
+  unsigned __int64 filepointer;
   DWORD flags;
   std::string sFilename;
-  std::string lineBuffer;
   BYTE* MemoryFile;
   WinFile();
   ~WinFile();
@@ -25,20 +40,30 @@ public:
   void close();
   void flush();
   void deleteFile();
-//  void useMemoryFile();
-  DWORD size();
-  DWORD read(void* buffer, DWORD length, DWORD filepointer);
-  DWORD read(void* buffer, DWORD length){return read(buffer,length,dwFilepointer);};
-  bool write(const void* buffer, DWORD length, DWORD filepointer);
-  bool write(const void* buffer, DWORD length){return write(buffer,length,dwFilepointer);};
-  bool setFilepointer(DWORD filepointer);
+  // Map a file opened with GENERIC_READ into memory.
+  bool useMemoryFile();
+  // Size of the read-ahead buffer, default 1 MB. Lines longer than the
+  // buffer make it grow.
+  void setBufferSize(size_t size);
+  unsigned __int64 size();
+  DWORD read(void* buffer, DWORD length, unsigned __int64 filepointer);
+  DWORD read(void* buffer, DWORD length){return read(buffer,length,filepointer);};
+  bool write(const void* buffer, DWORD length, unsigned __int64 filepointer);
+  bool write(const void* buffer, DWORD length){return write(buffer,length,filepointer);};
+  bool setFilepointer(unsigned __int64 filepointer);
   // For textreading
   bool readLine(std::string& line);
+  // The line is not copied, it points into the buffer and is valid until
+  // the next read. The line end (\n or \r\n) is not included.
+  bool readLine(const char*& line, size_t& length);
+  // Point to length bytes from fp in the buffer or the mapped file, NULL if
+  // they can't be read. As for readLine it is valid until the next read.
+  const char* view(unsigned __int64 fp, size_t length);
   bool writeLine(const char* str){return writeLine(std::string(str));};
   bool writeLine(const std::string& line);
+  // Go back to the start of the last line read.
   void putBack(std::string& line);
   bool isMemoryFile(){return (MemoryFile?true:false);};
   static const bool exist(const std::string& filename);
   const std::string toString();
 };
-
@@ -28,6 +28,8 @@ XBoardEngine::XBoardEngine()
 	feature.colors = true;
 	feature.time = true;
 	feature.san = false;
+	gameBoard.setStartposition();
+	pingNumber = 0;
 	timer = new QTimer(this);
 	connect(timer, SIGNAL(timeout()), SLOT(slotFinishInit()));
 }
@@ -80,6 +82,24 @@ void XBoardEngine::fromEngine(std::string& input)
 		line = trim(line.substr(i+1));
 		readFeature(line);
 	}
+	else if (cmd == "move")
+	{
+		searchtype = NO_SEARCH;
+		// The engine has played the move on its board.
+		ChessMove m = currentBoard.getMoveFromText(getWord(line, 2));
+		if (!m.empty())
+		{
+			gameMoves.push_back(m);
+			currentBoard.doMove(m, false);
+		}
+		emit engineMove(QString(getWord(line, 2).c_str()), QString());
+	}
+	else if (cmd == "pong")
+	{
+		// Answer to the ping from newGame.
+		if (atoi(getWord(line, 2).c_str()) == pingNumber)
+			emit engineStarted();
+	}
 	else if (cmd.at(0) == '#') // Comment
 	{
 		return;
@@ -93,6 +113,9 @@ void XBoardEngine::fromEngine(std::string& input)
 		if (isNumber(cmd))
 		{
 			ei->cp = atoi(cmd.c_str());
+			// From white as for uci engines.
+			if (currentBoard.toMove == BLACK)
+				ei->cp *= -1;
 			cmd = getWord(input, ++i);
 			if (isNumber(cmd))
 			{
@@ -329,31 +352,14 @@ void XBoardEngine::slotFinishInit()
 	emit engineStarted();
 }
 
-void XBoardEngine::analyze(ChessBoard& board)
+void XBoardEngine::setBoard(ChessBoard& board)
 {
-	currentBoard = board;
-
 	QString qs;
 
-	if (!feature.analyze)
-		return;
-
-	if (!feature.reuse)
-		restartNeeded = true;
-	// Stop current search
-	if (searchtype != NO_SEARCH)
-	{
-		if (searchtype == INFINITE_SEARCH)
-			write("exit");
-		else
-			write("?");
-	}
-
-	write("force");
 	if (feature.setboard)
 	{
 		qs = "setboard ";
-		qs += currentBoard.getFen().c_str();
+		qs += board.getFen().c_str();
 		write(qs);
 	}else
 	{
@@ -363,25 +369,25 @@ void XBoardEngine::analyze(ChessBoard& board)
 		char piecechar[] = "PNBRQK";
 		int color;
 		// XBoard edit command
-		if (currentBoard.toMove == BLACK)
+		if (board.toMove == BLACK)
 			write("a2a3");
 		write("edit");
 		write("#");
-		color = currentBoard.toMove;
+		color = board.toMove;
 		for (file = 0; file < 8; file++)
 		{
 			for (row = 0; row < 8; row++)
 			{
-				piece = PIECE(currentBoard.pieceAt(file, row));
+				piece = PIECE(board.pieceAt(file, row));
 				if (piece != EMPTY)
 				{
 					qs = piecechar[piece - 1];
 					qs += filechar[file];
 					qs += rowchar[row];
-					if (PIECECOLOR(currentBoard.pieceAt(file, row)) != color)
+					if (PIECECOLOR(board.pieceAt(file, row)) != color)
 					{
 						write("c");
-						color = PIECECOLOR(currentBoard.pieceAt(file, row));
+						color = PIECECOLOR(board.pieceAt(file, row));
 					}
 					write(qs);
 				}
@@ -389,11 +395,112 @@ void XBoardEngine::analyze(ChessBoard& board)
 		}
 		write(".");
 	}
+}
+
+void XBoardEngine::analyze(ChessBoard& board)
+{
+	currentBoard = board;
+
+	if (!feature.analyze)
+		return;
+
+	if (!feature.reuse)
+		restartNeeded = true;
+	// Stop current search
+	if (searchtype != NO_SEARCH)
+	{
+		if (searchtype == INFINITE_SEARCH)
+			write("exit");
+		else
+			write("?");
+	}
+
+	write("force");
+	setBoard(currentBoard);
+	gameBoard = currentBoard;
+	gameMoves.clear();
 	write("post");
 	write("analyze");
 	searchtype = INFINITE_SEARCH;
 }
 
+void XBoardEngine::search(ChessBoard& board, MoveList& moves, SEARCHTYPE st, int wtime, int winc, int btime, int binc, int movestogo)
+{
+	int i, own, other, inc;
+	char sz[32];
+	QString qs;
+
+	stop();
+
+	if (!feature.reuse)
+		restartNeeded = true;
+	write("force");
+	// Only the moves played since the last search are sent. The board is
+	// sent again if the game is not the one the engine has.
+	if (!inGame(board, moves))
+	{
+		setBoard(board);
+		gameBoard = board;
+		gameMoves.clear();
+	}
+	currentBoard = board;
+	for (i = 0; i < moves.size(); i++)
+	{
+		if (i >= gameMoves.size())
+		{
+			qs = feature.usermove ? "usermove " : "";
+			qs += currentBoard.makeMoveText(moves[i], feature.san ? SAN : UCI).c_str();
+			write(qs);
+			gameMoves.push_back(moves[i]);
+		}
+		currentBoard.doMove(moves[i], false);
+	}
+
+	if (st == TIME_SEARCH)
+	{
+		if (wtime && !(wtime % 1000))
+		{
+			// st is in whole seconds.
+			qs = "st " + QString().setNum(wtime / 1000);
+			write(qs);
+		}
+		else
+		{
+			// Parts of a second is given as the increment of a game with no
+			// base time, and the same time left on both clocks.
+			qs = "level 0 0 " + QString().setNum(wtime / 1000.0);
+			write(qs);
+			qs = "time " + QString().setNum(wtime / 10);
+			write(qs);
+			qs = "otim " + QString().setNum(wtime / 10);
+			write(qs);
+		}
+	}
+	else if (st == DEPTH_SEARCH)
+	{
+		qs = "sd " + QString().setNum(wtime);
+		write(qs);
+	}
+	else
+	{
+		own = (currentBoard.toMove == WHITE) ? wtime : btime;
+		other = (currentBoard.toMove == WHITE) ? btime : wtime;
+		inc = (currentBoard.toMove == WHITE) ? winc : binc;
+		// The level is given with the time left as base for each search.
+		sprintf_s(sz, 32, "level %d %d:%02d ", movestogo, own / 60000, (own / 1000) % 60);
+		qs = sz;
+		qs += QString().setNum(inc / 1000.0);
+		write(qs);
+		qs = "time " + QString().setNum(own / 10);
+		write(qs);
+		qs = "otim " + QString().setNum(other / 10);
+		write(qs);
+	}
+	write("post");
+	write("go");
+	searchtype = st;
+}
+
 void XBoardEngine::stop()
 {
 	// Stop current search
@@ -449,7 +556,35 @@ bool XBoardEngine::needRestart()
 	return restartNeeded;
 }
 
+bool XBoardEngine::inGame(ChessBoard& board, MoveList& moves)
+{
+	int i;
+	if ((board != gameBoard) || (gameMoves.size() > moves.size()))
+		return false;
+	for (i = 0; i < gameMoves.size(); i++)
+		if (gameMoves[i] != moves[i])
+			return false;
+	return true;
+}
+
 void XBoardEngine::newGame()
 {
+	QString qs;
 	stop();
+	write("new");
+	gameBoard.setStartposition();
+	gameMoves.clear();
+	// The engine is ready when it answer the ping. Without ping it is taken
+	// as ready when the event loop runs again.
+	if (feature.ping)
+	{
+		qs = "ping " + QString().setNum(++pingNumber);
+		write(qs);
+	}
+	else
+	{
+		timer->setInterval(0);
+		timer->setSingleShot(true);
+		timer->start();
+	}
 }
\ No newline at end of file
@@ -41,9 +41,18 @@ private:
 	ChessBoard currentBoard;
 	QTimer* timer;
 	bool restartNeeded;
+	// The game as the engine has it, the start position and the moves
+	// played after it by both sides.
+	ChessBoard gameBoard;
+	MoveList gameMoves;
+	int pingNumber;
+	// True if board and moves continue the game the engine has.
+	bool inGame(ChessBoard& board, MoveList& moves);
 protected:
 	virtual void fromEngine(std::string& input);
 	void readFeature(std::string& line);
+	// Send the board with setboard or edit.
+	void setBoard(ChessBoard& board);
 public slots:
 	virtual void slotFinishInit();
 	virtual void slotStarted();
@@ -55,6 +64,7 @@ public:
 	virtual bool load(QString& path);
 	virtual void unload();
 	void analyze(ChessBoard& board);
+	void search(ChessBoard& board, MoveList& moves, SEARCHTYPE searchtype, int wtime, int winc, int btime, int binc, int movestogo);
 	void stop();
 	void newGame();
 	bool needRestart();
@@ -12,6 +12,7 @@ class DrawTable
 public:
 	DrawTable() { clear(); };
 	void clear() { size = 0; };
+	inline bool empty() { return size == 0; };
 	void add(ChessBoard& cb)
 	{
 		if (size >= MAX_DRAWTABLE)
@@ -2,6 +2,9 @@
 
 #include <process.h>
 #include <string>
+#include <fstream>
+#include <stdlib.h>
+#include <time.h>
 #include "Engine.h"
 #include "EngineInterface.h"
 #include "../Common/utility.h"
@@ -18,8 +21,6 @@ using namespace std;
 const int BREAKING = MATE + 400;
 const int MAX_DEPTH = 100;
 
-Engine eng;
-char sz[256];
 ChessMove emptyMove;
 
 // White/black materiale are only used to deside if nullmove should be used.
@@ -35,142 +36,221 @@ ChessMove emptyMove;
 void EngineSearchThreadLoop(void* lpv)
 {
 	ENGINECOMMAND cmd=ENG_none;
-	eng.ei = (EngineInterface*)lpv;
+	// Each interface has its own engine.
+	SearchEngine* eng = new SearchEngine;
+	eng->ei = (EngineInterface*)lpv;
 	ChessBoard cb;
 	EngineGo eg;
 	EngineEval ev;
+	string s;
 	while (1)
 	{
-		WaitForSingleObject(eng.ei->hEngine, INFINITE);
-		while ((cmd=eng.ei->peekOutQue())!=ENG_none)
+		WaitForSingleObject(eng->ei->hEngine, INFINITE);
+		while ((cmd=eng->ei->peekOutQue())!=ENG_none)
 		{
 			if (cmd == ENG_quit)
 				break;
 			switch (cmd)
 			{
 			case ENG_debug:
-				eng.debug = true;
-				eng.ei->getOutQue();
+				eng->debug = true;
+				eng->ei->getOutQue();
 				break;
 			case ENG_nodebug:
-				eng.debug = false;
-				eng.ei->getOutQue();
+				eng->debug = false;
+				eng->ei->getOutQue();
 				break;
 			case ENG_stop: // No need to do anything here because the engine is in waiting state (or should it sent bestmove 0000 ?).
-				eng.ei->getOutQue();
+				eng->ei->getOutQue();
 				break;
 			case ENG_clearhistory:
-				eng.ei->getOutQue();
-				eng.drawTable.clear();
+				eng->ei->getOutQue();
+				eng->drawTable.clear();
 				break;
 			case ENG_history:
-				eng.ei->getOutQue(cb);
-				eng.drawTable.add(cb);
+				eng->ei->getOutQue(cb);
+				eng->drawTable.add(cb);
 				break;
 			case ENG_ponderhit: // Shouldnt happend here.
-				eng.ei->getOutQue();
+				eng->ei->getOutQue();
 				break;
 			case ENG_clearhash:
-				eng.ei->getOutQue();
+				eng->ei->getOutQue();
 				break;
 			case ENG_go:
-				eng.watch.start();
-				eng.ei->getOutQue(eg);
-				eng.fixedMate = eg.mate;
-				eng.fixedNodes = eg.nodes;
-				eng.fixedTime = eg.fixedTime*1000;
-				eng.maxTime = eg.maxTime*1000;
-				eng.fixedDepth = eg.depth;
-				eng.searchmoves = eg.searchmoves;
-				if (eng.fixedMate)
-					eng.searchtype = MATE_SEARCH;
-				else if (eng.fixedNodes)
-					eng.searchtype = NODES_SEARCH;
-				else if (eng.fixedTime)
-					eng.searchtype = TIME_SEARCH;
-				else if (eng.fixedDepth)
-					eng.searchtype = DEPTH_SEARCH;
-				else
-					eng.searchtype = NORMAL_SEARCH;
-				eng.startSearch();
+				eng->watch.start();
+				eng->ei->getOutQue(eg);
+				eng->go(eg, false);
 				break;
 			case ENG_ponder:
-				eng.watch.start();
-				eng.ei->getOutQue(eg);
-				eng.fixedMate = eg.mate;
-				eng.fixedNodes = eg.nodes;
-				eng.fixedTime = eg.fixedTime*1000;
-				eng.maxTime = eg.maxTime*1000;
-				eng.searchmoves = eg.searchmoves;
-				if (eng.fixedMate)
-					eng.searchtype = MATE_SEARCH;
-				else if (eng.fixedNodes)
-					eng.searchtype = NODES_SEARCH;
-				else if (eng.fixedTime)
-					eng.searchtype = TIME_SEARCH;
-				else
-					eng.searchtype = PONDER_SEARCH;
-				eng.startSearch();
+				eng->watch.start();
+				eng->ei->getOutQue(eg);
+				eng->go(eg, true);
 				break;
 			case ENG_position:
-				eng.ei->getOutQue(cb);
-				eng.theBoard = cb;
+				eng->ei->getOutQue(cb);
+				eng->theBoard = cb;
 				break;
 			case ENG_eval:
-				eng.ei->getOutQue(ev);
+				eng->ei->getOutQue(ev);
 				if (ev.type == EVAL_contempt)
-					eng.contempt = ev.value;
+					eng->contempt = ev.value;
 				else if (ev.type == EVAL_pawn)
-					eng.eval.pawnValue = ev.value;
+					eng->eval.pawnValue = ev.value;
 				else if (ev.type == EVAL_knight)
-					eng.eval.knightValue = ev.value;
+					eng->eval.knightValue = ev.value;
 				else if (ev.type == EVAL_bishop)
-					eng.eval.bishopValue = ev.value;
+					eng->eval.bishopValue = ev.value;
 				else if (ev.type == EVAL_rook)
-					eng.eval.rookValue = ev.value;
+					eng->eval.rookValue = ev.value;
 				else if (ev.type == EVAL_queen)
-					eng.eval.queenValue = ev.value;
+					eng->eval.queenValue = ev.value;
 				else if (ev.type == EVAL_bishoppair)
-					eng.eval.bishopValue = ev.value;
+					eng->eval.bishopPair = ev.value;
 				else if (ev.type == EVAL_mobility)
-					eng.eval.mobilityScore = ev.value;
+					eng->eval.mobilityScore = ev.value;
+				else if (ev.type == EVAL_traceply)
+					eng->trace.maxPly = ev.value;
+				else if (ev.type == EVAL_ownbook)
+					eng->ownBook = (ev.value != 0);
+				else if (ev.type == EVAL_learnreadonly)
+					eng->setLearnReadOnly(ev.value != 0);
+				else if (ev.type == EVAL_learnsize)
+					eng->learnSize = ev.value;
+				break;
+			case ENG_evalfile:
+				eng->ei->getOutQue(s);
+				eng->loadEvalFile(s);
+				break;
+			case ENG_trainingfile:
+				eng->ei->getOutQue(s);
+				eng->writeTrainingGame();
+				eng->trainingFile = s;
+				break;
+			case ENG_newgame:
+				eng->ei->getOutQue();
+				eng->writeTrainingGame();
+				break;
+			case ENG_bench:
+				eng->ei->getOutQue(eg);
+				eng->bench(eg.depth);
+				break;
+			case ENG_tracefile:
+				eng->ei->getOutQue(s);
+				eng->openTrace(s);
+				break;
+			case ENG_bookfile:
+				eng->ei->getOutQue(s);
+				eng->openBook(s);
+				break;
+			case ENG_learnfile:
+				eng->ei->getOutQue(s);
+				eng->openLearn(s);
 				break;
 			default:
 				// Unknown command, remove it.
-				eng.ei->getOutQue();
+				eng->ei->getOutQue();
 				break;
 			}
 		}
 		if (cmd == ENG_quit)
 			break;
 	}
+	eng->writeTrainingGame();
+	delete eng;
 	_endthread();
 };
 
 
-Engine::Engine()
+SearchEngine::SearchEngine()
 {
 	debug = false;
 	contempt = 0;
 	multiPV = 1;
+	rootScore = 0;
+	rootScoreValid = false;
+	benchMode = false;
+	ownBook = false;
+	learnSize = 16;
+	learnDepth = 0;
+	learnScore = 0;
+	searchtype = NORMAL_SEARCH;
+	fixedTime = maxTime = 0;
+	fixedNodes = fixedMate = fixedDepth = nodes = 0;
+	ei = NULL;
+	listener = NULL;
+	stopRequest = false;
+	evalFilePending = false;
+	info.clear();
+	srand((unsigned int)time(NULL));
+	stats.clear();
+	searchStats.clear();
+}
+
+void SearchEngine::go(const EngineGo& eg, bool ponder)
+{
+	fixedMate = eg.mate;
+	fixedNodes = eg.nodes;
+	fixedTime = eg.fixedTime*1000;
+	maxTime = eg.maxTime*1000;
+	searchmoves = eg.searchmoves;
+	if (!ponder)
+		fixedDepth = eg.depth;
+	if (fixedMate)
+		searchtype = MATE_SEARCH;
+	else if (fixedNodes)
+		searchtype = NODES_SEARCH;
+	else if (fixedTime)
+		searchtype = TIME_SEARCH;
+	else if (ponder)
+		searchtype = PONDER_SEARCH;
+	else if (fixedDepth)
+		searchtype = DEPTH_SEARCH;
+	else
+		searchtype = NORMAL_SEARCH;
+	if ((searchtype != NORMAL_SEARCH) || searchmoves.size() || !bookMove())
+		startSearch();
+	loadPendingEvalFile();
+}
+
+// Load an EvalFile that was sent during the search.
+void SearchEngine::loadPendingEvalFile()
+{
+	if (!evalFilePending)
+		return;
+	evalFilePending = false;
+	loadEvalFile(pendingEvalFile);
 }
 
-void Engine::startSearch()
+void SearchEngine::startSearch()
 {
 	int i;
 	typeSquare sq;
 	bool inCheck;
 	HASHKEY hashKey;
 	nodes = 0;
+	searchStats.clear();
+	for (i = 0; i < MAX_PLY; i++)
+		iterationNodes[i] = 0;
 	bestMove.clear();
+	info.clear();
 	eval.rootcolor = theBoard.toMove;
 	eval.drawscore[eval.rootcolor] = -contempt;
 	eval.drawscore[OTHERPLAYER(eval.rootcolor)] = contempt;
 	eval.setup(theBoard);
+	nnue.setup(theBoard);
+	trace.clear();
 
 	inCheck = mgen.inCheck(theBoard, theBoard.toMove);
 	hashKey = theBoard.hashkey();
 
+	// Quiet root positions are used as training data.
+	rootScoreValid = false;
+	if (trainingFile.length() && !inCheck)
+		rootFen = theBoard.getFen();
+	else
+		rootFen = "";
+
 	// Clear pv and nullmove
 	for (i = 0; i < MAX_PLY; i++)
 	{
@@ -192,7 +272,10 @@ void Engine::startSearch()
 
 	if (!ml[0].size())
 	{
-		ei->sendInQue(ENG_info, string("string No legal moves, aborting search."));
+		sendInfo(string("string No legal moves, aborting search."));
+		// The listener always gets the end of the search, the move is empty.
+		if (listener)
+			listener->searchDone(bestMove, info);
 		return;
 	}
 	else if ((ml[0].size() == 1) && (searchtype == NORMAL_SEARCH))
@@ -202,31 +285,63 @@ void Engine::startSearch()
 		return;
 	}
 
+	readLearn();
+	// The learn file doesn't know the game history, so a position that can
+	// repeat an earlier position is searched.
+	if ((searchtype == DEPTH_SEARCH) && learnDepth && (learnDepth >= (int)fixedDepth) && drawTable.empty())
+	{ // Already searched deep enough
+		bestMove = learnMove;
+		sendPV(pv[0], learnDepth, learnScore);
+		sendBestMove();
+		return;
+	}
 	iterativeSearch(inCheck, hashKey);
 }
 
-void Engine::iterativeSearch(bool inCheck, HASHKEY hashKey)
+void SearchEngine::iterativeSearch(bool inCheck, HASHKEY hashKey)
 {
 	int depth=1;
 	int score=-MATE;
-	
-	for (depth = 1; depth < MAX_DEPTH; depth++)
+	DWORD startNodes;
+
+	// Continue after the depth in the learn file, but not when the game
+	// history can make a draw the learn file doesn't know about.
+	if (learnDepth && drawTable.empty())
+	{
+		depth = learnDepth + 1;
+		score = learnScore;
+	}
+	for (; depth < MAX_DEPTH; depth++)
 	{
 		sprintf_s(sz, 256, "depth %i", depth);
-		ei->sendInQue(ENG_info, sz);
+		sendInfo(sz);
 #ifdef _DEBUG_SEARCH
 		highestsearchply = highestqsearchply = 0;
 #endif
+		stats.clear();
+		eval.lazyCutoffs = 0;
+		startNodes = nodes;
 		score = aspirationSearch(depth, score, inCheck, hashKey);
+		stats.nodes = nodes - startNodes;
+		stats.lazyCutoffs = eval.lazyCutoffs;
+		searchStats.add(stats);
 		if (score == BREAKING)
 			return;
+		iterationNodes[depth] = (DWORD)stats.nodes;
+		writeLearn(depth, score);
+		if (debug)
+		{
+			// Effective branching factor from the last iteration.
+			sprintf_s(sz, 256, "string stats depth %i ebf %.2f ", depth, (depth > 1 && iterationNodes[depth - 1]) ? (double)iterationNodes[depth] / iterationNodes[depth - 1] : 0.0);
+			sendInfo(sz + stats.text());
+		}
 #ifdef _DEBUG_SEARCH
 		cout << "Max ply: " << highestsearchply << ", Max qply: " << highestqsearchply << endl;
 #endif
 
 		if (searchtype == DEPTH_SEARCH)
 		{
-			if (depth == fixedDepth)
+			if (depth >= (int)fixedDepth)
 			{
 				sendBestMove();
 				return;
@@ -240,9 +355,19 @@ void Engine::iterativeSearch(bool inCheck, HASHKEY hashKey)
 			return;
 		}
 	}
+
+	// Max depth reached. An uci ponder or infinite search must wait for stop,
+	// abortCheck sends the move then.
+	if (ei && (searchtype == PONDER_SEARCH))
+	{
+		while (!abortCheck())
+			Sleep(10);
+		return;
+	}
+	sendBestMove();
 }
 
-int Engine::aspirationSearch(int depth, int bestscore, bool inCheck, HASHKEY hashKey)
+int SearchEngine::aspirationSearch(int depth, int bestscore, bool inCheck, HASHKEY hashKey)
 {
 	int alpha;
 	int beta;
@@ -276,7 +401,7 @@ int Engine::aspirationSearch(int depth, int bestscore, bool inCheck, HASHKEY has
 	return score;
 }
 
-int Engine::rootSearch(int depth, int alpha, int beta, bool inCheck, HASHKEY hashKey)
+int SearchEngine::rootSearch(int depth, int alpha, int beta, bool inCheck, HASHKEY hashKey)
 {
 	int score;
 	int mit;
@@ -287,8 +412,8 @@ int Engine::rootSearch(int depth, int alpha, int beta, bool inCheck, HASHKEY has
 
 	++nodes;
 
-	// Order moves. Do not extend before this
-	if (depth == 1)
+	// Order moves in the first iteration. Do not extend before this
+	if (bestMove.empty())
 	{
 		orderRootMoves();
 		bestMove = ml[0][0];
@@ -316,25 +441,34 @@ int Engine::rootSearch(int depth, int alpha, int beta, bool inCheck, HASHKEY has
 		if (debug || sendinfo)
 		{
 			sprintf_s(sz, 256, "currmove %s currmovenumber %i", theBoard.makeMoveText(ml[0][mit],UCI).c_str(), mit + 1);
-			ei->sendInQue(ENG_info, sz);
+			sendInfo(sz);
 		}
 		newkey = theBoard.newHashkey(ml[0][mit], hashKey);
 		mgen.doMove(theBoard, ml[0][mit]);
+		nnue.doMove(theBoard, ml[0][mit]);
 		--material[ml[0][mit].capturedpiece];
 
 		assert(theBoard.hashkey() == newkey);
 
 		inCheck = mgen.inCheck(theBoard, theBoard.toMove);
 		extention = moveExtention(inCheck, ml[0][mit], emptyMove, ml[0].size());
+		if (extention)
+			++stats.extensions;
 		oldNodes = nodes;
 		score = -Search(depth - 1 + extention, -beta, -alpha, inCheck, newkey, 1,followPV, true, ml[0][mit]);
 		if (score == -BREAKING)
 			return BREAKING;
 		mgen.undoMove(theBoard, ml[0][mit]);
+		nnue.undoMove();
 		++material[ml[0][mit].capturedpiece];
 		ml[0][mit].score = nodes - oldNodes;
+		if (trace.filter(0))
+			trace.add(0, depth, ml[0][mit], mit, extention ? TRACE_EXTENDED : 0, alpha, beta, score, nodes - oldNodes);
 		if (score >= beta)
+		{
+			stats.cutoff(mit);
 			return beta;
+		}
 		if (score > alpha)
 		{
 			copyPV(pv[0], pv[1], ml[0][mit]);
@@ -343,6 +477,8 @@ int Engine::rootSearch(int depth, int alpha, int beta, bool inCheck, HASHKEY has
 #endif
 				sendPV(pv[0], depth,score);
 			alpha = score;
+			rootScore = score;
+			rootScoreValid = true;
 
 			bestMove = ml[0][mit];
 		}
@@ -353,11 +489,12 @@ int Engine::rootSearch(int depth, int alpha, int beta, bool inCheck, HASHKEY has
 	return alpha;
 }
 
-int Engine::Search(int depth, int alpha, int beta, bool inCheck, HASHKEY hashKey, int ply, bool followPV, bool doNullmove, ChessMove& lastmove)
+int SearchEngine::Search(int depth, int alpha, int beta, bool inCheck, HASHKEY hashKey, int ply, bool followPV, bool doNullmove, ChessMove& lastmove)
 {
 	int score;
 	HASHKEY newkey;
 	int extention = 0;
+	DWORD oldNodes;
 
 //	pv[ply].clear();
 
@@ -373,7 +510,7 @@ int Engine::Search(int depth, int alpha, int beta, bool inCheck, HASHKEY hashKey
 		return (eval.drawscore[theBoard.toMove]);
 
 	if (ply >= MAX_PLY)
-		return eval.evaluate(theBoard, alpha, beta);
+		return evaluate(alpha, beta);
 
 	// Add position to the drawtable
 	hashDrawTable.add(hashKey, ply);
@@ -382,15 +519,24 @@ int Engine::Search(int depth, int alpha, int beta, bool inCheck, HASHKEY hashKey
 	if (!followPV && !inCheck && doNullmove && whitemateriale && blackmateriale)
 	{
 
+		++stats.nullTries;
+		oldNodes = nodes;
 		newkey = theBoard.newHashkey(nullmove[ply],hashKey);
 		mgen.doNullMove(theBoard, nullmove[ply]);
+		nnue.doNullMove();
 		score = -Search(__max(depth - 1 - nullMoveReduction(depth,__min(whitemateriale,blackmateriale)),0), -beta, -beta+1, false, newkey, ply + 1, false, false,nullmove[ply]);
 //		score = -Search(__max(depth - 4, 0), -beta, -beta+1, false, newkey, ply + 1, false, false);
 		if (score == -BREAKING)
 			return BREAKING;
 		mgen.undoNullMove(theBoard, nullmove[ply]);
+		nnue.undoMove();
+		if (trace.filter(ply))
+			trace.add(ply, depth, nullmove[ply], 0, TRACE_NULLMOVE, beta - 1, beta, score, nodes - oldNodes);
 		if (score >= beta)
+		{
+			++stats.nullCutoffs;
 			return beta;
+		}
 	}
 
 	mgen.makeMoves(theBoard, ml[ply]);
@@ -400,22 +546,32 @@ int Engine::Search(int depth, int alpha, int beta, bool inCheck, HASHKEY hashKey
 	{
 		newkey = theBoard.newHashkey(ml[ply][mit], hashKey);
 		mgen.doMove(theBoard, ml[ply][mit]);
+		nnue.doMove(theBoard, ml[ply][mit]);
 		--material[ml[ply][mit].capturedpiece];
 
 		assert(theBoard.hashkey() == newkey);
 
 		inCheck = mgen.inCheck(theBoard, theBoard.toMove);
 		extention = moveExtention(inCheck, ml[ply][mit], lastmove, ml[ply].size());
+		if (extention)
+			++stats.extensions;
 #ifdef _DEBUG_SEARCH
 		highestsearchply = __max(ply+1, highestsearchply);
 #endif
+		oldNodes = nodes;
 		score = -Search(depth - 1 + extention, -beta, -alpha, inCheck, newkey, ply + 1, followPV,true, ml[ply][mit]);
 		if (score == -BREAKING)
 			return BREAKING;
 		mgen.undoMove(theBoard, ml[ply][mit]);
+		nnue.undoMove();
 		++material[ml[ply][mit].capturedpiece];
+		if (trace.filter(ply))
+			trace.add(ply, depth, ml[ply][mit], mit, extention ? TRACE_EXTENDED : 0, alpha, beta, score, nodes - oldNodes);
 		if (score >= beta)
+		{
+			stats.cutoff(mit);
 			return beta;
+		}
 		if (score > alpha)
 		{
 			alpha = score;
@@ -435,17 +591,19 @@ int Engine::Search(int depth, int alpha, int beta, bool inCheck, HASHKEY hashKey
 	return alpha;
 }
 
-int Engine::qSearch(int alpha, int beta, int ply)
+int SearchEngine::qSearch(int alpha, int beta, int ply)
 {
 	int score;
+	DWORD oldNodes;
 
 	pv[ply].clear();
 
+	++stats.qnodes;
 	if (!(++nodes % 0x400))
 		if (abortCheck())
 			return BREAKING;
 
-	score = eval.evaluate(theBoard, alpha, beta);
+	score = evaluate(alpha, beta);
 
 	if (score >= beta)
 		return beta;
@@ -461,13 +619,18 @@ int Engine::qSearch(int alpha, int beta, int ply)
 	for (mit = 0; mit < ml[ply].size(); mit++)
 	{
 		mgen.doMove(theBoard, ml[ply][mit]);
+		nnue.doMove(theBoard, ml[ply][mit]);
 #ifdef _DEBUG_SEARCH
 		highestqsearchply = __max(ply+1, highestqsearchply);
 #endif
+		oldNodes = nodes;
 		score = -qSearch(-beta, -alpha, ply + 1);
 		if (score == -BREAKING)
 			return BREAKING;
 		mgen.undoMove(theBoard, ml[ply][mit]);
+		nnue.undoMove();
+		if (trace.filter(ply))
+			trace.add(ply, 0, ml[ply][mit], mit, TRACE_QSEARCH, alpha, beta, score, nodes - oldNodes);
 		if (score >= beta)
 			return beta;
 		if (score > alpha)
@@ -479,12 +642,13 @@ int Engine::qSearch(int alpha, int beta, int ply)
 	return alpha;
 }
 
-bool Engine::abortCheck()
+bool SearchEngine::abortCheck()
 {
 	ENGINECOMMAND cmd;
 	ChessBoard cb;
 	EngineGo eg;
 	EngineEval ev;
+	string s;
 	switch (searchtype)
 	{
 	case NODES_SEARCH:
@@ -509,6 +673,13 @@ bool Engine::abortCheck()
 		}
 		break;
 	}
+	if (stopRequest)
+	{
+		sendBestMove();
+		return true;
+	}
+	if (!ei)
+		return false;
 	while ((cmd = ei->peekOutQue()) != ENG_none)
 	{
 		switch (cmd)
@@ -567,9 +738,45 @@ bool Engine::abortCheck()
 			else if (ev.type == EVAL_queen)
 				eval.queenValue = ev.value;
 			else if (ev.type == EVAL_bishoppair)
-				eval.bishopValue = ev.value;
+				eval.bishopPair = ev.value;
 			else if (ev.type == EVAL_mobility)
 				eval.mobilityScore = ev.value;
+			else if (ev.type == EVAL_traceply)
+				trace.maxPly = ev.value;
+			else if (ev.type == EVAL_ownbook)
+				ownBook = (ev.value != 0);
+			else if (ev.type == EVAL_learnreadonly)
+				setLearnReadOnly(ev.value != 0);
+			else if (ev.type == EVAL_learnsize)
+				learnSize = ev.value;
+			break;
+		case ENG_evalfile: // The net can't be changed during search, it is loaded after.
+			ei->getOutQue(pendingEvalFile);
+			evalFilePending = true;
+			break;
+		case ENG_trainingfile:
+			ei->getOutQue(s);
+			writeTrainingGame();
+			trainingFile = s;
+			break;
+		case ENG_newgame:
+			ei->getOutQue();
+			writeTrainingGame();
+			break;
+		case ENG_bench: // Shouldnt happend here
+			ei->getOutQue(eg);
+			break;
+		case ENG_tracefile:
+			ei->getOutQue(s);
+			openTrace(s);
+			break;
+		case ENG_bookfile: // The book isn't used while searching.
+			ei->getOutQue(s);
+			openBook(s);
+			break;
+		case ENG_learnfile:
+			ei->getOutQue(s);
+			openLearn(s);
 			break;
 		default:
 			// Unknown command, remove it.
@@ -580,32 +787,56 @@ bool Engine::abortCheck()
 	return false;
 }
 
-void Engine::sendBestMove()
+void SearchEngine::sendBestMove()
 {
-	ei->sendInQue(ENG_string, "bestmove " + theBoard.makeMoveText(bestMove,UCI));
+	// Bench positions are not from a game.
+	if (benchMode)
+		return;
+	saveTrainingPosition();
+	if (listener)
+		listener->searchDone(bestMove, info);
+	if (ei)
+		ei->sendInQue(ENG_string, "bestmove " + theBoard.makeMoveText(bestMove,UCI));
 }
 
-void Engine::sendPV(const MoveList& pvline, int depth, int score, int type)
+void SearchEngine::sendInfo(const std::string& s)
 {
-	string pvstring = "";
-	string s;
-	int i = 0;
+	if (ei)
+		ei->sendInQue(ENG_info, s);
+	else if (listener)
+		listener->searchString(s);
+}
+
+void SearchEngine::sendPV(const MoveList& pvline, int depth, int score, int type)
+{
+	string pvstring;
+	int i;
+	int j;
 	ULONGLONG t = watch.read(WatchPrecision::Microsecond);
 	double ts = t / 1000000.0;
-	tempBoard = theBoard;
-	ChessMove m;
-	while (i < pvline.size())
-	{
-		m = pvline[i];
-		s = tempBoard.makeMoveText(m,UCI);
-		if (!tempBoard.doMove(m, true))
-			break;
-		pvstring += s;
-		pvstring += " ";
-		++i;
-	}
-	pvstring = trim(pvstring);
+	// Stops at an illegal move.
+	i = theBoard.makeMovesText(pvline, pvstring, UCI);
 	t /= 1000; //Use milliseconds in pv
+
+	info.depth = depth;
+	info.score = score;
+	info.bound = type;
+	info.nodes = nodes;
+	info.time = t;
+	info.pv.clear();
+	for (j = 0; j < i; j++)
+		info.pv.push_back(pvline[j]);
+	if (score > MATE - 200)
+		info.mate = (MATE - score) / 2 + 1;
+	else if (score < -MATE + 200)
+		info.mate = -(MATE + score) / 2;
+	else
+		info.mate = 0;
+	if (listener)
+		listener->searchInfo(info);
+	if (!ei)
+		return;
+
 	if (type==lowerbound)
 		sprintf_s(sz, 256, "depth %u nps %u score lowerbound cp %i nodes %u time %llu pv %s", depth, (DWORD)(nodes / ts), score, nodes, t, pvstring.c_str());
 	else if (type==upperbound)
@@ -616,23 +847,32 @@ void Engine::sendPV(const MoveList& pvline, int depth, int score, int type)
 		sprintf_s(sz, 256, "depth %u nps %u score mate %i nodes %u time %llu pv %s", depth, (DWORD)(nodes / ts), (MATE + score)/2, nodes, t, pvstring.c_str());
 	else
 		sprintf_s(sz, 256, "depth %u nps %u score cp %i nodes %u time %llu pv %s", depth, (DWORD)(nodes / ts), score, nodes, t, pvstring.c_str());
-	ei->sendInQue(ENG_info, sz);
+	sendInfo(sz);
 }
 
-void Engine::orderRootMoves()
+void SearchEngine::orderRootMoves()
 {
 	int mit;
 	for (mit = 0; mit < ml[0].size(); mit++)
 	{
 		mgen.doMove(theBoard, ml[0][mit]);
-		ml[0][mit].score = -eval.evaluate(theBoard, MATE, -MATE);
+		nnue.doMove(theBoard, ml[0][mit]);
+		ml[0][mit].score = -evaluate(MATE, -MATE);
 		mgen.undoMove(theBoard, ml[0][mit]);
+		nnue.undoMove();
+	}
+	// A move from an earlier search goes first.
+	if (!learnMove.empty())
+	{
+		mit = ml[0].find(learnMove);
+		if (mit < ml[0].size())
+			ml[0][mit].score = 0x7fffffff;
 	}
 	ml[0].sort();
 
 }
 
-void Engine::orderMoves(MoveList& mlist, const ChessMove& first)
+void SearchEngine::orderMoves(MoveList& mlist, const ChessMove& first)
 {
 	static int seevalue[13][13] = { // [victem][attacker]
 		 0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  // No capture
@@ -679,7 +919,7 @@ void Engine::orderMoves(MoveList& mlist, const ChessMove& first)
 	mlist.sort();
 }
 
-void Engine::orderQMoves(MoveList& mlist)
+void SearchEngine::orderQMoves(MoveList& mlist)
 {
 	static int seevalue[13][13] = { // [victem][attacker]
 		0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  0,  // No capture
@@ -716,7 +956,7 @@ void Engine::orderQMoves(MoveList& mlist)
 	mlist.sort();
 }
 
-void Engine::copyPV(MoveList& m1, MoveList& m2, ChessMove& m)
+void SearchEngine::copyPV(MoveList& m1, MoveList& m2, ChessMove& m)
 {
 	m1.clear();
 	m1.push_back(m);
@@ -724,7 +964,7 @@ void Engine::copyPV(MoveList& m1, MoveList& m2, ChessMove& m)
 		m1.push_back(m2[i]);
 };
 
-int Engine::moveExtention(bool inCheck, ChessMove& move, ChessMove& lastmove, int moves)
+int SearchEngine::moveExtention(bool inCheck, ChessMove& move, ChessMove& lastmove, int moves)
 {
 	if (move.toSquare == lastmove.toSquare)
 		return 1;
@@ -737,3 +977,369 @@ int Engine::moveExtention(bool inCheck, ChessMove& move, ChessMove& lastmove, in
 		return 1;
 	return 0;
 }
+
+int SearchEngine::evaluate(int alpha, int beta)
+{
+	++stats.evaluations;
+	if (nnue.loaded())
+	{
+		if (theBoard.move50draw > 98)
+			return eval.drawscore[theBoard.toMove];
+		return nnue.evaluate(theBoard);
+	}
+	return eval.evaluate(theBoard, alpha, beta);
+}
+
+// An empty name or <empty> goes back to the classical evaluation.
+void SearchEngine::loadEvalFile(const string& file)
+{
+	string error;
+	if (!file.length() || (file == "<empty>"))
+	{
+		nnue.unload();
+		sendInfo(string("string Using classical evaluation."));
+		return;
+	}
+	if (nnue.load(file, error))
+	{
+		sprintf_s(sz, 256, "string Network loaded: %s (simd %i)", file.c_str(), nnue.simd);
+		sendInfo(string(sz));
+	}
+	else
+	{
+		sendInfo("string " + error);
+	}
+}
+
+// An empty name or <empty> turns the trace off.
+void SearchEngine::openTrace(const string& file)
+{
+	trace.close();
+	if (!file.length() || (file == "<empty>"))
+		return;
+	if (trace.open(file))
+		sendInfo("string Tracing search to " + file);
+	else
+		sendInfo("string Unable to create trace file: " + file);
+}
+
+// An empty name or <empty> closes the book.
+void SearchEngine::openBook(const string& file)
+{
+	book.close();
+	if (!file.length() || (file == "<empty>"))
+		return;
+	if (book.open(file))
+	{
+		sprintf_s(sz, 256, "string Book opened: %s (%llu entries)", file.c_str(), (ULONGLONG)book.size());
+		sendInfo(string(sz));
+	}
+	else
+	{
+		sendInfo("string Unable to open book: " + file);
+	}
+}
+
+bool SearchEngine::bookMove()
+{
+	vector<ChessMove> moves;
+	DWORD total = 0;
+	DWORD r;
+	size_t i;
+
+	if (!ownBook || !book.isOpen())
+		return false;
+	book.get(theBoard, moves);
+	if (!moves.size())
+		return false;
+
+	// Random move, weighted by the book.
+	for (i = 0; i < moves.size(); i++)
+		total += moves[i].score;
+	bestMove = moves[0];
+	if (total)
+	{
+		r = (((DWORD)rand() << 15) | (DWORD)rand()) % total;
+		for (i = 0; i < moves.size(); i++)
+		{
+			if (r < (DWORD)moves[i].score)
+			{
+				bestMove = moves[i];
+				break;
+			}
+			r -= moves[i].score;
+		}
+	}
+	sendInfo("string Book move " + theBoard.makeMoveText(bestMove, UCI));
+	sendBestMove();
+	return true;
+}
+
+// An empty name or <empty> closes the learn file.
+void SearchEngine::openLearn(const string& file)
+{
+	learn.close();
+	if (!file.length() || (file == "<empty>"))
+		return;
+	if (learn.open(file, learnSize))
+	{
+		sprintf_s(sz, 256, "string Learn file opened: %s (%u entries)", file.c_str(), learn.size());
+		sendInfo(string(sz));
+	}
+	else
+	{
+		sendInfo("string Unable to open learn file: " + file);
+	}
+}
+
+void SearchEngine::setLearnReadOnly(bool readOnly)
+{
+	if (!learn.setReadOnly(readOnly))
+		sendInfo(string("string Unable to open the learn file again."));
+}
+
+void SearchEngine::readLearn()
+{
+	LearnEntry le;
+	ChessMove m;
+	MoveList line;
+	int i, n;
+
+	learnMove.clear();
+	learnDepth = 0;
+	learnScore = 0;
+	// Bench must search the same nodes with any learn file.
+	if (!learn.isOpen() || benchMode)
+		return;
+
+	// Follow the saved moves from the root. ml[1] is free before the search.
+	tempBoard = theBoard;
+	while (line.size() < (MAX_PLY / 2))
+	{
+		if (!learn.probe(tempBoard.hashkey(), le))
+			break;
+		mgen.makeMoves(tempBoard, ml[1]);
+		m.clear();
+		m.fromSquare = le.fromSquare;
+		m.toSquare = le.toSquare;
+		m.promotePiece = le.promotePiece;
+		i = ml[1].find(m);
+		if (i >= ml[1].size())
+			break;
+		if (!line.size())
+		{
+			if (ml[0].find(ml[1][i]) >= ml[0].size())
+				break;
+			learnMove = ml[1][i];
+			learnDepth = le.depth;
+			learnScore = le.score;
+			sprintf_s(sz, 256, "string Learned depth %i score %i move %s", le.depth, le.score, theBoard.makeMoveText(learnMove, UCI).c_str());
+			sendInfo(string(sz));
+		}
+		line.push_back(ml[1][i]);
+		mgen.doMove(tempBoard, ml[1][i]);
+	}
+
+	// The pv at each ply is the line from that ply.
+	for (i = 0; i < line.size(); i++)
+	{
+		pv[i].clear();
+		for (n = i; n < line.size(); n++)
+			pv[i].push_back(line[n]);
+	}
+}
+
+void SearchEngine::writeLearn(int depth, int score)
+{
+	ChessMove m;
+	int i;
+
+	if (!learn.isOpen() || learn.isReadOnly() || benchMode || (depth < LEARN_MINDEPTH))
+		return;
+	tempBoard = theBoard;
+	for (i = 0; i < pv[0].size(); i++)
+	{
+		// Mate scores depend on the ply.
+		if ((score >= (MATE - MAX_PLY)) || (score <= (-MATE + MAX_PLY)))
+			break;
+		if ((depth - i) < LEARN_MINDEPTH)
+			break;
+		m = pv[0][i];
+		learn.store(tempBoard.hashkey(), depth - i, score, m);
+		mgen.doMove(tempBoard, m);
+		score = -score;
+	}
+}
+
+void SearchEngine::saveTrainingPosition()
+{
+	TrainingPosition tp;
+	if (!rootFen.length() || !rootScoreValid)
+		return;
+	tp.fen = rootFen;
+	tp.score = (eval.rootcolor == WHITE) ? rootScore : -rootScore;
+	trainingGame.push_back(tp);
+	rootFen = "";
+}
+
+/* Write the positions from the last game as "fen | score | result".
+*  The engine doesn't know how the game ended, so the result is adjudicated
+*  from the last score, seen from white.
+*/
+void SearchEngine::writeTrainingGame()
+{
+	const int adjudicate = 400;
+	const char* result;
+	size_t i;
+	if (!trainingGame.size())
+		return;
+	if (trainingFile.length())
+	{
+		if (trainingGame.back().score > adjudicate)
+			result = "1";
+		else if (trainingGame.back().score < -adjudicate)
+			result = "0";
+		else
+			result = "0.5";
+		ofstream f(trainingFile, ios::app);
+		if (f.is_open())
+		{
+			for (i = 0; i < trainingGame.size(); i++)
+				f << trainingGame[i].fen << " | " << trainingGame[i].score << " | " << result << endl;
+			f.close();
+		}
+	}
+	trainingGame.clear();
+}
+
+void SearchStats::clear()
+{
+	int i;
+	nodes = qnodes = cutoffs = 0;
+	for (i = 0; i < STATS_CUTOFFS; i++)
+		cutoffIndex[i] = 0;
+	nullTries = nullCutoffs = extensions = evaluations = lazyCutoffs = 0;
+}
+
+void SearchStats::add(const SearchStats& s)
+{
+	int i;
+	nodes += s.nodes;
+	qnodes += s.qnodes;
+	cutoffs += s.cutoffs;
+	for (i = 0; i < STATS_CUTOFFS; i++)
+		cutoffIndex[i] += s.cutoffIndex[i];
+	nullTries += s.nullTries;
+	nullCutoffs += s.nullCutoffs;
+	extensions += s.extensions;
+	evaluations += s.evaluations;
+	lazyCutoffs += s.lazyCutoffs;
+}
+
+// Percent without dividing by zero.
+static double percent(ULONGLONG part, ULONGLONG total)
+{
+	return total ? (100.0*part) / total : 0.0;
+}
+
+std::string SearchStats::text()
+{
+	char buf[256];
+	string s;
+	int i;
+	sprintf_s(buf, 256, "nodes %llu qnodes %.1f%% cutoffs %llu first %.1f%% index", nodes, percent(qnodes, nodes), cutoffs, percent(cutoffIndex[0], cutoffs));
+	s = buf;
+	for (i = 0; i < STATS_CUTOFFS; i++)
+	{
+		sprintf_s(buf, 256, " %llu", cutoffIndex[i]);
+		s += buf;
+	}
+	sprintf_s(buf, 256, " null %llu/%llu ext %llu evals %llu lazy %.1f%%", nullCutoffs, nullTries, extensions, evaluations, percent(lazyCutoffs, evaluations));
+	s += buf;
+	return s;
+}
+
+std::string SearchStats::json()
+{
+	char buf[256];
+	string s;
+	int i;
+	sprintf_s(buf, 256, "\"nodes\":%llu,\"qnodes\":%llu,\"qnodeShare\":%.4f,\"cutoffs\":%llu,\"firstMoveCutoffRate\":%.4f,\"cutoffIndex\":[", nodes, qnodes, percent(qnodes, nodes) / 100, cutoffs, percent(cutoffIndex[0], cutoffs) / 100);
+	s = buf;
+	for (i = 0; i < STATS_CUTOFFS; i++)
+	{
+		sprintf_s(buf, 256, (i ? ",%llu" : "%llu"), cutoffIndex[i]);
+		s += buf;
+	}
+	sprintf_s(buf, 256, "],\"nullTries\":%llu,\"nullCutoffs\":%llu,\"extensions\":%llu,\"evaluations\":%llu,\"lazyCutoffs\":%llu,\"lazyCutoffRate\":%.4f", nullTries, nullCutoffs, extensions, evaluations, lazyCutoffs, percent(lazyCutoffs, evaluations) / 100);
+	s += buf;
+	return s;
+}
+
+/* Search a fixed set of positions to a fixed depth and send the result
+*  as one line of json.
+*/
+void SearchEngine::bench(int depth)
+{
+	static const char* benchPositions[] = {
+		"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+		"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+		"8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+		"r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+		"rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+		"r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+		"r1bqkb1r/pppp1ppp/2n2n2/4p2Q/2B1P3/8/PPPP1PPP/RNB1K1NR w KQkq - 4 4",
+		"8/8/4k3/8/2p5/8/B2P2K1/8 w - - 0 1"
+	};
+	const int positions = sizeof(benchPositions) / sizeof(benchPositions[0]);
+	SearchStats total;
+	ULONGLONG depthNodes[MAX_PLY];
+	ULONGLONG t;
+	StopWatch benchWatch;
+	string json;
+	int i, d, searched = 0;
+
+	if (depth < 1)
+		depth = 5;
+	if (depth >= MAX_PLY)
+		depth = MAX_PLY - 1;
+	total.clear();
+	for (d = 0; d < MAX_PLY; d++)
+		depthNodes[d] = 0;
+
+	benchMode = true;
+	benchWatch.start();
+	for (i = 0; i < positions; i++)
+	{
+		theBoard.setFen(benchPositions[i]);
+		drawTable.clear();
+		searchmoves.clear();
+		fixedDepth = depth;
+		fixedNodes = fixedMate = 0;
+		fixedTime = maxTime = 0;
+		searchtype = DEPTH_SEARCH;
+		watch.start();
+		startSearch();
+		total.add(searchStats);
+		for (d = 0; d <= depth; d++)
+			depthNodes[d] += iterationNodes[d];
+		++searched;
+		if (ei && (ei->peekOutQue() == ENG_quit))
+			break;
+	}
+	t = benchWatch.read(WatchPrecision::Millisecond);
+	benchMode = false;
+	loadPendingEvalFile();
+
+	sprintf_s(sz, 256, "{\"bench\":{\"depth\":%i,\"positions\":%i,\"timeMs\":%llu,\"nps\":%llu,", depth, searched, t, t ? (total.nodes * 1000) / t : 0);
+	json = sz;
+	json += total.json();
+	json += ",\"depthNodes\":[";
+	for (d = 1; d <= depth; d++)
+	{
+		sprintf_s(sz, 256, (d > 1) ? ",%llu" : "%llu", depthNodes[d]);
+		json += sz;
+	}
+	json += "]}}";
+	ei->sendInQue(ENG_string, json);
+}
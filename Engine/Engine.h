@@ -3,9 +3,16 @@
 #include "EngineInterface.h"
 #include "DrawTable.h"
 #include "Evaluation.h"
+#include "Nnue.h"
+#include "SearchTrace.h"
+#include "LearnFile.h"
+#include "SearchListener.h"
 #include "EngineInterface.h"
+#include <string>
+#include <vector>
 #include "../Common/StopWatch.h"
 #include "../Common/MoveGenerator.h"
+#include "../Common/PolyglotBook.h"
 #include "../Common/defs.h"
 
 enum SEARCHTYPE
@@ -24,12 +31,55 @@ enum
 	upperbound
 };
 
-class Engine
+const int STATS_CUTOFFS = 8;
+
+// Counters for the search behaviour. They are always counted, and are sent
+// after each iteration in debug mode and with the bench command.
+struct SearchStats
+{
+	ULONGLONG nodes;
+	ULONGLONG qnodes;
+	ULONGLONG cutoffs;
+	// Number of the move that gave the cutoff, the last entry is the rest.
+	ULONGLONG cutoffIndex[STATS_CUTOFFS];
+	ULONGLONG nullTries;
+	ULONGLONG nullCutoffs;
+	ULONGLONG extensions;
+	ULONGLONG evaluations;
+	ULONGLONG lazyCutoffs;
+	void clear();
+	void add(const SearchStats& s);
+	inline void cutoff(int index) { ++cutoffs; ++cutoffIndex[__min(index, STATS_CUTOFFS - 1)]; };
+	std::string text();
+	std::string json();
+};
+
+// A searched root position saved as training data for the network.
+struct TrainingPosition
+{
+	std::string fen;
+	// Score seen from white
+	int score;
+};
+
+class SearchEngine
 {
 	friend void EngineSearchThreadLoop(void* eng);
 public:
 	ChessMove bestMove;
 	Evaluation eval;
+	Nnue nnue;
+	// EvalFile sent during a search, loaded when the search ends.
+	std::string pendingEvalFile;
+	bool evalFilePending;
+	SearchTrace trace;
+	Polyglot book;
+	bool ownBook;
+	LearnFile learn;
+	DWORD learnSize; // MB for a new learn file
+	ChessMove learnMove; // Root move from the learn file
+	int learnDepth;
+	int learnScore;
 	StopWatch watch;
 	MoveGenerator mgen;
 	SEARCHTYPE searchtype;
@@ -44,30 +94,66 @@ public:
 	DWORD fixedDepth;
 	DWORD nodes;
 	DWORD multiPV;
+	SearchStats stats; // This iteration
+	SearchStats searchStats; // All iterations
+	DWORD iterationNodes[MAX_PLY];
+	bool benchMode;
 	MoveList searchmoves;
 	DrawTable drawTable;
 	HashDrawTable hashDrawTable;
 	EngineInterface* ei;
+	// Used instead of ei when the engine runs in a SearchSession.
+	SearchListener* listener;
+	// Set from another thread to stop the search.
+	volatile bool stopRequest;
+	SearchInfo info; // Last pv sent
+	char sz[256];
 	int contempt;
 	ChessBoard theBoard;
 	ChessBoard tempBoard;
 	// Keep track of materiale on board to deside if nullmove is dangerous
 	int material[13];
-	Engine();
+	// Training data, written when the game ends.
+	std::string trainingFile;
+	std::vector<TrainingPosition> trainingGame;
+	std::string rootFen;
+	int rootScore;
+	bool rootScoreValid;
+	SearchEngine();
+	// Set the search type from the limits and search.
+	void go(const EngineGo& eg, bool ponder);
 	void startSearch();
 	void iterativeSearch(bool inCheck, HASHKEY hashKey);
 	int aspirationSearch(int depth, int bestscore, bool inCheck, HASHKEY hashKey);
 	int rootSearch(int depth, int alpha, int beta, bool inCheck, HASHKEY hashKey);
 	int Search(int depth, int alpha, int beta, bool inCheck, HASHKEY hashKey, int ply, bool followPV, bool doNullmovem, ChessMove& lastmove);
 	int qSearch(int alpha, int beta, int ply);
+	int evaluate(int alpha, int beta);
 	void orderRootMoves();
 	// Order movelist, put m as first move.
 	void orderMoves(MoveList& mlist, const ChessMove& m);
 	void orderQMoves(MoveList& mlist);
 	bool abortCheck();
 	void sendBestMove();
+	void sendInfo(const std::string& s);
 	// Type=0-> Normal, 1=lowerbound, 2=upperbound
 	void sendPV(const MoveList& l, int depth, int score, int type = 0);
 	void copyPV(MoveList& m1, MoveList& m2, ChessMove& m);
 	int moveExtention(bool inCheck, ChessMove& move, ChessMove& lastmove, int moves);
+	void bench(int depth);
+	void loadEvalFile(const std::string& file);
+	void loadPendingEvalFile();
+	void openTrace(const std::string& file);
+	void openBook(const std::string& file);
+	// Play a move from the book, false if the position isn't in the book.
+	bool bookMove();
+	void openLearn(const std::string& file);
+	// A read only learn file can be shared with other engines.
+	void setLearnReadOnly(bool readOnly);
+	// Set the pv from the learn file before the search.
+	void readLearn();
+	// Save the pv after an iteration.
+	void writeLearn(int depth, int score);
+	void saveTrainingPosition();
+	void writeTrainingGame();
 };
@@ -3,12 +3,11 @@
 
 using namespace std;
 
-CRITICAL_SECTION engineCS;
 extern void EngineSearchThreadLoop(void* eng);
 
 EngineInterface::EngineInterface()
 {
-	InitializeCriticalSection(&engineCS);
+	InitializeCriticalSection(&cs);
 	hEvent = CreateEvent(NULL, FALSE, FALSE, NULL);
 	hEngine = CreateEvent(NULL, FALSE, FALSE, NULL);
 	hThread = (HANDLE)_beginthread(EngineSearchThreadLoop, 0, this);
@@ -16,81 +15,90 @@ EngineInterface::EngineInterface()
 
 EngineInterface::~EngineInterface()
 {
-	DeleteCriticalSection(&engineCS);
+	DeleteCriticalSection(&cs);
 	CloseHandle(hEvent);
 	CloseHandle(hEngine);
 }
 
 void EngineInterface::sendInQue(ENGINECOMMAND cmd)
 {
-	EnterCriticalSection(&engineCS);
+	EnterCriticalSection(&cs);
 	inQueCmd.push_back(cmd);
-	LeaveCriticalSection(&engineCS);
+	LeaveCriticalSection(&cs);
 	SetEvent(hEvent);
 }
 
 void EngineInterface::sendInQue(ENGINECOMMAND cmd, const std::string& s)
 {
-	EnterCriticalSection(&engineCS);
+	EnterCriticalSection(&cs);
 	inQueCmd.push_back(cmd);
 	inQueStr.push_back(s);
-	LeaveCriticalSection(&engineCS);
+	LeaveCriticalSection(&cs);
 	SetEvent(hEvent);
 }
 
 void EngineInterface::sendOutQue(ENGINECOMMAND cmd)
 {
-	EnterCriticalSection(&engineCS);
+	EnterCriticalSection(&cs);
 	if (cmd == ENG_quit)
 		outQueCmd.clear();
 	outQueCmd.push_back(cmd);
-	LeaveCriticalSection(&engineCS);
+	LeaveCriticalSection(&cs);
 	SetEvent(hEngine);
 }
 
 void EngineInterface::sendOutQue(ENGINECOMMAND cmd, const ChessBoard& cb)
 {
-	EnterCriticalSection(&engineCS);
+	EnterCriticalSection(&cs);
 	outQueCmd.push_back(cmd);
 	outQueCb.push_back(cb);
-	LeaveCriticalSection(&engineCS);
+	LeaveCriticalSection(&cs);
 	SetEvent(hEngine);
 }
 
 void EngineInterface::sendOutQue(ENGINECOMMAND cmd, const EngineGo& eg)
 {
-	EnterCriticalSection(&engineCS);
+	EnterCriticalSection(&cs);
 	outQueCmd.push_back(cmd);
 	outQueGo.push_back(eg);
-	LeaveCriticalSection(&engineCS);
+	LeaveCriticalSection(&cs);
 	SetEvent(hEngine);
 }
 
 void EngineInterface::sendOutQue(ENGINECOMMAND cmd, const EngineEval& e)
 {
-	EnterCriticalSection(&engineCS);
+	EnterCriticalSection(&cs);
 	outQueCmd.push_back(cmd);
 	outQueEvl.push_back(e);
-	LeaveCriticalSection(&engineCS);
+	LeaveCriticalSection(&cs);
+	SetEvent(hEngine);
+}
+
+void EngineInterface::sendOutQue(ENGINECOMMAND cmd, const std::string& s)
+{
+	EnterCriticalSection(&cs);
+	outQueCmd.push_back(cmd);
+	outQueStr.push_back(s);
+	LeaveCriticalSection(&cs);
 	SetEvent(hEngine);
 }
 
 ENGINECOMMAND EngineInterface::peekOutQue()
 {
 	ENGINECOMMAND cmd;
-	EnterCriticalSection(&engineCS);
+	EnterCriticalSection(&cs);
 	if (outQueCmd.size() > 0)
 		cmd = outQueCmd.front();
 	else
 		cmd = ENG_none;
-	LeaveCriticalSection(&engineCS);
+	LeaveCriticalSection(&cs);
 	return cmd;
 }
 
 ENGINECOMMAND EngineInterface::getOutQue()
 {
 	ENGINECOMMAND cmd;
-	EnterCriticalSection(&engineCS);
+	EnterCriticalSection(&cs);
 	if (outQueCmd.size() > 0)
 	{
 		cmd = outQueCmd.front();
@@ -100,14 +108,14 @@ ENGINECOMMAND EngineInterface::getOutQue()
 	{
 		cmd = ENG_none;
 	}
-	LeaveCriticalSection(&engineCS);
+	LeaveCriticalSection(&cs);
 	return cmd;
 }
 
 ENGINECOMMAND EngineInterface::getOutQue(ChessBoard& cb)
 {
 	ENGINECOMMAND cmd;
-	EnterCriticalSection(&engineCS);
+	EnterCriticalSection(&cs);
 	if (outQueCmd.size() > 0)
 	{
 		cmd = outQueCmd.front();
@@ -122,14 +130,14 @@ ENGINECOMMAND EngineInterface::getOutQue(ChessBoard& cb)
 	{
 		cmd = ENG_none;
 	}
-	LeaveCriticalSection(&engineCS);
+	LeaveCriticalSection(&cs);
 	return cmd;
 }
 
 ENGINECOMMAND EngineInterface::getOutQue(EngineGo& eg)
 {
 	ENGINECOMMAND cmd;
-	EnterCriticalSection(&engineCS);
+	EnterCriticalSection(&cs);
 	if (outQueCmd.size() > 0)
 	{
 		cmd = outQueCmd.front();
@@ -144,14 +152,14 @@ ENGINECOMMAND EngineInterface::getOutQue(EngineGo& eg)
 	{
 		cmd = ENG_none;
 	}
-	LeaveCriticalSection(&engineCS);
+	LeaveCriticalSection(&cs);
 	return cmd;
 }
 
 ENGINECOMMAND EngineInterface::getOutQue(EngineEval& e)
 {
 	ENGINECOMMAND cmd;
-	EnterCriticalSection(&engineCS);
+	EnterCriticalSection(&cs);
 	if (outQueCmd.size() > 0)
 	{
 		cmd = outQueCmd.front();
@@ -166,26 +174,48 @@ ENGINECOMMAND EngineInterface::getOutQue(EngineEval& e)
 	{
 		cmd = ENG_none;
 	}
-	LeaveCriticalSection(&engineCS);
+	LeaveCriticalSection(&cs);
+	return cmd;
+}
+
+ENGINECOMMAND EngineInterface::getOutQue(std::string& s)
+{
+	ENGINECOMMAND cmd;
+	EnterCriticalSection(&cs);
+	if (outQueCmd.size() > 0)
+	{
+		cmd = outQueCmd.front();
+		outQueCmd.pop_front();
+		if (outQueStr.size() > 0)
+		{
+			s = outQueStr.front();
+			outQueStr.pop_front();
+		}
+	}
+	else
+	{
+		cmd = ENG_none;
+	}
+	LeaveCriticalSection(&cs);
 	return cmd;
 }
 
 ENGINECOMMAND EngineInterface::peekInQue()
 {
 	ENGINECOMMAND cmd;
-	EnterCriticalSection(&engineCS);
+	EnterCriticalSection(&cs);
 	if (inQueCmd.size() > 0)
 		cmd = inQueCmd.front();
 	else
 		cmd = ENG_none;
-	LeaveCriticalSection(&engineCS);
+	LeaveCriticalSection(&cs);
 	return cmd;
 }
 
 ENGINECOMMAND EngineInterface::getInQue()
 {
 	ENGINECOMMAND cmd;
-	EnterCriticalSection(&engineCS);
+	EnterCriticalSection(&cs);
 	if (inQueCmd.size() > 0)
 	{
 		cmd = inQueCmd.front();
@@ -195,14 +225,14 @@ ENGINECOMMAND EngineInterface::getInQue()
 	{
 		cmd = ENG_none;
 	}
-	LeaveCriticalSection(&engineCS);
+	LeaveCriticalSection(&cs);
 	return cmd;
 }
 
 ENGINECOMMAND EngineInterface::getInQue(std::string& s)
 {
 	ENGINECOMMAND cmd;
-	EnterCriticalSection(&engineCS);
+	EnterCriticalSection(&cs);
 	if (inQueCmd.size() > 0)
 	{
 		cmd = inQueCmd.front();
@@ -217,7 +247,7 @@ ENGINECOMMAND EngineInterface::getInQue(std::string& s)
 	{
 		cmd = ENG_none;
 	}
-	LeaveCriticalSection(&engineCS);
+	LeaveCriticalSection(&cs);
 	return cmd;
 }
 
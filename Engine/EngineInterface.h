@@ -21,7 +21,14 @@ enum ENGINECOMMAND
 	ENG_debug,			// in|out
 	ENG_nodebug,		// out
 	ENG_eval,			// out
-	ENG_string			// in
+	ENG_string,			// in
+	ENG_evalfile,		// out
+	ENG_trainingfile,	// out
+	ENG_newgame,		// out
+	ENG_bench,			// out
+	ENG_tracefile,		// out
+	ENG_bookfile,		// out
+	ENG_learnfile		// out
 };
 
 enum ENGINEEVAL
@@ -34,7 +41,11 @@ enum ENGINEEVAL
 	EVAL_rook,
 	EVAL_queen,
 	EVAL_bishoppair,
-	EVAL_mobility
+	EVAL_mobility,
+	EVAL_traceply,
+	EVAL_ownbook,
+	EVAL_learnreadonly,
+	EVAL_learnsize
 };
 
 struct EngineEval
@@ -57,6 +68,7 @@ struct EngineGo
 
 class EngineInterface
 {
+	CRITICAL_SECTION cs;
 public:
 	HANDLE hEvent;
 	HANDLE hEngine;
@@ -67,6 +79,7 @@ public:
 	std::list<ChessBoard> outQueCb;
 	std::list<EngineGo> outQueGo;
 	std::list<EngineEval> outQueEvl;
+	std::list<std::string> outQueStr;
 	EngineInterface();
 	virtual ~EngineInterface();
 	void sendInQue(ENGINECOMMAND cmd);
@@ -75,6 +88,7 @@ public:
 	void sendOutQue(ENGINECOMMAND cmd);
 	void sendOutQue(ENGINECOMMAND cmd, const EngineGo& eg);
 	void sendOutQue(ENGINECOMMAND cmd, const EngineEval& e);
+	void sendOutQue(ENGINECOMMAND cmd, const std::string& s);
 	ENGINECOMMAND peekInQue();
 	ENGINECOMMAND getInQue();
 	ENGINECOMMAND getInQue(std::string& s);
@@ -83,4 +97,5 @@ public:
 	ENGINECOMMAND getOutQue(ChessBoard& cb);
 	ENGINECOMMAND getOutQue(EngineGo& cb);
 	ENGINECOMMAND getOutQue(EngineEval& e);
+	ENGINECOMMAND getOutQue(std::string& s);
 };
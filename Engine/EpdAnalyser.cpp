@@ -0,0 +1,189 @@
+#include <process.h>
+#include "EpdAnalyser.h"
+#include "../Common/Epd.h"
+#include "../Common/StopWatch.h"
+#include "../Common/Utility.h"
+
+using namespace std;
+
+const DWORD PROGRESS_INTERVAL = 2000; // ms
+
+void EpdAnalyseStats::clear()
+{
+	positions = skipped = done = nodes = 0;
+	seconds = 0;
+}
+
+EpdAnalyser::EpdAnalyser()
+{
+	threads = 0;
+	contempt = 0;
+	progress = NULL;
+	progressData = NULL;
+	stats.clear();
+	InitializeCriticalSection(&cs);
+}
+
+EpdAnalyser::~EpdAnalyser()
+{
+	DeleteCriticalSection(&cs);
+}
+
+bool EpdAnalyser::run(const std::string& infile, const std::string& outfile)
+{
+	vector<HANDLE> hThreads;
+	SYSTEM_INFO si;
+	StopWatch watch;
+	string line;
+	size_t i, count;
+
+	stats.clear();
+	error = "";
+	if (!limits.depth && !limits.nodes && !limits.moveTime)
+	{
+		error = "No depth, nodes or movetime given.";
+		return false;
+	}
+
+	ifstream in(infile);
+	if (!in.is_open())
+	{
+		error = "Unable to open: " + infile;
+		return false;
+	}
+	input.clear();
+	while (getline(in, line))
+	{
+		line = trim(line);
+		if (line.length())
+			input.push_back(line);
+	}
+	in.close();
+	stats.positions = input.size();
+
+	// Continue after the positions already written.
+	count = 0;
+	ifstream done(outfile);
+	while (done.is_open() && getline(done, line))
+	{
+		if (trim(line).length())
+			++count;
+	}
+	done.close();
+	stats.skipped = __min(count, input.size());
+
+	out.open(outfile, ios::app);
+	if (!out.is_open())
+	{
+		error = "Unable to open: " + outfile;
+		return false;
+	}
+
+	nextPosition = nextWrite = (size_t)stats.skipped;
+	result.assign(input.size(), string());
+	ready.assign(input.size(), false);
+
+	if (threads < 1)
+	{
+		GetSystemInfo(&si);
+		threads = si.dwNumberOfProcessors;
+	}
+	count = __min(__min((size_t)threads, (size_t)MAXIMUM_WAIT_OBJECTS), input.size() - nextPosition);
+
+	watch.start();
+	for (i = 0; i < count; i++)
+		hThreads.push_back((HANDLE)_beginthreadex(NULL, 0, worker, this, 0, NULL));
+	while (hThreads.size() && (WaitForMultipleObjects((DWORD)hThreads.size(), hThreads.data(), TRUE, PROGRESS_INTERVAL) == WAIT_TIMEOUT))
+	{
+		if (progress)
+		{
+			EnterCriticalSection(&cs);
+			stats.seconds = watch.read(WatchPrecision::Millisecond) / 1000.0;
+			progress(stats, progressData);
+			LeaveCriticalSection(&cs);
+		}
+	}
+	for (i = 0; i < hThreads.size(); i++)
+		CloseHandle(hThreads[i]);
+	stats.seconds = watch.read(WatchPrecision::Millisecond) / 1000.0;
+
+	out.close();
+	input.clear();
+	result.clear();
+	ready.clear();
+	if (out.fail())
+	{
+		error = "Unable to write: " + outfile;
+		return false;
+	}
+	return true;
+}
+
+unsigned __stdcall EpdAnalyser::worker(void* lpv)
+{
+	EpdAnalyser* ea = (EpdAnalyser*)lpv;
+	SearchSession session;
+	string line;
+	size_t i;
+
+	session.setContempt(ea->contempt);
+	if (ea->evalFile.length())
+		session.loadEvalFile(ea->evalFile);
+	while (1)
+	{
+		EnterCriticalSection(&ea->cs);
+		i = ea->nextPosition++;
+		LeaveCriticalSection(&ea->cs);
+		if (i >= ea->input.size())
+			break;
+		line = ea->analyse(session, ea->input[i]);
+		EnterCriticalSection(&ea->cs);
+		ea->result[i] = line;
+		ea->ready[i] = true;
+		++ea->stats.done;
+		ea->stats.nodes += session.nodes();
+		ea->write();
+		LeaveCriticalSection(&ea->cs);
+	}
+	return 0;
+}
+
+std::string EpdAnalyser::analyse(SearchSession& session, const std::string& line)
+{
+	Epd epd;
+	ChessBoard cb;
+	ChessMove m;
+	string pv;
+
+	epd.set(line);
+	cb.setFen(epd.getFen().c_str());
+	session.clearHistory();
+	session.setPosition(cb);
+	m = session.go(limits);
+	if (m.empty())
+		return epd.get();
+
+	const SearchInfo& info = session.lastInfo();
+	epd.ce = info.score;
+	epd.bce = true;
+	epd.acd = info.depth;
+	epd.acn = session.nodes();
+	if (!info.pv.size())
+		pv = cb.makeMoveText(m, SAN);
+	else
+		cb.makeMovesText(info.pv, pv, SAN);
+	epd.pv = pv;
+	return epd.get();
+}
+
+// Write the results that are next in order, called with cs entered.
+void EpdAnalyser::write()
+{
+	while ((nextWrite < ready.size()) && ready[nextWrite])
+	{
+		out << result[nextWrite] << '\n';
+		string().swap(result[nextWrite]);
+		++nextWrite;
+	}
+	out.flush();
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <Windows.h>
+#include <string>
+#include <vector>
+#include <fstream>
+#include "SearchSession.h"
+
+struct EpdAnalyseStats
+{
+	ULONGLONG positions; // In the input file
+	ULONGLONG skipped;   // Already in the output file
+	ULONGLONG done;
+	ULONGLONG nodes;
+	double seconds;
+	void clear();
+	double positionsPerSecond() const { return (seconds > 0) ? done / seconds : 0; };
+};
+
+// Analyse all positions in an epd file. The positions are searched at the
+// same time, one on each thread, and every thread has its own
+// SearchSession. The result is written as ce, acd, acn and pv in the same
+// order as the input. Positions already in the output file are skipped so
+// a stopped run can be continued.
+class EpdAnalyser
+{
+	std::vector<std::string> input;
+	std::vector<std::string> result;
+	std::vector<bool> ready;
+	size_t nextPosition; // Next to search
+	size_t nextWrite;
+	std::ofstream out;
+	CRITICAL_SECTION cs;
+	std::string error;
+	static unsigned __stdcall worker(void* lpv);
+	std::string analyse(SearchSession& session, const std::string& line);
+	void write();
+public:
+	SearchLimits limits;
+	// 0 is one thread for each processor
+	int threads;
+	int contempt;
+	std::string evalFile;
+	EpdAnalyseStats stats;
+	// Called every 2 seconds with progressData, from the thread calling run().
+	void(*progress)(const EpdAnalyseStats& stats, void* data);
+	void* progressData;
+	EpdAnalyser();
+	virtual ~EpdAnalyser();
+	bool run(const std::string& infile, const std::string& outfile);
+	inline const std::string& lastError() { return error; };
+};
@@ -21,84 +21,40 @@ Evaluation::Evaluation()
 	queenValue = 950;
 	bishopPair = 40;
 	mobilityScore = 2;
+	lazyCutoffs = 0;
+	fTerms[0] = NULL;
 }
 
 void Evaluation::setup(ChessBoard& cb)
 {
-	int i;
-	for (i = 0; i < MAX_EVAL; i++)
-	{
-		fMiddleGame[i] = NULL;
-		fEndGame[i] = NULL;
-		fPawnMiddleGame[i] = NULL;
-		fPawnEndGame[i] = NULL;
-	}
 	scanBoard(cb);
+}
 
-	if (bishopPair && ((bishoplist[WHITE].size > 1) || (bishoplist[BLACK].size > 1)))
-		addEval(&Evaluation::evalBishopPair, true, true);
-	if (mobilityScore)
-		addEval(&Evaluation::evalMobility, true, true);
+int Evaluation::evaluate(ChessBoard& cb, int alpha, int beta)
+{
+	return evaluateTerms<PositionalTerms>(cb, alpha, beta);
 }
 
-void Evaluation::addEval(evalFunction f, bool middle, bool end)
+// The terms with a weight, in the order of PositionalTerms.
+void Evaluation::setupDispatch()
 {
-	int i;
-	if (middle)
-	{
-		i = 0;
-		while (fMiddleGame[i])
-		{
-			if (i >= MAX_EVAL)
-				return;
-			++i;
-		}
-		fMiddleGame[i] = f;
-	}
-	if (end)
-	{
-		i = 0;
-		while (fEndGame[i])
-		{
-			if (i >= MAX_EVAL)
-				return;
-			++i;
-		}
-		fEndGame[i] = f;
-	}
+	int i = 0;
+	if (bishopPair)
+		fTerms[i++] = &Evaluation::evalBishopPair;
+	if (mobilityScore)
+		fTerms[i++] = &Evaluation::evalMobility;
+	fTerms[i] = NULL;
 }
 
-void Evaluation::addPawnEval(evalFunction f, bool middle, bool end)
+int Evaluation::evaluateDispatch(ChessBoard& cb, int alpha, int beta)
 {
-	int i;
-	if (middle)
-	{
-		i = 0;
-		while (fPawnMiddleGame[i])
-		{
-			if (i >= MAX_EVAL)
-				return;
-			++i;
-		}
-		fPawnMiddleGame[i] = f;
-	}
-	if (end)
-	{
-		i = 0;
-		while (fEndGame[i])
-		{
-			if (i >= MAX_EVAL)
-				return;
-			++i;
-		}
-		fPawnEndGame[i] = f;
-	}
+	return evaluateTerms<DispatchTerms>(cb, alpha, beta);
 }
 
-int Evaluation::evaluate(ChessBoard& cb, int alpha, int beta)
+template<typename Terms>
+int Evaluation::evaluateTerms(ChessBoard& cb, int alpha, int beta)
 {
-	int score,i;
-	evalFunction efunc;
+	int score;
 
 	if (cb.move50draw > 98)
 		return drawscore[cb.toMove];
@@ -124,12 +80,13 @@ int Evaluation::evaluate(ChessBoard& cb, int alpha, int beta)
 		// try a alphabeta cut
 		score = (cb.toMove == WHITE) ? (position[WHITE] - position[BLACK]) : (position[BLACK] - position[WHITE]);
 		if ((score < (alpha - 300)) || (score > (beta + 300)))
+		{
+			++lazyCutoffs;
 			return score;
+		}
 
 
-		i = 0;
-		while (efunc = fEndGame[i++])
-			(this->*efunc)(cb);
+		Terms::eval(*this, cb);
 
 		score = (cb.toMove == WHITE) ? (position[WHITE] - position[BLACK]) : (position[BLACK] - position[WHITE]);
 
@@ -153,11 +110,12 @@ int Evaluation::evaluate(ChessBoard& cb, int alpha, int beta)
 		// try a alphabeta cut
 		score = (cb.toMove == WHITE) ? (position[WHITE] - position[BLACK]) : (position[BLACK] - position[WHITE]);
 		if ((score < (alpha - 300)) || (score >(beta + 300)))
+		{
+			++lazyCutoffs;
 			return score;
+		}
 
-		i = 0;
-		while (efunc = fMiddleGame[i++])
-			(this->*efunc)(cb);
+		Terms::eval(*this, cb);
 		score = (cb.toMove == WHITE) ? (position[WHITE] - position[BLACK]) : (position[BLACK] - position[WHITE]);
 	}
 
@@ -1,11 +1,12 @@
 #pragma once
+#include <Windows.h>
 #include <assert.h>
 #include "../Common/ChessBoard.h"
 #include "../Common/defs.h"
 #include "../Common/MoveList.h"
 #include "../Common/MoveGenerator.h"
 
-const int MAX_EVAL = 100;
+const int MAX_EVAL = 8;
 class Evaluation;
 
 typedef void (Evaluation::* evalFunction) (ChessBoard&);
@@ -46,15 +47,18 @@ public:
 	int position[2]; // The score
 	int pawnscore[2];
 	int mobility[2];
-	evalFunction fMiddleGame[MAX_EVAL];
-	evalFunction fEndGame[MAX_EVAL];
-	evalFunction fPawnMiddleGame[MAX_EVAL];
-	evalFunction fPawnEndGame[MAX_EVAL];
+	// Evaluations that returned before the positional terms.
+	DWORD lazyCutoffs;
+	// The positional terms called through member function pointers, as
+	// before the term lists. Only used by evalbench to compare the two.
+	evalFunction fTerms[MAX_EVAL];
 	Evaluation();
 	void setup(ChessBoard& cb);
-	void addEval(evalFunction f, bool middle, bool end);
-	void addPawnEval(evalFunction f, bool middle, bool end);
 	int evaluate(ChessBoard& cb, int alpha, int beta);
+	// evaluate() with the terms in fTerms, filled by setupDispatch().
+	void setupDispatch();
+	int evaluateDispatch(ChessBoard& cb, int alpha, int beta);
+	template<typename Terms> int evaluateTerms(ChessBoard& cb, int alpha, int beta);
 	void scanBoard(ChessBoard& cb);
 	bool isDraw(ChessBoard& cb);
 	bool cantWin(ChessBoard& cb);
@@ -66,4 +70,53 @@ public:
 	void evalBishopPair(ChessBoard& cb);
 	void evalMobility(ChessBoard& cb);
 
-};
\ No newline at end of file
+};
+
+// Evaluation terms. Each term is a type with a static eval function, and the
+// terms for a game phase are listed in an EvalTerms type. The list is expanded
+// at compile time so the terms can be inlined in evaluate(). The weights are
+// still members of Evaluation and can be changed at runtime.
+struct BishopPairTerm
+{
+	static inline void eval(Evaluation& e, ChessBoard& cb)
+	{
+		if (e.bishopPair)
+			e.evalBishopPair(cb);
+	};
+};
+
+struct MobilityTerm
+{
+	static inline void eval(Evaluation& e, ChessBoard& cb)
+	{
+		if (e.mobilityScore)
+			e.evalMobility(cb);
+	};
+};
+
+template<typename... Terms>
+struct EvalTerms
+{
+	static inline void eval(Evaluation& e, ChessBoard& cb)
+	{
+		// Calls Terms::eval in the listed order.
+		int expand[] = { 0, (Terms::eval(e, cb), 0)... };
+		(void)expand;
+	};
+};
+
+// The terms after the lazy cutoff. Both game phases use the same terms, a
+// phase that needs other terms gets its own list.
+typedef EvalTerms<BishopPairTerm, MobilityTerm> PositionalTerms;
+
+// The terms in Evaluation::fTerms, one indirect call each.
+struct DispatchTerms
+{
+	static inline void eval(Evaluation& e, ChessBoard& cb)
+	{
+		evalFunction efunc;
+		int i = 0;
+		while ((i < MAX_EVAL) && (efunc = e.fTerms[i++]))
+			(e.*efunc)(cb);
+	};
+};
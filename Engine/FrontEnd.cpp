@@ -1,8 +1,17 @@
 #include <Windows.h>
+#include <intrin.h>
 #include <string>
 #include <fstream>
+#include <vector>
 #include "frontend.h"
 #include "engine.h"
+#include "Evaluation.h"
+#include "Nnue.h"
+#include "SearchTrace.h"
+#include "EpdAnalyser.h"
+#include "SearchSession.h"
+#include "../Common/PolyglotBook.h"
+#include "../Common/PolyglotBuilder.h"
 #include "../Common/Utility.h"
 #include "../Common/ChessBoard.h"
 #include "../Common/MoveList.h"
@@ -14,14 +23,24 @@ using namespace std;
 const char* ENGINENAME = "PolarChess 2.0 B6";
 
 // To calculate rating
-// Testmachine speed in MHz
-const DWORD testFrequence = 2100;
 // Full strength rating on test machine
 const DWORD testElo = 2000;
 // Rating difference when doubling speed
 const double halfSpeed = 100.0;
-// Nodes for a 1 sec. search (nps)
+// Nodes for a 1 sec. search (nps) on the test machine when testElo was set.
+// It is the speed of that engine version, the handcrafted evaluation
+// without EvalFile. The measured speed is compared with this, so a slower
+// engine version or a network gives a lower max Elo.
 const DWORD testNodes = 140000;
+// Nodes searched in each position when the speed is measured.
+const DWORD speedNodes = 40000;
+// Positions used to measure the speed.
+static const char* speedPositions[] = {
+	"rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+	"r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+	"r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+	"8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1"
+};
 
 FrontEnd::FrontEnd()
 {
@@ -31,6 +50,8 @@ FrontEnd::FrontEnd()
 	currentElo = maxElo;
 	minElo = 600;
 	limitStrength = false;
+	measuredNps = testNodes;
+	speedChanged = true;
 	contempt = 0;
 	currentBoard.setStartposition();
 }
@@ -54,7 +75,7 @@ int FrontEnd::run()
 	engine.sendOutQue(ENG_debug);
 #endif
 
-	findMaxElo();
+	updateSpeed();
 	currentElo = maxElo;
 	readIniFiles();
 
@@ -134,6 +155,24 @@ int FrontEnd::uciInput()
 		case UCI_movegen:
 			uciMovegen(input);
 			break;
+		case UCI_evalbench:
+			uciEvalbench(input);
+			break;
+		case UCI_bench:
+			uciBench(input);
+			break;
+		case UCI_speed:
+			uciSpeed(input);
+			break;
+		case UCI_tracereport:
+			uciTracereport(input);
+			break;
+		case UCI_makebook:
+			uciMakebook(input);
+			break;
+		case UCI_analyse:
+			uciAnalyse(input);
+			break;
 		case UCI_readfile:
 			uciReadFile(input);
 			break;
@@ -194,6 +233,15 @@ void FrontEnd::uciUci()
 	uci.write(s);
 	sprintf_s(sz, 256, "option name UCI_Elo type spin default %u min %u max %u", currentElo, minElo, maxElo);
 	uci.write(sz);
+	uci.write("option name EvalFile type string default <empty>");
+	uci.write("option name TrainingFile type string default <empty>");
+	uci.write("option name TraceFile type string default <empty>");
+	uci.write("option name TracePly type spin default 3 min 0 max 99");
+	uci.write("option name OwnBook type check default false");
+	uci.write("option name BookFile type string default <empty>");
+	uci.write("option name LearnSize type spin default 16 min 1 max 1024");
+	uci.write("option name LearnReadOnly type check default false");
+	uci.write("option name LearnFile type string default <empty>");
 
 	uci.write("uciok");
 }
@@ -229,6 +277,13 @@ void FrontEnd::uciDebug(const std::string& s)
 */
 void FrontEnd::uciIsready()
 {
+	if (speedChanged)
+	{
+		updateSpeed();
+		if (currentElo > maxElo)
+			currentElo = maxElo;
+	}
+	sendSpeed();
 	uci.write("readyok");
 }
 
@@ -306,14 +361,54 @@ void FrontEnd::uciSetoption(const std::string& s)
 			engine.sendOutQue(ENG_eval, ev);
 		}
 	}
-	else if ("UCI_LimitStrength")
+	else if (name == "EvalFile")
+	{
+		evalFile = (value == "<empty>") ? "" : value;
+		engine.sendOutQue(ENG_evalfile, evalFile);
+		speedChanged = true;
+	}
+	else if (name == "TrainingFile")
+	{
+		engine.sendOutQue(ENG_trainingfile, (value == "<empty>") ? string("") : value);
+	}
+	else if (name == "TraceFile")
+	{
+		engine.sendOutQue(ENG_tracefile, (value == "<empty>") ? string("") : value);
+	}
+	else if (name == "OwnBook")
+	{
+		engine.sendOutQue(ENG_eval, EngineEval(EVAL_ownbook, booleanString(value) ? 1 : 0));
+	}
+	else if (name == "BookFile")
+	{
+		if ((value != "<empty>") && !Polyglot::haveKeys())
+			uci.write("info string The Polyglot keys failed the self test.");
+		engine.sendOutQue(ENG_bookfile, (value == "<empty>") ? string("") : value);
+	}
+	else if (name == "LearnSize")
+	{
+		engine.sendOutQue(ENG_eval, EngineEval(EVAL_learnsize, atoi(value.c_str())));
+	}
+	else if (name == "LearnReadOnly")
+	{
+		engine.sendOutQue(ENG_eval, EngineEval(EVAL_learnreadonly, booleanString(value) ? 1 : 0));
+	}
+	else if (name == "LearnFile")
+	{
+		engine.sendOutQue(ENG_learnfile, (value == "<empty>") ? string("") : value);
+	}
+	else if (name == "TracePly")
+	{
+		engine.sendOutQue(ENG_eval, EngineEval(EVAL_traceply, atoi(value.c_str())));
+	}
+	else if (name == "UCI_LimitStrength")
 	{
 		limitStrength = booleanString(value);
 //		if (limitStrength)
 //			engine.sendOutQue(ENG_eval, EngineEval(EVAL_strength, calculateStrength(currentElo)));
 
 	}
-	else if ("UCI_Elo")
+	else if (name == "UCI_Elo")
 	{
 		currentElo = atoi(value.c_str());
 //		if (limitStrength)
@@ -361,6 +456,7 @@ void FrontEnd::uciUcinewgame()
 	currentBoard.setFen("rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1");
 	engine.sendOutQue(ENG_clearhistory);
 	engine.sendOutQue(ENG_clearhash);
+	engine.sendOutQue(ENG_newgame);
 }
 
 /* position [fen <fenstring> | startpos ]  moves <move1> .... <movei>
@@ -646,6 +742,268 @@ void FrontEnd::uciMovegen(const std::string& s)
 	uci.write(string(sz));
 }
 
+/* evalbench <file> [loops]
+*
+* Time the evaluation on all positions in an epd/fen file, with the
+* compile-time term lists and with the function pointer calls they replaced.
+* If EvalFile is set the network is timed too (with a full accumulator
+* refresh for every position) and compared with the classical evaluation.
+*/
+void FrontEnd::uciEvalbench(const std::string& s)
+{
+	string filename, line, fen;
+	vector<ChessBoard> positions;
+	ChessBoard cb;
+	Evaluation ev;
+	StopWatch st;
+	ULONGLONG t;
+	size_t i;
+	int loop, loops, score;
+	char sz[256];
+
+	filename = getWord(s, 1);
+	loops = atoi(getWord(s, 2).c_str());
+	if (loops < 1)
+		loops = 10;
+	ifstream file(filename);
+	if (!file.is_open())
+	{
+		uci.write("info string Unable to open file: " + filename);
+		return;
+	}
+	while (getline(file, line))
+	{
+		line = trim(line);
+		if (!line.length() || (line.at(0) == ';'))
+			continue;
+		// Only the position part of the line, epd opcodes are skipped.
+		fen = getWord(line, 1) + " " + getWord(line, 2) + " " + getWord(line, 3) + " " + getWord(line, 4);
+		cb.setFen(fen.c_str());
+		positions.push_back(cb);
+	}
+	file.close();
+	if (!positions.size())
+	{
+		uci.write("info string No positions in file: " + filename);
+		return;
+	}
+
+	score = 0;
+	st.start();
+	for (loop = 0; loop < loops; loop++)
+		for (i = 0; i < positions.size(); i++)
+			score += ev.evaluate(positions[i], -MATE, MATE);
+	t = st.read(WatchPrecision::Microsecond);
+	sprintf_s(sz, 256, "info string %u positions, %llu evals in %llu ms, %.1f ns/eval (checksum %i)", (DWORD)positions.size(), (ULONGLONG)positions.size()*loops, t / 1000, (t * 1000.0) / ((double)positions.size()*loops), score);
+	uci.write(string(sz));
+
+	ev.setupDispatch();
+	score = 0;
+	st.start();
+	for (loop = 0; loop < loops; loop++)
+		for (i = 0; i < positions.size(); i++)
+			score += ev.evaluateDispatch(positions[i], -MATE, MATE);
+	t = st.read(WatchPrecision::Microsecond);
+	sprintf_s(sz, 256, "info string function pointers %llu evals in %llu ms, %.1f ns/eval (checksum %i)", (ULONGLONG)positions.size()*loops, t / 1000, (t * 1000.0) / ((double)positions.size()*loops), score);
+	uci.write(string(sz));
+
+	if (!evalFile.length())
+		return;
+
+	string error;
+	Nnue* net = new Nnue();
+	if (!net->load(evalFile, error))
+	{
+		uci.write("info string " + error);
+		delete net;
+		return;
+	}
+
+	score = 0;
+	st.start();
+	for (loop = 0; loop < loops; loop++)
+	{
+		for (i = 0; i < positions.size(); i++)
+		{
+			net->setup(positions[i]);
+			score += net->evaluate(positions[i]);
+		}
+	}
+	t = st.read(WatchPrecision::Microsecond);
+	sprintf_s(sz, 256, "info string nnue (simd %i) %llu evals in %llu ms, %.1f ns/eval (checksum %i)", net->simd, (ULONGLONG)positions.size()*loops, t / 1000, (t * 1000.0) / ((double)positions.size()*loops), score);
+	uci.write(string(sz));
+
+	// Accuracy against the classical evaluation
+	double difference = 0;
+	int sameSign = 0, classical, nnue;
+	for (i = 0; i < positions.size(); i++)
+	{
+		classical = ev.evaluate(positions[i], -MATE, MATE);
+		net->setup(positions[i]);
+		nnue = net->evaluate(positions[i]);
+		difference += abs(nnue - classical);
+		if ((nnue > 0) == (classical > 0))
+			++sameSign;
+	}
+	sprintf_s(sz, 256, "info string nnue vs classical: mean difference %.1f cp, same sign %.1f%%", difference / positions.size(), (100.0*sameSign) / positions.size());
+	uci.write(string(sz));
+	delete net;
+}
+
+/* bench [depth]
+*
+* Search a fixed set of positions to the given depth (default 5). The result
+* with the search statistics is sent as one line of json.
+*/
+void FrontEnd::uciBench(const std::string& s)
+{
+	EngineGo eg;
+	eg.fixedTime = 0;
+	eg.maxTime = 0;
+	eg.nodes = 0;
+	eg.mate = 0;
+	eg.depth = atoi(getWord(s, 1).c_str());
+	engine.sendOutQue(ENG_bench, eg);
+}
+
+/* speed
+*
+* Measure the speed again and send it with the highest Elo. The speed is
+* saved for this computer and the current EvalFile.
+*/
+void FrontEnd::uciSpeed(const std::string& s)
+{
+	measureSpeed();
+	writeSpeed();
+	findMaxElo();
+	if (currentElo > maxElo)
+		currentElo = maxElo;
+	sendSpeed();
+}
+
+void FrontEnd::sendSpeed()
+{
+	char sz[256];
+	sprintf_s(sz, 256, "info string Speed %u nps (test machine %u nps), max Elo %u", measuredNps, testNodes, maxElo);
+	uci.write(sz);
+}
+
+/* tracereport <file> [lines]
+*
+* Summary of a search trace written with the TraceFile option.
+*/
+void FrontEnd::uciTracereport(const std::string& s)
+{
+	list<string> lines;
+	list<string>::iterator it;
+	int top = atoi(getWord(s, 2).c_str());
+	SearchTrace::report(getWord(s, 1), lines, (top > 0) ? top : 10);
+	for (it = lines.begin(); it != lines.end(); it++)
+		uci.write("info string " + *it);
+}
+
+static void makebookProgress(const PolyglotBuildStats& stats, void* data)
+{
+	char sz[256];
+	sprintf_s(sz, 256, "info string %llu games, %llu moves, %.0f games/s", stats.games, stats.moves, stats.games / __max(stats.seconds, 0.001));
+	((FrontEnd*)data)->uci.write(sz);
+}
+
+/* makebook <pgnfile> <bookfile> [plies] [mingames] [minscore] [minelo]
+*
+* Make a Polyglot book from the games in a pgn file. Defaults: 30 plies,
+* 1 game, 0% score and no rating limit.
+*/
+void FrontEnd::uciMakebook(const std::string& s)
+{
+	PolyglotBuilder builder;
+	char sz[256];
+	string pgnfile = getWord(s, 1);
+	string bookfile = getWord(s, 2);
+	string w;
+
+	if (!pgnfile.length() || !bookfile.length())
+	{
+		uci.write("info string makebook <pgnfile> <bookfile> [plies] [mingames] [minscore] [minelo]");
+		return;
+	}
+	if ((w = getWord(s, 3)).length())
+		builder.maxPly = atoi(w.c_str());
+	if ((w = getWord(s, 4)).length())
+		builder.minGames = atoi(w.c_str());
+	if ((w = getWord(s, 5)).length())
+		builder.minScore = atoi(w.c_str());
+	if ((w = getWord(s, 6)).length())
+		builder.minElo = atoi(w.c_str());
+	builder.progress = makebookProgress;
+	builder.progressData = this;
+
+	if (!builder.build(pgnfile, bookfile))
+	{
+		uci.write("info string " + builder.lastError());
+		return;
+	}
+	sprintf_s(sz, 256, "info string %llu games (%llu skipped), %llu moves, %llu runs, %llu book entries, %.1f s, %.0f games/s",
+		builder.stats.games, builder.stats.skipped, builder.stats.moves, builder.stats.runs, builder.stats.entries, builder.stats.seconds, builder.stats.gamesPerSecond());
+	uci.write(sz);
+}
+
+static void analyseProgress(const EpdAnalyseStats& stats, void* data)
+{
+	char sz[256];
+	sprintf_s(sz, 256, "info string %llu/%llu positions, %.1f positions/s", stats.skipped + stats.done, stats.positions, stats.positionsPerSecond());
+	((FrontEnd*)data)->uci.write(sz);
+}
+
+/* analyse file <epdfile> out <epdfile> depth|nodes|movetime <n> [threads <n>]
+*
+* Search all positions in an epd file and write them with ce, acd, acn and
+* pv to the out file. The positions are searched in parallel, by default
+* one for each processor. If the out file exists the positions in it are
+* skipped.
+*/
+void FrontEnd::uciAnalyse(const std::string& s)
+{
+	EpdAnalyser analyser;
+	char sz[256];
+	string infile, outfile, w;
+	int i = 1;
+
+	while ((w = getWord(s, i++)).length())
+	{
+		if (w == "file")
+			infile = getWord(s, i++);
+		else if (w == "out")
+			outfile = getWord(s, i++);
+		else if (w == "depth")
+			analyser.limits.depth = atoi(getWord(s, i++).c_str());
+		else if (w == "nodes")
+			analyser.limits.nodes = atoi(getWord(s, i++).c_str());
+		else if (w == "movetime")
+			analyser.limits.moveTime = atoi(getWord(s, i++).c_str());
+		else if (w == "threads")
+			analyser.threads = atoi(getWord(s, i++).c_str());
+	}
+	if (!infile.length() || !outfile.length())
+	{
+		uci.write("info string analyse file <epdfile> out <epdfile> depth|nodes|movetime <n> [threads <n>]");
+		return;
+	}
+	analyser.contempt = contempt;
+	analyser.evalFile = evalFile;
+	analyser.progress = analyseProgress;
+	analyser.progressData = this;
+
+	if (!analyser.run(infile, outfile))
+	{
+		uci.write("info string " + analyser.lastError());
+		return;
+	}
+	sprintf_s(sz, 256, "info string %llu positions (%llu skipped), %llu searched, %llu nodes, %.1f s, %.1f positions/s",
+		analyser.stats.positions, analyser.stats.skipped, analyser.stats.done, analyser.stats.nodes, analyser.stats.seconds, analyser.stats.positionsPerSecond());
+	uci.write(sz);
+}
+
 void FrontEnd::engineInput()
 {
 	int engCmd;
@@ -720,24 +1078,104 @@ bool FrontEnd::isMoveText(const std::string& input)
 	return true;
 }
 
-void FrontEnd::findMaxElo()
+// Use the speed saved for this computer and the current EvalFile, it is
+// only measured when there is none.
+void FrontEnd::updateSpeed()
 {
-	LARGE_INTEGER pf;
-	if (!QueryPerformanceFrequency(&pf))
-		return;
-	freqMz = pf.QuadPart / 1000;
-	double fact = (double)freqMz / testFrequence;
+	if (!readSpeed())
+	{
+		measureSpeed();
+		writeSpeed();
+	}
+	speedChanged = false;
+	findMaxElo();
+}
 
+// Search a few positions with a fixed number of nodes in a separate engine
+// to find the real speed (nps) of this computer with the current EvalFile.
+void FrontEnd::measureSpeed()
+{
+	SearchSession session;
+	SearchLimits limits;
+	ChessBoard cb;
+	StopWatch watch;
+	ULONGLONG nodes = 0;
+	ULONGLONG t;
+	const int positions = sizeof(speedPositions) / sizeof(speedPositions[0]);
+	int i;
 
-	int elodiff=(int)(halfSpeed*log(1 / fact) / log(2));
-	maxElo = testElo-elodiff;
-	// Test machine
+	if (evalFile.length())
+		session.loadEvalFile(evalFile);
+	limits.nodes = speedNodes;
+	watch.start();
+	for (i = 0; i < positions; i++)
+	{
+		cb.setFen(speedPositions[i]);
+		session.setPosition(cb);
+		session.go(limits);
+		nodes += session.nodes();
+	}
+	t = watch.read(WatchPrecision::Microsecond);
+	if (t && nodes)
+		measuredNps = (DWORD)(nodes * 1000000 / t);
+}
 
-#ifdef _DEBUG
-	char sz[256];
-	sprintf_s(sz, 256, "info string test fq: %u, this fq: %llu", testFrequence, freqMz);
-	uci.write(sz);
-#endif
+// The speed is saved in PolarChess.ini in the program folder, in a section
+// for this engine version with the cpu and the EvalFile as key. A folder
+// copied to another computer then measures its own speed.
+const string FrontEnd::speedKey()
+{
+	int info[4];
+	char brand[49];
+	char sz[16];
+	SYSTEM_INFO si;
+	string key;
+	int i;
+
+	memset(brand, 0, sizeof(brand));
+	__cpuid(info, 0x80000000);
+	if ((unsigned)info[0] >= 0x80000004)
+	{
+		for (i = 0; i < 3; i++)
+			__cpuid((int*)(brand + i * 16), 0x80000002 + i);
+	}
+	key = brand;
+	key.erase(0, key.find_first_not_of(' '));
+	GetSystemInfo(&si);
+	sprintf_s(sz, 16, " x%u", si.dwNumberOfProcessors);
+	key += sz;
+	key += " ";
+	key += evalFile.length() ? evalFile : "<empty>";
+	return key;
+}
+
+bool FrontEnd::readSpeed()
+{
+	string ini = getProgramPath() + "PolarChess.ini";
+	string key = speedKey();
+	UINT nps = GetPrivateProfileInt(ENGINENAME, key.c_str(), 0, ini.c_str());
+	if (!nps)
+		return false;
+	measuredNps = nps;
+	return true;
+}
+
+// If the folder is read only the speed is measured at each start.
+void FrontEnd::writeSpeed()
+{
+	char sz[16];
+	string ini = getProgramPath() + "PolarChess.ini";
+	string key = speedKey();
+	sprintf_s(sz, 16, "%u", measuredNps);
+	WritePrivateProfileString(ENGINENAME, key.c_str(), sz, ini.c_str());
+}
+
+void FrontEnd::findMaxElo()
+{
+	double fact = (double)measuredNps / testNodes;
+	int elodiff=(int)(halfSpeed*log(1 / fact) / log(2));
+	int elo = (int)testElo - elodiff;
+	maxElo = (elo < (int)minElo) ? minElo : elo;
 }  
 
 void FrontEnd::uciReadFile(const std::string& filename)
@@ -885,7 +1323,7 @@ DWORD FrontEnd::calculateStrength(int elo, int tm)
 		return 0;
 	double f1 = diff / halfSpeed;
 	double f2 = 1 / (pow(2,f1));
-	dnodes = testNodes * (double)(freqMz / testFrequence);
+	dnodes = measuredNps;
 	nodes = (DWORD)(f2*dnodes*tm/1000);
 #ifdef _DEBUG
 	char sz[256];
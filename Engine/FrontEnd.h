@@ -9,7 +9,10 @@
 class FrontEnd
 {
 	DWORD movegenTest(int depth, bool init = true, int ply = 0);
-	LONGLONG freqMz;
+	// Measured speed of this computer, used for the strength limit.
+	DWORD measuredNps;
+	// The speed must be measured again (EvalFile changed).
+	bool speedChanged;
 public:
 	std::list<std::string> personalities;
 	DWORD maxElo;
@@ -17,6 +20,7 @@ public:
 	DWORD minElo;
 	bool limitStrength;
 	int contempt;
+	std::string evalFile;
 	ChessBoard currentBoard;
 	Uci uci;
 	EngineInterface engine;
@@ -37,7 +41,19 @@ public:
 	void uciStop();
 	void uciPonderhit();
 	void uciMovegen(const std::string& s);
+	void uciEvalbench(const std::string& s);
+	void uciBench(const std::string& s);
+	void uciTracereport(const std::string& s);
+	void uciMakebook(const std::string& s);
+	void uciAnalyse(const std::string& s);
 	bool isMoveText(const std::string& input);
+	void uciSpeed(const std::string& s);
+	void updateSpeed();
+	void measureSpeed();
+	bool readSpeed();
+	void writeSpeed();
+	const std::string speedKey();
+	void sendSpeed();
 	void findMaxElo();
 	void uciReadFile(const std::string& s);
 	void uciEval(const std::string& s);
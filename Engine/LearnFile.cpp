@@ -0,0 +1,171 @@
+#include <string.h>
+#include "LearnFile.h"
+
+LearnFile::LearnFile()
+{
+	hFile = NULL;
+	hMap = NULL;
+	header = NULL;
+	entries = NULL;
+	age = 0;
+	readOnly = false;
+	createMB = 0;
+}
+
+LearnFile::~LearnFile()
+{
+	close();
+}
+
+bool LearnFile::open(const std::string& filename, DWORD sizeMB)
+{
+	LearnHeader h;
+	DWORD count, size, read;
+	bool create;
+
+	close();
+	if (readOnly)
+		hFile = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE, NULL, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, NULL);
+	else
+		hFile = CreateFileA(filename.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL, OPEN_ALWAYS, FILE_FLAG_RANDOM_ACCESS, NULL);
+	if (hFile == INVALID_HANDLE_VALUE)
+	{
+		hFile = NULL;
+		return false;
+	}
+
+	// Use the size from an existing file.
+	create = true;
+	if (ReadFile(hFile, &h, sizeof(h), &read, NULL) && (read == sizeof(h)))
+	{
+		if ((memcmp(h.magic, "PCLF", 4) != 0) || (h.version != LEARN_VERSION) || !h.entries || (h.entries%LEARN_BUCKET))
+		{
+			close();
+			return false;
+		}
+		count = h.entries;
+		create = false;
+	}
+	else if (readOnly)
+	{
+		close();
+		return false;
+	}
+	else
+	{
+		count = (__max(sizeMB, 1) * 1024 * 1024 / sizeof(LearnEntry)) & ~(LEARN_BUCKET - 1);
+	}
+	size = sizeof(LearnHeader) + count*sizeof(LearnEntry);
+
+	// A read only mapping fails if the file is shorter than the size.
+	hMap = CreateFileMappingA(hFile, NULL, readOnly ? PAGE_READONLY : PAGE_READWRITE, 0, size, NULL);
+	if (hMap == NULL)
+	{
+		close();
+		return false;
+	}
+	header = (LearnHeader*)MapViewOfFile(hMap, readOnly ? FILE_MAP_READ : FILE_MAP_WRITE, 0, 0, size);
+	if (header == NULL)
+	{
+		close();
+		return false;
+	}
+	entries = (LearnEntry*)(header + 1);
+	if (create)
+	{
+		memset(entries, 0, count*sizeof(LearnEntry));
+		memcpy(header->magic, "PCLF", 4);
+		header->version = LEARN_VERSION;
+		header->entries = count;
+		header->age = 0;
+	}
+	if (readOnly)
+		age = (unsigned char)header->age;
+	else
+		age = (unsigned char)++header->age;
+	name = filename;
+	createMB = sizeMB;
+	return true;
+}
+
+bool LearnFile::setReadOnly(bool ro)
+{
+	if (ro == readOnly)
+		return true;
+	readOnly = ro;
+	if (!isOpen())
+		return true;
+	return open(name, createMB);
+}
+
+void LearnFile::close()
+{
+	if (header)
+		UnmapViewOfFile(header);
+	if (hMap)
+		CloseHandle(hMap);
+	if (hFile)
+		CloseHandle(hFile);
+	header = NULL;
+	entries = NULL;
+	hMap = NULL;
+	hFile = NULL;
+}
+
+bool LearnFile::probe(HASHKEY key, LearnEntry& entry)
+{
+	DWORD i;
+	LearnEntry* b;
+	if (!header)
+		return false;
+	b = bucket(key);
+	for (i = 0; i < LEARN_BUCKET; i++)
+	{
+		if (b[i].depth && (b[i].key == key))
+		{
+			entry = b[i];
+			return true;
+		}
+	}
+	return false;
+}
+
+void LearnFile::store(HASHKEY key, int depth, int score, const ChessMove& move)
+{
+	DWORD i;
+	LearnEntry* b;
+	LearnEntry* replace;
+	int value, lowest;
+
+	if (!header || readOnly || (depth < LEARN_MINDEPTH))
+		return;
+	b = bucket(key);
+	replace = b;
+	lowest = 0x7fffffff;
+	for (i = 0; i < LEARN_BUCKET; i++)
+	{
+		if (b[i].depth && (b[i].key == key))
+		{
+			// Keep the deepest result for a position.
+			if (b[i].depth > depth)
+				return;
+			replace = &b[i];
+			break;
+		}
+		// Empty, then older sessions, then lowest depth.
+		value = b[i].depth + ((b[i].age == age) ? 256 : 0);
+		if (value < lowest)
+		{
+			lowest = value;
+			replace = &b[i];
+		}
+	}
+	replace->key = key;
+	replace->depth = (unsigned char)__min(depth, 255);
+	replace->score = (short)score;
+	replace->age = age;
+	replace->fromSquare = (unsigned char)move.fromSquare;
+	replace->toSquare = (unsigned char)move.toSquare;
+	replace->promotePiece = (unsigned char)move.promotePiece;
+	replace->reserved = 0;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <Windows.h>
+#include <string>
+#include "../Common/ChessMove.h"
+#include "../Common/defs.h"
+
+const DWORD LEARN_VERSION = 1;
+// Entries in a bucket, a position can be in any of them.
+const DWORD LEARN_BUCKET = 4;
+// Lowest depth saved.
+const int LEARN_MINDEPTH = 5;
+
+struct LearnEntry
+{
+	HASHKEY key;
+	short score;
+	unsigned char depth;
+	unsigned char age;
+	unsigned char fromSquare;
+	unsigned char toSquare;
+	unsigned char promotePiece;
+	unsigned char reserved;
+};
+
+struct LearnHeader
+{
+	char magic[4];
+	DWORD version;
+	DWORD entries;
+	// Increased each time the file is opened for writing.
+	DWORD age;
+};
+
+// Search results kept between sessions in a memory mapped file. The size
+// is fixed when the file is created. When a bucket is full the entry from
+// an older session or with the lowest depth is replaced.
+// A read only file is opened without write access and can be shared with
+// other engines, the file must exist.
+class LearnFile
+{
+	HANDLE hFile;
+	HANDLE hMap;
+	LearnHeader* header;
+	LearnEntry* entries;
+	unsigned char age;
+	bool readOnly;
+	std::string name;
+	DWORD createMB;
+	inline LearnEntry* bucket(HASHKEY key) { return entries + (key % (header->entries / LEARN_BUCKET)) * LEARN_BUCKET; };
+public:
+	LearnFile();
+	virtual ~LearnFile();
+	// A new file is made with the size in MB, an existing file keeps its size.
+	bool open(const std::string& filename, DWORD sizeMB);
+	void close();
+	// An open file is opened again in the new mode.
+	bool setReadOnly(bool ro);
+	inline bool isReadOnly() { return readOnly; };
+	inline bool isOpen() { return header != NULL; };
+	inline DWORD size() { return header ? header->entries : 0; };
+	bool probe(HASHKEY key, LearnEntry& entry);
+	void store(HASHKEY key, int depth, int score, const ChessMove& move);
+};
@@ -0,0 +1,431 @@
+#include <intrin.h>
+#include <immintrin.h>
+#include <fstream>
+#include <string.h>
+#include <assert.h>
+#include "Nnue.h"
+
+using namespace std;
+
+// The accumulator is clipped to 0..127 before the dense layers.
+const int CLIP_MAX = 127;
+// Shift after the hidden dense layers.
+const int LAYER_SHIFT = 6;
+// Output divisor to get centipawns.
+const int OUTPUT_SCALE = 16;
+
+const std::string Nnue::noFile;
+
+// The networks that are in use, see load().
+static vector<weak_ptr<const NnueWeights>> networks;
+
+static CRITICAL_SECTION* networksLock()
+{
+	static CRITICAL_SECTION cs;
+	static bool init = (InitializeCriticalSection(&cs), true);
+	return &cs;
+}
+
+static ULONGLONG writeTime(const string& file)
+{
+	WIN32_FILE_ATTRIBUTE_DATA fad;
+	if (!GetFileAttributesExA(file.c_str(), GetFileExInfoStandard, &fad))
+		return 0;
+	return ((ULONGLONG)fad.ftLastWriteTime.dwHighDateTime << 32) | fad.ftLastWriteTime.dwLowDateTime;
+}
+
+Nnue::Nnue()
+{
+	ply = 0;
+	simd = detectSimd();
+}
+
+Nnue::~Nnue()
+{
+}
+
+// Find the best instruction set supported by both cpu and os.
+NNUE_SIMD Nnue::detectSimd()
+{
+	int info[4];
+	bool osAvx = false;
+
+	__cpuid(info, 0);
+	if (info[0] < 1)
+		return SIMD_NONE;
+	__cpuid(info, 1);
+	// OSXSAVE and AVX, then check that the os saves the ymm registers.
+	if ((info[2] & (1 << 27)) && (info[2] & (1 << 28)))
+		osAvx = ((_xgetbv(0) & 0x06) == 0x06);
+	bool sse41 = (info[2] & (1 << 19)) != 0;
+	if (osAvx)
+	{
+		__cpuid(info, 0);
+		if (info[0] >= 7)
+		{
+			__cpuidex(info, 7, 0);
+			if (info[1] & (1 << 5))
+				return SIMD_AVX2;
+		}
+	}
+	if (sse41)
+		return SIMD_SSE41;
+	return SIMD_NONE;
+}
+
+template<typename T>
+static bool readValues(ifstream& file, vector<T>& v, size_t count)
+{
+	v.resize(count);
+	file.read((char*)v.data(), count*sizeof(T));
+	return file.good();
+}
+
+bool Nnue::load(const std::string& file, std::string& error)
+{
+	char magic[4];
+	unsigned int header[5];
+	ULONGLONG time = writeTime(file);
+	shared_ptr<const NnueWeights> found;
+	size_t i;
+
+	// Use the weights of another engine if it has the same file.
+	EnterCriticalSection(networksLock());
+	for (i = 0; i < networks.size();)
+	{
+		shared_ptr<const NnueWeights> w = networks[i].lock();
+		if (!w)
+		{
+			networks.erase(networks.begin() + i);
+			continue;
+		}
+		if ((w->filename == file) && (w->writeTime == time))
+			found = w;
+		++i;
+	}
+	LeaveCriticalSection(networksLock());
+	if (found)
+	{
+		net = found;
+		return true;
+	}
+
+	shared_ptr<NnueWeights> w = make_shared<NnueWeights>();
+	ifstream f(file, ios::binary);
+	if (!f.is_open())
+	{
+		error = "Unable to open file: " + file;
+		return false;
+	}
+	f.read(magic, 4);
+	f.read((char*)header, sizeof(header));
+	if (!f.good() || (memcmp(magic, "PCNN", 4) != 0))
+	{
+		error = "Not a network file: " + file;
+		return false;
+	}
+	if ((header[0] != NNUE_VERSION) || (header[1] != NNUE_INPUTS) || (header[2] != NNUE_HIDDEN) || (header[3] != NNUE_L1) || (header[4] != NNUE_L2))
+	{
+		error = "Wrong network version or size: " + file;
+		return false;
+	}
+	if (!readValues(f, w->ftBias, NNUE_HIDDEN) ||
+		!readValues(f, w->ftWeight, (size_t)NNUE_INPUTS*NNUE_HIDDEN) ||
+		!readValues(f, w->l1Bias, NNUE_L1) ||
+		!readValues(f, w->l1Weight, 2 * NNUE_HIDDEN*NNUE_L1) ||
+		!readValues(f, w->l2Bias, NNUE_L2) ||
+		!readValues(f, w->l2Weight, NNUE_L1*NNUE_L2))
+	{
+		error = "Network file is truncated: " + file;
+		return false;
+	}
+	f.read((char*)&w->outBias, sizeof(int));
+	if (!readValues(f, w->outWeight, NNUE_L2))
+	{
+		error = "Network file is truncated: " + file;
+		return false;
+	}
+	w->filename = file;
+	w->writeTime = time;
+
+	EnterCriticalSection(networksLock());
+	networks.push_back(w);
+	LeaveCriticalSection(networksLock());
+	net = w;
+	return true;
+}
+
+void Nnue::unload()
+{
+	net.reset();
+}
+
+int Nnue::featureIndex(typeColor side, typeSquare ksq, typePiece piece, typeSquare sq)
+{
+	int p = PIECE(piece) - 1;
+	if (PIECECOLOR(piece) != side)
+		p += 5;
+	ksq = SQUARE64(ksq);
+	sq = SQUARE64(sq);
+	if (side == BLACK)
+	{
+		ksq ^= 56;
+		sq ^= 56;
+	}
+	return (ksq*NNUE_PIECES + p) * 64 + sq;
+}
+
+void Nnue::addFeature(NnueAccumulator& a, typeColor side, int index)
+{
+	short* v = a.value[side];
+	const short* w = &net->ftWeight[(size_t)index*NNUE_HIDDEN];
+	int i;
+	switch (simd)
+	{
+	case SIMD_AVX2:
+		for (i = 0; i < NNUE_HIDDEN; i += 16)
+			_mm256_storeu_si256((__m256i*)(v + i), _mm256_add_epi16(_mm256_loadu_si256((const __m256i*)(v + i)), _mm256_loadu_si256((const __m256i*)(w + i))));
+		break;
+	case SIMD_SSE41:
+		for (i = 0; i < NNUE_HIDDEN; i += 8)
+			_mm_storeu_si128((__m128i*)(v + i), _mm_add_epi16(_mm_loadu_si128((const __m128i*)(v + i)), _mm_loadu_si128((const __m128i*)(w + i))));
+		break;
+	default:
+		for (i = 0; i < NNUE_HIDDEN; i++)
+			v[i] += w[i];
+		break;
+	}
+}
+
+void Nnue::subFeature(NnueAccumulator& a, typeColor side, int index)
+{
+	short* v = a.value[side];
+	const short* w = &net->ftWeight[(size_t)index*NNUE_HIDDEN];
+	int i;
+	switch (simd)
+	{
+	case SIMD_AVX2:
+		for (i = 0; i < NNUE_HIDDEN; i += 16)
+			_mm256_storeu_si256((__m256i*)(v + i), _mm256_sub_epi16(_mm256_loadu_si256((const __m256i*)(v + i)), _mm256_loadu_si256((const __m256i*)(w + i))));
+		break;
+	case SIMD_SSE41:
+		for (i = 0; i < NNUE_HIDDEN; i += 8)
+			_mm_storeu_si128((__m128i*)(v + i), _mm_sub_epi16(_mm_loadu_si128((const __m128i*)(v + i)), _mm_loadu_si128((const __m128i*)(w + i))));
+		break;
+	default:
+		for (i = 0; i < NNUE_HIDDEN; i++)
+			v[i] -= w[i];
+		break;
+	}
+}
+
+// Calculate the accumulator for one side from scratch.
+void Nnue::refresh(ChessBoard& cb, typeColor side, NnueAccumulator& a)
+{
+	typeSquare sq;
+	typePiece king = COLORPIECE(side, KING);
+
+	for (sq = 0; sq < 0x80; sq++)
+		if (LEGALSQUARE(sq) && (cb.board[sq] == king))
+			a.kingsquare[side] = sq;
+
+	memcpy(a.value[side], net->ftBias.data(), sizeof(short)*NNUE_HIDDEN);
+	for (sq = 0; sq < 0x80; sq++)
+	{
+		if (!LEGALSQUARE(sq) || !cb.board[sq] || (PIECE(cb.board[sq]) == KING))
+			continue;
+		addFeature(a, side, featureIndex(side, a.kingsquare[side], cb.board[sq], sq));
+	}
+}
+
+void Nnue::setup(ChessBoard& cb)
+{
+	ply = 0;
+	if (!net)
+		return;
+	refresh(cb, WHITE, acc[0]);
+	refresh(cb, BLACK, acc[0]);
+}
+
+void Nnue::doMove(ChessBoard& cb, ChessMove& m)
+{
+	typePiece removed[3], added[2];
+	typeSquare removedSq[3], addedSq[2];
+	int nRemoved = 0, nAdded = 0, i;
+	typeColor mover, side;
+	typePiece moved;
+
+	if (!net)
+		return;
+	assert(ply < (MAX_PLY + 1));
+	NnueAccumulator& a = acc[ply + 1];
+	a = acc[ply];
+	++ply;
+
+	mover = OTHERPLAYER(cb.toMove);
+	moved = cb.board[m.toSquare];
+
+	// Collect the pieces leaving and entering squares.
+	removed[nRemoved] = (m.moveType&PROMOTE) ? COLORPIECE(mover, PAWN) : moved;
+	removedSq[nRemoved++] = m.fromSquare;
+	added[nAdded] = moved;
+	addedSq[nAdded++] = m.toSquare;
+	if (m.moveType&CAPTURE)
+	{
+		removed[nRemoved] = m.capturedpiece;
+		if (m.moveType&ENPASSANT)
+			removedSq[nRemoved++] = (mover == WHITE) ? m.toSquare - 16 : m.toSquare + 16;
+		else
+			removedSq[nRemoved++] = m.toSquare;
+	}
+	if (m.moveType&CASTLE)
+	{
+		removed[nRemoved] = added[nAdded] = COLORPIECE(mover, ROOK);
+		switch (m.toSquare)
+		{
+		case c1: removedSq[nRemoved++] = a1; addedSq[nAdded++] = d1; break;
+		case g1: removedSq[nRemoved++] = h1; addedSq[nAdded++] = f1; break;
+		case c8: removedSq[nRemoved++] = a8; addedSq[nAdded++] = d8; break;
+		case g8: removedSq[nRemoved++] = h8; addedSq[nAdded++] = f8; break;
+		}
+	}
+
+	for (side = WHITE; side <= BLACK; side++)
+	{
+		// A king move changes all features for that side.
+		if ((PIECE(moved) == KING) && (side == mover))
+		{
+			refresh(cb, side, a);
+			continue;
+		}
+		for (i = 0; i < nRemoved; i++)
+			if (PIECE(removed[i]) != KING)
+				subFeature(a, side, featureIndex(side, a.kingsquare[side], removed[i], removedSq[i]));
+		for (i = 0; i < nAdded; i++)
+			if (PIECE(added[i]) != KING)
+				addFeature(a, side, featureIndex(side, a.kingsquare[side], added[i], addedSq[i]));
+	}
+}
+
+void Nnue::doNullMove()
+{
+	if (!net)
+		return;
+	assert(ply < (MAX_PLY + 1));
+	acc[ply + 1] = acc[ply];
+	++ply;
+}
+
+void Nnue::undoMove()
+{
+	if (net && ply)
+		--ply;
+}
+
+// Clip the accumulator to 0..CLIP_MAX as bytes.
+void Nnue::clip(const short* input, unsigned char* output, int size)
+{
+	int i;
+	switch (simd)
+	{
+	case SIMD_AVX2:
+	{
+		const __m256i zero = _mm256_setzero_si256();
+		const __m256i top = _mm256_set1_epi16(CLIP_MAX);
+		for (i = 0; i < size; i += 32)
+		{
+			__m256i a = _mm256_min_epi16(_mm256_max_epi16(_mm256_loadu_si256((const __m256i*)(input + i)), zero), top);
+			__m256i b = _mm256_min_epi16(_mm256_max_epi16(_mm256_loadu_si256((const __m256i*)(input + i + 16)), zero), top);
+			// packus works on 128 bit lanes, put the quadwords back in order.
+			_mm256_storeu_si256((__m256i*)(output + i), _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xd8));
+		}
+		break;
+	}
+	case SIMD_SSE41:
+	{
+		const __m128i zero = _mm_setzero_si128();
+		const __m128i top = _mm_set1_epi16(CLIP_MAX);
+		for (i = 0; i < size; i += 16)
+		{
+			__m128i a = _mm_min_epi16(_mm_max_epi16(_mm_loadu_si128((const __m128i*)(input + i)), zero), top);
+			__m128i b = _mm_min_epi16(_mm_max_epi16(_mm_loadu_si128((const __m128i*)(input + i + 8)), zero), top);
+			_mm_storeu_si128((__m128i*)(output + i), _mm_packus_epi16(a, b));
+		}
+		break;
+	}
+	default:
+		for (i = 0; i < size; i++)
+			output[i] = (unsigned char)__min(__max(input[i], 0), CLIP_MAX);
+		break;
+	}
+}
+
+// Dot product of unsigned byte input and signed byte weights.
+int Nnue::dense(const unsigned char* input, int inputs, const signed char* weight)
+{
+	int i, sum = 0;
+	switch (simd)
+	{
+	case SIMD_AVX2:
+	{
+		const __m256i ones = _mm256_set1_epi16(1);
+		__m256i s = _mm256_setzero_si256();
+		for (i = 0; i < inputs; i += 32)
+		{
+			__m256i p = _mm256_maddubs_epi16(_mm256_loadu_si256((const __m256i*)(input + i)), _mm256_loadu_si256((const __m256i*)(weight + i)));
+			s = _mm256_add_epi32(s, _mm256_madd_epi16(p, ones));
+		}
+		__m128i h = _mm_add_epi32(_mm256_castsi256_si128(s), _mm256_extracti128_si256(s, 1));
+		h = _mm_add_epi32(h, _mm_shuffle_epi32(h, 0x4e));
+		h = _mm_add_epi32(h, _mm_shuffle_epi32(h, 0xb1));
+		sum = _mm_cvtsi128_si32(h);
+		break;
+	}
+	case SIMD_SSE41:
+	{
+		const __m128i ones = _mm_set1_epi16(1);
+		__m128i s = _mm_setzero_si128();
+		for (i = 0; i < inputs; i += 16)
+		{
+			__m128i p = _mm_maddubs_epi16(_mm_loadu_si128((const __m128i*)(input + i)), _mm_loadu_si128((const __m128i*)(weight + i)));
+			s = _mm_add_epi32(s, _mm_madd_epi16(p, ones));
+		}
+		s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0x4e));
+		s = _mm_add_epi32(s, _mm_shuffle_epi32(s, 0xb1));
+		sum = _mm_cvtsi128_si32(s);
+		break;
+	}
+	default:
+		for (i = 0; i < inputs; i++)
+			sum += input[i] * weight[i];
+		break;
+	}
+	return sum;
+}
+
+int Nnue::evaluate(ChessBoard& cb)
+{
+	alignas(32) unsigned char input[2 * NNUE_HIDDEN];
+	alignas(32) unsigned char hidden1[NNUE_L1];
+	alignas(32) unsigned char hidden2[NNUE_L2];
+	NnueAccumulator& a = acc[ply];
+	const NnueWeights& w = *net;
+	int i, sum;
+
+	// Side to move first
+	clip(a.value[cb.toMove], input, NNUE_HIDDEN);
+	clip(a.value[OTHERPLAYER(cb.toMove)], input + NNUE_HIDDEN, NNUE_HIDDEN);
+
+	for (i = 0; i < NNUE_L1; i++)
+	{
+		sum = w.l1Bias[i] + dense(input, 2 * NNUE_HIDDEN, &w.l1Weight[i * 2 * NNUE_HIDDEN]);
+		hidden1[i] = (unsigned char)__min(__max(sum >> LAYER_SHIFT, 0), CLIP_MAX);
+	}
+	for (i = 0; i < NNUE_L2; i++)
+	{
+		sum = w.l2Bias[i] + dense(hidden1, NNUE_L1, &w.l2Weight[i * NNUE_L1]);
+		hidden2[i] = (unsigned char)__min(__max(sum >> LAYER_SHIFT, 0), CLIP_MAX);
+	}
+	sum = w.outBias + dense(hidden2, NNUE_L2, w.outWeight.data());
+	return sum / OUTPUT_SCALE;
+}
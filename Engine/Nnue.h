@@ -0,0 +1,95 @@
+#pragma once
+
+#include <Windows.h>
+#include <string>
+#include <vector>
+#include <memory>
+#include "../Common/ChessBoard.h"
+#include "../Common/ChessMove.h"
+#include "../Common/defs.h"
+
+// Efficiently updatable neural network evaluation.
+//
+// Input is HalfKP: for each side the own king square combined with every
+// piece (except kings) on every square, seen from that side. Black squares
+// are mirrored so both sides use the same weights.
+// The first layer is kept as an int16 accumulator per side that is updated
+// with the few features a move adds or removes. The rest of the network is
+// small int8 layers computed at evaluation.
+const int NNUE_KINGSQUARES = 64;
+const int NNUE_PIECES = 10;
+const int NNUE_INPUTS = NNUE_KINGSQUARES * NNUE_PIECES * 64;
+const int NNUE_HIDDEN = 256;
+const int NNUE_L1 = 32;
+const int NNUE_L2 = 32;
+
+// Net file: "PCNN", version, the dimensions above and then the weights.
+const unsigned int NNUE_VERSION = 1;
+
+enum NNUE_SIMD
+{
+	SIMD_NONE = 0,
+	SIMD_SSE41,
+	SIMD_AVX2
+};
+
+struct NnueAccumulator
+{
+	alignas(32) short value[2][NNUE_HIDDEN];
+	typeSquare kingsquare[2];
+};
+
+// The weights of a network. They are not changed after loading, so the
+// engines that use the same file share one copy.
+struct NnueWeights
+{
+	std::string filename;
+	ULONGLONG writeTime; // Last write of the file when it was loaded
+	// Feature transformer
+	std::vector<short> ftBias;
+	std::vector<short> ftWeight;
+	// Dense layers, weights stored [output][input]
+	std::vector<int> l1Bias;
+	std::vector<signed char> l1Weight;
+	std::vector<int> l2Bias;
+	std::vector<signed char> l2Weight;
+	int outBias;
+	std::vector<signed char> outWeight;
+};
+
+class Nnue
+{
+	std::shared_ptr<const NnueWeights> net;
+
+	// One accumulator for each ply from the root.
+	NnueAccumulator acc[MAX_PLY + 2];
+	int ply;
+	static const std::string noFile;
+
+	void refresh(ChessBoard& cb, typeColor side, NnueAccumulator& a);
+	void addFeature(NnueAccumulator& a, typeColor side, int index);
+	void subFeature(NnueAccumulator& a, typeColor side, int index);
+	int dense(const unsigned char* input, int inputs, const signed char* weight);
+	void clip(const short* input, unsigned char* output, int size);
+public:
+	NNUE_SIMD simd;
+	Nnue();
+	virtual ~Nnue();
+	// The weights are read from the file the first time it is loaded, or
+	// when the file has changed since it was read.
+	bool load(const std::string& file, std::string& error);
+	void unload();
+	inline bool loaded() { return net != nullptr; };
+	inline const std::string& filename() { return net ? net->filename : noFile; };
+	static NNUE_SIMD detectSimd();
+	// Index of a piece on a square seen from one side with its king on ksq.
+	static int featureIndex(typeColor side, typeSquare ksq, typePiece piece, typeSquare sq);
+	// Set the root position.
+	void setup(ChessBoard& cb);
+	// Call after the move is made on the board.
+	void doMove(ChessBoard& cb, ChessMove& m);
+	void doNullMove();
+	void undoMove();
+	// Score seen from the side to move.
+	int evaluate(ChessBoard& cb);
+};
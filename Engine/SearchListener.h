@@ -0,0 +1,36 @@
+#pragma once
+
+#include <Windows.h>
+#include <string>
+#include "../Common/ChessMove.h"
+#include "../Common/MoveList.h"
+
+// The result of an iteration, the same as the pv info sent to the gui.
+struct SearchInfo
+{
+	int depth;
+	// Centipawns from the side to move.
+	int score;
+	// Moves to mate, negative if the side to move is mated. 0 if not a mate score.
+	int mate;
+	// 0, lowerbound or upperbound
+	int bound;
+	ULONGLONG nodes;
+	ULONGLONG time; // ms
+	MoveList pv;
+	void clear() { depth = score = mate = bound = 0; nodes = time = 0; pv.clear(); };
+};
+
+// Receives the search output when the engine is used without the uci
+// interface. The functions are called from the thread doing the search.
+class SearchListener
+{
+public:
+	virtual ~SearchListener() {};
+	// After each iteration, and when the aspiration window fails.
+	virtual void searchInfo(const SearchInfo& info) {};
+	// The search has ended, info is the last iteration.
+	virtual void searchDone(const ChessMove& bestMove, const SearchInfo& info) {};
+	// Other info lines, like currmove and strings.
+	virtual void searchString(const std::string& s) {};
+};
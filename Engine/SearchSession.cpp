@@ -0,0 +1,78 @@
+#include "SearchSession.h"
+#include "Engine.h"
+
+SearchSession::SearchSession(SearchListener* listener)
+{
+	engine = new SearchEngine;
+	engine->listener = listener;
+	busy = false;
+}
+
+SearchSession::~SearchSession()
+{
+	delete engine;
+}
+
+void SearchSession::setListener(SearchListener* listener)
+{
+	engine->listener = listener;
+}
+
+void SearchSession::setPosition(const ChessBoard& cb)
+{
+	engine->theBoard = cb;
+}
+
+void SearchSession::addHistory(const ChessBoard& cb)
+{
+	ChessBoard b = cb;
+	engine->drawTable.add(b);
+}
+
+void SearchSession::clearHistory()
+{
+	engine->drawTable.clear();
+}
+
+void SearchSession::setContempt(int contempt)
+{
+	engine->contempt = contempt;
+}
+
+void SearchSession::loadEvalFile(const std::string& file)
+{
+	engine->loadEvalFile(file);
+}
+
+ChessMove SearchSession::go(const SearchLimits& limits)
+{
+	EngineGo eg;
+	eg.depth = limits.depth;
+	eg.nodes = limits.nodes;
+	eg.mate = limits.mate;
+	eg.fixedTime = limits.moveTime;
+	eg.maxTime = 0;
+	eg.searchmoves = limits.searchmoves;
+	busy = true;
+	engine->stopRequest = false;
+	engine->watch.start();
+	// Without limits it is searched as ponder, until stopped.
+	engine->go(eg, !limits.depth && !limits.nodes && !limits.moveTime && !limits.mate);
+	busy = false;
+	return engine->bestMove;
+}
+
+void SearchSession::stop()
+{
+	engine->stopRequest = true;
+}
+
+const SearchInfo& SearchSession::lastInfo()
+{
+	return engine->info;
+}
+
+DWORD SearchSession::nodes()
+{
+	return engine->nodes;
+}
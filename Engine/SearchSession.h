@@ -0,0 +1,52 @@
+#pragma once
+
+#include <Windows.h>
+#include <string>
+#include "SearchListener.h"
+#include "../Common/ChessBoard.h"
+#include "../Common/MoveList.h"
+
+class SearchEngine;
+
+// Limits for a search, 0 is no limit. Without any limits the search runs
+// until stop() is called or the max depth is reached.
+struct SearchLimits
+{
+	DWORD depth;
+	DWORD nodes;
+	DWORD moveTime; // ms
+	DWORD mate;     // Mate in moves
+	MoveList searchmoves;
+	SearchLimits() { depth = nodes = moveTime = mate = 0; };
+};
+
+// The engine used in process, without a uci process in between. Each
+// session has its own engine so sessions can search on different threads
+// at the same time. go() searches on the calling thread and returns when
+// the search ends, stop() can be called from any thread. A session must
+// not be deleted while it is searching. Only this header is needed to use
+// the engine, so it can be included together with the gui engine classes.
+class SearchSession
+{
+	SearchEngine* engine;
+	volatile bool busy;
+public:
+	SearchSession(SearchListener* listener = NULL);
+	virtual ~SearchSession();
+	void setListener(SearchListener* listener);
+	void setPosition(const ChessBoard& cb);
+	// Positions played before the current, used to find repetitions.
+	void addHistory(const ChessBoard& cb);
+	void clearHistory();
+	void setContempt(int contempt);
+	void loadEvalFile(const std::string& file);
+	// Search the position, returns the best move. The move is empty if there
+	// are no legal moves.
+	ChessMove go(const SearchLimits& limits);
+	// Stop a running search, go() returns with the best move found.
+	void stop();
+	inline bool searching() { return busy; };
+	// The last iteration of the search.
+	const SearchInfo& lastInfo();
+	DWORD nodes();
+};
@@ -0,0 +1,206 @@
+#include <fstream>
+#include <map>
+#include <vector>
+#include <algorithm>
+#include <string.h>
+#include "SearchTrace.h"
+
+using namespace std;
+
+// Subtrees down to this ply are listed in the report.
+const int REPORT_PLY = 2;
+
+SearchTrace::SearchTrace()
+{
+	hFile = NULL;
+	hMap = NULL;
+	header = NULL;
+	records = NULL;
+	active = false;
+	maxPly = 3;
+}
+
+SearchTrace::~SearchTrace()
+{
+	close();
+}
+
+bool SearchTrace::open(const std::string& filename)
+{
+	DWORD size = sizeof(TraceHeader) + TRACE_CAPACITY*sizeof(TraceRecord);
+
+	close();
+	hFile = CreateFileA(filename.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (hFile == INVALID_HANDLE_VALUE)
+	{
+		hFile = NULL;
+		return false;
+	}
+	hMap = CreateFileMappingA(hFile, NULL, PAGE_READWRITE, 0, size, NULL);
+	if (hMap == NULL)
+	{
+		close();
+		return false;
+	}
+	header = (TraceHeader*)MapViewOfFile(hMap, FILE_MAP_WRITE, 0, 0, size);
+	if (header == NULL)
+	{
+		close();
+		return false;
+	}
+	records = (TraceRecord*)(header + 1);
+	memcpy(header->magic, "PCTR", 4);
+	header->version = TRACE_VERSION;
+	header->recordSize = sizeof(TraceRecord);
+	header->capacity = TRACE_CAPACITY;
+	header->written = 0;
+	active = true;
+	return true;
+}
+
+void SearchTrace::close()
+{
+	active = false;
+	if (header)
+		UnmapViewOfFile(header);
+	if (hMap)
+		CloseHandle(hMap);
+	if (hFile)
+		CloseHandle(hFile);
+	header = NULL;
+	records = NULL;
+	hMap = NULL;
+	hFile = NULL;
+}
+
+void SearchTrace::clear()
+{
+	if (header)
+		header->written = 0;
+}
+
+static string traceMoveText(const TraceRecord& r)
+{
+	string s;
+	if (r.flags&TRACE_NULLMOVE)
+		return "null";
+	s += (char)('a' + FILE(r.fromSquare));
+	s += (char)('1' + RANK(r.fromSquare));
+	s += (char)('a' + FILE(r.toSquare));
+	s += (char)('1' + RANK(r.toSquare));
+	if (r.promotePiece)
+		s += " pnbrqk"[PIECE(r.promotePiece)];
+	return s;
+}
+
+static bool compareNodes(const pair<string, ULONGLONG>& p1, const pair<string, ULONGLONG>& p2)
+{
+	return p1.second > p2.second;
+}
+
+bool SearchTrace::report(const std::string& filename, std::list<std::string>& lines, int top)
+{
+	TraceHeader h;
+	vector<TraceRecord> trace;
+	ULONGLONG count, first, i, total = 0;
+	char sz[256];
+	int p, q;
+
+	ifstream f(filename, ios::binary);
+	if (!f.is_open())
+	{
+		lines.push_back("Unable to open file: " + filename);
+		return false;
+	}
+	f.read((char*)&h, sizeof(h));
+	if (!f.good() || (memcmp(h.magic, "PCTR", 4) != 0) || (h.version != TRACE_VERSION) || (h.recordSize != sizeof(TraceRecord)) || !h.capacity)
+	{
+		lines.push_back("Not a trace file: " + filename);
+		return false;
+	}
+
+	// Read the ring from the oldest record.
+	count = __min(h.written, (ULONGLONG)h.capacity);
+	first = (h.written > h.capacity) ? (h.written % h.capacity) : 0;
+	trace.resize((size_t)count);
+	f.seekg(sizeof(h) + first*sizeof(TraceRecord));
+	f.read((char*)trace.data(), (count - first)*sizeof(TraceRecord));
+	if (first)
+	{
+		f.seekg(sizeof(h));
+		f.read((char*)(trace.data() + (count - first)), first*sizeof(TraceRecord));
+	}
+	if (!f.good())
+	{
+		lines.push_back("Trace file is truncated: " + filename);
+		return false;
+	}
+
+	sprintf_s(sz, 256, "%llu records%s", count, (h.written > h.capacity) ? " (ring has wrapped, oldest records lost)" : "");
+	lines.push_back(sz);
+
+	// Walk backwards, then the moves above a record are already seen.
+	map<string, ULONGLONG> subtrees;
+	string path[256];
+	bool valid[256];
+	for (p = 0; p < 256; p++)
+		valid[p] = false;
+	for (i = count; i > 0; i--)
+	{
+		const TraceRecord& r = trace[(size_t)(i - 1)];
+		p = r.ply;
+		for (q = p + 1; q < 256; q++)
+			valid[q] = false;
+		path[p] = traceMoveText(r);
+		valid[p] = (p == 0) || valid[p - 1];
+		if (p == 0)
+			total += r.nodes;
+		if (valid[p] && (p <= REPORT_PLY))
+		{
+			string line = path[0];
+			for (q = 1; q <= p; q++)
+				line += " " + path[q];
+			subtrees[line] += r.nodes;
+		}
+	}
+
+	vector<pair<string, ULONGLONG> > hot(subtrees.begin(), subtrees.end());
+	sort(hot.begin(), hot.end(), compareNodes);
+	lines.push_back("Hottest subtrees (nodes, % of root nodes, line):");
+	for (i = 0; (i < hot.size()) && (i < (ULONGLONG)top); i++)
+	{
+		sprintf_s(sz, 256, "%10llu %5.1f%% ", hot[(size_t)i].second, total ? (100.0*hot[(size_t)i].second) / total : 0.0);
+		lines.push_back(sz + hot[(size_t)i].first);
+	}
+
+	// Move ordering: how often the first move gives the cutoff.
+	ULONGLONG moves[256], cutoffs[256], firstCutoffs[256], indexSum[256], qmoves[256];
+	for (p = 0; p < 256; p++)
+		moves[p] = cutoffs[p] = firstCutoffs[p] = indexSum[p] = qmoves[p] = 0;
+	for (i = 0; i < count; i++)
+	{
+		const TraceRecord& r = trace[(size_t)i];
+		if (r.flags&TRACE_NULLMOVE)
+			continue;
+		++moves[r.ply];
+		if (r.flags&TRACE_QSEARCH)
+			++qmoves[r.ply];
+		if (r.flags&TRACE_CUTOFF)
+		{
+			++cutoffs[r.ply];
+			indexSum[r.ply] += r.moveIndex;
+			if (r.moveIndex == 0)
+				++firstCutoffs[r.ply];
+		}
+	}
+	lines.push_back("Move ordering per ply:");
+	for (p = 0; p < 256; p++)
+	{
+		if (!moves[p])
+			continue;
+		sprintf_s(sz, 256, "ply %3i moves %10llu qsearch %5.1f%% cutoffs %10llu first %5.1f%% avg index %.2f", p, moves[p], (100.0*qmoves[p]) / moves[p],
+			cutoffs[p], cutoffs[p] ? (100.0*firstCutoffs[p]) / cutoffs[p] : 0.0, cutoffs[p] ? (double)indexSum[p] / cutoffs[p] : 0.0);
+		lines.push_back(sz);
+	}
+	return true;
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <Windows.h>
+#include <string>
+#include <list>
+#include "../Common/ChessMove.h"
+#include "../Common/defs.h"
+
+// Records written to the trace ring
+const DWORD TRACE_CAPACITY = 1 << 20;
+const DWORD TRACE_VERSION = 1;
+
+enum
+{
+	TRACE_QSEARCH = 0x01,
+	TRACE_NULLMOVE = 0x02,
+	TRACE_CUTOFF = 0x04,  // score >= beta
+	TRACE_BEST = 0x08,    // alpha < score < beta
+	TRACE_EXTENDED = 0x10
+};
+
+// One searched move, written when the search of the move returns. The
+// records are in post order, a move comes after all the moves below it.
+struct TraceRecord
+{
+	unsigned char ply;
+	unsigned char depth;
+	unsigned char fromSquare;
+	unsigned char toSquare;
+	unsigned char promotePiece;
+	unsigned char moveIndex;
+	unsigned short flags;
+	short alpha;
+	short beta;
+	short score;
+	unsigned short reserved;
+	DWORD nodes; // Nodes used below the move
+};
+
+struct TraceHeader
+{
+	char magic[4];
+	DWORD version;
+	DWORD recordSize;
+	DWORD capacity;
+	// Records written, the ring has wrapped if this is above capacity.
+	ULONGLONG written;
+};
+
+// Search trace in a memory mapped file. It holds the last search, and when
+// the ring is full the oldest records are overwritten.
+class SearchTrace
+{
+	HANDLE hFile;
+	HANDLE hMap;
+	TraceHeader* header;
+	TraceRecord* records;
+public:
+	// Don't call add if not active.
+	bool active;
+	// Highest ply to record
+	int maxPly;
+	SearchTrace();
+	virtual ~SearchTrace();
+	bool open(const std::string& filename);
+	void close();
+	// Start a new search.
+	void clear();
+	inline bool filter(int ply) { return active && (ply <= maxPly); };
+	inline void add(int ply, int depth, const ChessMove& m, int index, int flags, int alpha, int beta, int score, DWORD nodes)
+	{
+		TraceRecord& r = records[header->written++ % TRACE_CAPACITY];
+		r.ply = (unsigned char)ply;
+		r.depth = (unsigned char)__max(depth, 0);
+		r.fromSquare = (unsigned char)m.fromSquare;
+		r.toSquare = (unsigned char)m.toSquare;
+		r.promotePiece = (unsigned char)m.promotePiece;
+		r.moveIndex = (unsigned char)__min(index, 255);
+		if (score >= beta)
+			flags |= TRACE_CUTOFF;
+		else if (score > alpha)
+			flags |= TRACE_BEST;
+		r.flags = (unsigned short)flags;
+		r.alpha = (short)alpha;
+		r.beta = (short)beta;
+		r.score = (short)score;
+		r.reserved = 0;
+		r.nodes = nodes;
+	};
+	// Summary of a trace file: hottest subtrees and move ordering per ply.
+	static bool report(const std::string& filename, std::list<std::string>& lines, int top = 10);
+};
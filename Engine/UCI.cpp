@@ -132,6 +132,18 @@ int Uci::extract(std::string& s)
 		ret = UCI_readfile;
 	else if (cmd == "eval")
 		ret = UCI_eval;
+	else if (cmd == "evalbench")
+		ret = UCI_evalbench;
+	else if (cmd == "bench")
+		ret = UCI_bench;
+	else if (cmd == "speed")
+		ret = UCI_speed;
+	else if (cmd == "tracereport")
+		ret = UCI_tracereport;
+	else if (cmd == "makebook")
+		ret = UCI_makebook;
+	else if (cmd == "analyse")
+		ret = UCI_analyse;
 	if (ret != UCI_unknown)
 	{
 		len = cmd.length();
@@ -20,7 +20,13 @@ enum {
 	UCI_uci,
 	UCI_ucinewgame,
 	UCI_eval,
-	UCI_readfile
+	UCI_readfile,
+	UCI_evalbench,
+	UCI_bench,
+	UCI_speed,
+	UCI_tracereport,
+	UCI_makebook,
+	UCI_analyse
 };
 
 class Uci
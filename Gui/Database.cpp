@@ -6,8 +6,6 @@
 #include <QVariant>
 #include <QDebug>
 
-const char* GAMEDBVERSION = "1.0";
-const char* GAMEDBTYPE = "GAMEDB";
 const char* BOOKDBVERSION = "1.0";
 const char* BOOKDBTYPE = "BOOKDB";
 
@@ -15,11 +13,6 @@ const char* BOOKDBTYPE = "BOOKDB";
 Database::Database(QObject *parent)
 	: QObject(parent)
 {
-	if (!QSqlDatabase::isDriverAvailable("QSQLITE"))
-	{
-		qWarning("No SQLITE driver available.");
-		return;
-	}
 	QString path = QStandardPaths::locate(QStandardPaths::DocumentsLocation,"/Polarchess", QStandardPaths::LocateDirectory);
 	if (path.isEmpty())
 	{
@@ -32,12 +25,17 @@ Database::Database(QObject *parent)
 		}
 
 	}
-		
-	gamedb = QSqlDatabase::addDatabase("QSQLITE");
-	gamedb.setDatabaseName(path+ "/Polarchess.games");
-	path = QStandardPaths::locate(QStandardPaths::DocumentsLocation, "/Polarchess/Polarchess.games", QStandardPaths::LocateFile);
-	if (path.isEmpty())
-		create();
+
+	// The games are in a GameBase, the files Polarchess.gbh, .gbm, .gbo, .gbn and .gbs,
+	// and the PositionIndex of them is in Polarchess.gpx and the .gps segments.
+	gamepath = path + "/Polarchess";
+	create();
+
+	if (!QSqlDatabase::isDriverAvailable("QSQLITE"))
+	{
+		qWarning("No SQLITE driver available.");
+		return;
+	}
 	bookdb.setDatabaseName(path + "/Polarchess.book");
 }
 
@@ -47,71 +45,126 @@ Database::~Database()
 
 bool Database::create()
 {
-	if (!gamedb.open())
+	if (games.isOpen())
+		return true;
+	if (!games.open(gamepath.toStdString()))
+	{
+		emit databaseMessage(QString::fromStdString(games.lastError()));
+		return false;
+	}
+	// The index is made from the games, games added without it are indexed here.
+	if (!positions.open(gamepath.toStdString()) || !positions.update(games))
+		emit databaseMessage(QString::fromStdString(positions.lastError()));
+	return true;
+}
+
+bool Database::addGame(QChessGame* game)
+{
+	ChessGame cg;
+	MoveList ml;
+	int i;
+
+	if (!create())
+		return false;
+	cg.info.Event = game->event().toStdString();
+	cg.info.Site = game->site().toStdString();
+	cg.info.Date = game->date().toStdString();
+	cg.info.Round = game->round().toStdString();
+	cg.info.White = game->white().toStdString();
+	cg.info.Black = game->black().toStdString();
+	cg.info.Result = game->result().toStdString();
+	cg.info.WhiteElo = game->whiteelo().toStdString();
+	cg.info.BlackElo = game->blackelo().toStdString();
+	cg.info.ECO = game->eco().toStdString();
+	cg.info.Annotator = game->annotator().toStdString();
+	cg.info.WhiteTimeControl = game->whitetimecontrol().toStdString();
+	cg.info.BlackTimeControl = game->blacktimecontrol().toStdString();
+	cg.setStartPosition(game->getStartPosition().board());
+	ml = game->movelist();
+	for (i = 0; i < ml.size(); i++)
+		if (!cg.addMove(ml[i]))
+			break;
+	if (!games.append(cg) || !games.flush())
+	{
+		emit databaseMessage(QString::fromStdString(games.lastError()));
 		return false;
+	}
+	if (!positions.update(games))
+		emit databaseMessage(QString::fromStdString(positions.lastError()));
+	return true;
+}
 
-	QSqlQuery query(gamedb);
-	query.exec("CREATE TABLE info ( id INTEGER, type TEXT, version TEXT);");
-	query.prepare("INSERT INTO info (type, version) VALUES ( :type, :version);");
-	query.bindValue(":type", GAMEDBTYPE);
-	query.bindValue(":version", GAMEDBVERSION);
-	query.exec();
+size_t Database::findPosition(const ChessBoard& cb, std::vector<PositionHit>& hits)
+{
+	hits.clear();
+	if (!create())
+		return 0;
+	return positions.find(cb, hits);
+}
 
-	query.exec("CREATE TABLE `games` ( "
-		"`id`	INTEGER,"
-		"`event`	TEXT,"
-		"`site`	TEXT,"
-		"`white`	TEXT,"
-		"`black`	TEXT,"
-		"`round`	TEXT,"
-		"`date`	TEXT,"
-		"`result`	TEXT,"
-		"`whiteelo`	TEXT,"
-		"`blackelo`	TEXT,"
-		"`eco`	TEXT,"
-		"`annotator`	TEXT,"
-		"`whitetimecontrol`	TEXT,"
-		"`blacktimecontrol`	TEXT,"
-		"`rated`	TEXT,"
-		"`analysisengine`	TEXT,"
-		"`movetext`	BLOB,"
-		"PRIMARY KEY(`id`,`white`,`black`,`date`)"
-		"); ");
-	gamedb.close();
+bool Database::nextMoves(const ChessBoard& cb, std::vector<PositionMove>& moves)
+{
+	moves.clear();
+	if (!create())
+		return false;
+	if (!positions.nextMoves(games, cb, moves))
+	{
+		emit databaseMessage(QString::fromStdString(positions.lastError()));
+		return false;
+	}
 	return true;
 }
 
-bool Database::addGame(QChessGame* game)
+size_t Database::searchGames(GameSearch& search, std::vector<PositionHit>& hits)
+{
+	hits.clear();
+	if (!create())
+		return 0;
+	return search.find(games, hits);
+}
+
+bool Database::readGame(DWORD index, QChessGame* game)
 {
-/*
-char sz[1024];
-	QSqlQuery query;
-	if (!db.open())
+	ChessGame cg;
+	QString s;
+	int pos;
+
+	if (!create() || !games.read(index, cg) || cg.position.empty())
 		return false;
-	sprintf_s(sz, 1024, "INSERT INTO games (event, site, white, black,round, date, result, whiteelo, blackelo, "
-		"eco, annotator, whitetype, blacktype, whitetimecontrol, blacktimecontrol, opening, "
-		"variation, subvariation, remark, movetext ) VALUES ("
-		"'%s', '%s', '%s', '%s', '%s', '%s', '%s', '%s', '%s', '%s', '%s', '%s', '%s', '%s', '%s', '%s', '%s', '%s', '%s', '%s')",
-		game.info.Event.c_str(),
-		game.info.Site.c_str(),
-		game.info.White.c_str(),
-		game.info.Black.c_str(),
-		game.info.Round.c_str(),
-		game.info.Date.c_str(),
-		game.info.Result.c_str(),
-		game.info.WhiteElo.c_str(),
-		game.info.BlackElo.c_str(),
-		game.info.WhiteType.c_str(),
-		game.info.BlackType.c_str(),
-		game.info.WhiteTimeControl.c_str(),
-		game.info.BlackTimeControl.c_str(),
-		game.info.ECO.c_str(),
-		game.info.Opening.c_str(),
-		game.info.Variation.c_str(),
-		game.info.SubVariation.c_str(),
-		game.info.Remark.c_str(),
-		game.info.Annotator.c_str(),
-		game.toString().c_str());
-		*/
+	game->clear();
+	game->newGame(QString::fromStdString(cg.position[0].board.getFen()));
+	s = QString::fromStdString(cg.info.Event);
+	game->event(s);
+	s = QString::fromStdString(cg.info.Site);
+	game->site(s);
+	s = QString::fromStdString(cg.info.Date);
+	game->date(s);
+	s = QString::fromStdString(cg.info.Round);
+	game->round(s);
+	s = QString::fromStdString(cg.info.White);
+	game->white(s);
+	s = QString::fromStdString(cg.info.Black);
+	game->black(s);
+	s = QString::fromStdString(cg.info.Result);
+	game->result(s);
+	s = QString::fromStdString(cg.info.WhiteElo);
+	game->whiteelo(s);
+	s = QString::fromStdString(cg.info.BlackElo);
+	game->blackelo(s);
+	s = QString::fromStdString(cg.info.ECO);
+	game->eco(s);
+	s = QString::fromStdString(cg.info.Annotator);
+	game->annotator(s);
+	s = QString::fromStdString(cg.info.WhiteTimeControl);
+	game->whitetimecontrol(s);
+	s = QString::fromStdString(cg.info.BlackTimeControl);
+	game->blacktimecontrol(s);
+	pos = 0;
+	while (cg.position[pos].move.size())
+	{
+		if (!game->doMove(cg.position[pos].move[0].move))
+			break;
+		pos = cg.position[pos].move[0].posIndex;
+	}
 	return true;
-}
\ No newline at end of file
+}
@@ -4,13 +4,18 @@
 #include <QSqlDatabase>
 #include <QString>
 #include "../Common/QChessGame.h"
+#include "../Common/GameBase.h"
+#include "../Common/PositionIndex.h"
+#include "../Common/GameSearch.h"
 
 class Database : public QObject
 {
 	Q_OBJECT
 
 private:
-	QSqlDatabase gamedb;
+	GameBase games;
+	PositionIndex positions;
+	QString gamepath;
 	QSqlDatabase bookdb;
 signals:
 	void databaseMessage(const QString& msg);
@@ -20,4 +25,12 @@ public:
 	~Database();
 	bool create();
 	bool addGame(QChessGame* game);
+	// The games that reached the position, see PositionIndex.
+	size_t findPosition(const ChessBoard& cb, std::vector<PositionHit>& hits);
+	// The moves played in the position with the results, most played first.
+	bool nextMoves(const ChessBoard& cb, std::vector<PositionMove>& moves);
+	// Find the games by material or pawn structure, see GameSearch.
+	size_t searchGames(GameSearch& search, std::vector<PositionHit>& hits);
+	// Read the main line of a game.
+	bool readGame(DWORD index, QChessGame* game);
 };
@@ -8,6 +8,7 @@
 #include "../Common/BoardWindow.h"
 #include "../Common/Engine.h"
 #include "../Common/QChessGame.h"
+#include "../Common/GameSearch.h"
 #include <QIcon>
 #include <QSplitter>
 #include <QMenuBar>
@@ -23,6 +24,7 @@
 #include <QRandomGenerator>
 #include <QDate>
 #include <QMessageBox>
+#include <QInputDialog>
 
 MainWindow::MainWindow()
 {
@@ -30,6 +32,7 @@ MainWindow::MainWindow()
 	currentGame->newGame();
 	readSettings();
 	running = false;
+	foundIndex = 0;
 	createMenu();
 
 	statusBar();
@@ -94,6 +97,12 @@ void MainWindow::createMenu()
 	newGameAct = gameMenu->addAction(QIcon(":/icon/board48.png"),"*",this,&MainWindow::newGame);
 	abortAct = gameMenu->addAction(QIcon(":/icon/abort48.png"), "*", this, &MainWindow::abort);
 	resignAct = gameMenu->addAction(QIcon(":/icon/resign48.png"), "*", this, &MainWindow::resign);
+	gameMenu->addSeparator();
+	findMaterialAct = gameMenu->addAction("*", this, &MainWindow::findMaterial);
+	findPawnsAct = gameMenu->addAction("*", this, &MainWindow::findPawns);
+	findPositionAct = gameMenu->addAction("*", this, &MainWindow::findPosition);
+	nextMovesAct = gameMenu->addAction("*", this, &MainWindow::showNextMoves);
+	nextFoundAct = gameMenu->addAction("*", this, &MainWindow::nextFoundGame);
 
 	// Settings menu
 	settingsMenu = menuBar()->addMenu("*");
@@ -140,6 +149,11 @@ void MainWindow::retranslateUi()
 	newGameAct->setText(tr("New game"));
 	abortAct->setText(tr("Abort"));
 	resignAct->setText(tr("Resign"));
+	findMaterialAct->setText(tr("Find material..."));
+	findPawnsAct->setText(tr("Find pawn structure"));
+	findPositionAct->setText(tr("Find position"));
+	nextMovesAct->setText(tr("Moves played"));
+	nextFoundAct->setText(tr("Next found game"));
 
 	settingsMenu->setTitle(tr("Settings"));
 	langMenu->setTitle(tr("Language"));
@@ -511,4 +525,111 @@ void MainWindow::abort()
 void MainWindow::saveGame()
 {
 	database->addGame(currentGame);
+}
+
+// Find the games that reach a material, as "R vs BP*".
+void MainWindow::findMaterial()
+{
+	GameSearch search;
+	QString s;
+	bool ok;
+	if (running)
+		return;
+	s = QInputDialog::getText(this, tr("Find material"), tr("Material, as R vs BP*"), QLineEdit::Normal, lastMaterial, &ok);
+	if (!ok || s.isEmpty())
+		return;
+	if (!search.setMaterial(s.toStdString()))
+	{
+		statusBar()->showMessage(tr("Not a material pattern: %1").arg(s));
+		return;
+	}
+	lastMaterial = s;
+	findGames(search);
+}
+
+// Find the games with the pawns of the board.
+void MainWindow::findPawns()
+{
+	GameSearch search;
+	if (running)
+		return;
+	search.setPawns(currentGame->getPosition().board());
+	findGames(search);
+}
+
+// Find the games that reached the board. A game that repeats the position
+// has a hit for each time, only the first is kept. The hits are in game order.
+void MainWindow::findPosition()
+{
+	std::vector<PositionHit> hits;
+	size_t i;
+	if (running)
+		return;
+	database->findPosition(currentGame->getPosition().board(), hits);
+	foundGames.clear();
+	for (i = 0; i < hits.size(); i++)
+		if (foundGames.empty() || (foundGames.back().game != hits[i].game))
+			foundGames.push_back(hits[i]);
+	showFoundGames();
+}
+
+void MainWindow::findGames(GameSearch& search)
+{
+	database->searchGames(search, foundGames);
+	showFoundGames();
+}
+
+void MainWindow::showFoundGames()
+{
+	foundIndex = 0;
+	statusBar()->showMessage(tr("%1 games found").arg(foundGames.size()));
+	if (foundGames.size())
+		openFoundGame();
+}
+
+// The moves played from the board in the games, as "e4 120 (+50 =40 -30)".
+void MainWindow::showNextMoves()
+{
+	std::vector<PositionMove> moves;
+	ChessBoard cb;
+	QString s;
+	size_t i;
+	if (running)
+		return;
+	cb = currentGame->getPosition().board();
+	if (!database->nextMoves(cb, moves))
+		return;
+	if (moves.empty())
+	{
+		statusBar()->showMessage(tr("No games with the position"));
+		return;
+	}
+	for (i = 0; (i < moves.size()) && (i < 8); i++)
+	{
+		if (i)
+			s += ", ";
+		s += QString("%1 %2 (+%3 =%4 -%5)").arg(QString::fromStdString(cb.makeMoveText(moves[i].move, SAN)))
+			.arg(moves[i].games).arg(moves[i].whiteWins).arg(moves[i].draws).arg(moves[i].blackWins);
+	}
+	statusBar()->showMessage(s);
+}
+
+void MainWindow::nextFoundGame()
+{
+	if (running || foundGames.empty())
+		return;
+	foundIndex = (foundIndex + 1) % foundGames.size();
+	openFoundGame();
+}
+
+// Show a found game at the ply where it matched.
+void MainWindow::openFoundGame()
+{
+	const PositionHit& hit = foundGames[foundIndex];
+	if (!database->readGame(hit.game, currentGame))
+		return;
+	currentGame->gotoMove(hit.ply);
+	boardwindow->setPosition(currentGame->getPosition().board());
+	scoresheet->updateGame(currentGame);
+	statusBar()->showMessage(tr("Game %1 of %2").arg(foundIndex + 1).arg(foundGames.size()));
 }
\ No newline at end of file
@@ -3,10 +3,12 @@
 #include <QMainWindow>
 #include <QString>
 #include <QTranslator>
+#include <vector>
 #include "NewGameDialog.h"
 #include "Player.h"
 #include "EnginePlayer.h"
 #include "../Common/ChessMove.h"
+#include "../Common/PositionIndex.h"
 
 class QMenu;
 class QToolBar;
@@ -20,6 +22,7 @@ class EngineWindow;
 class Engine;
 class Database;
 class QChessGame;
+class GameSearch;
 
 class MainWindow : public QMainWindow
 {
@@ -65,6 +68,11 @@ private:
 	QAction* resignAct;
 	QAction* abortAct;
 	QAction* flipAct;
+	QAction* findMaterialAct;
+	QAction* findPawnsAct;
+	QAction* findPositionAct;
+	QAction* nextMovesAct;
+	QAction* nextFoundAct;
 	QTranslator translator;
 	QActionGroup * langGroup;
 	QString locale;
@@ -82,6 +90,10 @@ private:
 	EnginePlayers engines;
 	int engineColor;
 	bool running;
+	// The games of the last search, and the one shown.
+	std::vector<PositionHit> foundGames;
+	size_t foundIndex;
+	QString lastMaterial;
 	void createMenu();
 	void setLanguage();
 	void loadLanguage();
@@ -95,4 +107,12 @@ private:
 	void abort();
 	void endGame();
 	void saveGame();
+	void findMaterial();
+	void findPawns();
+	void findPosition();
+	void findGames(GameSearch& search);
+	void showFoundGames();
+	void showNextMoves();
+	void nextFoundGame();
+	void openFoundGame();
 };
@@ -0,0 +1,532 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <fstream>
+#include <QFileInfo>
+#include <QSettings>
+#include "Match.h"
+#include "../Common/MoveGenerator.h"
+#include "../Common/Utility.h"
+#include "../Common/defs.h"
+
+using namespace std;
+
+MatchSettings::MatchSettings()
+{
+	games = 100;
+	concurrency = 0;
+	baseTime = 10000;
+	increment = 100;
+	timeMargin = 100;
+	openingPlies = 16;
+	sprt = false;
+	elo0 = 0.0;
+	elo1 = 5.0;
+	alpha = 0.05;
+	beta = 0.05;
+	drawMoveNumber = 40;
+	drawMoves = 8;
+	drawScore = 10;
+	resignMoves = 4;
+	resignScore = 800;
+	maxMoves = 200;
+}
+
+MatchGame::MatchGame(Match* m)
+{
+	int i;
+	match = m;
+	running = false;
+	number = 0;
+	pairId = 0;
+	toMove = 0;
+	white = 0;
+	drawCount = 0;
+	resignCount = 0;
+	for (i = 0; i < 2; i++)
+	{
+		engine[i] = new Engine();
+		loaded[i] = false;
+		ready[i] = false;
+		clock[i] = 0;
+		score[i] = 0;
+		depth[i] = 0;
+		haveScore[i] = false;
+		connect(engine[i], SIGNAL(engineStarted()), SLOT(slotStarted()));
+		connect(engine[i], SIGNAL(engineStoped()), SLOT(slotStoped()));
+		connect(engine[i], SIGNAL(engineInfo(const EngineInfo&)), SLOT(slotInfo(const EngineInfo&)));
+		connect(engine[i], SIGNAL(engineMove(const QString&, const QString&)), SLOT(slotMove(const QString&, const QString&)));
+	}
+	flagTimer.setSingleShot(true);
+	connect(&flagTimer, SIGNAL(timeout()), SLOT(slotFlag()));
+}
+
+MatchGame::~MatchGame()
+{
+	int i;
+	flagTimer.stop();
+	for (i = 0; i < 2; i++)
+	{
+		disconnect(engine[i], 0, this, 0);
+		delete engine[i];
+	}
+}
+
+bool MatchGame::load()
+{
+	int i;
+	for (i = 0; i < 2; i++)
+		if (!engine[i]->load(match->settings.engine[i]))
+			return false;
+	return true;
+}
+
+int MatchGame::engineIndex()
+{
+	return (sender() == engine[1]) ? 1 : 0;
+}
+
+void MatchGame::start(int n, const MatchOpening& opening, bool firstWhite)
+{
+	ChessBoard cb;
+	ChessMove m;
+	SYSTEMTIME st;
+	char sz[32];
+	size_t i;
+
+	number = n;
+	pairId = (n - 1) / 2;
+	white = firstWhite ? 0 : 1;
+	game.clear();
+	if (opening.fen.empty())
+	{
+		cb.setStartposition();
+		game.setStartPosition(cb);
+	}
+	else
+	{
+		game.setStartPosition(opening.fen.c_str());
+	}
+	for (i = 0; i < opening.moves.size(); i++)
+	{
+		m = opening.moves[i];
+		if (!game.addMove(m))
+			break;
+	}
+
+	game.info.Event = "PolarTest match";
+	game.info.Site = "?";
+	sprintf_s(sz, 32, "%d", n);
+	game.info.Round = sz;
+	game.info.White = match->name[white].toStdString();
+	game.info.Black = match->name[1 - white].toStdString();
+	GetLocalTime(&st);
+	game.setDate(st);
+	sprintf_s(sz, 32, "%g+%g", match->settings.baseTime / 1000.0, match->settings.increment / 1000.0);
+	game.setTimeControl(sz);
+	prepare();
+}
+
+// Start a new game in the engines, the game starts when both are ready.
+void MatchGame::prepare()
+{
+	int i;
+	ready[0] = ready[1] = false;
+	for (i = 0; i < 2; i++)
+		if (loaded[i])
+			engine[i]->newGame();
+}
+
+void MatchGame::slotStarted()
+{
+	int i = engineIndex();
+	// The first time is when the engine has loaded.
+	if (!loaded[i])
+	{
+		loaded[i] = true;
+		if (number && !running)
+		{
+			ready[i] = false;
+			engine[i]->newGame();
+		}
+		return;
+	}
+	ready[i] = true;
+	if (number && !running && ready[0] && ready[1])
+	{
+		running = true;
+		clock[0] = clock[1] = match->settings.baseTime;
+		drawCount = resignCount = 0;
+		go();
+	}
+}
+
+void MatchGame::go()
+{
+	ChessBoard start, cb;
+	MoveList ml;
+	int inc = match->settings.increment;
+
+	game.getPosition(cb);
+	game.getStartPosition(start);
+	game.getCurrentLine(ml);
+	toMove = (cb.toMove == WHITE) ? white : 1 - white;
+	haveScore[toMove] = false;
+	engine[toMove]->search(start, ml, NORMAL_SEARCH, clock[white], inc, clock[1 - white], inc, 0);
+	watch.start();
+	flagTimer.start(__max(clock[toMove], 0) + match->settings.timeMargin);
+}
+
+void MatchGame::slotInfo(const EngineInfo& ei)
+{
+	int i = engineIndex();
+	if (!running || (i != toMove) || !ei.pv.size())
+		return;
+	if (ei.mate)
+		score[i] = (ei.mate > 0) ? MATE - ei.mate : -MATE - ei.mate;
+	else
+		score[i] = ei.cp;
+	depth[i] = ei.depth;
+	haveScore[i] = true;
+}
+
+void MatchGame::slotMove(const QString& move, const QString& ponder)
+{
+	int i = engineIndex();
+	int used, s;
+	ChessBoard cb;
+	ChessMove m;
+	char sz[64];
+
+	if (!running || (i != toMove))
+		return;
+	flagTimer.stop();
+	used = (int)watch.elapsed();
+	clock[i] -= used;
+	game.getPosition(cb);
+	if (clock[i] < -match->settings.timeMargin)
+	{
+		end((cb.toMove == WHITE) ? "0-1" : "1-0", (cb.toMove == WHITE) ? "White loses on time" : "Black loses on time");
+		return;
+	}
+	m = cb.getMoveFromText(move.toStdString());
+	if (m.empty() || !game.addMove(m))
+	{
+		end((cb.toMove == WHITE) ? "0-1" : "1-0", match->name[i].toStdString() + " makes an illegal move: " + move.toStdString());
+		return;
+	}
+	clock[i] += match->settings.increment;
+
+	// Score from the side that moved, depth and time.
+	if (haveScore[i])
+	{
+		s = (cb.toMove == WHITE) ? score[i] : -score[i];
+		if (abs(s) > MATE - 1000)
+			sprintf_s(sz, 64, "%sM%d/%d %.3fs", (s > 0) ? "+" : "-", (s > 0) ? MATE - s : MATE + s, depth[i], used / 1000.0);
+		else
+			sprintf_s(sz, 64, "%+.2f/%d %.3fs", s / 100.0, depth[i], used / 1000.0);
+	}
+	else
+	{
+		sprintf_s(sz, 64, "%.3fs", used / 1000.0);
+	}
+	game.addMoveComment(sz);
+
+	game.getPosition(cb);
+	adjudicate(cb);
+	if (running)
+		go();
+}
+
+// Check for the end of the game after a move by toMove.
+void MatchGame::adjudicate(ChessBoard& cb)
+{
+	MoveGenerator mgen;
+	MoveList ml;
+	MatchSettings& ms = match->settings;
+	int s;
+
+	mgen.makeMoves(cb, ml);
+	if (!ml.size())
+	{
+		if (mgen.inCheck(cb, cb.toMove))
+			end((cb.toMove == WHITE) ? "0-1" : "1-0", (cb.toMove == WHITE) ? "Black mates" : "White mates");
+		else
+			end("1/2-1/2", "Stalemate");
+		return;
+	}
+	switch (game.isDraw())
+	{
+	case 1:
+		end("1/2-1/2", "Draw by 3-fold repetition");
+		return;
+	case 2:
+		end("1/2-1/2", "Draw by the 50 moves rule");
+		return;
+	case 3:
+		end("1/2-1/2", "Draw by insufficient material");
+		return;
+	}
+	if (ms.maxMoves && (game.mainMoves() >= 2 * ms.maxMoves))
+	{
+		end("1/2-1/2", "Draw by adjudication, max moves");
+		return;
+	}
+
+	// The scores from the two engines are taken in turn, so both must agree.
+	if (!haveScore[toMove])
+	{
+		drawCount = resignCount = 0;
+		return;
+	}
+	s = score[toMove];
+	if (ms.drawMoves && (game.mainMoves() >= 2 * ms.drawMoveNumber) && (abs(s) <= ms.drawScore))
+		++drawCount;
+	else
+		drawCount = 0;
+	if (ms.resignMoves && (s >= ms.resignScore))
+		resignCount = (resignCount > 0) ? resignCount + 1 : 1;
+	else if (ms.resignMoves && (s <= -ms.resignScore))
+		resignCount = (resignCount < 0) ? resignCount - 1 : -1;
+	else
+		resignCount = 0;
+
+	if (ms.drawMoves && (drawCount >= 2 * ms.drawMoves))
+		end("1/2-1/2", "Draw by adjudication");
+	else if (ms.resignMoves && (resignCount >= 2 * ms.resignMoves))
+		end("1-0", "White wins by adjudication");
+	else if (ms.resignMoves && (resignCount <= -2 * ms.resignMoves))
+		end("0-1", "Black wins by adjudication");
+}
+
+void MatchGame::slotFlag()
+{
+	if (!running)
+		return;
+	engine[toMove]->stop();
+	end((toMove == white) ? "0-1" : "1-0", (toMove == white) ? "White loses on time" : "Black loses on time");
+}
+
+void MatchGame::slotStoped()
+{
+	int i = engineIndex();
+	loaded[i] = false;
+	if (running)
+		end((i == white) ? "0-1" : "1-0", match->name[i].toStdString() + " disconnects");
+	// The engine can't be deleted from its own signal.
+	QTimer::singleShot(0, this, SLOT(slotReload()));
+}
+
+void MatchGame::slotReload()
+{
+	int i;
+	for (i = 0; i < 2; i++)
+	{
+		if (!loaded[i] && engine[i]->isLoaded())
+		{
+			engine[i]->unload();
+			engine[i]->load(match->settings.engine[i]);
+		}
+	}
+}
+
+void MatchGame::end(const char* result, const std::string& reason)
+{
+	running = false;
+	flagTimer.stop();
+	game.info.Result = result;
+	game.info.Remark = reason;
+	emit finished(this);
+}
+
+Match::Match()
+{
+	started = 0;
+	done = 0;
+	stopping = false;
+}
+
+Match::~Match()
+{
+	int i;
+	for (i = 0; i < games.size(); i++)
+		delete games[i];
+	pgn.close();
+}
+
+bool Match::start()
+{
+	SYSTEM_INFO si;
+	int i, n, threads;
+
+	error = "";
+	threads = 1;
+	for (i = 0; i < 2; i++)
+	{
+		QSettings ini(settings.engine[i], QSettings::IniFormat);
+		if (ini.value("Engine/path").toString().isEmpty())
+		{
+			error = "Unable to read engine: " + settings.engine[i].toStdString();
+			return false;
+		}
+		threads = __max(threads, ini.value("Option/Threads", 1).toInt());
+		name[i] = QFileInfo(settings.engine[i]).completeBaseName();
+	}
+	if (name[0] == name[1])
+		name[1] += " 2";
+	if (!loadOpenings())
+		return false;
+	if (!settings.pgnFile.empty() && !pgn.open(settings.pgnFile, false))
+	{
+		error = "Unable to open: " + settings.pgnFile;
+		return false;
+	}
+	stats.clear();
+	stats.elo0 = settings.elo0;
+	stats.elo1 = settings.elo1;
+	stats.alpha = settings.alpha;
+	stats.beta = settings.beta;
+
+	// Only one engine in a game is searching, so one game for each processor.
+	settings.games += settings.games % 2;
+	n = settings.concurrency;
+	if (n <= 0)
+	{
+		GetSystemInfo(&si);
+		n = __max(1, (int)si.dwNumberOfProcessors / threads);
+	}
+	n = __min(n, settings.games);
+	printf("Playing %d games, %d at a time.\n", settings.games, n);
+	fflush(stdout);
+	for (i = 0; i < n; i++)
+	{
+		MatchGame* mg = new MatchGame(this);
+		games.push_back(mg);
+		connect(mg, SIGNAL(finished(MatchGame*)), SLOT(slotGameFinished(MatchGame*)));
+		if (!mg->load())
+		{
+			error = "Unable to start the engines.";
+			return false;
+		}
+		startNext(mg);
+	}
+	return true;
+}
+
+// Read the openings, from a pgn file the main line up to openingPlies.
+bool Match::loadOpenings()
+{
+	MatchOpening o;
+	string line;
+	size_t len;
+	int pos, ply;
+
+	openings.clear();
+	if (settings.openingFile.empty())
+		return true;
+	len = settings.openingFile.length();
+	if ((len > 4) && (_stricmp(settings.openingFile.substr(len - 4).c_str(), ".pgn") == 0))
+	{
+		Pgn in;
+		ChessGame g;
+		DWORD index;
+		if (!in.open(settings.openingFile, true))
+		{
+			error = "Unable to open: " + settings.openingFile;
+			return false;
+		}
+		// The opening file is read by every match, the next open uses the saved index.
+		in.saveIndex(true);
+		for (index = 1; in.read(g, index, settings.openingPlies / 2 + 1, false); index++)
+		{
+			o.fen = g.position[0].board.getFen();
+			o.moves.clear();
+			pos = 0;
+			for (ply = 0; (ply < settings.openingPlies) && (pos < (int)g.position.size()) && g.position[pos].move.size(); ply++)
+			{
+				o.moves.push_back(g.position[pos].move[0].move);
+				pos = g.position[pos].move[0].posIndex;
+			}
+			openings.push_back(o);
+		}
+		in.close();
+	}
+	else
+	{
+		ifstream in(settings.openingFile);
+		if (!in.is_open())
+		{
+			error = "Unable to open: " + settings.openingFile;
+			return false;
+		}
+		while (getline(in, line))
+		{
+			line = trim(line);
+			if (line.empty())
+				continue;
+			o.fen = getWord(line, 1) + " " + getWord(line, 2) + " " + getWord(line, 3) + " " + getWord(line, 4) + " 0 1";
+			o.moves.clear();
+			openings.push_back(o);
+		}
+	}
+	if (!openings.size())
+	{
+		error = "No openings in: " + settings.openingFile;
+		return false;
+	}
+	return true;
+}
+
+// Give the slot the next game, each opening is played twice.
+void Match::startNext(MatchGame* mg)
+{
+	static const MatchOpening startPosition;
+	if (stopping || (started >= settings.games))
+	{
+		mg->number = 0;
+		return;
+	}
+	++started;
+	if (openings.size())
+		mg->start(started, openings[((started - 1) / 2) % openings.size()], (started % 2) == 1);
+	else
+		mg->start(started, startPosition, (started % 2) == 1);
+}
+
+void Match::slotGameFinished(MatchGame* mg)
+{
+	int score;
+	++done;
+	if (mg->game.info.Result == "1-0")
+		score = mg->firstEngineWhite() ? 2 : 0;
+	else if (mg->game.info.Result == "0-1")
+		score = mg->firstEngineWhite() ? 0 : 2;
+	else
+		score = 1;
+	stats.add(score, mg->pairId);
+	if (!settings.pgnFile.empty())
+		pgn.appendGame(mg->game);
+	printf("Game %d (%s - %s): %s {%s}\n", mg->number, mg->game.info.White.c_str(), mg->game.info.Black.c_str(), mg->game.info.Result.c_str(), mg->game.info.Remark.c_str());
+	printScore();
+
+	if (settings.sprt && !stopping && stats.sprtResult())
+	{
+		stopping = true;
+		printf("SPRT: %s accepted.\n", (stats.sprtResult() > 0) ? "H1" : "H0");
+	}
+	fflush(stdout);
+	startNext(mg);
+	if (done == started)
+		emit matchFinished();
+}
+
+void Match::printScore()
+{
+	double elo, margin;
+	elo = stats.elo(margin);
+	printf("Score of %s vs %s: %d - %d - %d [%.3f] %d\n", name[0].toLatin1().constData(), name[1].toLatin1().constData(),
+		stats.wins, stats.losses, stats.draws, stats.score(), stats.games());
+	printf("Elo difference: %.1f +/- %.1f", elo, margin);
+	if (settings.sprt)
+		printf(", LLR %.2f (%.2f, %.2f) [%.1f, %.1f]", stats.llr(), stats.lowerBound(), stats.upperBound(), stats.elo0, stats.elo1);
+	printf("\n");
+}
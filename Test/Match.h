@@ -0,0 +1,135 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QVector>
+#include <string>
+#include <vector>
+#include "../Common/ChessGame.h"
+#include "../Common/Engine.h"
+#include "../Common/Pgn.h"
+#include "MatchStats.h"
+
+class Match;
+
+// A start position with the moves played from it.
+struct MatchOpening
+{
+	std::string fen;
+	std::vector<ChessMove> moves;
+};
+
+struct MatchSettings
+{
+	// Engine setup files, as read by Engine::load.
+	QString engine[2];
+	int games;
+	// Games played at the same time, 0 for one on each processor.
+	int concurrency;
+	// Clock in ms.
+	int baseTime;
+	int increment;
+	// Time an engine can use over the clock before it lose on time.
+	int timeMargin;
+	// Epd or pgn, each opening is played twice with the colours swapped.
+	std::string openingFile;
+	int openingPlies;
+	std::string pgnFile;
+	bool sprt;
+	double elo0;
+	double elo1;
+	double alpha;
+	double beta;
+	// Draw if both engines score within drawScore for drawMoves moves after drawMoveNumber, 0 to turn off.
+	int drawMoveNumber;
+	int drawMoves;
+	int drawScore;
+	// Win if both engines score over resignScore for one side for resignMoves moves, 0 to turn off.
+	int resignMoves;
+	int resignScore;
+	// Draw after this many moves, 0 to turn off.
+	int maxMoves;
+	MatchSettings();
+};
+
+// One game slot with its own pair of engines. The engines are kept
+// running between the games.
+class MatchGame :public QObject
+{
+	Q_OBJECT
+
+	Match* match;
+	Engine* engine[2];
+	bool loaded[2];
+	bool ready[2];
+	bool running;
+	// Engine to move, and the engine playing white.
+	int toMove;
+	int white;
+	int clock[2];
+	QElapsedTimer watch;
+	QTimer flagTimer;
+	// Last score from white for each engine, and if there is one for this search.
+	int score[2];
+	int depth[2];
+	bool haveScore[2];
+	int drawCount;
+	int resignCount;
+	int engineIndex();
+	void prepare();
+	void go();
+	void adjudicate(ChessBoard& cb);
+	void end(const char* result, const std::string& reason);
+public slots:
+	void slotStarted();
+	void slotStoped();
+	void slotInfo(const EngineInfo&);
+	void slotMove(const QString&, const QString&);
+	void slotFlag();
+	void slotReload();
+signals:
+	void finished(MatchGame*);
+public:
+	int number; // From 1, 0 if no game is given.
+	int pairId;
+	ChessGame game;
+	MatchGame(Match* m);
+	virtual ~MatchGame();
+	bool load();
+	// The first engine plays white if firstWhite.
+	void start(int n, const MatchOpening& opening, bool firstWhite);
+	inline bool firstEngineWhite() { return white == 0; };
+};
+
+// Engine against engine match. All games run in the Qt event loop, the
+// engines are separate processes so one game slot for each processor is
+// enough to keep them busy.
+class Match :public QObject
+{
+	Q_OBJECT
+
+	std::vector<MatchOpening> openings;
+	QVector<MatchGame*> games;
+	Pgn pgn;
+	int started;
+	int done;
+	bool stopping;
+	std::string error;
+	bool loadOpenings();
+	void startNext(MatchGame* mg);
+	void printScore();
+public slots:
+	void slotGameFinished(MatchGame*);
+signals:
+	void matchFinished();
+public:
+	MatchSettings settings;
+	MatchStats stats;
+	QString name[2];
+	Match();
+	virtual ~Match();
+	bool start();
+	inline const std::string& lastError() { return error; };
+};
@@ -0,0 +1,117 @@
+#include "MatchStats.h"
+
+using namespace std;
+
+// Logistic Elo to expected score.
+static double eloScore(double elo)
+{
+	return 1.0 / (1.0 + pow(10.0, -elo / 400.0));
+}
+
+static double scoreElo(double score)
+{
+	if (score <= 0.0)
+		return -999.0;
+	if (score >= 1.0)
+		return 999.0;
+	return -400.0*log10(1.0 / score - 1.0);
+}
+
+MatchStats::MatchStats()
+{
+	elo0 = 0.0;
+	elo1 = 5.0;
+	alpha = 0.05;
+	beta = 0.05;
+	clear();
+}
+
+void MatchStats::clear()
+{
+	int i;
+	wins = losses = draws = 0;
+	for (i = 0; i < 5; i++)
+		pair[i] = 0;
+	pending.clear();
+}
+
+void MatchStats::add(int score, int pairId)
+{
+	map<int, int>::iterator it;
+	if (score == 2)
+		++wins;
+	else if (score == 1)
+		++draws;
+	else
+		++losses;
+
+	it = pending.find(pairId);
+	if (it == pending.end())
+	{
+		pending[pairId] = score;
+		return;
+	}
+	++pair[it->second + score];
+	pending.erase(it);
+}
+
+double MatchStats::score()
+{
+	if (!games())
+		return 0.5;
+	return (wins + draws / 2.0) / games();
+}
+
+double MatchStats::elo(double& margin)
+{
+	double mean, var, dev;
+	int i, n;
+
+	margin = 0;
+	n = pairs();
+	if (n < 2)
+		return scoreElo(score());
+	mean = var = 0;
+	for (i = 0; i < 5; i++)
+		mean += pair[i] * i / 4.0;
+	mean /= n;
+	for (i = 0; i < 5; i++)
+		var += pair[i] * (i / 4.0 - mean)*(i / 4.0 - mean);
+	var /= n;
+	dev = 1.96*sqrt(var / n);
+	margin = (scoreElo(mean + dev) - scoreElo(mean - dev)) / 2;
+	return scoreElo(mean);
+}
+
+// The normal approximation of the generalized SPRT on the pair scores.
+double MatchStats::llr()
+{
+	double mean, var, s0, s1;
+	int i, n;
+
+	n = pairs();
+	if (n < 2)
+		return 0;
+	mean = var = 0;
+	for (i = 0; i < 5; i++)
+		mean += pair[i] * i / 4.0;
+	mean /= n;
+	for (i = 0; i < 5; i++)
+		var += pair[i] * (i / 4.0 - mean)*(i / 4.0 - mean);
+	var /= n;
+	if (var <= 0)
+		return 0;
+	s0 = eloScore(elo0);
+	s1 = eloScore(elo1);
+	return n*(s1 - s0)*(2 * mean - s0 - s1) / (2 * var);
+}
+
+int MatchStats::sprtResult()
+{
+	double l = llr();
+	if (l <= lowerBound())
+		return -1;
+	if (l >= upperBound())
+		return 1;
+	return 0;
+}
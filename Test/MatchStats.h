@@ -0,0 +1,40 @@
+#pragma once
+
+#include <math.h>
+#include <map>
+
+// Results of a match seen from the first engine. The openings are played
+// in pairs with the colours swapped, and the score of each pair (0, 0.5,
+// 1, 1.5 or 2) is counted in pair[]. The pairs are used for the error and
+// the SPRT, as the two games from the same opening are not independent.
+class MatchStats
+{
+	// The first game of each pair not finished, in half points.
+	std::map<int, int> pending;
+public:
+	int wins;
+	int losses;
+	int draws;
+	int pair[5];
+	// SPRT bounds in logistic Elo, and the error rates.
+	double elo0;
+	double elo1;
+	double alpha;
+	double beta;
+	MatchStats();
+	void clear();
+	// Add a game, score in half points (0, 1 or 2) for the first engine.
+	// Games from the same opening pair must have the same pairId.
+	void add(int score, int pairId);
+	inline int games() { return wins + losses + draws; };
+	inline int pairs() { return pair[0] + pair[1] + pair[2] + pair[3] + pair[4]; };
+	double score();
+	// Elo with the 95% error margin.
+	double elo(double& margin);
+	// Log likelihood ratio for elo1 against elo0.
+	double llr();
+	inline double lowerBound() { return log(beta / (1 - alpha)); };
+	inline double upperBound() { return log((1 - beta) / alpha); };
+	// -1 if elo0 is accepted, 1 if elo1 is accepted, else 0.
+	int sprtResult();
+};
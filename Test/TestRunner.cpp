@@ -0,0 +1,292 @@
+#include <Windows.h>
+#include <stdio.h>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QSettings>
+#include "TestRunner.h"
+#include "../Common/MoveList.h"
+
+using namespace std;
+
+TestRunSettings::TestRunSettings()
+{
+	searchtype = TIME_SEARCH;
+	limit = 1000;
+	concurrency = 0;
+	timeMargin = 1000;
+}
+
+TestEngine::TestEngine(TestRunner* r)
+{
+	runner = r;
+	loaded = false;
+	running = false;
+	busy = false;
+	depth = 0;
+	nodes = 0;
+	haveSolution = false;
+	engine = new Engine();
+	connect(engine, SIGNAL(engineStarted()), SLOT(slotStarted()));
+	connect(engine, SIGNAL(engineStoped()), SLOT(slotStoped()));
+	connect(engine, SIGNAL(engineInfo(const EngineInfo&)), SLOT(slotInfo(const EngineInfo&)));
+	connect(engine, SIGNAL(engineMove(const QString&, const QString&)), SLOT(slotMove(const QString&, const QString&)));
+	stopTimer.setSingleShot(true);
+	connect(&stopTimer, SIGNAL(timeout()), SLOT(slotStopTimer()));
+}
+
+TestEngine::~TestEngine()
+{
+	stopTimer.stop();
+	disconnect(engine, 0, this, 0);
+	delete engine;
+}
+
+bool TestEngine::load()
+{
+	return engine->load(runner->settings.engine);
+}
+
+void TestEngine::start(const TestPosition& tp)
+{
+	position = tp;
+	busy = true;
+	if (loaded)
+		engine->newGame();
+}
+
+void TestEngine::slotStarted()
+{
+	// The first time is when the engine has loaded.
+	if (!loaded)
+	{
+		loaded = true;
+		if (busy && !running)
+			engine->newGame();
+		return;
+	}
+	if (busy && !running)
+		go();
+}
+
+void TestEngine::go()
+{
+	MoveList ml;
+	TestRunSettings& ts = runner->settings;
+
+	running = true;
+	depth = 0;
+	nodes = 0;
+	haveSolution = false;
+	result = TestResult();
+	result.posid = position.id;
+	board.setFen(position.fen.c_str());
+	engine->search(board, ml, ts.searchtype, ts.limit);
+	watch.start();
+	if (ts.searchtype == TIME_SEARCH)
+		stopTimer.start(ts.limit + ts.timeMargin);
+}
+
+void TestEngine::slotInfo(const EngineInfo& ei)
+{
+	bool solved;
+	if (!running || !ei.pv.size() || (ei.multipv > 1))
+		return;
+	depth = ei.depth;
+	nodes = ei.nodes;
+	position.score(board.makeMoveText(ei.pv[0], UCI), solved);
+	if (!solved)
+	{
+		haveSolution = false;
+		return;
+	}
+	if (haveSolution)
+		return;
+	haveSolution = true;
+	result.time = ei.time ? (int)ei.time : (int)watch.elapsed();
+	result.depth = ei.depth;
+	result.nodes = ei.nodes;
+}
+
+void TestEngine::slotMove(const QString& move, const QString& ponder)
+{
+	ChessMove m;
+	if (!running)
+		return;
+	running = false;
+	busy = false;
+	stopTimer.stop();
+	m = board.getMoveFromText(move.toStdString());
+	result.move = m.empty() ? move.toStdString() : board.makeMoveText(m, UCI);
+	result.score = position.score(result.move, result.solved);
+	// Not solved, or the move played was not in the last pv.
+	if (!result.solved || !haveSolution)
+	{
+		result.time = (int)watch.elapsed();
+		result.depth = depth;
+		result.nodes = nodes;
+	}
+	emit finished(this);
+}
+
+void TestEngine::slotStopTimer()
+{
+	if (running)
+		engine->stop();
+}
+
+void TestEngine::slotStoped()
+{
+	loaded = false;
+	if (running)
+	{
+		running = false;
+		busy = false;
+		stopTimer.stop();
+		// A result without position is not saved.
+		result.posid = 0;
+		emit finished(this);
+	}
+	// The engine can't be deleted from its own signal.
+	QTimer::singleShot(0, this, SLOT(slotReload()));
+}
+
+void TestEngine::slotReload()
+{
+	if (!loaded && engine->isLoaded())
+	{
+		engine->unload();
+		engine->load(runner->settings.engine);
+	}
+}
+
+TestRunner::TestRunner()
+{
+	testSet = NULL;
+	started = 0;
+	done = 0;
+	solved = 0;
+}
+
+TestRunner::~TestRunner()
+{
+	int i;
+	for (i = 0; i < engines.size(); i++)
+		delete engines[i];
+}
+
+bool TestRunner::start(TestSet& ts, int setid)
+{
+	SYSTEM_INFO si;
+	QString path, type;
+	int i, n, threads;
+
+	error = "";
+	testSet = &ts;
+	QSettings ini(settings.engine, QSettings::IniFormat);
+	path = ini.value("Engine/path").toString();
+	type = ini.value("Engine/type").toString();
+	threads = __max(1, ini.value("Option/Threads", 1).toInt());
+	if (path.isEmpty())
+	{
+		error = "Unable to read engine: " + settings.engine.toStdString();
+		return false;
+	}
+	name = QFileInfo(settings.engine).completeBaseName();
+	if (settings.build.isEmpty())
+	{
+		if (!QFileInfo(path).exists())
+		{
+			error = "Unable to find the engine: " + path.toStdString();
+			return false;
+		}
+		settings.build = QFileInfo(path).lastModified().toString("yyyy-MM-dd hh:mm:ss");
+	}
+	switch (settings.searchtype)
+	{
+	case TIME_SEARCH:
+		searchlimit = "movetime " + QString().setNum(settings.limit);
+		break;
+	case DEPTH_SEARCH:
+		searchlimit = "depth " + QString().setNum(settings.limit);
+		break;
+	case NODES_SEARCH:
+		if (QString::compare(type, "uci", Qt::CaseInsensitive) != 0)
+		{
+			error = "A node limit needs an uci engine.";
+			return false;
+		}
+		searchlimit = "nodes " + QString().setNum(settings.limit);
+		break;
+	default:
+		error = "Unknown search limit.";
+		return false;
+	}
+
+	if (!ts.pending(setid, name, settings.build, searchlimit, positions))
+	{
+		error = ts.lastError();
+		return false;
+	}
+	printf("%s %s, %s: %u positions to run.\n", name.toLatin1().constData(), settings.build.toLatin1().constData(),
+		searchlimit.toLatin1().constData(), (unsigned int)positions.size());
+	fflush(stdout);
+	if (!positions.size())
+		return true;
+
+	n = settings.concurrency;
+	if (n <= 0)
+	{
+		GetSystemInfo(&si);
+		n = __max(1, (int)si.dwNumberOfProcessors / threads);
+	}
+	n = __min(n, (int)positions.size());
+	for (i = 0; i < n; i++)
+	{
+		TestEngine* te = new TestEngine(this);
+		engines.push_back(te);
+		connect(te, SIGNAL(finished(TestEngine*)), SLOT(slotPositionFinished(TestEngine*)));
+		if (!te->load())
+		{
+			error = "Unable to start the engine.";
+			return false;
+		}
+		startNext(te);
+	}
+	return true;
+}
+
+void TestRunner::startNext(TestEngine* te)
+{
+	if (started >= positions.size())
+		return;
+	te->start(positions[started++]);
+}
+
+void TestRunner::slotPositionFinished(TestEngine* te)
+{
+	TestResult& r = te->result;
+	TestPosition& tp = te->position;
+
+	++done;
+	if (!r.posid)
+	{
+		printf("%u/%u %s: %s disconnects\n", (unsigned int)done, (unsigned int)positions.size(), tp.name.c_str(), name.toLatin1().constData());
+	}
+	else
+	{
+		if (r.solved)
+			++solved;
+		printf("%u/%u %s: %s %d%s %.3fs d%d n%lu\n", (unsigned int)done, (unsigned int)positions.size(), tp.name.c_str(),
+			r.move.c_str(), r.score, r.solved ? " solved" : "", r.time / 1000.0, r.depth, r.nodes);
+		if (!testSet->addResult(name, settings.build, searchlimit, r))
+			printf("%s\n", testSet->lastError().c_str());
+	}
+	fflush(stdout);
+	startNext(te);
+	if (done == positions.size())
+	{
+		printf("Solved %d of %u.\n", solved, (unsigned int)positions.size());
+		fflush(stdout);
+		emit runFinished();
+	}
+}
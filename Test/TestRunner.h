@@ -0,0 +1,99 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QVector>
+#include <string>
+#include <vector>
+#include "../Common/ChessBoard.h"
+#include "../Common/Engine.h"
+#include "TestSet.h"
+
+class TestRunner;
+
+struct TestRunSettings
+{
+	// Engine setup file, as read by Engine::load.
+	QString engine;
+	// Version of the engine, the time of the engine file if empty.
+	QString build;
+	// TIME_SEARCH (ms), NODES_SEARCH or DEPTH_SEARCH.
+	SEARCHTYPE searchtype;
+	int limit;
+	// Engines running at the same time, 0 for one on each processor.
+	int concurrency;
+	// Time a TIME_SEARCH can use over the limit before it is stopped.
+	int timeMargin;
+	TestRunSettings();
+};
+
+// One engine running positions. The hash is cleared with a new game
+// before each position.
+class TestEngine :public QObject
+{
+	Q_OBJECT
+
+	TestRunner* runner;
+	Engine* engine;
+	bool loaded;
+	bool running;
+	ChessBoard board;
+	QElapsedTimer watch;
+	QTimer stopTimer;
+	// Depth and nodes of the last info, and the first info with the
+	// solution since the engine last changed its mind.
+	int depth;
+	unsigned long nodes;
+	bool haveSolution;
+	void go();
+public slots:
+	void slotStarted();
+	void slotStoped();
+	void slotInfo(const EngineInfo&);
+	void slotMove(const QString&, const QString&);
+	void slotStopTimer();
+	void slotReload();
+signals:
+	void finished(TestEngine*);
+public:
+	bool busy;
+	TestPosition position;
+	TestResult result;
+	TestEngine(TestRunner* r);
+	virtual ~TestEngine();
+	bool load();
+	void start(const TestPosition& tp);
+};
+
+// Run the positions of a testset that have no result for the engine,
+// build and search limit. The results are saved as they come in, so a
+// run can be stopped and continued later.
+class TestRunner :public QObject
+{
+	Q_OBJECT
+
+	TestSet* testSet;
+	std::vector<TestPosition> positions;
+	QVector<TestEngine*> engines;
+	size_t started;
+	size_t done;
+	int solved;
+	std::string error;
+	void startNext(TestEngine* te);
+public slots:
+	void slotPositionFinished(TestEngine*);
+signals:
+	void runFinished();
+public:
+	TestRunSettings settings;
+	QString name;
+	QString searchlimit;
+	TestRunner();
+	virtual ~TestRunner();
+	// Returns false on errors, check count() for positions to run.
+	bool start(TestSet& ts, int setid);
+	inline size_t count() { return positions.size(); };
+	inline const std::string& lastError() { return error; };
+};
@@ -2,11 +2,72 @@
 #include <QSqlDatabase>
 #include <QSqlQuery>
 #include <QSqlError>
+#include <QStringList>
+#include <QFileInfo>
+#include <QDateTime>
 #include <QDebug>
+#include <fstream>
+#include <map>
+#include <stdlib.h>
+#include "../Common/ChessBoard.h"
+#include "../Common/Epd.h"
+#include "../Common/Utility.h"
+
+using namespace std;
 
 const char* DBNAME = "TestSet";
 const char* DBVERSION = "1.0";
 
+int TestPosition::score(const std::string& m, bool& solved) const
+{
+	string w;
+	int i, s, best;
+	bool found = false;
+	int moveScore = 0;
+
+	best = 0;
+	for (i = 1; (w = getWord(move, i)).length(); i++)
+	{
+		s = atoi(w.substr(w.find('=') + 1).c_str());
+		if (s > best)
+			best = s;
+		if (w.substr(0, w.find('=')) == m)
+		{
+			found = true;
+			moveScore = s;
+		}
+	}
+	// Only moves to avoid.
+	if (!best)
+	{
+		best = 10;
+		if (!found)
+			moveScore = 10;
+	}
+	solved = (moveScore == best);
+	return moveScore;
+}
+
+TestResult::TestResult()
+{
+	posid = 0;
+	score = 0;
+	solved = false;
+	time = 0;
+	depth = 0;
+	nodes = 0;
+}
+
+TestRunSummary::TestRunSummary()
+{
+	positions = 0;
+	solved = 0;
+	score = 0;
+	time = 0;
+	depth = 0;
+	nodes = 0;
+}
+
 TestSet::TestSet(QObject *parent)
 	: QObject(parent)
 {
@@ -25,6 +86,14 @@ TestSet::~TestSet()
 {
 }
 
+bool TestSet::setError(const std::string& what, const QString& dberror)
+{
+	error = what;
+	if (!dberror.isEmpty())
+		error += ": " + dberror.toStdString();
+	return false;
+}
+
 bool TestSet::create(const QString& path)
 {
 	QSqlDatabase db = QSqlDatabase::database(DBNAME);
@@ -36,7 +105,7 @@ bool TestSet::create(const QString& path)
 	{
 		qDebug() << "Create database error. Database: " << db.lastError().databaseText() << "Driver: " << db.lastError().driverText();
 		opened = false;
-		return false;
+		return setError("Unable to create: " + path.toStdString(), db.lastError().text());
 	}
 	QSqlQuery query(db);
 	query.exec("CREATE TABLE info ( db TEXT, version TEXT);");
@@ -51,7 +120,288 @@ bool TestSet::create(const QString& path)
 		"type	INTEGER,"
 		"PRIMARY KEY(id)"
 		"); ");
+	query.exec("CREATE TABLE position ( "
+		"id	INTEGER,"
+		"fen	TEXT,"
+		"setid	INTEGER,"
+		"move	TEXT,"
+		"name	TEXT,"
+		"PRIMARY KEY(id)"
+		"); ");
+	query.exec("CREATE TABLE result ( "
+		"id	INTEGER,"
+		"posid	INTEGER,"
+		"engine	TEXT,"
+		"build	TEXT,"
+		"searchlimit	TEXT,"
+		"move	TEXT,"
+		"score	INTEGER,"
+		"solved	INTEGER,"
+		"time	INTEGER,"
+		"depth	INTEGER,"
+		"nodes	INTEGER,"
+		"date	TEXT,"
+		"PRIMARY KEY(id)"
+		"); ");
+	query.exec("CREATE INDEX positionset ON position (setid);");
+	query.exec("CREATE INDEX resultposition ON result (posid);");
+	opened = true;
+	return true;
+}
+
+bool TestSet::open(const QString& path)
+{
+	QSqlDatabase db = QSqlDatabase::database(DBNAME);
+
+	if (!QFileInfo(path).exists())
+		return create(path);
+	db.setDatabaseName(path);
+	if (!db.open())
+	{
+		opened = false;
+		return setError("Unable to open: " + path.toStdString(), db.lastError().text());
+	}
+	if (!db.tables().contains("info") || !db.tables().contains("result"))
+	{
+		db.close();
+		opened = false;
+		return setError("Not a testset database: " + path.toStdString(), "");
+	}
 	opened = true;
 	return true;
 }
 
+int TestSet::setId(const QString& name)
+{
+	QSqlQuery query(QSqlDatabase::database(DBNAME));
+	query.prepare("SELECT id FROM testset WHERE name = :name;");
+	query.bindValue(":name", name);
+	if (!query.exec() || !query.next())
+		return -1;
+	return query.value(0).toInt();
+}
+
+// Read the moves of an epd line as coordinate moves with scores.
+static string epdMoves(Epd& epd, ChessBoard& cb)
+{
+	ChessMove m;
+	string w, moves;
+	int i;
+
+	if (epd.c[8].length() && epd.c[9].length())
+	{
+		for (i = 1; (w = getWord(epd.c[9], i)).length(); i++)
+		{
+			m = cb.getMoveFromText(w);
+			if (m.empty())
+				continue;
+			moves += cb.makeMoveText(m, UCI) + "=" + getWord(epd.c[8], i) + " ";
+		}
+		return trim(moves);
+	}
+	for (i = 1; (w = getWord(epd.bm, i)).length(); i++)
+	{
+		m = cb.getMoveFromText(w);
+		if (!m.empty())
+			moves += cb.makeMoveText(m, UCI) + "=10 ";
+	}
+	for (i = 1; (w = getWord(epd.am, i)).length(); i++)
+	{
+		m = cb.getMoveFromText(w);
+		if (!m.empty())
+			moves += cb.makeMoveText(m, UCI) + "=0 ";
+	}
+	return trim(moves);
+}
+
+bool TestSet::importEpd(const std::string& path, const QString& name, int& added, int& changed, int& removed)
+{
+	QSqlDatabase db = QSqlDatabase::database(DBNAME);
+	QSqlQuery query(db);
+	// Positions in the database by fen, with the moves and the name.
+	map<string, TestPosition> old;
+	map<string, TestPosition>::iterator it;
+	map<string, bool> seen;
+	TestPosition tp;
+	ChessBoard cb;
+	Epd epd;
+	string line, fen, moves;
+	int setid;
+
+	added = changed = removed = 0;
+	if (!opened)
+		return setError("No database is open.", "");
+	ifstream in(path);
+	if (!in.is_open())
+		return setError("Unable to open: " + path, "");
+
+	db.transaction();
+	setid = setId(name);
+	if (setid < 0)
+	{
+		query.prepare("INSERT INTO testset (name, description, type) VALUES (:name, :description, 0);");
+		query.bindValue(":name", name);
+		query.bindValue(":description", QFileInfo(path.c_str()).fileName());
+		if (!query.exec())
+		{
+			db.rollback();
+			return setError("Unable to add the testset", query.lastError().text());
+		}
+		setid = query.lastInsertId().toInt();
+	}
+
+	query.prepare("SELECT id, fen, move, name FROM position WHERE setid = :setid;");
+	query.bindValue(":setid", setid);
+	query.exec();
+	while (query.next())
+	{
+		tp.id = query.value(0).toInt();
+		tp.fen = query.value(1).toString().toStdString();
+		tp.move = query.value(2).toString().toStdString();
+		tp.name = query.value(3).toString().toStdString();
+		old[tp.fen] = tp;
+	}
+
+	while (getline(in, line))
+	{
+		line = trim(line);
+		if (line.empty())
+			continue;
+		epd.set(line);
+		cb.setFen(epd.getFen().c_str());
+		fen = cb.getFen();
+		moves = epdMoves(epd, cb);
+		if (moves.empty() || seen.count(fen))
+			continue;
+		seen[fen] = true;
+		it = old.find(fen);
+		if (it == old.end())
+		{
+			query.prepare("INSERT INTO position (fen, setid, move, name) VALUES (:fen, :setid, :move, :name);");
+			query.bindValue(":fen", fen.c_str());
+			query.bindValue(":setid", setid);
+			query.bindValue(":move", moves.c_str());
+			query.bindValue(":name", epd.id.c_str());
+			query.exec();
+			++added;
+		}
+		else if ((it->second.move != moves) || (it->second.name != epd.id))
+		{
+			query.prepare("UPDATE position SET move = :move, name = :name WHERE id = :id;");
+			query.bindValue(":move", moves.c_str());
+			query.bindValue(":name", epd.id.c_str());
+			query.bindValue(":id", it->second.id);
+			query.exec();
+			// The name alone don't change the solution.
+			if (it->second.move != moves)
+			{
+				query.prepare("DELETE FROM result WHERE posid = :id;");
+				query.bindValue(":id", it->second.id);
+				query.exec();
+				++changed;
+			}
+		}
+	}
+
+	for (it = old.begin(); it != old.end(); ++it)
+	{
+		if (seen.count(it->first))
+			continue;
+		query.prepare("DELETE FROM result WHERE posid = :id;");
+		query.bindValue(":id", it->second.id);
+		query.exec();
+		query.prepare("DELETE FROM position WHERE id = :id;");
+		query.bindValue(":id", it->second.id);
+		query.exec();
+		++removed;
+	}
+	if (!db.commit())
+		return setError("Unable to import " + path, db.lastError().text());
+	return true;
+}
+
+bool TestSet::pending(int setid, const QString& engine, const QString& build, const QString& searchlimit, std::vector<TestPosition>& list)
+{
+	QSqlQuery query(QSqlDatabase::database(DBNAME));
+	TestPosition tp;
+
+	list.clear();
+	query.prepare("SELECT id, fen, move, name FROM position WHERE setid = :setid AND id NOT IN "
+		"(SELECT posid FROM result WHERE engine = :engine AND build = :build AND searchlimit = :searchlimit) ORDER BY id;");
+	query.bindValue(":setid", setid);
+	query.bindValue(":engine", engine);
+	query.bindValue(":build", build);
+	query.bindValue(":searchlimit", searchlimit);
+	if (!query.exec())
+		return setError("Unable to read the positions", query.lastError().text());
+	while (query.next())
+	{
+		tp.id = query.value(0).toInt();
+		tp.fen = query.value(1).toString().toStdString();
+		tp.move = query.value(2).toString().toStdString();
+		tp.name = query.value(3).toString().toStdString();
+		list.push_back(tp);
+	}
+	return true;
+}
+
+bool TestSet::addResult(const QString& engine, const QString& build, const QString& searchlimit, const TestResult& result)
+{
+	QSqlQuery query(QSqlDatabase::database(DBNAME));
+	query.prepare("INSERT INTO result (posid, engine, build, searchlimit, move, score, solved, time, depth, nodes, date) "
+		"VALUES (:posid, :engine, :build, :searchlimit, :move, :score, :solved, :time, :depth, :nodes, :date);");
+	query.bindValue(":posid", result.posid);
+	query.bindValue(":engine", engine);
+	query.bindValue(":build", build);
+	query.bindValue(":searchlimit", searchlimit);
+	query.bindValue(":move", result.move.c_str());
+	query.bindValue(":score", result.score);
+	query.bindValue(":solved", result.solved ? 1 : 0);
+	query.bindValue(":time", result.time);
+	query.bindValue(":depth", result.depth);
+	query.bindValue(":nodes", (qulonglong)result.nodes);
+	query.bindValue(":date", QDateTime::currentDateTime().toString(Qt::ISODate));
+	if (!query.exec())
+		return setError("Unable to save the result", query.lastError().text());
+	return true;
+}
+
+bool TestSet::summary(int setid, std::vector<TestRunSummary>& runs)
+{
+	QSqlQuery query(QSqlDatabase::database(DBNAME));
+	map<QString, size_t> index;
+	QString key;
+	size_t i;
+
+	runs.clear();
+	query.prepare("SELECT r.engine, r.build, r.searchlimit, r.posid, r.solved, r.score, r.time, r.depth, r.nodes "
+		"FROM result r JOIN position p ON r.posid = p.id WHERE p.setid = :setid ORDER BY r.id;");
+	query.bindValue(":setid", setid);
+	if (!query.exec())
+		return setError("Unable to read the results", query.lastError().text());
+	while (query.next())
+	{
+		key = query.value(0).toString() + "\t" + query.value(1).toString() + "\t" + query.value(2).toString();
+		if (!index.count(key))
+		{
+			index[key] = runs.size();
+			runs.push_back(TestRunSummary());
+			runs.back().engine = query.value(0).toString();
+			runs.back().build = query.value(1).toString();
+			runs.back().searchlimit = query.value(2).toString();
+		}
+		i = index[key];
+		TestRunSummary& trs = runs[i];
+		++trs.positions;
+		trs.score += query.value(5).toInt();
+		trs.depth += query.value(7).toInt();
+		trs.nodes += query.value(8).toDouble();
+		if (query.value(4).toInt())
+		{
+			++trs.solved;
+			trs.time += query.value(6).toInt();
+		}
+		trs.result.push_back(pair<int, bool>(query.value(3).toInt(), query.value(4).toInt() != 0));
+	}
+	return true;
+}
@@ -28,11 +28,95 @@ Position table
 
 	move	text
 		List of moves whith score for position.
+		Coordinate moves with the score, 'e2e4=10 d2d4=5'.
+
+	name	text
+		The epd id of the position.
+
+Result table
+	id			integer
+		Id for this result.
+
+	posid		integer
+		Point to the position.
+
+	engine		text
+		Name of the engine, the name of the engine file.
+
+	build		text
+		Version of the engine. Positions are only run once for each engine,
+		build and searchlimit.
+
+	searchlimit	text
+		'movetime 1000', 'nodes 100000' or 'depth 10'.
+
+	move		text
+		Move played by the engine.
+
+	score		integer
+		Score of the move played.
+
+	solved		integer
+		1 if the move played has the best score.
+
+	time		integer
+		Time in ms when the engine found and kept the solution.
+
+	depth		integer
+		Depth when the solution was found, or the last depth if not solved.
+
+	nodes		integer
+		Nodes when the solution was found, or the last nodes if not solved.
+
+	date		text
+		Time of the run.
 
 */
 
 #include <QObject>
 #include <QString>
+#include <string>
+#include <vector>
+
+struct TestPosition
+{
+	int id;
+	std::string fen;
+	std::string name;
+	std::string move;
+	// Score of a coordinate move, and if it is the best score. If only
+	// moves to avoid are given, all other moves are best.
+	int score(const std::string& m, bool& solved) const;
+};
+
+struct TestResult
+{
+	int posid;
+	std::string move;
+	int score;
+	bool solved;
+	int time;
+	int depth;
+	unsigned long nodes;
+	TestResult();
+};
+
+// Results for one engine, build and searchlimit in a testset.
+struct TestRunSummary
+{
+	QString engine;
+	QString build;
+	QString searchlimit;
+	int positions;
+	int solved;
+	int score;
+	double time; // Sum for the solved positions
+	double depth;
+	double nodes;
+	// Solved for each position id.
+	std::vector<std::pair<int, bool> > result;
+	TestRunSummary();
+};
 
 class TestSet : public QObject
 {
@@ -42,7 +126,24 @@ public:
 	TestSet(QObject *parent = 0);
 	~TestSet();
 	bool create(const QString& path);
+	// Open the database, it is created if it don't exist.
+	bool open(const QString& path);
+	// Returns -1 if there is no testset with this name.
+	int setId(const QString& name);
+	// Add or update the testset from an epd file. The moves are taken from
+	// bm (score 10) and am (score 0), or from c9 with the scores in c8 as in
+	// the STS files. Positions with changed moves lose their results, and
+	// positions not in the file are removed.
+	bool importEpd(const std::string& path, const QString& name, int& added, int& changed, int& removed);
+	// Positions in the testset without a result for this run.
+	bool pending(int setid, const QString& engine, const QString& build, const QString& searchlimit, std::vector<TestPosition>& list);
+	bool addResult(const QString& engine, const QString& build, const QString& searchlimit, const TestResult& result);
+	// All runs of a testset in the order they were first run.
+	bool summary(int setid, std::vector<TestRunSummary>& runs);
+	inline const std::string& lastError() { return error; };
 
 private:
 	bool opened;
+	std::string error;
+	bool setError(const std::string& what, const QString& dberror);
 };
@@ -0,0 +1,373 @@
+#include <process.h>
+#include <math.h>
+#include <fstream>
+#include "Tuner.h"
+#include "../Common/MoveGenerator.h"
+#include "../Common/Utility.h"
+
+using namespace std;
+
+TuneParameter Tuner::parameter[] = {
+	{ "pawn", &Evaluation::pawnValue, false },
+	{ "knight", &Evaluation::knightValue, true },
+	{ "bishop", &Evaluation::bishopValue, true },
+	{ "rook", &Evaluation::rookValue, true },
+	{ "queen", &Evaluation::queenValue, true },
+	{ "bishoppair", &Evaluation::bishopPair, true },
+	{ "mobility", &Evaluation::mobilityScore, true }
+};
+const int Tuner::parameters = sizeof(Tuner::parameter) / sizeof(Tuner::parameter[0]);
+
+enum
+{
+	JOB_EVALERROR = 1,
+	JOB_CACHE,
+	JOB_CACHEERROR,
+	JOB_GRADIENT
+};
+
+// The positions from start to end for one thread.
+struct TunerJob
+{
+	Tuner* tuner;
+	int job;
+	size_t start;
+	size_t end;
+	// Squared error, then the gradient for each parameter.
+	vector<double> sum;
+};
+
+void TunePosition::pack(ChessBoard& cb, int r)
+{
+	int sq;
+	for (sq = 0; sq < 32; sq++)
+		squares[sq] = (unsigned char)(cb[2 * sq] | (cb[2 * sq + 1] << 4));
+	flags = (unsigned char)(cb.toMove | (cb.castle << 1));
+	result = (unsigned char)r;
+}
+
+void TunePosition::unpack(ChessBoard& cb) const
+{
+	int sq;
+	cb.clear();
+	for (sq = 0; sq < 32; sq++)
+	{
+		cb[2 * sq] = squares[sq] & 0x0f;
+		cb[2 * sq + 1] = squares[sq] >> 4;
+	}
+	cb.toMove = flags & 1;
+	cb.castle = flags >> 1;
+}
+
+// Predicted result for white.
+static inline double sigmoid(double score, double k)
+{
+	return 1.0 / (1.0 + pow(10.0, -k*score / 400.0));
+}
+
+// Score for white.
+static inline int whiteScore(Evaluation& eval, ChessBoard& cb)
+{
+	int score = eval.evaluate(cb, -MATE, MATE);
+	return (cb.toMove == WHITE) ? score : -score;
+}
+
+unsigned __stdcall TunerWorker(void* lpv)
+{
+	TunerJob* job = (TunerJob*)lpv;
+	Tuner* t = job->tuner;
+	const int n = Tuner::parameters + 1;
+	Evaluation eval;
+	ChessBoard cb;
+	vector<double> delta(Tuner::parameters);
+	double r, s, q, f;
+	float* c;
+	size_t i;
+	int j, plus, minus;
+
+	job->sum.assign(n, 0.0);
+	if ((job->job == JOB_EVALERROR) || (job->job == JOB_CACHE))
+		t->setValues(eval, t->baseline);
+	for (j = 0; j < Tuner::parameters; j++)
+		delta[j] = t->value[j] - t->baseline[j];
+
+	for (i = job->start; i < job->end; i++)
+	{
+		const TunePosition& p = t->positions[i];
+		r = p.result / 2.0;
+		if (job->job != JOB_EVALERROR)
+			c = &t->cache[i*n];
+		switch (job->job)
+		{
+		case JOB_EVALERROR:
+			p.unpack(cb);
+			s = sigmoid(whiteScore(eval, cb), t->k);
+			job->sum[0] += (r - s)*(r - s);
+			break;
+		case JOB_CACHE:
+			p.unpack(cb);
+			c[0] = (float)whiteScore(eval, cb);
+			for (j = 0; j < Tuner::parameters; j++)
+			{
+				c[j + 1] = 0;
+				if (!Tuner::parameter[j].tune)
+					continue;
+				int& v = eval.*(Tuner::parameter[j].value);
+				++v;
+				plus = whiteScore(eval, cb);
+				v -= 2;
+				minus = whiteScore(eval, cb);
+				++v;
+				c[j + 1] = (float)((plus - minus) / 2.0);
+			}
+			break;
+		case JOB_CACHEERROR:
+			s = sigmoid(c[0], t->k);
+			job->sum[0] += (r - s)*(r - s);
+			break;
+		case JOB_GRADIENT:
+			q = c[0];
+			for (j = 0; j < Tuner::parameters; j++)
+				q += c[j + 1] * delta[j];
+			s = sigmoid(q, t->k);
+			job->sum[0] += (r - s)*(r - s);
+			f = (s - r)*s*(1 - s);
+			for (j = 0; j < Tuner::parameters; j++)
+				job->sum[j + 1] += f*c[j + 1];
+			break;
+		}
+	}
+	return 0;
+}
+
+Tuner::Tuner()
+{
+	int i;
+	SYSTEM_INFO si;
+	GetSystemInfo(&si);
+	threads = si.dwNumberOfProcessors;
+	iterations = 1000;
+	relinearize = 100;
+	learningRate = 1.0;
+	k = 1.0;
+	tuneError = 0;
+	progress = NULL;
+	progressData = NULL;
+
+	// Start with the values in the engine.
+	Evaluation eval;
+	for (i = 0; i < parameters; i++)
+		value.push_back(eval.*(parameter[i].value));
+	baseline = value;
+}
+
+Tuner::~Tuner()
+{
+}
+
+void Tuner::setValues(Evaluation& eval, const std::vector<double>& v)
+{
+	int i;
+	for (i = 0; i < parameters; i++)
+		eval.*(parameter[i].value) = (int)floor(v[i] + 0.5);
+}
+
+bool Tuner::load(const std::string& file)
+{
+	ChessBoard cb;
+	MoveGenerator mgen;
+	TunePosition p;
+	string line, fen;
+	int r;
+
+	filename = file;
+	ifstream f(file);
+	if (!f.is_open())
+	{
+		error = "Unable to open: " + file;
+		return false;
+	}
+	positions.clear();
+	while (getline(f, line))
+	{
+		if (line.find("1/2-1/2") != string::npos || line.find("[0.5]") != string::npos)
+			r = 1;
+		else if (line.find("1-0") != string::npos || line.find("[1.0]") != string::npos)
+			r = 2;
+		else if (line.find("0-1") != string::npos || line.find("[0.0]") != string::npos)
+			r = 0;
+		else
+			continue;
+		fen = getWord(line, 1) + " " + getWord(line, 2) + " " + getWord(line, 3) + " " + getWord(line, 4);
+		cb.setFen(fen.c_str());
+		if (mgen.inCheck(cb, cb.toMove))
+			continue;
+		p.pack(cb, r);
+		positions.push_back(p);
+	}
+	if (!positions.size())
+	{
+		error = "No positions with a result in: " + file;
+		return false;
+	}
+	return true;
+}
+
+void Tuner::runThreads(int job, std::vector<double>& sums)
+{
+	vector<TunerJob> jobs;
+	vector<HANDLE> hThreads;
+	size_t i, count, start;
+	int j;
+
+	count = __max(1, __min((size_t)threads, (size_t)MAXIMUM_WAIT_OBJECTS));
+	jobs.resize(count);
+	start = 0;
+	for (i = 0; i < count; i++)
+	{
+		jobs[i].tuner = this;
+		jobs[i].job = job;
+		jobs[i].start = start;
+		jobs[i].end = (i == count - 1) ? positions.size() : start + positions.size() / count;
+		start = jobs[i].end;
+		hThreads.push_back((HANDLE)_beginthreadex(NULL, 0, TunerWorker, &jobs[i], 0, NULL));
+	}
+	WaitForMultipleObjects((DWORD)hThreads.size(), hThreads.data(), TRUE, INFINITE);
+	sums.assign(parameters + 1, 0.0);
+	for (i = 0; i < count; i++)
+	{
+		CloseHandle(hThreads[i]);
+		for (j = 0; j <= parameters; j++)
+			sums[j] += jobs[i].sum[j];
+	}
+}
+
+void Tuner::makeCache()
+{
+	vector<double> sums;
+	int i;
+	for (i = 0; i < parameters; i++)
+		baseline[i] = floor(value[i] + 0.5);
+	cache.resize(positions.size()*(parameters + 1));
+	runThreads(JOB_CACHE, sums);
+}
+
+double Tuner::cacheError()
+{
+	vector<double> sums;
+	runThreads(JOB_CACHEERROR, sums);
+	return sums[0] / positions.size();
+}
+
+double Tuner::evaluationError()
+{
+	vector<double> sums;
+	if (!positions.size())
+		return 0;
+	baseline = value;
+	runThreads(JOB_EVALERROR, sums);
+	return sums[0] / positions.size();
+}
+
+// The gradient of the mean squared error, from the cache.
+void Tuner::gradient(std::vector<double>& g)
+{
+	vector<double> sums;
+	int i;
+	runThreads(JOB_GRADIENT, sums);
+	tuneError = sums[0] / positions.size();
+	g.resize(parameters);
+	for (i = 0; i < parameters; i++)
+		g[i] = 2.0 * log(10.0) * k / 400.0 * sums[i + 1] / positions.size();
+}
+
+void Tuner::tune()
+{
+	const double beta1 = 0.9;
+	const double beta2 = 0.999;
+	vector<double> g, m, v;
+	double a, b, c, d, ec, ed;
+	int i, it;
+
+	if (!positions.size())
+		return;
+	makeCache();
+
+	// Find the k that gives the lowest error (golden section search).
+	a = 0.1;
+	b = 4.0;
+	c = b - (b - a) / 1.618034;
+	d = a + (b - a) / 1.618034;
+	k = c;
+	ec = cacheError();
+	k = d;
+	ed = cacheError();
+	for (i = 0; i < 30; i++)
+	{
+		if (ec < ed)
+		{
+			b = d;
+			d = c;
+			ed = ec;
+			c = b - (b - a) / 1.618034;
+			k = c;
+			ec = cacheError();
+		}
+		else
+		{
+			a = c;
+			c = d;
+			ec = ed;
+			d = a + (b - a) / 1.618034;
+			k = d;
+			ed = cacheError();
+		}
+	}
+	k = (a + b) / 2;
+
+	// Adam
+	m.assign(parameters, 0.0);
+	v.assign(parameters, 0.0);
+	for (it = 1; it <= iterations; it++)
+	{
+		if ((it > 1) && (relinearize > 0) && !((it - 1) % relinearize))
+			makeCache();
+		gradient(g);
+		for (i = 0; i < parameters; i++)
+		{
+			if (!parameter[i].tune)
+				continue;
+			m[i] = beta1*m[i] + (1 - beta1)*g[i];
+			v[i] = beta2*v[i] + (1 - beta2)*g[i] * g[i];
+			value[i] -= learningRate * (m[i] / (1 - pow(beta1, it))) / (sqrt(v[i] / (1 - pow(beta2, it))) + 1e-12);
+		}
+		if (progress)
+			progress(*this, it, progressData);
+	}
+	for (i = 0; i < parameters; i++)
+		value[i] = floor(value[i] + 0.5);
+	tuneError = evaluationError();
+}
+
+// Write a personality file that the engine can read.
+bool Tuner::write(const std::string& file)
+{
+	char sz[256];
+	int i;
+	ofstream f(file, ios::trunc);
+	if (!f.is_open())
+	{
+		error = "Unable to create: " + file;
+		return false;
+	}
+	sprintf_s(sz, 256, "; Tuned with %u positions from %s, k %.3f, error %.6f", (unsigned int)positions.size(), filename.c_str(), k, tuneError);
+	f << sz << endl;
+	for (i = 0; i < parameters; i++)
+		f << "eval " << parameter[i].name << " " << getValue(i) << endl;
+	if (f.fail())
+	{
+		error = "Unable to write: " + file;
+		return false;
+	}
+	return true;
+}
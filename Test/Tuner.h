@@ -0,0 +1,78 @@
+#pragma once
+
+#include <Windows.h>
+#include <math.h>
+#include <string>
+#include <vector>
+#include "../Common/ChessBoard.h"
+#include "../Engine/Evaluation.h"
+
+// A labelled position packed to 34 bytes.
+struct TunePosition
+{
+	unsigned char squares[32]; // Two squares in each byte, a1 in the low bits of the first
+	unsigned char flags;       // Color to move in bit 0, castle rights above
+	unsigned char result;      // For white: 0=loss, 1=draw, 2=win
+	void pack(ChessBoard& cb, int r);
+	void unpack(ChessBoard& cb) const;
+};
+
+// An evaluation term that can be tuned, with the name used in the
+// personality file ('eval <name> <value>').
+struct TuneParameter
+{
+	const char* name;
+	int Evaluation::* value;
+	bool tune; // The pawn value is kept to set the scale.
+};
+
+// Texel tuning of the evaluation. The result of the games is predicted
+// from the evaluation with a sigmoid and the parameters are changed to get
+// the lowest squared error. The evaluation is not linear (the game stage
+// depends on the material), so the score and the change of the score for
+// each parameter is calculated for all positions and cached. The gradient
+// is then found from the cache, and the cache is made again every
+// relinearize iterations. All passes over the positions are split on
+// threads, each with its own Evaluation.
+class Tuner
+{
+	std::vector<TunePosition> positions;
+	// For each position: the score, then the change for each parameter.
+	std::vector<float> cache;
+	std::vector<double> value;    // Current values
+	std::vector<double> baseline; // Values the cache was made with
+	std::string error;
+	std::string filename;
+	friend unsigned __stdcall TunerWorker(void* lpv);
+	void makeCache();
+	double cacheError();
+	void gradient(std::vector<double>& g);
+	void runThreads(int job, std::vector<double>& sums);
+	void setValues(Evaluation& eval, const std::vector<double>& v);
+public:
+	int threads;
+	int iterations;
+	int relinearize;
+	double learningRate;
+	double k; // Sigmoid scale
+	double tuneError; // Mean squared error after the last iteration
+	static TuneParameter parameter[];
+	static const int parameters;
+	// Called after each iteration with progressData.
+	void(*progress)(Tuner& tuner, int iteration, void* data);
+	void* progressData;
+	Tuner();
+	virtual ~Tuner();
+	// Read an epd/fen file, one position in each line with the result as
+	// c9 "1-0"; (or 1-0, 0-1, 1/2-1/2, [1.0], [0.5], [0.0]) in the line.
+	// Positions with the side to move in check are skipped.
+	bool load(const std::string& filename);
+	inline size_t size() { return positions.size(); };
+	// Find k for the current values, then tune.
+	void tune();
+	// Error with the full evaluation.
+	double evaluationError();
+	inline int getValue(int i) { return (int)floor(value[i] + 0.5); };
+	bool write(const std::string& filename);
+	inline const std::string& lastError() { return error; };
+};
@@ -1,8 +1,1067 @@
 #include "MainWindow.h"
 #include <QApplication>
+#include <QFileInfo>
+#include <QElapsedTimer>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QVariant>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <map>
+#include "Match.h"
+#include "../Common/PgnPipeline.h"
+#include "../Common/MoveGenerator.h"
+#include "../Common/CompactGame.h"
+#include "../Common/GameBase.h"
+#include "../Common/PositionIndex.h"
+#include "../Common/GameSearch.h"
+#include "../Common/Utility.h"
+#include "TestRunner.h"
+#include "TestSet.h"
+#include "Tuner.h"
+
+// The program is built for the windows subsystem, write to the console it was started from.
+static void attachConsole()
+{
+	if (AttachConsole(ATTACH_PARENT_PROCESS))
+		freopen("CONOUT$", "w", stdout);
+}
+
+static void tuneProgress(Tuner& tuner, int iteration, void* data)
+{
+	int i;
+	if (iteration % 10)
+		return;
+	printf("Iteration %d, error %.6f:", iteration, tuner.tuneError);
+	for (i = 0; i < Tuner::parameters; i++)
+		printf(" %s=%d", Tuner::parameter[i].name, tuner.getValue(i));
+	printf("\n");
+	fflush(stdout);
+}
+
+// Test tune <epdfile> <perfile> [iterations]
+static int tuneMain(int argc, char *argv[])
+{
+	Tuner tuner;
+	attachConsole();
+	if (argc < 4)
+	{
+		printf("Usage: Test tune <epdfile> <perfile> [iterations]\n");
+		return 1;
+	}
+	if (argc > 4)
+		tuner.iterations = atoi(argv[4]);
+	if (!tuner.load(argv[2]))
+	{
+		printf("%s\n", tuner.lastError().c_str());
+		return 1;
+	}
+	printf("%u positions, error %.6f\n", (unsigned int)tuner.size(), tuner.evaluationError());
+	tuner.progress = tuneProgress;
+	tuner.tune();
+	printf("k %.3f, error %.6f\n", tuner.k, tuner.tuneError);
+	if (!tuner.write(argv[3]))
+	{
+		printf("%s\n", tuner.lastError().c_str());
+		return 1;
+	}
+	return 0;
+}
+
+// Test match <engine1.ini> <engine2.ini> [games n] [tc base+inc] [concurrency n] [openings file [plies n]]
+//   [pgn file] [sprt elo0 elo1] [alpha a] [beta b] [draw movenumber moves score] [resign moves score] [maxmoves n]
+static int matchMain(int argc, char *argv[])
+{
+	QCoreApplication app(argc, argv);
+	Match match;
+	MatchSettings& ms = match.settings;
+	const char* tc;
+	int i;
+
+	attachConsole();
+	if (argc < 4)
+	{
+		printf("Usage: Test match <engine1.ini> <engine2.ini> [games n] [tc base+inc] [concurrency n] [openings file [plies n]]\n");
+		printf("  [pgn file] [sprt elo0 elo1] [alpha a] [beta b] [draw movenumber moves score] [resign moves score] [maxmoves n]\n");
+		return 1;
+	}
+	ms.engine[0] = argv[2];
+	ms.engine[1] = argv[3];
+	for (i = 4; i < argc; i++)
+	{
+		if ((strcmp(argv[i], "games") == 0) && (i + 1 < argc))
+		{
+			ms.games = atoi(argv[++i]);
+		}
+		else if ((strcmp(argv[i], "tc") == 0) && (i + 1 < argc))
+		{
+			tc = argv[++i];
+			ms.baseTime = (int)(atof(tc) * 1000);
+			ms.increment = strchr(tc, '+') ? (int)(atof(strchr(tc, '+') + 1) * 1000) : 0;
+		}
+		else if ((strcmp(argv[i], "concurrency") == 0) && (i + 1 < argc))
+		{
+			ms.concurrency = atoi(argv[++i]);
+		}
+		else if ((strcmp(argv[i], "openings") == 0) && (i + 1 < argc))
+		{
+			ms.openingFile = argv[++i];
+		}
+		else if ((strcmp(argv[i], "plies") == 0) && (i + 1 < argc))
+		{
+			ms.openingPlies = atoi(argv[++i]);
+		}
+		else if ((strcmp(argv[i], "pgn") == 0) && (i + 1 < argc))
+		{
+			ms.pgnFile = argv[++i];
+		}
+		else if ((strcmp(argv[i], "sprt") == 0) && (i + 2 < argc))
+		{
+			ms.sprt = true;
+			ms.elo0 = atof(argv[++i]);
+			ms.elo1 = atof(argv[++i]);
+		}
+		else if ((strcmp(argv[i], "alpha") == 0) && (i + 1 < argc))
+		{
+			ms.alpha = atof(argv[++i]);
+		}
+		else if ((strcmp(argv[i], "beta") == 0) && (i + 1 < argc))
+		{
+			ms.beta = atof(argv[++i]);
+		}
+		else if ((strcmp(argv[i], "draw") == 0) && (i + 3 < argc))
+		{
+			ms.drawMoveNumber = atoi(argv[++i]);
+			ms.drawMoves = atoi(argv[++i]);
+			ms.drawScore = atoi(argv[++i]);
+		}
+		else if ((strcmp(argv[i], "resign") == 0) && (i + 2 < argc))
+		{
+			ms.resignMoves = atoi(argv[++i]);
+			ms.resignScore = atoi(argv[++i]);
+		}
+		else if ((strcmp(argv[i], "maxmoves") == 0) && (i + 1 < argc))
+		{
+			ms.maxMoves = atoi(argv[++i]);
+		}
+		else
+		{
+			printf("Unknown parameter: %s\n", argv[i]);
+			return 1;
+		}
+	}
+	QObject::connect(&match, SIGNAL(matchFinished()), &app, SLOT(quit()));
+	if (!match.start())
+	{
+		printf("%s\n", match.lastError().c_str());
+		return 1;
+	}
+	return app.exec();
+}
+
+// Runs of a testset with the positions gained and lost against the run
+// before with the same search limit.
+static void suiteReport(std::vector<TestRunSummary>& runs)
+{
+	std::map<QString, std::map<int, bool> > previous;
+	std::map<int, bool>::iterator it;
+	size_t i, j;
+	int gained, lost;
+	bool compare;
+
+	printf("%-4s %-16s %-20s %-16s %9s %6s %8s %6s %10s %s\n", "Run", "Engine", "Build", "Limit", "Solved", "Score", "Time", "Depth", "Nodes", "+/-");
+	for (i = 0; i < runs.size(); i++)
+	{
+		TestRunSummary& r = runs[i];
+		std::map<int, bool>& last = previous[r.searchlimit];
+		compare = !last.empty();
+		gained = lost = 0;
+		for (j = 0; j < r.result.size(); j++)
+		{
+			it = last.find(r.result[j].first);
+			if (it == last.end())
+				continue;
+			if (r.result[j].second && !it->second)
+				++gained;
+			else if (!r.result[j].second && it->second)
+				++lost;
+		}
+		printf("%-4u %-16s %-20s %-16s %4d/%-4d %6d %7.3fs %6.1f %10.0f", (unsigned int)i + 1, r.engine.toLatin1().constData(),
+			r.build.toLatin1().constData(), r.searchlimit.toLatin1().constData(), r.solved, r.positions, r.score,
+			r.solved ? r.time / r.solved / 1000.0 : 0.0, r.depth / r.positions, r.nodes / r.positions);
+		if (compare)
+			printf(" +%d -%d", gained, lost);
+		printf("\n");
+		last.clear();
+		for (j = 0; j < r.result.size(); j++)
+			last[r.result[j].first] = r.result[j].second;
+	}
+}
+
+// Test suite import <db> <epdfile> [name]
+// Test suite run <db> <name> <engine.ini> [movetime ms | nodes n | depth n] [concurrency n] [build name]
+// Test suite report <db> <name>
+static int suiteMain(int argc, char *argv[])
+{
+	QCoreApplication app(argc, argv);
+	TestSet ts;
+	TestRunner runner;
+	TestRunSettings& rs = runner.settings;
+	std::vector<TestRunSummary> runs;
+	QString name;
+	int i, setid, added, changed, removed;
+
+	attachConsole();
+	if ((argc < 5) || ((strcmp(argv[2], "run") == 0) && (argc < 6)))
+	{
+		printf("Usage: Test suite import <db> <epdfile> [name]\n");
+		printf("       Test suite run <db> <name> <engine.ini> [movetime ms | nodes n | depth n] [concurrency n] [build name]\n");
+		printf("       Test suite report <db> <name>\n");
+		return 1;
+	}
+	if (!ts.open(argv[3]))
+	{
+		printf("%s\n", ts.lastError().c_str());
+		return 1;
+	}
+
+	if (strcmp(argv[2], "import") == 0)
+	{
+		name = (argc > 5) ? argv[5] : QFileInfo(argv[4]).completeBaseName();
+		if (!ts.importEpd(argv[4], name, added, changed, removed))
+		{
+			printf("%s\n", ts.lastError().c_str());
+			return 1;
+		}
+		printf("%s: %d added, %d changed, %d removed.\n", name.toLatin1().constData(), added, changed, removed);
+		return 0;
+	}
+
+	setid = ts.setId(argv[4]);
+	if (setid < 0)
+	{
+		printf("No testset: %s\n", argv[4]);
+		return 1;
+	}
+	if (strcmp(argv[2], "report") == 0)
+	{
+		if (!ts.summary(setid, runs))
+		{
+			printf("%s\n", ts.lastError().c_str());
+			return 1;
+		}
+		suiteReport(runs);
+		return 0;
+	}
+	if (strcmp(argv[2], "run") != 0)
+	{
+		printf("Unknown command: %s\n", argv[2]);
+		return 1;
+	}
+
+	rs.engine = argv[5];
+	for (i = 6; i < argc; i++)
+	{
+		if ((strcmp(argv[i], "movetime") == 0) && (i + 1 < argc))
+		{
+			rs.searchtype = TIME_SEARCH;
+			rs.limit = atoi(argv[++i]);
+		}
+		else if ((strcmp(argv[i], "nodes") == 0) && (i + 1 < argc))
+		{
+			rs.searchtype = NODES_SEARCH;
+			rs.limit = atoi(argv[++i]);
+		}
+		else if ((strcmp(argv[i], "depth") == 0) && (i + 1 < argc))
+		{
+			rs.searchtype = DEPTH_SEARCH;
+			rs.limit = atoi(argv[++i]);
+		}
+		else if ((strcmp(argv[i], "concurrency") == 0) && (i + 1 < argc))
+		{
+			rs.concurrency = atoi(argv[++i]);
+		}
+		else if ((strcmp(argv[i], "build") == 0) && (i + 1 < argc))
+		{
+			rs.build = argv[++i];
+		}
+		else
+		{
+			printf("Unknown parameter: %s\n", argv[i]);
+			return 1;
+		}
+	}
+	QObject::connect(&runner, SIGNAL(runFinished()), &app, SLOT(quit()));
+	if (!runner.start(ts, setid))
+	{
+		printf("%s\n", runner.lastError().c_str());
+		return 1;
+	}
+	if (!runner.count())
+		return 0;
+	return app.exec();
+}
+
+// Test pgn <pgnfile> [maxmove n] [unordered] [threads n...]
+// Time making the .pgi game index and loading it again when the file is
+// opened the next time, then reading all games with Pgn::read and with the
+// pipeline.
+static int pgnMain(int argc, char *argv[])
+{
+	std::vector<int> threads;
+	QElapsedTimer watch;
+	ChessGame game;
+	DWORD index, games;
+	int i, maxmove = 999;
+	bool ordered = true;
+	double s;
+
+	attachConsole();
+	if (argc < 3)
+	{
+		printf("Usage: Test pgn <pgnfile> [maxmove n] [unordered] [threads n...]\n");
+		return 1;
+	}
+	for (i = 3; i < argc; i++)
+	{
+		if ((strcmp(argv[i], "maxmove") == 0) && (i + 1 < argc))
+		{
+			maxmove = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "unordered") == 0)
+		{
+			ordered = false;
+		}
+		else if (strcmp(argv[i], "threads") == 0)
+		{
+			while ((i + 1 < argc) && (atoi(argv[i + 1]) > 0))
+				threads.push_back(atoi(argv[++i]));
+		}
+		else
+		{
+			printf("Unknown parameter: %s\n", argv[i]);
+			return 1;
+		}
+	}
+	if (!threads.size())
+		threads = { 1, 2, 4, 8, 16 };
+
+	// The index is made by the first open and loaded by the second.
+	Pgn pgn;
+	DeleteFileA((std::string(argv[2]) + ".pgi").c_str());
+	for (i = 0; i < 2; i++)
+	{
+		if (i)
+			pgn.close();
+		if (!pgn.open(argv[2], true))
+		{
+			printf("Unable to open: %s\n", argv[2]);
+			return 1;
+		}
+		pgn.saveIndex(true);
+		watch.start();
+		games = pgn.size();
+		s = watch.elapsed() / 1000.0;
+		printf("Pgn index %s: %u games %.2fs\n", i ? "loaded" : "made", games, s);
+	}
+	fflush(stdout);
+
+	// Pgn::read
+	watch.start();
+	for (games = 0; pgn.read(game, games + 1, maxmove, false); games++);
+	s = watch.elapsed() / 1000.0;
+	printf("Pgn::read: %u games %.2fs %.0f games/s\n", games, s, (s > 0) ? games / s : 0);
+	fflush(stdout);
+	pgn.close();
+
+	for (i = 0; i < threads.size(); i++)
+	{
+		PgnPipeline pipeline;
+		pipeline.threads = threads[i];
+		pipeline.ordered = ordered;
+		pipeline.maxmove = maxmove;
+		pipeline.expandnag = false;
+		watch.start();
+		if (!pipeline.start(argv[2]))
+		{
+			printf("%s\n", pipeline.lastError().c_str());
+			return 1;
+		}
+		for (games = 0; pipeline.next(game, index); games++);
+		s = watch.elapsed() / 1000.0;
+		printf("%2d threads: %u games %.2fs %.0f games/s %.1f MB/s\n", threads[i], games, s, (s > 0) ? games / s : 0,
+			(s > 0) ? pipeline.size() / s / 1000000 : 0);
+		fflush(stdout);
+	}
+	return 0;
+}
+
+// Test movetext <pgnfile> [maxmove n]
+// Time writing the legal moves in the positions of the games in SAN, LAN and
+// UCI with ChessBoard::makeMoveText, and reading them back with
+// ChessBoard::getMoveFromText.
+static int movetextMain(int argc, char *argv[])
+{
+	const int types[] = { SAN, LAN, UCI };
+	std::vector<ChessBoard> boards;
+	std::vector<int> board;
+	std::vector<std::string> texts;
+	std::vector<ChessMove> moves, read;
+	QElapsedTimer watch;
+	MoveGenerator gen;
+	MoveList* ml = new MoveList;
+	ChessGame game;
+	ChessBoard cb;
+	Pgn pgn;
+	DWORD games;
+	qint64 ns = 0, nsWrite = 0;
+	unsigned __int64 count = 0, errors = 0;
+	int i, j, maxmove = 999;
+	double s;
+
+	attachConsole();
+	if (argc < 3)
+	{
+		printf("Usage: Test movetext <pgnfile> [maxmove n]\n");
+		return 1;
+	}
+	if ((argc > 4) && (strcmp(argv[3], "maxmove") == 0))
+		maxmove = atoi(argv[4]);
+	if (!pgn.open(argv[2], true))
+	{
+		printf("Unable to open: %s\n", argv[2]);
+		return 1;
+	}
+	for (games = 0; pgn.read(game, games + 1, maxmove, false); games++)
+	{
+		boards.clear();
+		board.clear();
+		texts.clear();
+		moves.clear();
+		game.toStart();
+		do
+		{
+			game.getPosition(cb);
+			boards.push_back(cb);
+			gen.makeMoves(cb, *ml);
+			watch.start();
+			for (i = 0; i < ml->size(); i++)
+			{
+				for (j = 0; j < sizeof(types) / sizeof(types[0]); j++)
+				{
+					board.push_back((int)boards.size() - 1);
+					texts.push_back(cb.makeMoveText(ml->at(i), types[j]));
+					moves.push_back(ml->at(i));
+				}
+			}
+			nsWrite += watch.nsecsElapsed();
+		} while (game.doMove(0));
+
+		read.resize(texts.size());
+		watch.start();
+		for (i = 0; i < texts.size(); i++)
+			read[i] = boards[board[i]].getMoveFromText(texts[i]);
+		ns += watch.nsecsElapsed();
+		count += texts.size();
+		for (i = 0; i < texts.size(); i++)
+		{
+			if (read[i].score || (read[i] != moves[i]))
+			{
+				if (errors++ < 10)
+					printf("Game %u: %s %s\n", games + 1, boards[board[i]].getFen().c_str(), texts[i].c_str());
+			}
+		}
+	}
+	delete ml;
+	s = nsWrite / 1e9;
+	printf("%u games, %llu moves\n", games, count);
+	printf("makeMoveText: %.2fs %.0f moves/s\n", s, (s > 0) ? count / s : 0);
+	s = ns / 1e9;
+	printf("getMoveFromText: %.2fs %.0f moves/s, %llu errors\n", s, (s > 0) ? count / s : 0, errors);
+	return errors ? 1 : 0;
+}
+
+// Bytes used by a ChessGame, strings in the short string buffer not counted.
+static size_t gameMemory(const ChessGame& game)
+{
+	const std::string* info = &game.info.Event;
+	size_t i, j, n = sizeof(ChessGame);
+	for (i = 0; i < sizeof(ChessGameInfo) / sizeof(std::string); i++)
+		if (info[i].capacity() > 15)
+			n += info[i].capacity() + 1;
+	n += game.position.capacity() * sizeof(ChessGamePosition);
+	for (i = 0; i < game.position.size(); i++)
+	{
+		const ChessGamePosition& cgp = game.position[i];
+		if (cgp.comment.capacity() > 15)
+			n += cgp.comment.capacity() + 1;
+		n += cgp.move.capacity() * sizeof(ChessGameMove);
+		for (j = 0; j < cgp.move.size(); j++)
+			if (cgp.move[j].comment.capacity() > 15)
+				n += cgp.move[j].comment.capacity() + 1;
+	}
+	return n;
+}
+
+// Test compact <pgnfile> [maxmove n]
+// Convert the games to CompactGame and back, check that the pgn and the
+// boards of the main line are the same and compare the memory used.
+static int compactMain(int argc, char *argv[])
+{
+	std::vector<ChessGame> games;
+	std::vector<CompactGame> compact;
+	QElapsedTimer watch;
+	PgnPipeline pipeline;
+	ChessGame game;
+	ChessBoard cb;
+	DWORD index;
+	size_t i, gameBytes = 0, compactBytes = 0, errors = 0;
+	unsigned __int64 boards = 0;
+	int ply, pos;
+	double sSet, sGet, sBoard;
+
+	attachConsole();
+	if (argc < 3)
+	{
+		printf("Usage: Test compact <pgnfile> [maxmove n]\n");
+		return 1;
+	}
+	if ((argc > 4) && (strcmp(argv[3], "maxmove") == 0))
+		pipeline.maxmove = atoi(argv[4]);
+	pipeline.expandnag = false;
+	if (!pipeline.start(argv[2]))
+	{
+		printf("%s\n", pipeline.lastError().c_str());
+		return 1;
+	}
+	while (pipeline.next(game, index))
+		games.push_back(std::move(game));
+	for (i = 0; i < games.size(); i++)
+		gameBytes += gameMemory(games[i]);
+
+	compact.resize(games.size());
+	watch.start();
+	for (i = 0; i < games.size(); i++)
+		compact[i].set(games[i]);
+	sSet = watch.nsecsElapsed() / 1e9;
+	for (i = 0; i < compact.size(); i++)
+		compactBytes += compact[i].memory();
+
+	// Every board of the main line, from the nearest checkpoint.
+	watch.start();
+	for (i = 0; i < compact.size(); i++)
+	{
+		pos = 0;
+		for (ply = 0; ply <= compact[i].mainMoves(); ply++)
+		{
+			if (!compact[i].getBoard(0, ply, cb) || (cb != games[i].position[pos].board))
+			{
+				if (errors++ < 10)
+					printf("Game %u: board %d differs\n", (unsigned)(i + 1), ply);
+			}
+			if (ply < compact[i].mainMoves())
+				pos = games[i].position[pos].move[0].posIndex;
+			++boards;
+		}
+	}
+	sBoard = watch.nsecsElapsed() / 1e9;
+
+	watch.start();
+	for (i = 0; i < compact.size(); i++)
+	{
+		if (!compact[i].get(game) || (game.toString() != games[i].toString()))
+		{
+			if (errors++ < 10)
+				printf("Game %u differs\n", (unsigned)(i + 1));
+		}
+	}
+	sGet = watch.nsecsElapsed() / 1e9;
+
+	printf("%u games\n", (unsigned)games.size());
+	printf("ChessGame: %.1f MB, %.0f bytes/game\n", gameBytes / 1e6, games.size() ? (double)gameBytes / games.size() : 0);
+	printf("CompactGame: %.1f MB, %.0f bytes/game\n", compactBytes / 1e6, games.size() ? (double)compactBytes / games.size() : 0);
+	printf("set: %.2fs %.0f games/s\n", sSet, (sSet > 0) ? games.size() / sSet : 0);
+	printf("get: %.2fs %.0f games/s (with the pgn compare)\n", sGet, (sGet > 0) ? games.size() / sGet : 0);
+	printf("getBoard: %.2fs %.0f boards/s\n", sBoard, (sBoard > 0) ? boards / sBoard : 0);
+	printf("%u errors\n", (unsigned)errors);
+	return errors ? 1 : 0;
+}
+
+// The header fields and the moves of the main line are the same.
+static bool sameMainLine(const ChessGame& g1, const ChessGame& g2)
+{
+	const std::string* info1 = &g1.info.Event;
+	const std::string* info2 = &g2.info.Event;
+	size_t i;
+	int p1 = 0, p2 = 0;
+	for (i = 0; i < sizeof(ChessGameInfo) / sizeof(std::string); i++)
+		if (info1[i] != info2[i])
+			return false;
+	if (!g1.position.size() || !g2.position.size() || (g1.position[0].board != g2.position[0].board))
+		return false;
+	while (g1.position[p1].move.size() && g2.position[p2].move.size())
+	{
+		if (CompactGame::encode(g1.position[p1].move[0].move) != CompactGame::encode(g2.position[p2].move[0].move))
+			return false;
+		p1 = g1.position[p1].move[0].posIndex;
+		p2 = g2.position[p2].move[0].posIndex;
+	}
+	return !g1.position[p1].move.size() && !g2.position[p2].move.size();
+}
+
+static void printRate(const char* what, DWORD games, double s)
+{
+	printf("%-22s %8u games %7.2fs %9.0f games/s %6.2fM games/min\n", what, games, s,
+		(s > 0) ? games / s : 0, (s > 0) ? games / s * 60 / 1e6 : 0);
+	fflush(stdout);
+}
+
+// Test gamebase <pgnfile> [random n]
+// Add the games in a pgn file to a GameBase and to a SQLite table with the
+// pgn text, as the Gui games table was made, and time adding the games,
+// reading all of them and reading games at random. The files are made
+// next to the pgn file.
+static int gamebaseMain(int argc, char *argv[])
+{
+	const char* ext[] = { ".gbh", ".gbm", ".gbo", ".gbn", ".gbs" };
+	std::string path, text;
+	std::vector<DWORD> order;
+	QElapsedTimer watch;
+	PgnPipeline pipeline;
+	GameBase base;
+	GameBaseEntry entry;
+	ChessGame game, copy;
+	Pgn pgn;
+	DWORD i, index, games, errors = 0, randomReads = 10000;
+	qint64 baseSize = 0;
+
+	attachConsole();
+	if (argc < 3)
+	{
+		printf("Usage: Test gamebase <pgnfile> [random n]\n");
+		return 1;
+	}
+	if ((argc > 4) && (strcmp(argv[3], "random") == 0))
+		randomReads = atoi(argv[4]);
+	path = std::string(argv[2]) + ".test";
+	for (i = 0; i < 5; i++)
+		DeleteFileA((path + ext[i]).c_str());
+	DeleteFileA((path + ".sqlite").c_str());
+
+	if (!base.open(path))
+	{
+		printf("%s\n", base.lastError().c_str());
+		return 1;
+	}
+	watch.start();
+	games = base.importPgn(argv[2]);
+	printRate("GameBase import:", games, watch.nsecsElapsed() / 1e9);
+	if (!games)
+	{
+		printf("%s\n", base.lastError().c_str());
+		return 1;
+	}
+	for (i = 0; i < 5; i++)
+		baseSize += QFileInfo(QString::fromStdString(path + ext[i])).size();
+
+	watch.start();
+	for (i = 1; i <= games; i++)
+		base.readEntry(i, entry);
+	printRate("GameBase headers:", games, watch.nsecsElapsed() / 1e9);
+	watch.start();
+	for (i = 1; i <= games; i++)
+		base.read(i, game);
+	printRate("GameBase games:", games, watch.nsecsElapsed() / 1e9);
+	for (i = 0; i < randomReads; i++)
+		order.push_back(rand32() % games + 1);
+	watch.start();
+	for (i = 0; i < order.size(); i++)
+		base.read(order[i], game);
+	printRate("GameBase random:", (DWORD)order.size(), watch.nsecsElapsed() / 1e9);
+
+	// Check the games against the pgn file.
+	pipeline.expandnag = false;
+	if (!pipeline.start(argv[2]))
+	{
+		printf("%s\n", pipeline.lastError().c_str());
+		return 1;
+	}
+	while (pipeline.next(game, index))
+	{
+		if (!base.read(index, copy) || !sameMainLine(game, copy))
+		{
+			if (errors++ < 10)
+				printf("Game %u differs\n", index);
+		}
+	}
+	base.close();
+
+	// The same with the pgn text in SQLite.
+	{
+		QSqlDatabase db = QSqlDatabase::addDatabase("QSQLITE", "gamebase");
+		db.setDatabaseName(QString::fromStdString(path + ".sqlite"));
+		if (!db.open())
+		{
+			printf("Unable to create: %s.sqlite\n", path.c_str());
+			return 1;
+		}
+		QSqlQuery query(db);
+		query.exec("CREATE TABLE games ( id INTEGER, event TEXT, site TEXT, white TEXT, black TEXT, date TEXT, "
+			"result TEXT, whiteelo TEXT, blackelo TEXT, eco TEXT, movetext BLOB, PRIMARY KEY(id));");
+		watch.start();
+		pipeline.start(argv[2]);
+		db.transaction();
+		query.prepare("INSERT INTO games (id, event, site, white, black, date, result, whiteelo, blackelo, eco, movetext) "
+			"VALUES (?, ?, ?, ?, ?, ?, ?, ?, ?, ?, ?);");
+		while (pipeline.next(game, index))
+		{
+			text = pgn.toString(game);
+			query.addBindValue((uint)index);
+			query.addBindValue(QString::fromStdString(game.info.Event));
+			query.addBindValue(QString::fromStdString(game.info.Site));
+			query.addBindValue(QString::fromStdString(game.info.White));
+			query.addBindValue(QString::fromStdString(game.info.Black));
+			query.addBindValue(QString::fromStdString(game.info.Date));
+			query.addBindValue(QString::fromStdString(game.info.Result));
+			query.addBindValue(QString::fromStdString(game.info.WhiteElo));
+			query.addBindValue(QString::fromStdString(game.info.BlackElo));
+			query.addBindValue(QString::fromStdString(game.info.ECO));
+			query.addBindValue(QByteArray(text.data(), (int)text.size()));
+			query.exec();
+		}
+		db.commit();
+		printRate("SQLite import:", games, watch.nsecsElapsed() / 1e9);
+
+		watch.start();
+		query.exec("SELECT white, black, date, result FROM games ORDER BY id;");
+		while (query.next())
+			text = query.value(0).toString().toStdString();
+		printRate("SQLite headers:", games, watch.nsecsElapsed() / 1e9);
+		watch.start();
+		query.exec("SELECT movetext FROM games ORDER BY id;");
+		while (query.next())
+		{
+			QByteArray b = query.value(0).toByteArray();
+			pgn.parseGame(b.constData(), b.size(), game, 999, false);
+		}
+		printRate("SQLite games:", games, watch.nsecsElapsed() / 1e9);
+		watch.start();
+		query.prepare("SELECT movetext FROM games WHERE id = ?;");
+		for (i = 0; i < order.size(); i++)
+		{
+			query.addBindValue((uint)order[i]);
+			query.exec();
+			if (query.next())
+			{
+				QByteArray b = query.value(0).toByteArray();
+				pgn.parseGame(b.constData(), b.size(), game, 999, false);
+			}
+		}
+		printRate("SQLite random:", (DWORD)order.size(), watch.nsecsElapsed() / 1e9);
+		db.close();
+	}
+	QSqlDatabase::removeDatabase("gamebase");
+
+	printf("GameBase: %.1f MB, %.0f bytes/game\n", baseSize / 1e6, (double)baseSize / games);
+	baseSize = QFileInfo(QString::fromStdString(path + ".sqlite")).size();
+	printf("SQLite:   %.1f MB, %.0f bytes/game\n", baseSize / 1e6, (double)baseSize / games);
+	printf("%u errors\n", errors);
+	return errors ? 1 : 0;
+}
+
+// Test positions <pgnfile> [queries n]
+// Make a position index for the games in a pgn file and time finding the
+// games of positions taken at random from the games. Each game is checked
+// to be in the hits of its own position, and the hits of the first queries
+// are replayed to see that they reach the position.
+static int positionsMain(int argc, char *argv[])
+{
+	std::string path;
+	std::vector<ChessBoard> boards;
+	std::vector<PositionHit> query, hits;
+	std::vector<PositionMove> next;
+	std::vector<ChessMove> moves;
+	QElapsedTimer watch;
+	GameBase base;
+	PositionIndex index;
+	ChessBoard start, cb;
+	MoveGenerator gen;
+	PositionHit hit;
+	DWORD i, j, k, games, queries = 10000, errors = 0, checked = 0;
+	unsigned __int64 totalHits = 0;
+	double s, slowest = 0;
+
+	attachConsole();
+	if (argc < 3)
+	{
+		printf("Usage: Test positions <pgnfile> [queries n]\n");
+		return 1;
+	}
+	if ((argc > 4) && (strcmp(argv[3], "queries") == 0))
+		queries = atoi(argv[4]);
+	path = std::string(argv[2]) + ".test";
+	if (!base.open(path) || !index.open(path))
+	{
+		printf("Unable to open: %s\n", path.c_str());
+		return 1;
+	}
+	if (!base.size())
+	{
+		watch.start();
+		games = base.importPgn(argv[2]);
+		printRate("GameBase import:", games, watch.nsecsElapsed() / 1e9);
+	}
+	games = base.size();
+	if (!games)
+	{
+		printf("%s\n", base.lastError().c_str());
+		return 1;
+	}
+
+	index.clear();
+	watch.start();
+	if (!index.update(base) || !index.flush())
+	{
+		printf("%s\n", index.lastError().c_str());
+		return 1;
+	}
+	printRate("Index update:", games, watch.nsecsElapsed() / 1e9);
+	printf("Index: %.1f MB, %.0f bytes/game\n", index.fileSize() / 1e6, (double)index.fileSize() / games);
+
+	// The positions to find, giving up if the games can't be read.
+	for (k = 0; (query.size() < queries) && (k < queries * 10); k++)
+	{
+		hit.game = rand32() % games + 1;
+		if (!base.readMoves(hit.game, start, moves))
+			continue;
+		hit.ply = (WORD)(rand32() % (moves.size() + 1));
+		cb = start;
+		for (j = 0; j < hit.ply; j++)
+		{
+			if (moves[j].moveType&NULL_MOVE)
+				gen.doNullMove(cb, moves[j]);
+			else
+				gen.doMove(cb, moves[j]);
+		}
+		query.push_back(hit);
+		boards.push_back(cb);
+	}
+	if (query.size() < queries)
+	{
+		printf("Unable to read the moves of the games\n");
+		return 1;
+	}
+
+	watch.start();
+	for (i = 0; i < query.size(); i++)
+	{
+		s = watch.nsecsElapsed() / 1e9;
+		index.find(boards[i], hits);
+		s = watch.nsecsElapsed() / 1e9 - s;
+		if (s > slowest)
+			slowest = s;
+		totalHits += hits.size();
+		for (j = 0; (j < hits.size()) && ((hits[j].game != query[i].game) || (hits[j].ply != query[i].ply)); j++);
+		if (j == hits.size())
+		{
+			if (errors++ < 10)
+				printf("Game %u ply %u not found\n", query[i].game, query[i].ply);
+		}
+	}
+	s = watch.nsecsElapsed() / 1e9;
+	printf("Find: %u positions %.2fs, %.3f ms/position, slowest %.3f ms, %.1f hits/position\n", (DWORD)query.size(), s,
+		query.size() ? s * 1000 / query.size() : 0, slowest * 1000, query.size() ? (double)totalHits / query.size() : 0);
+
+	// Replay the hits, another move order to the position is a transposition.
+	for (i = 0; (i < query.size()) && (i < 1000); i++)
+	{
+		index.find(boards[i], hits, 100);
+		for (j = 0; j < hits.size(); j++)
+		{
+			base.readMoves(hits[j].game, start, moves);
+			cb = start;
+			for (k = 0; (k < hits[j].ply) && (k < moves.size()); k++)
+			{
+				if (moves[k].moveType&NULL_MOVE)
+					gen.doNullMove(cb, moves[k]);
+				else
+					gen.doMove(cb, moves[k]);
+			}
+			++checked;
+			if (PositionIndex::key(cb) != PositionIndex::key(boards[i]))
+			{
+				if (errors++ < 10)
+					printf("Game %u ply %u is not the position\n", hits[j].game, hits[j].ply);
+			}
+		}
+	}
+	printf("%u hits replayed\n", checked);
+
+	cb.setStartposition();
+	watch.start();
+	index.nextMoves(base, cb, next, 10000);
+	s = watch.nsecsElapsed() / 1e9;
+	printf("Start position, %.3f ms for the moves of 10000 games:\n", s * 1000);
+	for (i = 0; (i < next.size()) && (i < 5); i++)
+		printf("  %-6s %6u games +%u =%u -%u\n", cb.makeMoveText(next[i].move, SAN).c_str(), next[i].games,
+			next[i].whiteWins, next[i].draws, next[i].blackWins);
+	printf("%u errors\n", errors);
+	return errors ? 1 : 0;
+}
+
+// Test search <pgnfile> [material pattern]
+// Find games in a GameBase made from a pgn file by material and by pawn
+// structure. The material hits are checked against replaying all games,
+// and the pawn structure of a game at the first signature ply must find
+// the game.
+static int searchMain(int argc, char *argv[])
+{
+	const char* patterns[] = { "R vs BP*", "Q vs R", "RP* vs RP*", "BP* vs NP*", "K vs K" };
+	std::vector<std::string> material;
+	std::vector<PositionHit> hits;
+	std::vector<ChessMove> moves;
+	std::vector<DWORD> expected;
+	QElapsedTimer watch;
+	GameBase base;
+	GameSearch search;
+	MaterialPattern pattern;
+	ChessBoard start, cb;
+	MoveGenerator gen;
+	DWORD i, j, ply, games, found, errors = 0, queries = 0;
+	double s, pawnTime = 0;
+
+	attachConsole();
+	if (argc < 3)
+	{
+		printf("Usage: Test search <pgnfile> [material pattern]\n");
+		return 1;
+	}
+	if (argc > 3)
+		material.push_back(argv[3]);
+	else
+		material.assign(patterns, patterns + sizeof(patterns) / sizeof(patterns[0]));
+	if (!base.open(std::string(argv[2]) + ".test"))
+	{
+		printf("%s\n", base.lastError().c_str());
+		return 1;
+	}
+	if (!base.size())
+	{
+		watch.start();
+		games = base.importPgn(argv[2]);
+		printRate("GameBase import:", games, watch.nsecsElapsed() / 1e9);
+	}
+	games = base.size();
+	if (!games)
+	{
+		printf("%s\n", base.lastError().c_str());
+		return 1;
+	}
+
+	for (i = 0; i < material.size(); i++)
+	{
+		if (!pattern.set(material[i]))
+		{
+			printf("Not a material pattern: %s\n", material[i].c_str());
+			return 1;
+		}
+		search.clear();
+		search.setMaterial(pattern);
+		watch.start();
+		search.find(base, hits);
+		s = watch.nsecsElapsed() / 1e9;
+		printf("%-12s %8u games %8u candidates %7.2fs %6.2fM games/s\n", material[i].c_str(), (DWORD)hits.size(),
+			search.candidates, s, (s > 0) ? games / s / 1e6 : 0);
+		fflush(stdout);
+
+		// The first ply of each game with the material.
+		expected.clear();
+		for (j = 1; j <= games; j++)
+		{
+			if (!base.readMoves(j, start, moves))
+				continue;
+			cb = start;
+			for (ply = 0; ply <= moves.size(); ply++)
+			{
+				if (pattern.match(cb))
+				{
+					expected.push_back(j);
+					expected.push_back(ply);
+					break;
+				}
+				if (ply == moves.size())
+					break;
+				if (moves[ply].moveType&NULL_MOVE)
+					gen.doNullMove(cb, moves[ply]);
+				else
+					gen.doMove(cb, moves[ply]);
+			}
+		}
+		for (j = 0; j < hits.size(); j++)
+			if ((2 * j + 1 >= expected.size()) || (hits[j].game != expected[2 * j]) || (hits[j].ply != expected[2 * j + 1]))
+				break;
+		if ((j < hits.size()) || (2 * hits.size() != expected.size()))
+		{
+			++errors;
+			printf("%s: %u games found, %u games by replaying\n", material[i].c_str(), (DWORD)hits.size(), (DWORD)expected.size() / 2);
+		}
+	}
+
+	// The pawns of games at the first ply in the signature.
+	search.clear();
+	for (i = 0; (i < 1000) && (i < games * 10); i++)
+	{
+		j = rand32() % games + 1;
+		if (!base.readMoves(j, start, moves) || (moves.size() < GAMEBASE_PAWNPLY[0]))
+			continue;
+		cb = start;
+		for (ply = 0; ply < GAMEBASE_PAWNPLY[0]; ply++)
+		{
+			if (moves[ply].moveType&NULL_MOVE)
+				gen.doNullMove(cb, moves[ply]);
+			else
+				gen.doMove(cb, moves[ply]);
+		}
+		search.setPawns(cb);
+		watch.start();
+		search.find(base, hits);
+		pawnTime += watch.nsecsElapsed() / 1e9;
+		++queries;
+		for (found = 0; (found < hits.size()) && (hits[found].game != j); found++);
+		if ((found == hits.size()) || (hits[found].ply > GAMEBASE_PAWNPLY[0]))
+		{
+			if (errors++ < 10)
+				printf("Pawns of game %u not found\n", j);
+		}
+	}
+	printf("Pawns: %u searches, %.3fs/search, %.2fM games/s\n", queries, queries ? pawnTime / queries : 0,
+		(pawnTime > 0) ? (double)games * queries / pawnTime / 1e6 : 0);
+	printf("%u errors\n", errors);
+	return errors ? 1 : 0;
+}
 
 int main(int argc, char *argv[])
 {
+	if ((argc > 1) && (strcmp(argv[1], "tune") == 0))
+		return tuneMain(argc, argv);
+	if ((argc > 1) && (strcmp(argv[1], "match") == 0))
+		return matchMain(argc, argv);
+	if ((argc > 1) && (strcmp(argv[1], "suite") == 0))
+		return suiteMain(argc, argv);
+	if ((argc > 1) && (strcmp(argv[1], "pgn") == 0))
+		return pgnMain(argc, argv);
+	if ((argc > 1) && (strcmp(argv[1], "movetext") == 0))
+		return movetextMain(argc, argv);
+	if ((argc > 1) && (strcmp(argv[1], "compact") == 0))
+		return compactMain(argc, argv);
+	if ((argc > 1) && (strcmp(argv[1], "gamebase") == 0))
+		return gamebaseMain(argc, argv);
+	if ((argc > 1) && (strcmp(argv[1], "positions") == 0))
+		return positionsMain(argc, argv);
+	if ((argc > 1) && (strcmp(argv[1], "search") == 0))
+		return searchMain(argc, argv);
+
 	QApplication app(argc, argv);
 	QCoreApplication::setOrganizationName("PolarChess");
 	QCoreApplication::setApplicationName("Test");